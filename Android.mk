@@ -30,11 +30,14 @@ sources := \
     	compile/PngCrunch.cpp \
     	compile/PseudolocaleGenerator.cpp \
     	compile/Pseudolocalizer.cpp \
+    	compile/StableIdMap.cpp \
     	compile/XmlIdCollector.cpp \
     	configuration/ConfigurationParser.cpp \
+    	diff/TableDigest.cpp \
     	filter/AbiFilter.cpp \
     	filter/ConfigFilter.cpp \
     	flatten/Archive.cpp \
+    	flatten/ResourceAccessProfile.cpp \
     	flatten/TableFlattener.cpp \
     	flatten/XmlFlattener.cpp \
     	io/BigBufferStreams.cpp \
@@ -45,6 +48,7 @@ sources := \
     	io/Util.cpp \
     	io/ZipArchive.cpp \
     	link/AutoVersioner.cpp \
+    	link/IncrementalLinkState.cpp \
     	link/ManifestFixer.cpp \
     	link/ProductFilter.cpp \
     	link/PrivateAttributeMover.cpp \
@@ -54,8 +58,10 @@ sources := \
     	link/XmlNamespaceRemover.cpp \
     	link/XmlReferenceLinker.cpp \
     	optimize/ResourceDeduper.cpp \
+    	optimize/TableOptimizer.cpp \
     	optimize/VersionCollapser.cpp \
     	process/SymbolTable.cpp \
+    	proto/LazyPbTable.cpp \
     	proto/ProtoHelpers.cpp \
     	proto/TableProtoDeserializer.cpp \
     	proto/TableProtoSerializer.cpp \
@@ -63,16 +69,20 @@ sources := \
     	text/Unicode.cpp \
     	text/Utf8Iterator.cpp \
     	unflatten/BinaryResourceParser.cpp \
+    	unflatten/BinaryTableIndex.cpp \
     	unflatten/ResChunkPullParser.cpp \
     	util/BigBuffer.cpp \
     	util/Files.cpp \
+    	util/ThreadPool.cpp \
     	util/Util.cpp \
     	ConfigDescription.cpp \
+    	ConfigInterner.cpp \
     	Debug.cpp \
     	DominatorTree.cpp \
     	Flags.cpp \
     	java/AnnotationProcessor.cpp \
     	java/ClassDefinition.cpp \
+    	java/ClassFileBuilder.cpp \
     	java/JavaClassGenerator.cpp \
     	java/ManifestClassGenerator.cpp \
     	java/ProguardRules.cpp \
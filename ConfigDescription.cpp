@@ -16,7 +16,9 @@
 
 #include "ConfigDescription.h"
 
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "androidfw/ResourceTypes.h"
@@ -33,6 +35,9 @@ namespace aapt {
 
 static const char* kWildcardName = "any";
 
+// The number of distinct strings whose parse results ConfigDescription::Parse() keeps.
+constexpr static size_t kMaxCachedParses = 4096u;
+
 const ConfigDescription& ConfigDescription::DefaultConfig() {
   static ConfigDescription config = {};
   return config;
@@ -643,7 +648,63 @@ static bool parseVersion(const char* name, ResTable_config* out) {
   return true;
 }
 
-bool ConfigDescription::Parse(const StringPiece& str, ConfigDescription* out) {
+using QualifierParseFunc = bool (*)(const char* name, ResTable_config* out);
+
+// The parsers of the qualifiers that follow the locale, in the order the qualifiers must appear in.
+static const QualifierParseFunc kQualifierParsers[] = {
+    parseLayoutDirection,  // 0
+    parseSmallestScreenWidthDp,
+    parseScreenWidthDp,
+    parseScreenHeightDp,
+    parseScreenLayoutSize,
+    parseScreenLayoutLong,  // 5
+    parseScreenRound,
+    parseWideColorGamut,
+    parseHdr,
+    parseOrientation,
+    parseUiModeType,  // 10
+    parseUiModeNight,
+    parseDensity,
+    parseTouchscreen,
+    parseKeysHidden,
+    parseKeyboard,  // 15
+    parseNavHidden,
+    parseNavigation,
+    parseScreenSize,
+    parseVersion,
+};
+
+constexpr static size_t kQualifierParserCount =
+    sizeof(kQualifierParsers) / sizeof(kQualifierParsers[0]);
+
+// The parsers in kQualifierParsers that accept nothing but the keywords in
+// GetQualifierKeywords() and the wildcard. They only need to be run for their own keywords.
+constexpr static uint32_t kKeywordOnlyParsers = ~((1u << 1) | (1u << 2) | (1u << 3) | (1u << 12) |
+                                                  (1u << 18) | (1u << 19));
+
+// Maps each qualifier keyword to the bit of the parser in kQualifierParsers that accepts it, so
+// that a keyword is matched with a single lookup instead of trying each parser in turn.
+static const std::unordered_map<std::string, uint32_t>& GetQualifierKeywords() {
+  static const std::unordered_map<std::string, uint32_t> keywords = {
+      {"ldltr", 1u << 0},       {"ldrtl", 1u << 0},       {"small", 1u << 4},
+      {"normal", 1u << 4},      {"large", 1u << 4},       {"xlarge", 1u << 4},
+      {"long", 1u << 5},        {"notlong", 1u << 5},     {"round", 1u << 6},
+      {"notround", 1u << 6},    {"widecg", 1u << 7},      {"nowidecg", 1u << 7},
+      {"highdr", 1u << 8},      {"lowdr", 1u << 8},       {"port", 1u << 9},
+      {"land", 1u << 9},        {"square", 1u << 9},      {"desk", 1u << 10},
+      {"car", 1u << 10},        {"television", 1u << 10}, {"appliance", 1u << 10},
+      {"watch", 1u << 10},      {"vrheadset", 1u << 10},  {"night", 1u << 11},
+      {"notnight", 1u << 11},   {"notouch", 1u << 13},    {"stylus", 1u << 13},
+      {"finger", 1u << 13},     {"keysexposed", 1u << 14}, {"keyshidden", 1u << 14},
+      {"keyssoft", 1u << 14},   {"nokeys", 1u << 15},     {"qwerty", 1u << 15},
+      {"12key", 1u << 15},      {"navexposed", 1u << 16}, {"navhidden", 1u << 16},
+      {"nonav", 1u << 17},      {"dpad", 1u << 17},       {"trackball", 1u << 17},
+      {"wheel", 1u << 17},
+  };
+  return keywords;
+}
+
+static bool ParseUncached(const StringPiece& str, ConfigDescription* out) {
   std::vector<std::string> parts = util::SplitAndLowercase(str, '-');
 
   ConfigDescription config;
@@ -654,185 +715,98 @@ bool ConfigDescription::Parse(const StringPiece& str, ConfigDescription* out) {
   auto part_iter = parts.begin();
 
   if (str.size() == 0) {
-    goto success;
+    *out = config;
+    return true;
   }
 
   if (parseMcc(part_iter->c_str(), &config)) {
     ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
-    }
   }
 
-  if (parseMnc(part_iter->c_str(), &config)) {
+  if (part_iter != parts_end && parseMnc(part_iter->c_str(), &config)) {
     ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
-    }
   }
 
   // Locale spans a few '-' separators, so we let it
   // control the index.
-  parts_consumed = locale.InitFromParts(part_iter, parts_end);
-  if (parts_consumed < 0) {
-    return false;
-  } else {
+  if (part_iter != parts_end) {
+    parts_consumed = locale.InitFromParts(part_iter, parts_end);
+    if (parts_consumed < 0) {
+      return false;
+    }
     locale.WriteTo(&config);
     part_iter += parts_consumed;
-    if (part_iter == parts_end) {
-      goto success;
-    }
-  }
-
-  if (parseLayoutDirection(part_iter->c_str(), &config)) {
-    ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
-    }
-  }
-
-  if (parseSmallestScreenWidthDp(part_iter->c_str(), &config)) {
-    ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
-    }
-  }
-
-  if (parseScreenWidthDp(part_iter->c_str(), &config)) {
-    ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
-    }
-  }
-
-  if (parseScreenHeightDp(part_iter->c_str(), &config)) {
-    ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
-    }
-  }
-
-  if (parseScreenLayoutSize(part_iter->c_str(), &config)) {
-    ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
-    }
-  }
-
-  if (parseScreenLayoutLong(part_iter->c_str(), &config)) {
-    ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
-    }
-  }
-
-  if (parseScreenRound(part_iter->c_str(), &config)) {
-    ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
-    }
-  }
-
-  if (parseWideColorGamut(part_iter->c_str(), &config)) {
-    ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
-    }
-  }
-
-  if (parseHdr(part_iter->c_str(), &config)) {
-    ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
-    }
-  }
-
-  if (parseOrientation(part_iter->c_str(), &config)) {
-    ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
-    }
-  }
-
-  if (parseUiModeType(part_iter->c_str(), &config)) {
-    ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
-    }
   }
 
-  if (parseUiModeNight(part_iter->c_str(), &config)) {
-    ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
+  // Each qualifier goes to the first parser, from the one after the parser of the previous
+  // qualifier, that accepts it. Parsers that only accept keywords are skipped unless the
+  // qualifier is one of their keywords.
+  const std::unordered_map<std::string, uint32_t>& keywords = GetQualifierKeywords();
+  size_t next_parser = 0;
+  for (; part_iter != parts_end; ++part_iter) {
+    uint32_t keyword_parsers = ~0u;
+    if (*part_iter != kWildcardName) {
+      auto keyword_iter = keywords.find(*part_iter);
+      keyword_parsers = keyword_iter != keywords.end() ? keyword_iter->second : 0u;
     }
-  }
 
-  if (parseDensity(part_iter->c_str(), &config)) {
-    ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
-    }
-  }
+    for (; next_parser < kQualifierParserCount; next_parser++) {
+      const uint32_t parser_bit = 1u << next_parser;
+      if ((kKeywordOnlyParsers & parser_bit) != 0 && (keyword_parsers & parser_bit) == 0) {
+        continue;
+      }
 
-  if (parseTouchscreen(part_iter->c_str(), &config)) {
-    ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
+      if (kQualifierParsers[next_parser](part_iter->c_str(), &config)) {
+        break;
+      }
     }
-  }
 
-  if (parseKeysHidden(part_iter->c_str(), &config)) {
-    ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
+    if (next_parser == kQualifierParserCount) {
+      // Unrecognized.
+      return false;
     }
+    next_parser++;
   }
 
-  if (parseKeyboard(part_iter->c_str(), &config)) {
-    ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
-    }
-  }
+  ConfigDescription::ApplyVersionForCompatibility(&config);
+  *out = config;
+  return true;
+}
 
-  if (parseNavHidden(part_iter->c_str(), &config)) {
-    ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
+bool ConfigDescription::Parse(const StringPiece& str, ConfigDescription* out) {
+  // The same few qualifier strings are parsed over and over, once for each file in a resource
+  // directory, so the results are cached for the whole process.
+  struct CachedResult {
+    bool valid;
+    ConfigDescription config;
+  };
+  static std::mutex cache_lock;
+  static std::unordered_map<std::string, CachedResult>* cache =
+      new std::unordered_map<std::string, CachedResult>();
+
+  const std::string key = str.to_string();
+  {
+    std::lock_guard<std::mutex> guard(cache_lock);
+    auto iter = cache->find(key);
+    if (iter != cache->end()) {
+      if (iter->second.valid && out != nullptr) {
+        *out = iter->second.config;
+      }
+      return iter->second.valid;
     }
   }
 
-  if (parseNavigation(part_iter->c_str(), &config)) {
-    ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
-    }
-  }
+  CachedResult result;
+  result.valid = ParseUncached(str, &result.config);
 
-  if (parseScreenSize(part_iter->c_str(), &config)) {
-    ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
-    }
-  }
-
-  if (parseVersion(part_iter->c_str(), &config)) {
-    ++part_iter;
-    if (part_iter == parts_end) {
-      goto success;
-    }
+  std::lock_guard<std::mutex> guard(cache_lock);
+  if (cache->size() < kMaxCachedParses) {
+    cache->insert({key, result});
   }
-
-  // Unrecognized.
-  return false;
-
-success:
-  if (out != NULL) {
-    ApplyVersionForCompatibility(&config);
-    *out = config;
+  if (result.valid && out != nullptr) {
+    *out = result.config;
   }
-  return true;
+  return result.valid;
 }
 
 void ConfigDescription::ApplyVersionForCompatibility(
@@ -152,4 +152,23 @@ TEST(ConfigDescriptionTest, RangeQualifiersDoNotConflict) {
   EXPECT_FALSE(ParseConfigOrDie("600x400").ConflictsWith(ParseConfigOrDie("300x200")));
 }
 
+TEST(ConfigDescriptionTest, ParseEveryQualifierInOrder) {
+  const std::string str =
+      "mcc310-mnc260-en-rUS-ldrtl-sw320dp-w720dp-h1024dp-large-long-round-widecg-highdr-port-"
+      "television-night-xhdpi-finger-keysexposed-qwerty-navhidden-dpad-1920x1080-v26";
+  ConfigDescription config;
+  ASSERT_TRUE(TestParse(str, &config));
+  EXPECT_EQ(str, config.toString().string());
+
+  // Parsed again from the cache.
+  ConfigDescription cached_config;
+  ASSERT_TRUE(TestParse(str, &cached_config));
+  EXPECT_EQ(config, cached_config);
+
+  EXPECT_TRUE(TestParse("any-any-any"));
+  EXPECT_FALSE(TestParse("night-television"));
+  EXPECT_FALSE(TestParse("night-television"));
+  EXPECT_FALSE(TestParse("land-land"));
+}
+
 }  // namespace aapt
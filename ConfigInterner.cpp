@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "ConfigInterner.h"
+
+#include "android-base/logging.h"
+
+namespace aapt {
+
+// Beyond this many configurations, the relations matrix of a snapshot would take more memory than
+// it is worth, so relations are computed directly instead.
+constexpr static size_t kMaxMemoizedConfigs = 2048u;
+
+// Values are mostly created in runs with the same configuration, so each thread remembers the
+// last configuration it interned or looked up, and skips the lock for it.
+static thread_local const ConfigDescription* sLastConfig = nullptr;
+static thread_local ConfigId sLastId = kDefaultConfigId;
+
+ConfigInterner* ConfigInterner::Get() {
+  // Never destroyed, so that interned configurations outlive every static table referring to them.
+  static ConfigInterner* interner = new ConfigInterner();
+  return interner;
+}
+
+ConfigInterner::ConfigInterner() {
+  configs_.push_back(ConfigDescription::DefaultConfig());
+  ids_.insert({configs_.back(), kDefaultConfigId});
+}
+
+ConfigId ConfigInterner::Intern(const ConfigDescription& config) {
+  if (sLastConfig == nullptr || *sLastConfig != config) {
+    std::lock_guard<std::mutex> guard(lock_);
+    auto iter = ids_.find(config);
+    if (iter == ids_.end()) {
+      const ConfigId id = static_cast<ConfigId>(configs_.size());
+      configs_.push_back(config);
+      iter = ids_.insert({configs_.back(), id}).first;
+    }
+    sLastConfig = &configs_[iter->second];
+    sLastId = iter->second;
+  }
+  return sLastId;
+}
+
+const ConfigDescription& ConfigInterner::Lookup(ConfigId id) {
+  if (sLastConfig == nullptr || sLastId != id) {
+    std::lock_guard<std::mutex> guard(lock_);
+    CHECK(id < configs_.size()) << "invalid configuration ID " << id;
+    sLastConfig = &configs_[id];
+    sLastId = id;
+  }
+  return *sLastConfig;
+}
+
+size_t ConfigInterner::size() {
+  std::lock_guard<std::mutex> guard(lock_);
+  return configs_.size();
+}
+
+ConfigOrder::ConfigOrder() {
+  ConfigInterner* interner = ConfigInterner::Get();
+  std::lock_guard<std::mutex> guard(interner->lock_);
+  configs_.reserve(interner->configs_.size());
+  for (const ConfigDescription& config : interner->configs_) {
+    configs_.push_back(&config);
+  }
+
+  // The interner's map already holds the configurations in order.
+  ranks_.resize(configs_.size());
+  uint32_t rank = 0u;
+  for (const auto& entry : interner->ids_) {
+    ranks_[entry.second] = rank++;
+  }
+}
+
+int ConfigOrder::Compare(ConfigId a, ConfigId b) const {
+  if (a == b) {
+    return 0;
+  }
+
+  if (a < ranks_.size() && b < ranks_.size()) {
+    return ranks_[a] < ranks_[b] ? -1 : 1;
+  }
+
+  ConfigInterner* interner = ConfigInterner::Get();
+  return interner->Lookup(a).compare(interner->Lookup(b));
+}
+
+ConfigRelations::ConfigRelations() {
+  const size_t count = configs_.size();
+  if (count <= kMaxMemoizedConfigs) {
+    relations_.reset(new std::atomic<uint8_t>[count * count]);
+    for (size_t i = 0; i < count * count; i++) {
+      relations_[i].store(0u, std::memory_order_relaxed);
+    }
+  }
+}
+
+std::atomic<uint8_t>* ConfigRelations::FindRelations(ConfigId a, ConfigId b) {
+  const size_t count = configs_.size();
+  if (relations_ == nullptr || a >= count || b >= count) {
+    return nullptr;
+  }
+  return &relations_[a * count + b];
+}
+
+bool ConfigRelations::Dominates(ConfigId a, ConfigId b) {
+  std::atomic<uint8_t>* relations = FindRelations(a, b);
+  if (relations == nullptr) {
+    ConfigInterner* interner = ConfigInterner::Get();
+    return interner->Lookup(a).Dominates(interner->Lookup(b));
+  }
+
+  uint8_t bits = relations->load(std::memory_order_relaxed);
+  if ((bits & kDominatesKnown) == 0) {
+    bits = kDominatesKnown | (configs_[a]->Dominates(*configs_[b]) ? kDominates : 0u);
+    relations->fetch_or(bits, std::memory_order_relaxed);
+  }
+  return (bits & kDominates) != 0;
+}
+
+bool ConfigRelations::IsCompatibleWith(ConfigId a, ConfigId b) {
+  std::atomic<uint8_t>* relations = FindRelations(a, b);
+  if (relations == nullptr) {
+    ConfigInterner* interner = ConfigInterner::Get();
+    return interner->Lookup(a).IsCompatibleWith(interner->Lookup(b));
+  }
+
+  uint8_t bits = relations->load(std::memory_order_relaxed);
+  if ((bits & kCompatibleKnown) == 0) {
+    bits = kCompatibleKnown | (configs_[a]->IsCompatibleWith(*configs_[b]) ? kCompatible : 0u);
+    relations->fetch_or(bits, std::memory_order_relaxed);
+  }
+  return (bits & kCompatible) != 0;
+}
+
+}  // namespace aapt
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef AAPT_CONFIG_INTERNER_H
+#define AAPT_CONFIG_INTERNER_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "android-base/macros.h"
+
+#include "ConfigDescription.h"
+
+namespace aapt {
+
+// A small integer standing for a configuration interned in the ConfigInterner. Two IDs are equal
+// if and only if their configurations are equal.
+using ConfigId = uint32_t;
+
+// The ID of ConfigDescription::DefaultConfig().
+constexpr ConfigId kDefaultConfigId = 0u;
+
+// The process-wide set of distinct configurations. Resource values and string pool contexts refer
+// to their configuration by ID, instead of each holding a copy of it. Thread-safe.
+class ConfigInterner {
+ public:
+  static ConfigInterner* Get();
+
+  // Returns the ID of `config`, interning it if it was not seen before.
+  ConfigId Intern(const ConfigDescription& config);
+
+  // Returns the configuration with ID `id`. The reference is valid for the lifetime of the
+  // process. Looking up the configuration just interned is cheap.
+  const ConfigDescription& Lookup(ConfigId id);
+
+  // Returns the number of configurations interned so far. IDs are dense, so every ID below this
+  // has been handed out.
+  size_t size();
+
+ private:
+  friend class ConfigOrder;
+
+  ConfigInterner();
+
+  DISALLOW_COPY_AND_ASSIGN(ConfigInterner);
+
+  std::mutex lock_;
+
+  // A deque, so that references to the configurations are never invalidated.
+  std::deque<ConfigDescription> configs_;
+  std::map<ConfigDescription, ConfigId> ids_;
+};
+
+// A snapshot of the order of the configurations interned so far, for sorting by configuration
+// with integer comparisons. Configurations interned after the snapshot was taken are compared
+// directly. A snapshot can be shared by threads.
+class ConfigOrder {
+ public:
+  ConfigOrder();
+
+  // Same as ConfigDescription::compare() on the configurations of `a` and `b`.
+  int Compare(ConfigId a, ConfigId b) const;
+
+ protected:
+  std::vector<const ConfigDescription*> configs_;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ConfigOrder);
+
+  std::vector<uint32_t> ranks_;
+};
+
+// Orders configuration IDs like their configurations, for ordered containers keyed by ConfigId.
+// The ConfigOrder must outlive the comparator.
+class ConfigIdLess {
+ public:
+  explicit ConfigIdLess(const ConfigOrder* order) : order_(order) {
+  }
+
+  bool operator()(ConfigId a, ConfigId b) const {
+    return order_->Compare(a, b) < 0;
+  }
+
+ private:
+  const ConfigOrder* order_;
+};
+
+// A ConfigOrder that also memoizes dominance and compatibility in a matrix as they are queried,
+// for passes that relate the same configurations over and over. It can be shared by threads too.
+class ConfigRelations : public ConfigOrder {
+ public:
+  ConfigRelations();
+
+  // Same as ConfigDescription::Dominates() on the configurations of `a` and `b`.
+  bool Dominates(ConfigId a, ConfigId b);
+
+  // Same as ConfigDescription::IsCompatibleWith() on the configurations of `a` and `b`.
+  bool IsCompatibleWith(ConfigId a, ConfigId b);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ConfigRelations);
+
+  enum : uint8_t {
+    kDominatesKnown = 1u << 0,
+    kDominates = 1u << 1,
+    kCompatibleKnown = 1u << 2,
+    kCompatible = 1u << 3,
+  };
+
+  // Returns the memoized relations of `a` and `b`, or nullptr if they are not memoized.
+  std::atomic<uint8_t>* FindRelations(ConfigId a, ConfigId b);
+
+  // The relations of each pair of configurations, row-major by the ID of the first. Threads
+  // racing to fill in a relation compute the same bits, so they are simply or-ed in.
+  std::unique_ptr<std::atomic<uint8_t>[]> relations_;
+};
+
+}  // namespace aapt
+
+#endif /* AAPT_CONFIG_INTERNER_H */
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "ConfigInterner.h"
+
+#include <map>
+#include <vector>
+
+#include "ResourceTable.h"
+#include "test/Test.h"
+
+namespace aapt {
+
+TEST(ConfigInternerTest, EqualConfigsShareAnId) {
+  ConfigInterner* interner = ConfigInterner::Get();
+  EXPECT_EQ(kDefaultConfigId, interner->Intern(ConfigDescription::DefaultConfig()));
+
+  const ConfigId fr = interner->Intern(test::ParseConfigOrDie("fr"));
+  const ConfigId land = interner->Intern(test::ParseConfigOrDie("land"));
+  EXPECT_NE(fr, land);
+  EXPECT_EQ(fr, interner->Intern(test::ParseConfigOrDie("fr")));
+  EXPECT_EQ(test::ParseConfigOrDie("fr"), interner->Lookup(fr));
+  EXPECT_EQ(test::ParseConfigOrDie("land"), interner->Lookup(land));
+}
+
+TEST(ConfigInternerTest, ValuesShareInternedConfigs) {
+  ResourceConfigValue a(test::ParseConfigOrDie("fr-v21"), "");
+  ResourceConfigValue b(test::ParseConfigOrDie("fr-v21"), "tablet");
+  EXPECT_EQ(a.config_id, b.config_id);
+  EXPECT_EQ(&a.config, &b.config);
+  EXPECT_EQ(test::ParseConfigOrDie("fr-v21"), a.config);
+}
+
+TEST(ConfigInternerTest, RelationsMatchConfigDescription) {
+  const std::vector<ConfigDescription> configs = {
+      ConfigDescription::DefaultConfig(), test::ParseConfigOrDie("en"),
+      test::ParseConfigOrDie("en-rGB"), test::ParseConfigOrDie("land"),
+      test::ParseConfigOrDie("en-land"), test::ParseConfigOrDie("v21"),
+      test::ParseConfigOrDie("sw600dp-v13"),
+  };
+
+  std::vector<ConfigId> ids;
+  for (const ConfigDescription& config : configs) {
+    ids.push_back(ConfigInterner::Get()->Intern(config));
+  }
+
+  ConfigRelations relations;
+
+  // Interned after the snapshot was taken, so related directly.
+  const ConfigDescription late = test::ParseConfigOrDie("ja-port-v26");
+  std::vector<ConfigDescription> all_configs = configs;
+  all_configs.push_back(late);
+  ids.push_back(ConfigInterner::Get()->Intern(late));
+
+  for (size_t i = 0; i < all_configs.size(); i++) {
+    for (size_t j = 0; j < all_configs.size(); j++) {
+      const int cmp = all_configs[i].compare(all_configs[j]);
+      const int expected_sign = (cmp > 0) - (cmp < 0);
+      const int actual = relations.Compare(ids[i], ids[j]);
+      EXPECT_EQ(expected_sign, (actual > 0) - (actual < 0)) << all_configs[i] << " vs "
+                                                            << all_configs[j];
+
+      // Asked twice, to go through the memoized relations.
+      for (int k = 0; k < 2; k++) {
+        EXPECT_EQ(all_configs[i].Dominates(all_configs[j]), relations.Dominates(ids[i], ids[j]));
+        EXPECT_EQ(all_configs[i].IsCompatibleWith(all_configs[j]),
+                  relations.IsCompatibleWith(ids[i], ids[j]));
+      }
+    }
+  }
+}
+
+TEST(ConfigInternerTest, MapsKeyedByIdIterateInConfigOrder) {
+  ConfigInterner* interner = ConfigInterner::Get();
+  const ConfigId land = interner->Intern(test::ParseConfigOrDie("land"));
+  const ConfigId fr = interner->Intern(test::ParseConfigOrDie("fr"));
+  const ConfigOrder order;
+  const ConfigId late = interner->Intern(test::ParseConfigOrDie("de-port-v26"));
+
+  std::map<ConfigId, int, ConfigIdLess> map{ConfigIdLess(&order)};
+  for (ConfigId id : {land, late, kDefaultConfigId, fr}) {
+    map[id] = 0;
+  }
+
+  std::vector<ConfigDescription> configs;
+  for (const auto& entry : map) {
+    configs.push_back(interner->Lookup(entry.first));
+  }
+  EXPECT_EQ((std::vector<ConfigDescription>{ConfigDescription::DefaultConfig(),
+                                            test::ParseConfigOrDie("land"),
+                                            test::ParseConfigOrDie("de-port-v26"),
+                                            test::ParseConfigOrDie("fr")}),
+            configs);
+}
+
+}  // namespace aapt
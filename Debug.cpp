@@ -46,7 +46,10 @@ class PrintVisitor : public ValueVisitor {
         android::ResTable_map::TYPE_ENUM | android::ResTable_map::TYPE_FLAGS;
     if (attr->type_mask & kMask) {
       for (const auto& symbol : attr->symbols) {
-        std::cout << "\n        " << symbol.symbol.name.value().entry;
+        std::cout << "\n        ";
+        if (symbol.symbol.name) {
+          std::cout << symbol.symbol.name.value().entry;
+        }
         if (symbol.symbol.id) {
           std::cout << " (" << symbol.symbol.id.value() << ")";
         }
@@ -124,66 +127,79 @@ class PrintVisitor : public ValueVisitor {
 }  // namespace
 
 void Debug::PrintTable(ResourceTable* table, const DebugPrintTableOptions& options) {
-  PrintVisitor visitor;
-
   for (auto& package : table->packages) {
-    std::cout << "Package name=" << package->name;
-    if (package->id) {
-      std::cout << " id=" << std::hex << (int)package->id.value() << std::dec;
+    PrintPackageHeader(*package);
+    for (const auto& type : package->types) {
+      PrintType(*package, type.get(), options);
     }
-    std::cout << std::endl;
+  }
+}
 
-    for (const auto& type : package->types) {
-      std::cout << "\n  type " << type->type;
-      if (type->id) {
-        std::cout << " id=" << std::hex << (int)type->id.value() << std::dec;
-      }
-      std::cout << " entryCount=" << type->entries.size() << std::endl;
-
-      std::vector<const ResourceEntry*> sorted_entries;
-      for (const auto& entry : type->entries) {
-        auto iter = std::lower_bound(
-            sorted_entries.begin(), sorted_entries.end(), entry.get(),
-            [](const ResourceEntry* a, const ResourceEntry* b) -> bool {
-              if (a->id && b->id) {
-                return a->id.value() < b->id.value();
-              } else if (a->id) {
-                return true;
-              } else {
-                return false;
-              }
-            });
-        sorted_entries.insert(iter, entry.get());
-      }
+void Debug::PrintValue(Value* value) {
+  PrintVisitor visitor;
+  value->Accept(&visitor);
+}
 
-      for (const ResourceEntry* entry : sorted_entries) {
-        const ResourceId id(package->id.value_or_default(0), type->id.value_or_default(0),
-                            entry->id.value_or_default(0));
-        const ResourceName name(package->name, type->type, entry->name);
-
-        std::cout << "    spec resource " << id << " " << name;
-        switch (entry->symbol_status.state) {
-          case SymbolState::kPublic:
-            std::cout << " PUBLIC";
-            break;
-          case SymbolState::kPrivate:
-            std::cout << " _PRIVATE_";
-            break;
-          default:
-            break;
-        }
+void Debug::PrintPackageHeader(const ResourceTablePackage& package) {
+  std::cout << "Package name=" << package.name;
+  if (package.id) {
+    std::cout << " id=" << std::hex << (int)package.id.value() << std::dec;
+  }
+  std::cout << std::endl;
+}
 
-        std::cout << std::endl;
+void Debug::PrintType(const ResourceTablePackage& package, ResourceTableType* type,
+                      const DebugPrintTableOptions& options) {
+  PrintVisitor visitor;
 
-        for (const auto& value : entry->values) {
-          std::cout << "      (" << value->config << ") ";
-          value->value->Accept(&visitor);
-          if (options.show_sources && !value->value->GetSource().path.empty()) {
-            std::cout << " src=" << value->value->GetSource();
+  std::cout << "\n  type " << type->type;
+  if (type->id) {
+    std::cout << " id=" << std::hex << (int)type->id.value() << std::dec;
+  }
+  std::cout << " entryCount=" << type->entries.size() << std::endl;
+
+  std::vector<const ResourceEntry*> sorted_entries;
+  for (const auto& entry : type->entries) {
+    auto iter = std::lower_bound(
+        sorted_entries.begin(), sorted_entries.end(), entry.get(),
+        [](const ResourceEntry* a, const ResourceEntry* b) -> bool {
+          if (a->id && b->id) {
+            return a->id.value() < b->id.value();
+          } else if (a->id) {
+            return true;
+          } else {
+            return false;
           }
-          std::cout << std::endl;
-        }
+        });
+    sorted_entries.insert(iter, entry.get());
+  }
+
+  for (const ResourceEntry* entry : sorted_entries) {
+    const ResourceId id(package.id.value_or_default(0), type->id.value_or_default(0),
+                        entry->id.value_or_default(0));
+    const ResourceName name(package.name, type->type, entry->name);
+
+    std::cout << "    spec resource " << id << " " << name;
+    switch (entry->symbol_status.state) {
+      case SymbolState::kPublic:
+        std::cout << " PUBLIC";
+        break;
+      case SymbolState::kPrivate:
+        std::cout << " _PRIVATE_";
+        break;
+      default:
+        break;
+    }
+
+    std::cout << std::endl;
+
+    for (const auto& value : entry->values) {
+      std::cout << "      (" << value->config << ") ";
+      value->value->Accept(&visitor);
+      if (options.show_sources && !value->value->GetSource().path.empty()) {
+        std::cout << " src=" << value->value->GetSource();
       }
+      std::cout << std::endl;
     }
   }
 }
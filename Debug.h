@@ -33,6 +33,15 @@ struct DebugPrintTableOptions {
 struct Debug {
   static void PrintTable(ResourceTable* table,
                          const DebugPrintTableOptions& options = {});
+
+  // The parts of PrintTable(), for printing a table one type at a time.
+  static void PrintPackageHeader(const ResourceTablePackage& package);
+  static void PrintType(const ResourceTablePackage& package, ResourceTableType* type,
+                        const DebugPrintTableOptions& options = {});
+
+  // Prints a single value the way PrintTable() does.
+  static void PrintValue(Value* value);
+
   static void PrintStyleGraph(ResourceTable* table,
                               const ResourceName& target_style);
   static void DumpHex(const void* data, size_t len);
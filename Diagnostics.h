@@ -20,6 +20,8 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "android-base/macros.h"
 #include "androidfw/StringPiece.h"
@@ -142,6 +144,29 @@ class SourcePathDiagnostics : public IDiagnostics {
   DISALLOW_COPY_AND_ASSIGN(SourcePathDiagnostics);
 };
 
+// Records messages so they can be replayed later. Used to give each task running on a worker
+// thread its own diagnostics, which are then replayed in a deterministic order.
+class BufferedDiagnostics : public IDiagnostics {
+ public:
+  BufferedDiagnostics() = default;
+
+  void Log(Level level, DiagMessageActual& actual_msg) override {
+    messages_.push_back(std::make_pair(level, actual_msg));
+  }
+
+  void ReplayTo(IDiagnostics* diag) {
+    for (auto& message : messages_) {
+      diag->Log(message.first, message.second);
+    }
+    messages_.clear();
+  }
+
+ private:
+  std::vector<std::pair<Level, DiagMessageActual>> messages_;
+
+  DISALLOW_COPY_AND_ASSIGN(BufferedDiagnostics);
+};
+
 }  // namespace aapt
 
 #endif /* AAPT_DIAGNOSTICS_H */
@@ -25,10 +25,11 @@
 namespace aapt {
 
 DominatorTree::DominatorTree(
-    const std::vector<std::unique_ptr<ResourceConfigValue>>& configs) {
+    const std::vector<std::unique_ptr<ResourceConfigValue>>& configs,
+    ConfigRelations* relations) {
   for (const auto& config : configs) {
     product_roots_[config->product].TryAddChild(
-        util::make_unique<Node>(config.get(), nullptr));
+        util::make_unique<Node>(config.get(), nullptr, relations));
   }
 }
 
@@ -88,6 +89,9 @@ bool DominatorTree::Node::Dominates(const Node* other) const {
     return true;
   }
   // Neither node is a root node; compare the configurations.
+  if (relations_ != nullptr) {
+    return relations_->Dominates(value_->config_id, other->value_->config_id);
+  }
   return value_->config.Dominates(other->value_->config);
 }
 
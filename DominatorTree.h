@@ -22,6 +22,7 @@
 #include <string>
 #include <vector>
 
+#include "ConfigInterner.h"
 #include "ResourceTable.h"
 
 namespace aapt {
@@ -44,16 +45,21 @@ namespace aapt {
  * The dominator tree relies on the underlying configurations passed to it. If
  * the configurations passed to the dominator tree go out of scope, the tree
  * will exhibit undefined behavior.
+ *
+ * If `relations` is set, dominance is looked up there instead of being computed
+ * for each pair of nodes.
  */
 class DominatorTree {
  public:
   explicit DominatorTree(
-      const std::vector<std::unique_ptr<ResourceConfigValue>>& configs);
+      const std::vector<std::unique_ptr<ResourceConfigValue>>& configs,
+      ConfigRelations* relations = nullptr);
 
   class Node {
    public:
-    explicit Node(ResourceConfigValue* value = nullptr, Node* parent = nullptr)
-        : value_(value), parent_(parent) {}
+    explicit Node(ResourceConfigValue* value = nullptr, Node* parent = nullptr,
+                  ConfigRelations* relations = nullptr)
+        : value_(value), parent_(parent), relations_(relations) {}
 
     inline ResourceConfigValue* value() const { return value_; }
 
@@ -73,6 +79,7 @@ class DominatorTree {
 
     ResourceConfigValue* value_;
     Node* parent_;
+    ConfigRelations* relations_;
     std::vector<std::unique_ptr<Node>> children_;
 
     DISALLOW_COPY_AND_ASSIGN(Node);
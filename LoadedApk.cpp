@@ -63,6 +63,19 @@ bool LoadedApk::WriteToArchive(IAaptContext* context, const TableFlattenerOption
 
 bool LoadedApk::WriteToArchive(IAaptContext* context, const TableFlattenerOptions& options,
                                FilterChain* filters, IArchiveWriter* writer) {
+  // The resource table needs to be re-serialized since it might have changed.
+  BigBuffer buffer(4096);
+  // TODO(adamlesinski): How to determine if there were sparse entries (and if to encode
+  // with sparse entries) b/35389232.
+  TableFlattener flattener(options, &buffer);
+  if (!flattener.Consume(context, table_.get())) {
+    return false;
+  }
+  return WriteToArchive(context, buffer, filters, writer);
+}
+
+bool LoadedApk::WriteToArchive(IAaptContext* context, const BigBuffer& table_buffer,
+                               FilterChain* filters, IArchiveWriter* writer) {
   std::set<std::string> referenced_resources;
   // List the files being referenced in the resource table.
   for (auto& pkg : table_->packages) {
@@ -102,17 +115,8 @@ bool LoadedApk::WriteToArchive(IAaptContext* context, const TableFlattenerOption
       continue;
     }
 
-    // The resource table needs to be re-serialized since it might have changed.
     if (path == "resources.arsc") {
-      BigBuffer buffer(4096);
-      // TODO(adamlesinski): How to determine if there were sparse entries (and if to encode
-      // with sparse entries) b/35389232.
-      TableFlattener flattener(options, &buffer);
-      if (!flattener.Consume(context, table_.get())) {
-        return false;
-      }
-
-      io::BigBufferInputStream input_stream(&buffer);
+      io::BigBufferInputStream input_stream(&table_buffer);
       if (!io::CopyInputStreamToArchive(context, &input_stream, path, ArchiveEntry::kAlign,
                                         writer)) {
         return false;
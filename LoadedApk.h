@@ -24,6 +24,7 @@
 #include "flatten/Archive.h"
 #include "flatten/TableFlattener.h"
 #include "io/ZipArchive.h"
+#include "util/BigBuffer.h"
 #include "unflatten/BinaryResourceParser.h"
 
 namespace aapt {
@@ -58,6 +59,14 @@ class LoadedApk {
   bool WriteToArchive(IAaptContext* context, const TableFlattenerOptions& options,
                       FilterChain* filters, IArchiveWriter* writer);
 
+  /**
+   * Same as above, but writes `table_buffer` as the resources.arsc instead of flattening the
+   * resource table. Flattening modifies the table, so this is what allows several archives to be
+   * written from the same LoadedApk at the same time.
+   */
+  bool WriteToArchive(IAaptContext* context, const BigBuffer& table_buffer, FilterChain* filters,
+                      IArchiveWriter* writer);
+
   static std::unique_ptr<LoadedApk> LoadApkFromPath(IAaptContext* context,
                                                     const android::StringPiece& path);
 
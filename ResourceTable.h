@@ -18,6 +18,7 @@
 #define AAPT_RESOURCE_TABLE_H
 
 #include "ConfigDescription.h"
+#include "ConfigInterner.h"
 #include "Diagnostics.h"
 #include "Resource.h"
 #include "ResourceValues.h"
@@ -60,9 +61,15 @@ struct Symbol {
 class ResourceConfigValue {
  public:
   /**
-   * The configuration for which this value is defined.
+   * The ID of the configuration for which this value is defined.
    */
-  const ConfigDescription config;
+  const ConfigId config_id;
+
+  /**
+   * The configuration for which this value is defined. This is the copy held
+   * by the ConfigInterner, shared by all values of the same configuration.
+   */
+  const ConfigDescription& config;
 
   /**
    * The product for which this value is defined.
@@ -75,7 +82,9 @@ class ResourceConfigValue {
   std::unique_ptr<Value> value;
 
   ResourceConfigValue(const ConfigDescription& config, const android::StringPiece& product)
-      : config(config), product(product.to_string()) {}
+      : config_id(ConfigInterner::Get()->Intern(config)),
+        config(ConfigInterner::Get()->Lookup(config_id)),
+        product(product.to_string()) {}
 
  private:
   DISALLOW_COPY_AND_ASSIGN(ResourceConfigValue);
@@ -16,10 +16,7 @@
 
 #include "SdkConstants.h"
 
-#include <algorithm>
-#include <string>
-#include <unordered_map>
-#include <vector>
+#include <cstdint>
 
 using android::StringPiece;
 
@@ -28,7 +25,23 @@ namespace aapt {
 static const char* sDevelopmentSdkCodeName = "O";
 static ApiVersion sDevelopmentSdkLevel = 26;
 
-static const std::vector<std::pair<uint16_t, ApiVersion>> sAttrIdMap = {
+namespace {
+
+struct AttrIdLevel {
+  uint16_t last_entry_id;
+  ApiVersion version;
+};
+
+struct AttrNameLevel {
+  const char* name;
+  ApiVersion version;
+};
+
+}  // namespace
+
+// Each framework attribute with an entry ID up to and including `last_entry_id`, and past the
+// previous range, was added in `version`.
+static constexpr AttrIdLevel sAttrIdRanges[] = {
     {0x021c, 1},
     {0x021d, 2},
     {0x0269, SDK_CUPCAKE},
@@ -55,22 +68,56 @@ static const std::vector<std::pair<uint16_t, ApiVersion>> sAttrIdMap = {
     {0x0568, SDK_O},
 };
 
-static bool less_entry_id(const std::pair<uint16_t, ApiVersion>& p, uint16_t entryId) {
-  return p.first < entryId;
-}
+// The version of every framework attribute ID covered by sAttrIdRanges, indexed by entry ID.
+// Built at compile time so that lookups are a single load.
+namespace {
+
+class AttrIdLevelTable {
+ public:
+  static constexpr size_t kSize = 0x0568 + 1;
+
+  template <size_t N>
+  constexpr explicit AttrIdLevelTable(const AttrIdLevel (&ranges)[N]) : levels_{}, valid_(true) {
+    size_t entry_id = 0;
+    for (const AttrIdLevel& range : ranges) {
+      if (range.last_entry_id < entry_id || range.last_entry_id >= kSize) {
+        valid_ = false;
+        return;
+      }
+      for (; entry_id <= range.last_entry_id; entry_id++) {
+        levels_[entry_id] = range.version;
+      }
+    }
+    valid_ = entry_id == kSize;
+  }
+
+  constexpr bool valid() const {
+    return valid_;
+  }
+
+  ApiVersion Find(uint16_t entry_id) const {
+    return entry_id < kSize ? levels_[entry_id] : SDK_LOLLIPOP_MR1;
+  }
+
+ private:
+  ApiVersion levels_[kSize];
+  bool valid_;
+};
+
+}  // namespace
+
+static constexpr AttrIdLevelTable sAttrIdLevels(sAttrIdRanges);
+static_assert(sAttrIdLevels.valid(),
+              "sAttrIdRanges must be sorted and end at AttrIdLevelTable::kSize - 1");
 
 ApiVersion FindAttributeSdkLevel(const ResourceId& id) {
   if (id.package_id() != 0x01 || id.type_id() != 0x01) {
     return 0;
   }
-  auto iter = std::lower_bound(sAttrIdMap.begin(), sAttrIdMap.end(), id.entry_id(), less_entry_id);
-  if (iter == sAttrIdMap.end()) {
-    return SDK_LOLLIPOP_MR1;
-  }
-  return iter->second;
+  return sAttrIdLevels.Find(id.entry_id());
 }
 
-static const std::unordered_map<std::string, ApiVersion> sAttrMap = {
+static constexpr AttrNameLevel sAttrNameLevels[] = {
     {"marqueeRepeatLimit", 2},
     {"windowNoDisplay", 3},
     {"backgroundDimEnabled", 3},
@@ -732,14 +779,150 @@ static const std::unordered_map<std::string, ApiVersion> sAttrMap = {
     {"windowActivityTransitions", 21},
     {"colorEdgeEffect", 21}};
 
+static constexpr uint64_t HashAttrName(const char* str, size_t len) {
+  // 64-bit FNV-1a.
+  uint64_t hash = UINT64_C(0xcbf29ce484222325);
+  for (size_t i = 0; i < len; i++) {
+    hash = (hash ^ static_cast<uint8_t>(str[i])) * UINT64_C(0x100000001b3);
+  }
+  return hash;
+}
+
+static constexpr size_t ConstexprStrlen(const char* str) {
+  size_t len = 0;
+  while (str[len] != '\0') {
+    len++;
+  }
+  return len;
+}
+
+// A perfect hash of the names in sAttrNameLevels, built at compile time.
+//
+// Names are split into buckets by the low bits of their hash. Each bucket gets a displacement
+// chosen so that its names land in slots no other name uses. Finding a name takes one hash, one
+// table load and one string comparison.
+namespace {
+
+class AttrNameLevelTable {
+ public:
+  static constexpr size_t kBucketCount = 256;
+  static constexpr size_t kSlotCount = 1024;
+  static constexpr int16_t kEmptySlot = -1;
+
+  template <size_t N>
+  constexpr explicit AttrNameLevelTable(const AttrNameLevel (&levels)[N])
+      : displacements_{}, slots_{}, valid_(false) {
+    static_assert(N < kSlotCount, "too many attribute names for the slot table");
+
+    uint64_t hashes[N] = {};
+    for (size_t i = 0; i < N; i++) {
+      hashes[i] = HashAttrName(levels[i].name, ConstexprStrlen(levels[i].name));
+    }
+
+    // Group the names by bucket.
+    size_t bucket_offsets[kBucketCount + 1] = {};
+    for (size_t i = 0; i < N; i++) {
+      bucket_offsets[Bucket(hashes[i]) + 1]++;
+    }
+    size_t max_bucket_size = 0;
+    for (size_t b = 0; b < kBucketCount; b++) {
+      if (bucket_offsets[b + 1] > max_bucket_size) {
+        max_bucket_size = bucket_offsets[b + 1];
+      }
+      bucket_offsets[b + 1] += bucket_offsets[b];
+    }
+    size_t bucket_fill[kBucketCount] = {};
+    size_t bucket_names[N] = {};
+    for (size_t i = 0; i < N; i++) {
+      const size_t b = Bucket(hashes[i]);
+      bucket_names[bucket_offsets[b] + bucket_fill[b]++] = i;
+    }
+
+    for (size_t s = 0; s < kSlotCount; s++) {
+      slots_[s] = kEmptySlot;
+    }
+
+    // Place the largest buckets first, while most slots are still free.
+    for (size_t size = max_bucket_size; size > 0; size--) {
+      for (size_t b = 0; b < kBucketCount; b++) {
+        if (bucket_offsets[b + 1] - bucket_offsets[b] != size) {
+          continue;
+        }
+
+        bool placed = false;
+        for (size_t d = 0; d < kSlotCount && !placed; d++) {
+          size_t placed_count = 0;
+          for (; placed_count < size; placed_count++) {
+            const size_t name = bucket_names[bucket_offsets[b] + placed_count];
+            const size_t slot = Slot(hashes[name], d);
+            if (slots_[slot] != kEmptySlot) {
+              break;
+            }
+            slots_[slot] = static_cast<int16_t>(name);
+          }
+
+          placed = placed_count == size;
+          if (!placed) {
+            // Undo the partial placement and try the next displacement.
+            for (size_t j = 0; j < placed_count; j++) {
+              const size_t name = bucket_names[bucket_offsets[b] + j];
+              slots_[Slot(hashes[name], d)] = kEmptySlot;
+            }
+          } else {
+            displacements_[b] = static_cast<uint16_t>(d);
+          }
+        }
+
+        if (!placed) {
+          // Two names share a hash, or appear twice.
+          return;
+        }
+      }
+    }
+    valid_ = true;
+  }
+
+  constexpr bool valid() const {
+    return valid_;
+  }
+
+  // Returns the index of the only name in the table's source array that `name` can be, or -1 if
+  // its slot is empty. A name that is not in the table can land in the slot of another name, so
+  // the caller must compare the name at the returned index with `name`.
+  int Find(const StringPiece& name) const {
+    const uint64_t hash = HashAttrName(name.data(), name.size());
+    return slots_[Slot(hash, displacements_[Bucket(hash)])];
+  }
+
+ private:
+  static constexpr size_t Bucket(uint64_t hash) {
+    return static_cast<size_t>(hash) & (kBucketCount - 1);
+  }
+
+  static constexpr size_t Slot(uint64_t hash, size_t displacement) {
+    // The step is odd, so the displacements of a name reach every slot.
+    const uint64_t step = (hash >> 40) | 1u;
+    return static_cast<size_t>((hash >> 16) + displacement * step) & (kSlotCount - 1);
+  }
+
+  uint16_t displacements_[kBucketCount];
+  int16_t slots_[kSlotCount];
+  bool valid_;
+};
+
+}  // namespace
+
+static constexpr AttrNameLevelTable sAttrNameTable(sAttrNameLevels);
+static_assert(sAttrNameTable.valid(), "sAttrNameLevels must not contain duplicate names");
+
 ApiVersion FindAttributeSdkLevel(const ResourceName& name) {
   if (name.package != "android" && name.type != ResourceType::kAttr) {
     return 0;
   }
 
-  auto iter = sAttrMap.find(name.entry);
-  if (iter != sAttrMap.end()) {
-    return iter->second;
+  const int idx = sAttrNameTable.Find(name.entry);
+  if (idx != AttrNameLevelTable::kEmptySlot && name.entry == sAttrNameLevels[idx].name) {
+    return sAttrNameLevels[idx].version;
   }
   return SDK_LOLLIPOP_MR1;
 }
@@ -28,4 +28,24 @@ TEST(SdkConstantsTest, NonFrameworkAttributeIsSdk0) {
   EXPECT_EQ(0, FindAttributeSdkLevel(ResourceId(0x7f010345)));
 }
 
+TEST(SdkConstantsTest, AttributeIdLevels) {
+  EXPECT_EQ(2, FindAttributeSdkLevel(ResourceId(0x0101021d)));
+  EXPECT_EQ(SDK_CUPCAKE, FindAttributeSdkLevel(ResourceId(0x0101021e)));
+  EXPECT_EQ(SDK_O, FindAttributeSdkLevel(ResourceId(0x01010568)));
+  EXPECT_EQ(SDK_LOLLIPOP_MR1, FindAttributeSdkLevel(ResourceId(0x01010569)));
+}
+
+TEST(SdkConstantsTest, AttributeNameLevels) {
+  EXPECT_EQ(2, FindAttributeSdkLevel(ResourceName("android", ResourceType::kAttr,
+                                                  "marqueeRepeatLimit")));
+  EXPECT_EQ(SDK_LOLLIPOP, FindAttributeSdkLevel(ResourceName("android", ResourceType::kAttr,
+                                                             "colorEdgeEffect")));
+  EXPECT_EQ(SDK_LOLLIPOP_MR1, FindAttributeSdkLevel(ResourceName("android", ResourceType::kAttr,
+                                                                 "notAnAttribute")));
+  EXPECT_EQ(SDK_LOLLIPOP_MR1,
+            FindAttributeSdkLevel(ResourceName("android", ResourceType::kAttr, "")));
+  EXPECT_EQ(0, FindAttributeSdkLevel(ResourceName("com.app", ResourceType::kString,
+                                                  "marqueeRepeatLimit")));
+}
+
 }  // namespace aapt
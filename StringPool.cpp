@@ -263,6 +263,15 @@ void StringPool::Merge(StringPool&& pool) {
   ReAssignIndices();
 }
 
+void StringPool::SetPriority(const Ref& ref, uint32_t priority) {
+  CHECK(ref.entry_->pool_ == this) << "string does not belong to this pool";
+  ref.entry_->context.priority = priority;
+}
+
+void StringPool::SetPriority(const StyleRef& ref, uint32_t priority) {
+  ref.entry_->context.priority = priority;
+}
+
 void StringPool::HintWillAdd(size_t string_count, size_t style_count) {
   strings_.reserve(strings_.size() + string_count);
   styles_.reserve(styles_.size() + style_count);
@@ -344,8 +353,7 @@ static size_t EncodedLengthUnits(size_t length) {
 static void EncodeString(const std::string& str, const bool utf8, BigBuffer* out) {
   if (utf8) {
     const std::string& encoded = str;
-    const ssize_t utf16_length =
-        utf8_to_utf16_length(reinterpret_cast<const uint8_t*>(str.data()), str.size());
+    const ssize_t utf16_length = util::Utf8ToUtf16Length(str);
     CHECK(utf16_length >= 0);
 
     const size_t total_size = EncodedLengthUnits<char>(utf16_length) +
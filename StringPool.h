@@ -27,6 +27,7 @@
 #include "androidfw/StringPiece.h"
 
 #include "ConfigDescription.h"
+#include "ConfigInterner.h"
 #include "util/BigBuffer.h"
 
 namespace aapt {
@@ -54,17 +55,27 @@ class StringPool {
   class Context {
    public:
     enum : uint32_t {
+      kHotPriority = 0u,
       kHighPriority = 1u,
       kNormalPriority = 0x7fffffffu,
       kLowPriority = 0xffffffffu,
     };
     uint32_t priority = kNormalPriority;
-    ConfigDescription config;
+
+    // The configuration of the string, interned in the ConfigInterner.
+    ConfigId config_id = kDefaultConfigId;
 
     Context() = default;
-    Context(uint32_t p, const ConfigDescription& c) : priority(p), config(c) {}
+    Context(uint32_t p, const ConfigDescription& c)
+        : priority(p), config_id(ConfigInterner::Get()->Intern(c)) {
+    }
     explicit Context(uint32_t p) : priority(p) {}
-    explicit Context(const ConfigDescription& c) : priority(kNormalPriority), config(c) {
+    explicit Context(const ConfigDescription& c)
+        : priority(kNormalPriority), config_id(ConfigInterner::Get()->Intern(c)) {
+    }
+
+    const ConfigDescription& config() const {
+      return ConfigInterner::Get()->Lookup(config_id);
     }
   };
 
@@ -204,6 +215,11 @@ class StringPool {
   // Removes any strings that have no references.
   void Prune();
 
+  // Changes the priority of the context of the string or style that `ref` refers to. The new
+  // priority takes effect the next time the pool is sorted.
+  void SetPriority(const Ref& ref, uint32_t priority);
+  void SetPriority(const StyleRef& ref, uint32_t priority);
+
  private:
   DISALLOW_COPY_AND_ASSIGN(StringPool);
 
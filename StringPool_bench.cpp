@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "StringPool.h"
+
+#include "android-base/macros.h"
+#include "android-base/stringprintf.h"
+#include "androidfw/ResourceTypes.h"
+#include "benchmark/benchmark.h"
+
+#include "test/Test.h"
+#include "util/BigBuffer.h"
+#include "util/Util.h"
+
+using ::android::ResStringPool;
+using ::android::base::StringPrintf;
+
+namespace aapt {
+
+// Builds a pool shaped like the value pool of an app translated into many scripts: ASCII strings
+// next to CJK, Arabic and emoji heavy ones.
+static void BuildMultilingualPool(size_t string_count, StringPool* pool) {
+  static const char* kPhrases[] = {
+      "Settings saved. Tap here to undo the last change",
+      "\xe8\xae\xbe\xe7\xbd\xae\xe5\xb7\xb2\xe4\xbf\x9d\xe5\xad\x98\xe3\x80\x82"
+      "\xe7\x82\xb9\xe5\x87\xbb\xe6\xad\xa4\xe5\xa4\x84\xe6\x92\xa4\xe6\xb6\x88",
+      "\xe8\xa8\xad\xe5\xae\x9a\xe3\x82\x92\xe4\xbf\x9d\xe5\xad\x98\xe3\x81\x97"
+      "\xe3\x81\xbe\xe3\x81\x97\xe3\x81\x9f",
+      "\xd8\xaa\xd9\x85 \xd8\xad\xd9\x81\xd8\xb8 \xd8\xa7\xd9\x84\xd8\xa5\xd8\xb9\xd8\xaf\xd8\xa7"
+      "\xd8\xaf\xd8\xa7\xd8\xaa",
+      "Saved \xf0\x9f\x8e\x89\xf0\x9f\x91\x8d\xf0\x9f\x98\x80 see you soon \xe2\x9c\xa8",
+  };
+
+  for (size_t i = 0; i < string_count; i++) {
+    const char* phrase = kPhrases[i % arraysize(kPhrases)];
+    pool->MakeRef(StringPrintf("%s (%zu)", phrase, i));
+  }
+}
+
+static void BM_StringPoolFlattenUtf8(benchmark::State& state) {
+  StringPool pool;
+  BuildMultilingualPool(state.range(0), &pool);
+  while (state.KeepRunning()) {
+    BigBuffer buffer(1024);
+    CHECK(StringPool::FlattenUtf8(&buffer, pool));
+  }
+}
+BENCHMARK(BM_StringPoolFlattenUtf8)->Arg(1000)->Arg(10000)->Arg(50000);
+
+static void BM_StringPoolFlattenUtf16(benchmark::State& state) {
+  StringPool pool;
+  BuildMultilingualPool(state.range(0), &pool);
+  while (state.KeepRunning()) {
+    BigBuffer buffer(1024);
+    CHECK(StringPool::FlattenUtf16(&buffer, pool));
+  }
+}
+BENCHMARK(BM_StringPoolFlattenUtf16)->Arg(1000)->Arg(10000)->Arg(50000);
+
+// Reads every string of a UTF-16 pool back as UTF-8, the way BinaryResourceParser does.
+static void BM_StringPoolReadUtf16(benchmark::State& state) {
+  StringPool pool;
+  BuildMultilingualPool(state.range(0), &pool);
+  BigBuffer buffer(1024);
+  CHECK(StringPool::FlattenUtf16(&buffer, pool));
+  std::unique_ptr<uint8_t[]> data = util::Copy(buffer);
+
+  ResStringPool res_pool;
+  CHECK(res_pool.setTo(data.get(), buffer.size()) == android::NO_ERROR);
+  while (state.KeepRunning()) {
+    for (size_t i = 0; i < res_pool.size(); i++) {
+      benchmark::DoNotOptimize(util::GetString(res_pool, i));
+    }
+  }
+}
+BENCHMARK(BM_StringPoolReadUtf16)->Arg(1000)->Arg(10000)->Arg(50000);
+
+}  // namespace aapt
@@ -145,6 +145,24 @@ TEST(StringPoolTest, SortAndStillDedupe) {
   EXPECT_THAT(ref_f.index(), Eq(ref_c.index()));
 }
 
+TEST(StringPoolTest, SortByPriorityAfterSettingIt) {
+  StringPool pool;
+
+  StringPool::Ref ref_a = pool.MakeRef("a");
+  StringPool::Ref ref_m = pool.MakeRef("m");
+  StringPool::Ref ref_z = pool.MakeRef("z");
+
+  pool.SetPriority(ref_z, StringPool::Context::kHotPriority);
+  pool.Sort([](const StringPool::Context& a, const StringPool::Context& b) -> int {
+    return util::compare(a.priority, b.priority);
+  });
+
+  EXPECT_THAT(ref_z.index(), Eq(0u));
+  EXPECT_THAT(ref_a.index(), Eq(1u));
+  EXPECT_THAT(ref_m.index(), Eq(2u));
+  EXPECT_THAT(ref_z.GetContext().priority, Eq(StringPool::Context::kHotPriority));
+}
+
 TEST(StringPoolTest, AddStyles) {
   StringPool pool;
 
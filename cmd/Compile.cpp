@@ -248,7 +248,8 @@ static bool CompileTable(IAaptContext* context, const CompileOptions& options,
     // ZeroCopyOutputStream interface.
     CopyingOutputStreamAdaptor copying_adaptor(writer);
 
-    std::unique_ptr<pb::ResourceTable> pb_table = SerializeTableToPb(&table);
+    google::protobuf::Arena arena(MakeArenaOptions(0u));
+    pb::ResourceTable* pb_table = SerializeTableToPb(&table, &arena);
     if (!pb_table->SerializeToZeroCopyStream(&copying_adaptor)) {
       context->GetDiagnostics()->Error(DiagMessage(output_path) << "failed to write");
       return false;
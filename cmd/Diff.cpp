@@ -14,13 +14,21 @@
  * limitations under the License.
  */
 
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
 #include "android-base/macros.h"
 
 #include "Flags.h"
 #include "LoadedApk.h"
 #include "ValueVisitor.h"
+#include "diff/TableDigest.h"
 #include "process/IResourceTableConsumer.h"
 #include "process/SymbolTable.h"
+#include "util/ThreadPool.h"
+#include "util/Util.h"
 
 using android::StringPiece;
 
@@ -71,9 +79,63 @@ class DiffContext : public IAaptContext {
   SymbolTable symbol_table_;
 };
 
-static void EmitDiffLine(const Source& source, const StringPiece& message) {
-  std::cerr << source << ": " << message << "\n";
-}
+// Collects the differences found in one part of the tables. Parts are compared on different
+// threads, each with its own printer, and the printers are written out in order afterwards.
+//
+// Each difference is either written as a human readable message, or as a line of tab-separated
+// fields for tools to consume: the kind of difference, the resource, and then any details, such
+// as the config or the values in the first and second APK.
+class DiffPrinter {
+ public:
+  explicit DiffPrinter(bool machine_readable) : machine_readable_(machine_readable) {
+  }
+
+  void Emit(const Source& source, const StringPiece& kind, const std::string& resource,
+            const std::vector<std::string>& details, const StringPiece& message) {
+    if (!machine_readable_) {
+      out_ << source << ": " << message << "\n";
+      return;
+    }
+
+    out_ << kind << "\t" << Escape(resource);
+    for (const std::string& detail : details) {
+      out_ << "\t" << Escape(detail);
+    }
+    out_ << "\n";
+  }
+
+  std::string str() const {
+    return out_.str();
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(DiffPrinter);
+
+  // Keeps each difference on one line and its fields apart.
+  static std::string Escape(const StringPiece& str) {
+    std::string escaped;
+    for (char c : str) {
+      switch (c) {
+        case '\\':
+          escaped += "\\\\";
+          break;
+        case '\t':
+          escaped += "\\t";
+          break;
+        case '\n':
+          escaped += "\\n";
+          break;
+        default:
+          escaped += c;
+          break;
+      }
+    }
+    return escaped;
+  }
+
+  bool machine_readable_;
+  std::stringstream out_;
+};
 
 static bool IsSymbolVisibilityDifferent(const Symbol& symbol_a, const Symbol& symbol_b) {
   return symbol_a.state != symbol_b.state;
@@ -88,45 +150,66 @@ static bool IsIdDiff(const Symbol& symbol_a, const Maybe<Id>& id_a, const Symbol
   return false;
 }
 
-static bool EmitResourceConfigValueDiff(IAaptContext* context, LoadedApk* apk_a,
-                                        ResourceTablePackage* pkg_a, ResourceTableType* type_a,
-                                        ResourceEntry* entry_a, ResourceConfigValue* config_value_a,
-                                        LoadedApk* apk_b, ResourceTablePackage* pkg_b,
-                                        ResourceTableType* type_b, ResourceEntry* entry_b,
+static std::string VisibilityToString(const Symbol& symbol) {
+  return symbol.state == SymbolState::kPublic ? "PUBLIC" : "PRIVATE";
+}
+
+template <typename Id>
+static std::string IdToString(const Maybe<Id>& id) {
+  if (!id) {
+    return "none";
+  }
+  std::stringstream str_stream;
+  str_stream << "0x" << std::hex << id.value();
+  return str_stream.str();
+}
+
+static std::string ValueToString(const Value* value) {
+  std::stringstream str_stream;
+  value->Print(&str_stream);
+  return str_stream.str();
+}
+
+static void EmitResourceConfigValueDiff(DiffPrinter* printer, LoadedApk* apk_b,
+                                        const std::string& resource,
+                                        ResourceConfigValue* config_value_a,
                                         ResourceConfigValue* config_value_b) {
   Value* value_a = config_value_a->value.get();
   Value* value_b = config_value_b->value.get();
-  if (!value_a->Equals(value_b)) {
-    std::stringstream str_stream;
-    str_stream << "value " << pkg_a->name << ":" << type_a->type << "/" << entry_a->name
-               << " config=" << config_value_a->config << " does not match:\n";
-    value_a->Print(&str_stream);
-    str_stream << "\n vs \n";
-    value_b->Print(&str_stream);
-    EmitDiffLine(apk_b->GetSource(), str_stream.str());
-    return true;
-  }
-  return false;
+  const std::string value_str_a = ValueToString(value_a);
+  const std::string value_str_b = ValueToString(value_b);
+
+  std::stringstream str_stream;
+  str_stream << "value " << resource << " config=" << config_value_a->config
+             << " does not match:\n"
+             << value_str_a << "\n vs \n"
+             << value_str_b;
+  printer->Emit(apk_b->GetSource(), "value", resource,
+                {config_value_a->config.toString().string(), value_str_a, value_str_b},
+                str_stream.str());
 }
 
-static bool EmitResourceEntryDiff(IAaptContext* context, LoadedApk* apk_a,
+static bool EmitResourceEntryDiff(DiffPrinter* printer, LoadedApk* apk_a,
                                   ResourceTablePackage* pkg_a, ResourceTableType* type_a,
                                   ResourceEntry* entry_a, LoadedApk* apk_b,
                                   ResourceTablePackage* pkg_b, ResourceTableType* type_b,
                                   ResourceEntry* entry_b) {
+  std::stringstream name_stream;
+  name_stream << pkg_a->name << ":" << type_a->type << "/" << entry_a->name;
+  const std::string resource = name_stream.str();
+
   bool diff = false;
   for (std::unique_ptr<ResourceConfigValue>& config_value_a : entry_a->values) {
     ResourceConfigValue* config_value_b = entry_b->FindValue(config_value_a->config);
     if (!config_value_b) {
       std::stringstream str_stream;
-      str_stream << "missing " << pkg_a->name << ":" << type_a->type << "/" << entry_a->name
-                 << " config=" << config_value_a->config;
-      EmitDiffLine(apk_b->GetSource(), str_stream.str());
+      str_stream << "missing " << resource << " config=" << config_value_a->config;
+      printer->Emit(apk_b->GetSource(), "missing-config", resource,
+                    {config_value_a->config.toString().string()}, str_stream.str());
+      diff = true;
+    } else if (!config_value_a->value->Equals(config_value_b->value.get())) {
+      EmitResourceConfigValueDiff(printer, apk_b, resource, config_value_a.get(), config_value_b);
       diff = true;
-    } else {
-      diff |=
-          EmitResourceConfigValueDiff(context, apk_a, pkg_a, type_a, entry_a, config_value_a.get(),
-                                      apk_b, pkg_b, type_b, entry_b, config_value_b);
     }
   }
 
@@ -135,193 +218,221 @@ static bool EmitResourceEntryDiff(IAaptContext* context, LoadedApk* apk_a,
     ResourceConfigValue* config_value_a = entry_a->FindValue(config_value_b->config);
     if (!config_value_a) {
       std::stringstream str_stream;
-      str_stream << "new config " << pkg_b->name << ":" << type_b->type << "/" << entry_b->name
-                 << " config=" << config_value_b->config;
-      EmitDiffLine(apk_b->GetSource(), str_stream.str());
+      str_stream << "new config " << resource << " config=" << config_value_b->config;
+      printer->Emit(apk_b->GetSource(), "new-config", resource,
+                    {config_value_b->config.toString().string()}, str_stream.str());
       diff = true;
     }
   }
-  return false;
+  return diff;
 }
 
-static bool EmitResourceTypeDiff(IAaptContext* context, LoadedApk* apk_a,
-                                 ResourceTablePackage* pkg_a, ResourceTableType* type_a,
-                                 LoadedApk* apk_b, ResourceTablePackage* pkg_b,
-                                 ResourceTableType* type_b) {
-  bool diff = false;
-  for (std::unique_ptr<ResourceEntry>& entry_a : type_a->entries) {
-    ResourceEntry* entry_b = type_b->FindEntry(entry_a->name);
-    if (!entry_b) {
-      std::stringstream str_stream;
-      str_stream << "missing " << pkg_a->name << ":" << type_a->type << "/" << entry_a->name;
-      EmitDiffLine(apk_b->GetSource(), str_stream.str());
-      diff = true;
-    } else {
-      if (IsSymbolVisibilityDifferent(entry_a->symbol_status, entry_b->symbol_status)) {
-        std::stringstream str_stream;
-        str_stream << pkg_a->name << ":" << type_a->type << "/" << entry_a->name
-                   << " has different visibility (";
-        if (entry_b->symbol_status.state == SymbolState::kPublic) {
-          str_stream << "PUBLIC";
-        } else {
-          str_stream << "PRIVATE";
-        }
-        str_stream << " vs ";
-        if (entry_a->symbol_status.state == SymbolState::kPublic) {
-          str_stream << "PUBLIC";
-        } else {
-          str_stream << "PRIVATE";
-        }
-        str_stream << ")";
-        EmitDiffLine(apk_b->GetSource(), str_stream.str());
-        diff = true;
-      } else if (IsIdDiff(entry_a->symbol_status, entry_a->id, entry_b->symbol_status,
-                          entry_b->id)) {
-        std::stringstream str_stream;
-        str_stream << pkg_a->name << ":" << type_a->type << "/" << entry_a->name
-                   << " has different public ID (";
-        if (entry_b->id) {
-          str_stream << "0x" << std::hex << entry_b->id.value();
-        } else {
-          str_stream << "none";
-        }
-        str_stream << " vs ";
-        if (entry_a->id) {
-          str_stream << "0x " << std::hex << entry_a->id.value();
-        } else {
-          str_stream << "none";
-        }
-        str_stream << ")";
-        EmitDiffLine(apk_b->GetSource(), str_stream.str());
-        diff = true;
-      }
-      diff |= EmitResourceEntryDiff(context, apk_a, pkg_a, type_a, entry_a.get(), apk_b, pkg_b,
-                                    type_b, entry_b);
-    }
-  }
+static bool EmitEntryPairDiff(DiffPrinter* printer, LoadedApk* apk_a,
+                              ResourceTablePackage* pkg_a, ResourceTableType* type_a,
+                              ResourceEntry* entry_a, LoadedApk* apk_b,
+                              ResourceTablePackage* pkg_b, ResourceTableType* type_b,
+                              ResourceEntry* entry_b) {
+  std::stringstream name_stream;
+  name_stream << pkg_a->name << ":" << type_a->type << "/" << entry_a->name;
+  const std::string resource = name_stream.str();
 
-  // Check for any newly added entries.
-  for (std::unique_ptr<ResourceEntry>& entry_b : type_b->entries) {
-    ResourceEntry* entry_a = type_a->FindEntry(entry_b->name);
-    if (!entry_a) {
-      std::stringstream str_stream;
-      str_stream << "new entry " << pkg_b->name << ":" << type_b->type << "/" << entry_b->name;
-      EmitDiffLine(apk_b->GetSource(), str_stream.str());
-      diff = true;
-    }
+  bool diff = false;
+  if (IsSymbolVisibilityDifferent(entry_a->symbol_status, entry_b->symbol_status)) {
+    std::stringstream str_stream;
+    str_stream << resource << " has different visibility ("
+               << VisibilityToString(entry_b->symbol_status) << " vs "
+               << VisibilityToString(entry_a->symbol_status) << ")";
+    printer->Emit(apk_b->GetSource(), "visibility", resource,
+                  {VisibilityToString(entry_a->symbol_status),
+                   VisibilityToString(entry_b->symbol_status)},
+                  str_stream.str());
+    diff = true;
+  } else if (IsIdDiff(entry_a->symbol_status, entry_a->id, entry_b->symbol_status,
+                      entry_b->id)) {
+    std::stringstream str_stream;
+    str_stream << resource << " has different public ID (" << IdToString(entry_b->id) << " vs "
+               << IdToString(entry_a->id) << ")";
+    printer->Emit(apk_b->GetSource(), "public-id", resource,
+                  {IdToString(entry_a->id), IdToString(entry_b->id)}, str_stream.str());
+    diff = true;
   }
+  diff |= EmitResourceEntryDiff(printer, apk_a, pkg_a, type_a, entry_a, apk_b, pkg_b, type_b,
+                                entry_b);
   return diff;
 }
 
-static bool EmitResourcePackageDiff(IAaptContext* context, LoadedApk* apk_a,
-                                    ResourceTablePackage* pkg_a, LoadedApk* apk_b,
-                                    ResourceTablePackage* pkg_b) {
+static bool EmitResourceTypeDiff(DiffPrinter* printer, const TableDigests& digests,
+                                 LoadedApk* apk_a, ResourceTablePackage* pkg_a,
+                                 ResourceTableType* type_a, LoadedApk* apk_b,
+                                 ResourceTablePackage* pkg_b, ResourceTableType* type_b) {
+  std::stringstream name_stream;
+  name_stream << pkg_a->name << ":" << type_a->type;
+  const std::string resource = name_stream.str();
+
   bool diff = false;
-  for (std::unique_ptr<ResourceTableType>& type_a : pkg_a->types) {
-    ResourceTableType* type_b = pkg_b->FindType(type_a->type);
-    if (!type_b) {
+  if (IsSymbolVisibilityDifferent(type_a->symbol_status, type_b->symbol_status)) {
+    std::stringstream str_stream;
+    str_stream << resource << " has different visibility ("
+               << VisibilityToString(type_b->symbol_status) << " vs "
+               << VisibilityToString(type_a->symbol_status) << ")";
+    printer->Emit(apk_b->GetSource(), "visibility", resource,
+                  {VisibilityToString(type_a->symbol_status),
+                   VisibilityToString(type_b->symbol_status)},
+                  str_stream.str());
+    diff = true;
+  } else if (IsIdDiff(type_a->symbol_status, type_a->id, type_b->symbol_status, type_b->id)) {
+    std::stringstream str_stream;
+    str_stream << resource << " has different public ID (" << IdToString(type_b->id) << " vs "
+               << IdToString(type_a->id) << ")";
+    printer->Emit(apk_b->GetSource(), "public-id", resource,
+                  {IdToString(type_a->id), IdToString(type_b->id)}, str_stream.str());
+    diff = true;
+  }
+
+  // Both lists of entries are sorted by name, so they can be walked side by side. Only entries
+  // whose digests differ need to be compared.
+  std::vector<ResourceEntry*> new_entries;
+  size_t index_a = 0;
+  size_t index_b = 0;
+  while (index_a < type_a->entries.size() || index_b < type_b->entries.size()) {
+    int cmp;
+    if (index_a == type_a->entries.size()) {
+      cmp = 1;
+    } else if (index_b == type_b->entries.size()) {
+      cmp = -1;
+    } else {
+      cmp = type_a->entries[index_a]->name.compare(type_b->entries[index_b]->name);
+    }
+
+    if (cmp < 0) {
+      ResourceEntry* entry_a = type_a->entries[index_a++].get();
       std::stringstream str_stream;
-      str_stream << "missing " << pkg_a->name << ":" << type_a->type;
-      EmitDiffLine(apk_a->GetSource(), str_stream.str());
+      str_stream << "missing " << resource << "/" << entry_a->name;
+      printer->Emit(apk_b->GetSource(), "missing", resource + "/" + entry_a->name, {},
+                    str_stream.str());
       diff = true;
+    } else if (cmp > 0) {
+      new_entries.push_back(type_b->entries[index_b++].get());
     } else {
-      if (IsSymbolVisibilityDifferent(type_a->symbol_status, type_b->symbol_status)) {
-        std::stringstream str_stream;
-        str_stream << pkg_a->name << ":" << type_a->type << " has different visibility (";
-        if (type_b->symbol_status.state == SymbolState::kPublic) {
-          str_stream << "PUBLIC";
-        } else {
-          str_stream << "PRIVATE";
-        }
-        str_stream << " vs ";
-        if (type_a->symbol_status.state == SymbolState::kPublic) {
-          str_stream << "PUBLIC";
-        } else {
-          str_stream << "PRIVATE";
-        }
-        str_stream << ")";
-        EmitDiffLine(apk_b->GetSource(), str_stream.str());
-        diff = true;
-      } else if (IsIdDiff(type_a->symbol_status, type_a->id, type_b->symbol_status, type_b->id)) {
-        std::stringstream str_stream;
-        str_stream << pkg_a->name << ":" << type_a->type << " has different public ID (";
-        if (type_b->id) {
-          str_stream << "0x" << std::hex << type_b->id.value();
-        } else {
-          str_stream << "none";
-        }
-        str_stream << " vs ";
-        if (type_a->id) {
-          str_stream << "0x " << std::hex << type_a->id.value();
-        } else {
-          str_stream << "none";
-        }
-        str_stream << ")";
-        EmitDiffLine(apk_b->GetSource(), str_stream.str());
-        diff = true;
+      if (digests.GetEntryDigest(type_a, index_a) != digests.GetEntryDigest(type_b, index_b)) {
+        diff |= EmitEntryPairDiff(printer, apk_a, pkg_a, type_a, type_a->entries[index_a].get(),
+                                  apk_b, pkg_b, type_b, type_b->entries[index_b].get());
       }
-      diff |= EmitResourceTypeDiff(context, apk_a, pkg_a, type_a.get(), apk_b, pkg_b, type_b);
+      index_a++;
+      index_b++;
     }
   }
 
-  // Check for any newly added types.
-  for (std::unique_ptr<ResourceTableType>& type_b : pkg_b->types) {
-    ResourceTableType* type_a = pkg_a->FindType(type_b->type);
-    if (!type_a) {
-      std::stringstream str_stream;
-      str_stream << "new type " << pkg_b->name << ":" << type_b->type;
-      EmitDiffLine(apk_b->GetSource(), str_stream.str());
-      diff = true;
-    }
+  // Report any newly added entries after the others.
+  for (ResourceEntry* entry_b : new_entries) {
+    std::stringstream str_stream;
+    str_stream << "new entry " << pkg_b->name << ":" << type_b->type << "/" << entry_b->name;
+    printer->Emit(apk_b->GetSource(), "new", resource + "/" + entry_b->name, {},
+                  str_stream.str());
+    diff = true;
   }
   return diff;
 }
 
-static bool EmitResourceTableDiff(IAaptContext* context, LoadedApk* apk_a, LoadedApk* apk_b) {
+// Compares the tables of two APKs. Packages and types with equal digests are skipped, and the
+// remaining pairs of types are compared on separate threads.
+static bool EmitResourceTableDiff(LoadedApk* apk_a, LoadedApk* apk_b, bool machine_readable) {
   ResourceTable* table_a = apk_a->GetResourceTable();
   ResourceTable* table_b = apk_b->GetResourceTable();
 
-  bool diff = false;
-  for (std::unique_ptr<ResourceTablePackage>& pkg_a : table_a->packages) {
+  ThreadPool thread_pool;
+  TableDigests digests;
+  digests.Compute({table_a, table_b}, &thread_pool);
+
+  // Every difference is found by a task, in the order it is reported in. Most tasks are cheap,
+  // but the comparison of two types can involve every value in them.
+  std::vector<std::function<bool(DiffPrinter*)>> tasks;
+  for (std::unique_ptr<ResourceTablePackage>& pkg_a_ptr : table_a->packages) {
+    ResourceTablePackage* pkg_a = pkg_a_ptr.get();
     ResourceTablePackage* pkg_b = table_b->FindPackage(pkg_a->name);
     if (!pkg_b) {
-      std::stringstream str_stream;
-      str_stream << "missing package " << pkg_a->name;
-      EmitDiffLine(apk_b->GetSource(), str_stream.str());
-      diff = true;
-    } else {
-      if (pkg_a->id != pkg_b->id) {
+      tasks.push_back([=](DiffPrinter* printer) {
+        printer->Emit(apk_b->GetSource(), "missing-package", pkg_a->name, {},
+                      "missing package " + pkg_a->name);
+        return true;
+      });
+      continue;
+    }
+
+    if (pkg_a->id != pkg_b->id) {
+      tasks.push_back([=](DiffPrinter* printer) {
         std::stringstream str_stream;
-        str_stream << "package '" << pkg_a->name << "' has different id (";
-        if (pkg_b->id) {
-          str_stream << "0x" << std::hex << pkg_b->id.value();
-        } else {
-          str_stream << "none";
-        }
-        str_stream << " vs ";
-        if (pkg_a->id) {
-          str_stream << "0x" << std::hex << pkg_a->id.value();
-        } else {
-          str_stream << "none";
-        }
-        str_stream << ")";
-        EmitDiffLine(apk_b->GetSource(), str_stream.str());
-        diff = true;
+        str_stream << "package '" << pkg_a->name << "' has different id ("
+                   << IdToString(pkg_b->id) << " vs " << IdToString(pkg_a->id) << ")";
+        printer->Emit(apk_b->GetSource(), "package-id", pkg_a->name,
+                      {IdToString(pkg_a->id), IdToString(pkg_b->id)}, str_stream.str());
+        return true;
+      });
+    }
+
+    if (digests.GetPackageDigest(pkg_a) == digests.GetPackageDigest(pkg_b)) {
+      continue;
+    }
+
+    for (std::unique_ptr<ResourceTableType>& type_a_ptr : pkg_a->types) {
+      ResourceTableType* type_a = type_a_ptr.get();
+      ResourceTableType* type_b = pkg_b->FindType(type_a->type);
+      if (!type_b) {
+        tasks.push_back([=](DiffPrinter* printer) {
+          std::stringstream str_stream;
+          str_stream << pkg_a->name << ":" << type_a->type;
+          printer->Emit(apk_a->GetSource(), "missing-type", str_stream.str(), {},
+                        "missing " + str_stream.str());
+          return true;
+        });
+      } else if (digests.GetTypeDigest(type_a) != digests.GetTypeDigest(type_b)) {
+        tasks.push_back([=, &digests](DiffPrinter* printer) {
+          return EmitResourceTypeDiff(printer, digests, apk_a, pkg_a, type_a, apk_b, pkg_b,
+                                      type_b);
+        });
+      }
+    }
+
+    // Check for any newly added types.
+    for (std::unique_ptr<ResourceTableType>& type_b_ptr : pkg_b->types) {
+      ResourceTableType* type_b = type_b_ptr.get();
+      if (!pkg_a->FindType(type_b->type)) {
+        tasks.push_back([=](DiffPrinter* printer) {
+          std::stringstream str_stream;
+          str_stream << pkg_b->name << ":" << type_b->type;
+          printer->Emit(apk_b->GetSource(), "new-type", str_stream.str(), {},
+                        "new type " + str_stream.str());
+          return true;
+        });
       }
-      diff |= EmitResourcePackageDiff(context, apk_a, pkg_a.get(), apk_b, pkg_b);
     }
   }
 
   // Check for any newly added packages.
-  for (std::unique_ptr<ResourceTablePackage>& pkg_b : table_b->packages) {
-    ResourceTablePackage* pkg_a = table_a->FindPackage(pkg_b->name);
-    if (!pkg_a) {
-      std::stringstream str_stream;
-      str_stream << "new package " << pkg_b->name;
-      EmitDiffLine(apk_b->GetSource(), str_stream.str());
-      diff = true;
+  for (std::unique_ptr<ResourceTablePackage>& pkg_b_ptr : table_b->packages) {
+    ResourceTablePackage* pkg_b = pkg_b_ptr.get();
+    if (!table_a->FindPackage(pkg_b->name)) {
+      tasks.push_back([=](DiffPrinter* printer) {
+        printer->Emit(apk_b->GetSource(), "new-package", pkg_b->name, {},
+                      "new package " + pkg_b->name);
+        return true;
+      });
     }
   }
+
+  std::vector<std::unique_ptr<DiffPrinter>> printers;
+  for (size_t i = 0; i < tasks.size(); i++) {
+    printers.push_back(util::make_unique<DiffPrinter>(machine_readable));
+  }
+  std::unique_ptr<bool[]> results(new bool[tasks.size()]);
+  thread_pool.ForEach(tasks.size(), [&](size_t i) { results[i] = tasks[i](printers[i].get()); });
+
+  std::ostream& out = machine_readable ? std::cout : std::cerr;
+  bool diff = false;
+  for (size_t i = 0; i < tasks.size(); i++) {
+    out << printers[i]->str();
+    diff |= results[i];
+  }
   return diff;
 }
 
@@ -346,7 +457,13 @@ static void ZeroOutAppReferences(ResourceTable* table) {
 int Diff(const std::vector<StringPiece>& args) {
   DiffContext context;
 
-  Flags flags;
+  bool machine_readable = false;
+  Flags flags = Flags().OptionalSwitch(
+      "--machine-readable",
+      "Writes each difference to stdout as one line of tab-separated fields: the kind of\n"
+      "difference, the resource, and its details, such as the config or the values\n"
+      "in each APK.",
+      &machine_readable);
   if (!flags.Parse("aapt2 diff", args, &std::cerr)) {
     return 1;
   }
@@ -367,7 +484,7 @@ int Diff(const std::vector<StringPiece>& args) {
   ZeroOutAppReferences(apk_a->GetResourceTable());
   ZeroOutAppReferences(apk_b->GetResourceTable());
 
-  if (EmitResourceTableDiff(&context, apk_a.get(), apk_b.get())) {
+  if (EmitResourceTableDiff(apk_a.get(), apk_b.get(), machine_readable)) {
     // We emitted a diff, so return 1 (failure).
     return 1;
   }
@@ -14,18 +14,28 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <set>
+#include <unordered_set>
 #include <vector>
 
+#include "androidfw/ResourceTypes.h"
 #include "androidfw/StringPiece.h"
 
+#include "ConfigDescription.h"
 #include "Debug.h"
 #include "Diagnostics.h"
 #include "Flags.h"
+#include "io/Data.h"
 #include "io/ZipArchive.h"
+#include "ResourceUtils.h"
 #include "process/IResourceTableConsumer.h"
+#include "proto/LazyPbTable.h"
 #include "proto/ProtoSerialize.h"
 #include "unflatten/BinaryResourceParser.h"
+#include "unflatten/BinaryTableIndex.h"
 #include "util/Files.h"
+#include "util/Util.h"
 
 using ::android::StringPiece;
 
@@ -147,6 +157,262 @@ bool TryDumpFile(IAaptContext* context, const std::string& file_path) {
   return true;
 }
 
+// Prints resource tables one type at a time as they are decoded, skipping the packages, types
+// and configurations that were filtered out. An empty filter accepts everything.
+class StreamingTablePrinter {
+ public:
+  StreamingTablePrinter(const std::unordered_set<std::string>& packages,
+                        const std::set<ResourceType>& types,
+                        const std::vector<ConfigDescription>& configs)
+      : packages_(packages), types_(types), configs_(configs) {
+    print_options_.show_sources = true;
+  }
+
+  bool AcceptsPackage(const std::string& name) const {
+    return packages_.empty() || packages_.count(name) != 0;
+  }
+
+  bool AcceptsType(ResourceType type) const {
+    return types_.empty() || types_.count(type) != 0;
+  }
+
+  bool AcceptsConfig(const ConfigDescription& config) const {
+    return configs_.empty() ||
+           std::find(configs_.begin(), configs_.end(), config) != configs_.end();
+  }
+
+  // Removes the values whose configuration was filtered out, then prints the entries left.
+  void PrintType(const ResourceTablePackage& package, ResourceTableType* type) {
+    for (auto& entry : type->entries) {
+      entry->values.erase(
+          std::remove_if(entry->values.begin(), entry->values.end(),
+                         [&](const std::unique_ptr<ResourceConfigValue>& value) -> bool {
+                           return !AcceptsConfig(value->config);
+                         }),
+          entry->values.end());
+    }
+    type->entries.erase(std::remove_if(type->entries.begin(), type->entries.end(),
+                                       [](const std::unique_ptr<ResourceEntry>& entry) -> bool {
+                                         return entry->values.empty();
+                                       }),
+                        type->entries.end());
+    if (type->entries.empty()) {
+      return;
+    }
+
+    if (!printed_package_ || package.name != package_name_ || package.id != package_id_) {
+      Debug::PrintPackageHeader(package);
+      printed_package_ = true;
+      package_name_ = package.name;
+      package_id_ = package.id;
+    }
+    Debug::PrintType(package, type, print_options_);
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(StreamingTablePrinter);
+
+  const std::unordered_set<std::string>& packages_;
+  const std::set<ResourceType>& types_;
+  const std::vector<ConfigDescription>& configs_;
+  DebugPrintTableOptions print_options_;
+
+  // The package whose header was printed last.
+  bool printed_package_ = false;
+  std::string package_name_;
+  Maybe<uint8_t> package_id_;
+};
+
+// Walks the chunks of a resources.arsc, decoding and printing one type chunk at a time. Filtered
+// out chunks are skipped without decoding their entries.
+static bool StreamBinaryTable(IAaptContext* context, const void* data, size_t len,
+                              const Source& source, StreamingTablePrinter* printer) {
+  BinaryResourceParserOptions options;
+  options.package_filter = [&](const std::string& name) -> bool {
+    return printer->AcceptsPackage(name);
+  };
+  options.type_filter = [&](ResourceType type) -> bool { return printer->AcceptsType(type); };
+  options.config_filter = [&](const ConfigDescription& config) -> bool {
+    return printer->AcceptsConfig(config);
+  };
+  options.on_type_chunk = [&](const ResourceTablePackage& package, ResourceTableType* type,
+                              const ConfigDescription& config) -> bool {
+    printer->PrintType(package, type);
+    return true;
+  };
+
+  ResourceTable table;
+  BinaryResourceParser parser(context, &table, source, data, len, nullptr, options);
+  return parser.Parse();
+}
+
+// Decodes and prints one type of a compiled table at a time. The values of all configurations
+// of a type are stored together, so only packages and types are skipped without decoding.
+static bool StreamPbTable(LazyPbTable* lazy_table, StreamingTablePrinter* printer) {
+  for (const LazyPbTable::PackageIndex& package : lazy_table->packages()) {
+    if (!printer->AcceptsPackage(package.name)) {
+      continue;
+    }
+
+    for (const LazyPbTable::TypeIndex& type : package.types) {
+      if (!printer->AcceptsType(type.type)) {
+        continue;
+      }
+
+      ResourceTable table;
+      ResourceTableType* loaded_type = lazy_table->LoadType(package, type, &table);
+      if (loaded_type == nullptr) {
+        return false;
+      }
+      printer->PrintType(*table.packages.front(), loaded_type);
+    }
+  }
+  return true;
+}
+
+static bool IsBinaryTable(const void* data, size_t len) {
+  return len >= sizeof(android::ResChunk_header) &&
+         util::DeviceToHost16(static_cast<const android::ResChunk_header*>(data)->type) ==
+             android::RES_TABLE_TYPE;
+}
+
+// Like TryDumpFile(), but never holds more than one type of a table in memory.
+bool TryStreamFile(IAaptContext* context, const std::string& file_path,
+                   StreamingTablePrinter* printer) {
+  std::string err;
+  std::unique_ptr<io::ZipFileCollection> zip = io::ZipFileCollection::Create(file_path, &err);
+  if (zip) {
+    if (io::IFile* file = zip->FindFile("resources.arsc.flat")) {
+      std::unique_ptr<io::IData> data = file->OpenAsData();
+      if (!data) {
+        context->GetDiagnostics()->Error(DiagMessage(file_path)
+                                         << "failed to open resources.arsc.flat");
+        return false;
+      }
+
+      std::unique_ptr<LazyPbTable> lazy_table =
+          LazyPbTable::Create(std::move(data), Source(file_path), context->GetDiagnostics());
+      return lazy_table != nullptr && StreamPbTable(lazy_table.get(), printer);
+    }
+
+    if (io::IFile* file = zip->FindFile("resources.arsc")) {
+      std::unique_ptr<io::IData> data = file->OpenAsData();
+      if (!data) {
+        context->GetDiagnostics()->Error(DiagMessage(file_path)
+                                         << "failed to open resources.arsc");
+        return false;
+      }
+      return StreamBinaryTable(context, data->data(), data->size(), Source(file_path), printer);
+    }
+  }
+
+  Maybe<android::FileMap> file = file::MmapPath(file_path, &err);
+  if (!file) {
+    context->GetDiagnostics()->Error(DiagMessage(file_path) << err);
+    return false;
+  }
+
+  if (IsBinaryTable(file.value().getDataPtr(), file.value().getDataLength())) {
+    return StreamBinaryTable(context, file.value().getDataPtr(), file.value().getDataLength(),
+                             Source(file_path), printer);
+  }
+
+  // The file may be a compiled file rather than a compiled table, so only report errors once it
+  // is known to be a table.
+  BufferedDiagnostics diag;
+  std::unique_ptr<LazyPbTable> lazy_table = LazyPbTable::Create(
+      util::make_unique<io::MmappedData>(std::move(file.value())), Source(file_path), &diag);
+  if (lazy_table) {
+    const bool result = StreamPbTable(lazy_table.get(), printer);
+    diag.ReplayTo(context->GetDiagnostics());
+    return result;
+  }
+
+  // Not a table, so there is nothing to filter.
+  return TryDumpFile(context, file_path);
+}
+
+static void PrintQueryResult(BinaryTableIndex::Result* result) {
+  std::cout << "resource " << result->id << " " << result->name;
+  if ((result->spec_flags & android::ResTable_typeSpec::SPEC_PUBLIC) != 0) {
+    std::cout << " PUBLIC";
+  }
+  std::cout << std::endl;
+
+  for (BinaryTableIndex::ConfigValue& config_value : result->values) {
+    std::cout << "  (" << config_value.config << ") ";
+    Debug::PrintValue(config_value.value.get());
+    std::cout << std::endl;
+  }
+}
+
+// Answers each query, a resource name or ID, by looking it up in the resources.arsc of
+// `file_path` without parsing the table.
+bool QueryFile(IAaptContext* context, const std::string& file_path,
+               const std::vector<std::string>& queries,
+               const BinaryTableIndex::ConfigFilter& config_filter) {
+  std::unique_ptr<io::IData> data;
+  std::string err;
+  std::unique_ptr<io::ZipFileCollection> zip = io::ZipFileCollection::Create(file_path, &err);
+  if (zip) {
+    io::IFile* file = zip->FindFile("resources.arsc");
+    if (!file) {
+      context->GetDiagnostics()->Error(DiagMessage(file_path)
+                                       << "queries need a resources.arsc, which was not found");
+      return false;
+    }
+    data = file->OpenAsData();
+  } else {
+    Maybe<android::FileMap> file = file::MmapPath(file_path, &err);
+    if (!file) {
+      context->GetDiagnostics()->Error(DiagMessage(file_path) << err);
+      return false;
+    }
+    data = util::make_unique<io::MmappedData>(std::move(file.value()));
+  }
+
+  if (!data) {
+    context->GetDiagnostics()->Error(DiagMessage(file_path) << "failed to open resources.arsc");
+    return false;
+  }
+
+  if (!IsBinaryTable(data->data(), data->size())) {
+    context->GetDiagnostics()->Error(DiagMessage(file_path) << "not a binary resource table");
+    return false;
+  }
+
+  std::unique_ptr<BinaryTableIndex> index =
+      BinaryTableIndex::Create(context, Source(file_path), data->data(), data->size());
+  if (!index) {
+    return false;
+  }
+
+  bool error = false;
+  for (const std::string& query : queries) {
+    Maybe<BinaryTableIndex::Result> result;
+    ResourceNameRef name;
+    if (Maybe<ResourceId> id = ResourceUtils::ParseResourceId(query)) {
+      result = index->FindResource(id.value(), config_filter);
+    } else if (ResourceUtils::ParseResourceName(query, &name)) {
+      result = index->FindResource(name, config_filter);
+    } else {
+      context->GetDiagnostics()->Error(DiagMessage() << "invalid resource name or ID '" << query
+                                                     << "'");
+      error = true;
+      continue;
+    }
+
+    if (!result) {
+      context->GetDiagnostics()->Error(DiagMessage(file_path) << "resource '" << query
+                                                              << "' not found");
+      error = true;
+      continue;
+    }
+    PrintQueryResult(&result.value());
+  }
+  return !error;
+}
+
 class DumpContext : public IAaptContext {
  public:
   PackageType GetPackageType() override {
@@ -199,7 +465,35 @@ class DumpContext : public IAaptContext {
  */
 int Dump(const std::vector<StringPiece>& args) {
   bool verbose = false;
-  Flags flags = Flags().OptionalSwitch("-v", "increase verbosity of output", &verbose);
+  bool stream = false;
+  std::unordered_set<std::string> package_names;
+  std::vector<std::string> type_names;
+  std::vector<std::string> config_strs;
+  std::vector<std::string> queries;
+  Flags flags =
+      Flags()
+          .OptionalSwitch("-v", "increase verbosity of output", &verbose)
+          .OptionalSwitch("--stream",
+                          "Prints resource tables one type at a time as they are decoded,\n"
+                          "instead of loading the whole table first. Resource references\n"
+                          "in resources.arsc are printed as IDs. Implied by the filters below.",
+                          &stream)
+          .OptionalFlagList("--package", "Only dumps the packages with this name.",
+                            &package_names)
+          .OptionalFlagList("--type", "Only dumps resources of this type, e.g. 'string'.",
+                            &type_names)
+          .OptionalFlagList("--config",
+                            "Only dumps values for this configuration, e.g. 'fr-rFR'.\n"
+                            "Use 'default' for the default configuration.",
+                            &config_strs)
+          .OptionalFlagList("--query",
+                            "Prints only the resource with this name or ID, e.g.\n"
+                            "'string/app_name' or '0x7f0a0123', by looking it up in the\n"
+                            "resources.arsc without parsing the whole table. Can be given\n"
+                            "many times to answer a batch of queries, such as in one daemon\n"
+                            "invocation. --config selects the values printed, while\n"
+                            "--package and --type can not be combined with it.",
+                            &queries);
   if (!flags.Parse("aapt2 dump", args, &std::cerr)) {
     return 1;
   }
@@ -207,8 +501,56 @@ int Dump(const std::vector<StringPiece>& args) {
   DumpContext context;
   context.SetVerbose(verbose);
 
+  std::set<ResourceType> types;
+  for (const std::string& type_name : type_names) {
+    const ResourceType* type = ParseResourceType(type_name);
+    if (type == nullptr) {
+      context.GetDiagnostics()->Error(DiagMessage() << "invalid resource type '" << type_name
+                                                    << "'");
+      return 1;
+    }
+    types.insert(*type);
+  }
+
+  std::vector<ConfigDescription> configs;
+  for (const std::string& config_str : config_strs) {
+    ConfigDescription config;
+    if (config_str == "default") {
+      config = ConfigDescription::DefaultConfig();
+    } else if (!ConfigDescription::Parse(config_str, &config)) {
+      context.GetDiagnostics()->Error(DiagMessage() << "invalid configuration '" << config_str
+                                                    << "'");
+      return 1;
+    }
+    configs.push_back(config);
+  }
+
+  stream = stream || !package_names.empty() || !types.empty() || !configs.empty();
+  StreamingTablePrinter printer(package_names, types, configs);
+
+  if (!queries.empty()) {
+    if (!package_names.empty() || !types.empty()) {
+      // A query names a single resource, so only the configuration of its values can be chosen.
+      context.GetDiagnostics()->Error(DiagMessage()
+                                      << "--package and --type can not be used with --query");
+      return 1;
+    }
+
+    auto config_filter = [&](const ConfigDescription& config) -> bool {
+      return printer.AcceptsConfig(config);
+    };
+    for (const std::string& arg : flags.GetArgs()) {
+      if (!QueryFile(&context, arg, queries, config_filter)) {
+        return 1;
+      }
+    }
+    return 0;
+  }
+
   for (const std::string& arg : flags.GetArgs()) {
-    if (!TryDumpFile(&context, arg)) {
+    const bool result =
+        stream ? TryStreamFile(&context, arg, &printer) : TryDumpFile(&context, arg);
+    if (!result) {
       return 1;
     }
   }
@@ -16,13 +16,14 @@
 
 #include <sys/stat.h>
 
-#include <fstream>
+#include <algorithm>
+#include <mutex>
 #include <queue>
+#include <sstream>
 #include <unordered_map>
 #include <vector>
 
 #include "android-base/errors.h"
-#include "android-base/file.h"
 #include "android-base/stringprintf.h"
 #include "androidfw/StringPiece.h"
 #include "google/protobuf/io/coded_stream.h"
@@ -35,6 +36,7 @@
 #include "ResourceUtils.h"
 #include "cmd/Util.h"
 #include "compile/IdAssigner.h"
+#include "compile/StableIdMap.h"
 #include "filter/ConfigFilter.h"
 #include "flatten/Archive.h"
 #include "flatten/TableFlattener.h"
@@ -42,11 +44,14 @@
 #include "io/BigBufferInputStream.h"
 #include "io/FileInputStream.h"
 #include "io/FileSystem.h"
+#include "io/StringInputStream.h"
 #include "io/Util.h"
 #include "io/ZipArchive.h"
+#include "java/ClassDefinition.h"
 #include "java/JavaClassGenerator.h"
 #include "java/ManifestClassGenerator.h"
 #include "java/ProguardRules.h"
+#include "link/IncrementalLinkState.h"
 #include "link/Linkers.h"
 #include "link/ManifestFixer.h"
 #include "link/ReferenceLinker.h"
@@ -56,10 +61,14 @@
 #include "optimize/VersionCollapser.h"
 #include "process/IResourceTableConsumer.h"
 #include "process/SymbolTable.h"
+#include "process/WorkerContext.h"
+#include "proto/LazyPbTable.h"
 #include "proto/ProtoSerialize.h"
 #include "split/TableSplitter.h"
 #include "unflatten/BinaryResourceParser.h"
+#include "util/Digest.h"
 #include "util/Files.h"
+#include "util/ThreadPool.h"
 #include "xml/XmlDom.h"
 
 using ::aapt::io::FileInputStream;
@@ -79,6 +88,7 @@ struct LinkOptions {
 
   // Java/Proguard options.
   Maybe<std::string> generate_java_class_path;
+  Maybe<std::string> generate_java_jar_path;
   Maybe<std::string> custom_java_package;
   std::set<std::string> extra_java_packages;
   Maybe<std::string> generate_text_symbols_path;
@@ -115,8 +125,12 @@ struct LinkOptions {
   std::vector<std::string> split_paths;
 
   // Stable ID options.
-  std::unordered_map<ResourceName, ResourceId> stable_id_map;
+  std::shared_ptr<const StableIdMap> stable_id_map;
   Maybe<std::string> resource_id_map_path;
+  Maybe<std::string> binary_resource_id_map_path;
+
+  // Incremental link options.
+  Maybe<std::string> incremental_state_path;
 };
 
 class LinkContext : public IAaptContext {
@@ -194,6 +208,61 @@ class LinkContext : public IAaptContext {
   int min_sdk_version_ = 0;
 };
 
+// A WorkerContext that looks up symbols through a per-thread cache in front of the parent's
+// SymbolTable.
+class LinkWorkerContext : public WorkerContext {
+ public:
+  LinkWorkerContext(IAaptContext* parent, std::mutex* symbol_lock)
+      : WorkerContext(parent),
+        name_mangler_(NameManglerPolicy{parent->GetCompilationPackage()}),
+        symbols_(&name_mangler_) {
+    symbols_.AppendSource(
+        util::make_unique<SharedSymbolTableSource>(parent->GetExternalSymbols(), symbol_lock));
+  }
+
+  SymbolTable* GetExternalSymbols() override {
+    return &symbols_;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(LinkWorkerContext);
+
+  // Names are mangled by the parent's SymbolTable, so this one only fills in the package.
+  NameMangler name_mangler_;
+  SymbolTable symbols_;
+};
+
+// A WorkerContext that records every symbol looked up through it, so that the next incremental
+// link can tell whether linking an XML file again would give the same result.
+class RecordingLinkContext : public WorkerContext {
+ public:
+  explicit RecordingLinkContext(IAaptContext* parent)
+      : WorkerContext(parent),
+        name_mangler_(NameManglerPolicy{parent->GetCompilationPackage()}),
+        symbols_(&name_mangler_) {
+    std::unique_ptr<RecordingSymbolSource> source =
+        util::make_unique<RecordingSymbolSource>(parent->GetExternalSymbols());
+    recorder_ = source.get();
+    symbols_.AppendSource(std::move(source));
+  }
+
+  SymbolTable* GetExternalSymbols() override {
+    return &symbols_;
+  }
+
+  std::vector<SymbolDependency>* dependencies() {
+    return recorder_->dependencies();
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(RecordingLinkContext);
+
+  // Names are mangled by the parent's SymbolTable, so this one only fills in the package.
+  NameMangler name_mangler_;
+  SymbolTable symbols_;
+  RecordingSymbolSource* recorder_;
+};
+
 // A custom delegate that generates compatible pre-O IDs for use with feature splits.
 // Feature splits use package IDs > 7f, which in Java (since Java doesn't have unsigned ints)
 // is interpreted as a negative number. Some verification was wrongly assuming negative values
@@ -250,8 +319,11 @@ class FeatureSplitSymbolTableDelegate : public DefaultSymbolTableDelegate {
   IAaptContext* context_;
 };
 
+// Flattens `xml_res` and writes it to `path` in the archive. If `out_data` is set, the binary XML
+// is copied to it too.
 static bool FlattenXml(IAaptContext* context, xml::XmlResource* xml_res, const StringPiece& path,
-                       bool keep_raw_values, bool utf16, IArchiveWriter* writer) {
+                       bool keep_raw_values, bool utf16, IArchiveWriter* writer,
+                       std::string* out_data = nullptr) {
   BigBuffer buffer(1024);
   XmlFlattenerOptions options = {};
   options.keep_raw_values = keep_raw_values;
@@ -267,24 +339,20 @@ static bool FlattenXml(IAaptContext* context, xml::XmlResource* xml_res, const S
                                                       << ")");
   }
 
+  if (out_data != nullptr) {
+    *out_data = buffer.to_string();
+  }
+
   io::BigBufferInputStream input_stream(&buffer);
   return io::CopyInputStreamToArchive(context, &input_stream, path.to_string(),
                                       ArchiveEntry::kCompress, writer);
 }
 
+// The intermediate pb::ResourceTable is parsed on an arena that is freed as soon as the
+// ResourceTable has been built from it.
 static std::unique_ptr<ResourceTable> LoadTableFromPb(const Source& source, const void* data,
                                                       size_t len, IDiagnostics* diag) {
-  pb::ResourceTable pb_table;
-  if (!pb_table.ParseFromArray(data, len)) {
-    diag->Error(DiagMessage(source) << "invalid compiled table");
-    return {};
-  }
-
-  std::unique_ptr<ResourceTable> table = DeserializeTableFromPb(pb_table, source, diag);
-  if (!table) {
-    return {};
-  }
-  return table;
+  return DeserializeTableFromPb(data, len, source, diag);
 }
 
 // Inflates an XML file from the source path.
@@ -306,6 +374,10 @@ struct ResourceFileFlattenerOptions {
   bool do_not_compress_anything = false;
   bool update_proguard_spec = false;
   std::unordered_set<std::string> extensions_to_not_compress;
+
+  // When set, XML files whose result would be the same as in the previous link are taken from
+  // here instead of being linked and flattened, and the others are added to it.
+  IncrementalLinkState* incremental_state = nullptr;
 };
 
 // A sampling of public framework resource IDs.
@@ -351,19 +423,39 @@ class ResourceFileFlattener {
     // The XML to process and flatten.
     std::unique_ptr<xml::XmlResource> xml_to_flatten;
 
+    // The digest of the compiled XML file, when linking incrementally.
+    uint64_t input_digest = 0u;
+
     // The destination to write this file to.
     std::string dst_path;
   };
 
   uint32_t GetCompressionFlags(const StringPiece& str);
 
-  std::vector<std::unique_ptr<xml::XmlResource>> LinkAndVersionXmlFile(ResourceTable* table,
+  std::vector<std::unique_ptr<xml::XmlResource>> LinkAndVersionXmlFile(IAaptContext* context,
+                                                                       ResourceTable* table,
                                                                        FileOperation* file_op);
 
+  // Links, versions and flattens an XML file, or reuses the files written for it by the previous
+  // incremental link if its inputs are unchanged.
+  bool FlattenXmlFile(ResourceTable* table, FileOperation* file_op,
+                      IArchiveWriter* archive_writer);
+
+  // Writes the files of an XML file cached by the previous incremental link.
+  bool WriteCachedXmlFile(ResourceTable* table, const FileOperation& file_op,
+                          const CachedXmlFile& cached_file, IArchiveWriter* archive_writer);
+
+  // Collects the proguard rules referenced by `docs` into keep_set_. The files are spread over
+  // several threads, each collecting into its own KeepSet, and the sets are merged at the end.
+  bool CollectProguardRules(const std::vector<xml::XmlResource*>& docs);
+
   ResourceFileFlattenerOptions options_;
   IAaptContext* context_;
   proguard::KeepSet* keep_set_;
   XmlCompatVersioner::Rules rules_;
+
+  // The attributes with versioning rules, which depend on the framework linked against.
+  uint64_t rules_digest_ = 0u;
 };
 
 ResourceFileFlattener::ResourceFileFlattener(const ResourceFileFlattenerOptions& options,
@@ -417,6 +509,12 @@ ResourceFileFlattener::ResourceFileFlattener(const ResourceFileFlattenerOptions&
     rules_[R::attr::layout_marginVertical] =
         util::make_unique<DegradeToManyRule>(std::move(replacements));
   }
+
+  Digest rules_digest;
+  for (const auto& rule : rules_) {
+    rules_digest.Update(rule.first.id);
+  }
+  rules_digest_ = rules_digest.value();
 }
 
 uint32_t ResourceFileFlattener::GetCompressionFlags(const StringPiece& str) {
@@ -453,26 +551,22 @@ std::vector<T> make_singleton_vec(T&& val) {
 }
 
 std::vector<std::unique_ptr<xml::XmlResource>> ResourceFileFlattener::LinkAndVersionXmlFile(
-    ResourceTable* table, FileOperation* file_op) {
+    IAaptContext* context, ResourceTable* table, FileOperation* file_op) {
   xml::XmlResource* doc = file_op->xml_to_flatten.get();
   const Source& src = doc->file.source;
 
-  if (context_->IsVerbose()) {
-    context_->GetDiagnostics()->Note(DiagMessage() << "linking " << src.path);
+  if (context->IsVerbose()) {
+    context->GetDiagnostics()->Note(DiagMessage() << "linking " << src.path);
   }
 
   XmlReferenceLinker xml_linker;
-  if (!xml_linker.Consume(context_, doc)) {
-    return {};
-  }
-
-  if (options_.update_proguard_spec && !proguard::CollectProguardRules(src, doc, keep_set_)) {
+  if (!xml_linker.Consume(context, doc)) {
     return {};
   }
 
   if (options_.no_xml_namespaces) {
     XmlNamespaceRemover namespace_remover;
-    if (!namespace_remover.Consume(context_, doc)) {
+    if (!namespace_remover.Consume(context, doc)) {
       return {};
     }
   }
@@ -498,7 +592,139 @@ std::vector<std::unique_ptr<xml::XmlResource>> ResourceFileFlattener::LinkAndVer
   XmlCompatVersioner xml_compat_versioner(&rules_);
   const util::Range<ApiVersion> api_range{config.sdkVersion,
                                           FindNextApiVersionForConfig(entry, config)};
-  return xml_compat_versioner.Process(context_, doc, api_range);
+  return xml_compat_versioner.Process(context, doc, api_range);
+}
+
+bool ResourceFileFlattener::FlattenXmlFile(ResourceTable* table, FileOperation* file_op,
+                                           IArchiveWriter* archive_writer) {
+  const ConfigDescription& config = file_op->config;
+  IAaptContext* link_context = context_;
+  std::unique_ptr<RecordingLinkContext> recording_context;
+  if (options_.incremental_state != nullptr) {
+    // The versions this entry is already defined for decide how the file is auto-versioned.
+    file_op->input_digest = Digest()
+                                .Update(file_op->input_digest)
+                                .Update(FindNextApiVersionForConfig(file_op->entry, config))
+                                .Update(rules_digest_)
+                                .value();
+
+    std::shared_ptr<const CachedXmlFile> cached_file = options_.incremental_state->FindUpToDate(
+        file_op->dst_path, file_op->input_digest, context_->GetExternalSymbols());
+    if (cached_file != nullptr) {
+      return WriteCachedXmlFile(table, *file_op, *cached_file, archive_writer);
+    }
+
+    recording_context = util::make_unique<RecordingLinkContext>(context_);
+    link_context = recording_context.get();
+  }
+
+  std::vector<std::unique_ptr<xml::XmlResource>> versioned_docs =
+      LinkAndVersionXmlFile(link_context, table, file_op);
+  if (recording_context != nullptr) {
+    recording_context->GetDiagnostics()->ReplayTo(context_->GetDiagnostics());
+  }
+
+  if (versioned_docs.empty()) {
+    return false;
+  }
+
+  std::unique_ptr<CachedXmlFile> new_cached_file;
+  if (recording_context != nullptr) {
+    new_cached_file = util::make_unique<CachedXmlFile>();
+    new_cached_file->input_digest = file_op->input_digest;
+    new_cached_file->dependencies = std::move(*recording_context->dependencies());
+  }
+
+  bool error = false;
+  for (std::unique_ptr<xml::XmlResource>& doc : versioned_docs) {
+    std::string dst_path = file_op->dst_path;
+    if (doc->file.config != file_op->config) {
+      // Only add the new versioned configurations.
+      if (context_->IsVerbose()) {
+        context_->GetDiagnostics()->Note(DiagMessage(doc->file.source)
+                                         << "auto-versioning resource from config '"
+                                         << config << "' -> '" << doc->file.config << "'");
+      }
+
+      dst_path = ResourceUtils::BuildResourceFileName(doc->file, context_->GetNameMangler());
+      bool result = table->AddFileReferenceAllowMangled(doc->file.name, doc->file.config,
+                                                        doc->file.source, dst_path, nullptr,
+                                                        context_->GetDiagnostics());
+      if (!result) {
+        return false;
+      }
+    }
+
+    std::string* out_data = nullptr;
+    if (new_cached_file != nullptr) {
+      new_cached_file->outputs.push_back(CachedXmlOutput{doc->file.config, dst_path, {}});
+      out_data = &new_cached_file->outputs.back().data;
+    }
+    error |= !FlattenXml(context_, doc.get(), dst_path, options_.keep_raw_values,
+                         false /*utf16*/, archive_writer, out_data);
+  }
+
+  if (error) {
+    return false;
+  }
+
+  if (new_cached_file != nullptr) {
+    options_.incremental_state->Add(file_op->dst_path, std::move(new_cached_file));
+  }
+  return true;
+}
+
+bool ResourceFileFlattener::WriteCachedXmlFile(ResourceTable* table, const FileOperation& file_op,
+                                               const CachedXmlFile& cached_file,
+                                               IArchiveWriter* archive_writer) {
+  const xml::XmlResource* doc = file_op.xml_to_flatten.get();
+  if (context_->IsVerbose()) {
+    context_->GetDiagnostics()->Note(DiagMessage(doc->file.source)
+                                     << "unchanged since the last link");
+  }
+
+  bool error = false;
+  for (const CachedXmlOutput& output : cached_file.outputs) {
+    if (output.config != file_op.config) {
+      bool result = table->AddFileReferenceAllowMangled(doc->file.name, output.config,
+                                                        doc->file.source, output.path, nullptr,
+                                                        context_->GetDiagnostics());
+      if (!result) {
+        return false;
+      }
+    }
+
+    io::StringInputStream input_stream(output.data);
+    error |= !io::CopyInputStreamToArchive(context_, &input_stream, output.path,
+                                           ArchiveEntry::kCompress, archive_writer);
+  }
+  return !error;
+}
+
+bool ResourceFileFlattener::CollectProguardRules(const std::vector<xml::XmlResource*>& docs) {
+  if (docs.empty()) {
+    return true;
+  }
+
+  ThreadPool thread_pool;
+  const size_t set_count = std::min(docs.size(), thread_pool.max_threads());
+  std::vector<proguard::KeepSet> keep_sets(set_count);
+  std::unique_ptr<bool[]> results(new bool[set_count]);
+  thread_pool.ForEach(set_count, [&](size_t i) {
+    results[i] = true;
+    for (size_t j = i; j < docs.size(); j += set_count) {
+      if (!proguard::CollectProguardRules(docs[j]->file.source, docs[j], &keep_sets[i])) {
+        results[i] = false;
+      }
+    }
+  });
+
+  bool error = false;
+  for (size_t i = 0; i < set_count; i++) {
+    error |= !results[i];
+    keep_set_->Merge(keep_sets[i]);
+  }
+  return !error;
 }
 
 bool ResourceFileFlattener::Flatten(ResourceTable* table, IArchiveWriter* archive_writer) {
@@ -545,6 +771,10 @@ bool ResourceFileFlattener::Flatten(ResourceTable* table, IArchiveWriter* archiv
               return false;
             }
 
+            if (options_.incremental_state != nullptr) {
+              file_op.input_digest = Digest().Update(data->data(), data->size()).value();
+            }
+
             file_op.xml_to_flatten = xml::Inflate(data->data(), data->size(),
                                                   context_->GetDiagnostics(), file->GetSource());
 
@@ -567,41 +797,24 @@ bool ResourceFileFlattener::Flatten(ResourceTable* table, IArchiveWriter* archiv
         }
       }
 
+      // Proguard rules only depend on the unlinked XML, so they are collected up front for all
+      // of this type's files instead of while linking each one.
+      if (options_.update_proguard_spec) {
+        std::vector<xml::XmlResource*> docs;
+        for (auto& map_entry : config_sorted_files) {
+          if (map_entry.second.xml_to_flatten) {
+            docs.push_back(map_entry.second.xml_to_flatten.get());
+          }
+        }
+        error |= !CollectProguardRules(docs);
+      }
+
       // Now flatten the sorted values.
       for (auto& map_entry : config_sorted_files) {
-        const ConfigDescription& config = map_entry.first.first;
         FileOperation& file_op = map_entry.second;
 
         if (file_op.xml_to_flatten) {
-          std::vector<std::unique_ptr<xml::XmlResource>> versioned_docs =
-              LinkAndVersionXmlFile(table, &file_op);
-          if (versioned_docs.empty()) {
-            error = true;
-            continue;
-          }
-
-          for (std::unique_ptr<xml::XmlResource>& doc : versioned_docs) {
-            std::string dst_path = file_op.dst_path;
-            if (doc->file.config != file_op.config) {
-              // Only add the new versioned configurations.
-              if (context_->IsVerbose()) {
-                context_->GetDiagnostics()->Note(DiagMessage(doc->file.source)
-                                                 << "auto-versioning resource from config '"
-                                                 << config << "' -> '" << doc->file.config << "'");
-              }
-
-              dst_path =
-                  ResourceUtils::BuildResourceFileName(doc->file, context_->GetNameMangler());
-              bool result = table->AddFileReferenceAllowMangled(doc->file.name, doc->file.config,
-                                                                doc->file.source, dst_path, nullptr,
-                                                                context_->GetDiagnostics());
-              if (!result) {
-                return false;
-              }
-            }
-            error |= !FlattenXml(context_, doc.get(), dst_path, options_.keep_raw_values,
-                                 false /*utf16*/, archive_writer);
-          }
+          error |= !FlattenXmlFile(table, &file_op, archive_writer);
         } else {
           error |= !io::CopyFileToArchive(context_, file_op.file_to_copy, file_op.dst_path,
                                           GetCompressionFlags(file_op.dst_path), archive_writer);
@@ -612,76 +825,22 @@ bool ResourceFileFlattener::Flatten(ResourceTable* table, IArchiveWriter* archiv
   return !error;
 }
 
-static bool WriteStableIdMapToPath(IDiagnostics* diag,
-                                   const std::unordered_map<ResourceName, ResourceId>& id_map,
-                                   const std::string& id_map_path) {
-  std::ofstream fout(id_map_path, std::ofstream::binary);
-  if (!fout) {
-    diag->Error(DiagMessage(id_map_path) << strerror(errno));
+// Writes a generated side output, leaving the file untouched when its contents are unchanged.
+static bool WriteOutputFile(IDiagnostics* diag, const std::string& path,
+                            const std::string& contents) {
+  std::string error;
+  if (!file::WriteFileIfChanged(path, contents, &error)) {
+    diag->Error(DiagMessage() << "failed writing to '" << path << "': " << error);
     return false;
   }
-
-  for (const auto& entry : id_map) {
-    const ResourceName& name = entry.first;
-    const ResourceId& id = entry.second;
-    fout << name << " = " << id << "\n";
-  }
-
-  if (!fout) {
-    diag->Error(DiagMessage(id_map_path) << "failed writing to file: "
-                                         << android::base::SystemErrorCodeToString(errno));
-    return false;
-  }
-
   return true;
 }
 
-static bool LoadStableIdMap(IDiagnostics* diag, const std::string& path,
-                            std::unordered_map<ResourceName, ResourceId>* out_id_map) {
-  std::string content;
-  if (!android::base::ReadFileToString(path, &content, true /*follow_symlinks*/)) {
-    diag->Error(DiagMessage(path) << "failed reading stable ID file");
-    return false;
-  }
-
-  out_id_map->clear();
-  size_t line_no = 0;
-  for (StringPiece line : util::Tokenize(content, '\n')) {
-    line_no++;
-    line = util::TrimWhitespace(line);
-    if (line.empty()) {
-      continue;
-    }
-
-    auto iter = std::find(line.begin(), line.end(), '=');
-    if (iter == line.end()) {
-      diag->Error(DiagMessage(Source(path, line_no)) << "missing '='");
-      return false;
-    }
-
-    ResourceNameRef name;
-    StringPiece res_name_str =
-        util::TrimWhitespace(line.substr(0, std::distance(line.begin(), iter)));
-    if (!ResourceUtils::ParseResourceName(res_name_str, &name)) {
-      diag->Error(DiagMessage(Source(path, line_no)) << "invalid resource name '" << res_name_str
-                                                     << "'");
-      return false;
-    }
-
-    const size_t res_id_start_idx = std::distance(line.begin(), iter) + 1;
-    const size_t res_id_str_len = line.size() - res_id_start_idx;
-    StringPiece res_id_str = util::TrimWhitespace(line.substr(res_id_start_idx, res_id_str_len));
-
-    Maybe<ResourceId> maybe_id = ResourceUtils::ParseResourceId(res_id_str);
-    if (!maybe_id) {
-      diag->Error(DiagMessage(Source(path, line_no)) << "invalid resource ID '" << res_id_str
-                                                     << "'");
-      return false;
-    }
-
-    (*out_id_map)[name.ToResourceName()] = maybe_id.value();
-  }
-  return true;
+static bool WriteStableIdMapToPath(IDiagnostics* diag, const StableIdMap::NameIdMap& id_map,
+                                   const std::string& id_map_path) {
+  std::ostringstream out;
+  StableIdMap::WriteText(id_map, &out);
+  return WriteOutputFile(diag, id_map_path, out.str());
 }
 
 class LinkCommand {
@@ -707,7 +866,7 @@ class LinkCommand {
 
       // First try to load the file as a static lib.
       std::string error_str;
-      std::unique_ptr<ResourceTable> include_static = LoadStaticLibrary(path, &error_str);
+      std::unique_ptr<LazyPbTable> include_static = LoadStaticLibrary(path, &error_str);
       if (include_static) {
         if (context_->GetPackageType() != PackageType::kStaticLib) {
           // Can't include static libraries when not building a static library (they have no IDs
@@ -723,17 +882,16 @@ class LinkCommand {
           // Since package names can differ, and multiple packages can exist in a ResourceTable,
           // we place the requirement that all static libraries are built with the package
           // ID 0x7f. So if one is not found, this is an error.
-          if (ResourceTablePackage* pkg = include_static->FindPackageById(kAppPackageId)) {
-            pkg->name = context_->GetCompilationPackage();
-          } else {
+          if (!include_static->RenamePackage(kAppPackageId, context_->GetCompilationPackage())) {
             context_->GetDiagnostics()->Error(DiagMessage(path)
                                               << "no package with ID 0x7f found in static library");
             return false;
           }
         }
 
+        // Only the types of the attributes that are actually looked up get decoded.
         context_->GetExternalSymbols()->AppendSource(
-            util::make_unique<ResourceTableSymbolSource>(include_static.get()));
+            util::make_unique<LazyPbTableSymbolSource>(include_static.get()));
 
         static_table_includes_.push_back(std::move(include_static));
 
@@ -893,79 +1051,107 @@ class LinkCommand {
     return true;
   }
 
-  std::unique_ptr<IArchiveWriter> MakeArchiveWriter(const StringPiece& out) {
+  std::unique_ptr<IArchiveWriter> MakeArchiveWriter(IDiagnostics* diag, const StringPiece& out) {
     if (options_.output_to_directory) {
-      return CreateDirectoryArchiveWriter(context_->GetDiagnostics(), out);
+      return CreateDirectoryArchiveWriter(diag, out);
     } else {
-      return CreateZipFileArchiveWriter(context_->GetDiagnostics(), out);
+      return CreateZipFileArchiveWriter(diag, out);
     }
   }
 
-  bool FlattenTable(ResourceTable* table, IArchiveWriter* writer) {
+  bool FlattenTable(IAaptContext* context, ResourceTable* table, IArchiveWriter* writer) {
     BigBuffer buffer(1024);
     TableFlattener flattener(options_.table_flattener_options, &buffer);
-    if (!flattener.Consume(context_, table)) {
-      context_->GetDiagnostics()->Error(DiagMessage() << "failed to flatten resource table");
+    if (!flattener.Consume(context, table)) {
+      context->GetDiagnostics()->Error(DiagMessage() << "failed to flatten resource table");
       return false;
     }
 
     io::BigBufferInputStream input_stream(&buffer);
-    return io::CopyInputStreamToArchive(context_, &input_stream, "resources.arsc",
+    return io::CopyInputStreamToArchive(context, &input_stream, "resources.arsc",
                                         ArchiveEntry::kAlign, writer);
   }
 
-  bool FlattenTableToPb(ResourceTable* table, IArchiveWriter* writer) {
-    std::unique_ptr<pb::ResourceTable> pb_table = SerializeTableToPb(table);
-    return io::CopyProtoToArchive(context_, pb_table.get(), "resources.arsc.flat", 0, writer);
+  bool FlattenTableToPb(IAaptContext* context, ResourceTable* table, IArchiveWriter* writer) {
+    google::protobuf::Arena arena(MakeArenaOptions(0u));
+    pb::ResourceTable* pb_table = SerializeTableToPb(table, &arena);
+    return io::CopyProtoToArchive(context, pb_table, "resources.arsc.flat", 0, writer);
   }
 
-  bool WriteJavaFile(ResourceTable* table, const StringPiece& package_name_to_generate,
-                     const StringPiece& out_package, const JavaClassGeneratorOptions& java_options,
-                     const Maybe<std::string> out_text_symbols_path = {}) {
-    if (!options_.generate_java_class_path) {
-      return true;
-    }
-
+  // Creates the directory of the Java package `package` and returns the path of `filename` in it.
+  Maybe<std::string> MakeJavaFilePath(const StringPiece& package, const StringPiece& filename) {
     std::string out_path = options_.generate_java_class_path.value();
-    file::AppendPath(&out_path, file::PackageToPath(out_package));
+    file::AppendPath(&out_path, file::PackageToPath(package));
     if (!file::mkdirs(out_path)) {
-      context_->GetDiagnostics()->Error(DiagMessage() << "failed to create directory '" << out_path
-                                                      << "'");
-      return false;
+      context_->GetDiagnostics()->Error(DiagMessage() << "failed to create directory '"
+                                                      << out_path << "'");
+      return {};
     }
 
-    file::AppendPath(&out_path, "R.java");
+    file::AppendPath(&out_path, filename);
+    return out_path;
+  }
 
-    std::ofstream fout(out_path, std::ofstream::binary);
-    if (!fout) {
-      context_->GetDiagnostics()->Error(DiagMessage()
-                                        << "failed writing to '" << out_path
-                                        << "': " << android::base::SystemErrorCodeToString(errno));
-      return false;
+  // Writes the same R class to each of `out_packages`.
+  bool WriteJavaFile(ResourceTable* table, const StringPiece& package_name_to_generate,
+                     const std::vector<std::string>& out_packages,
+                     const JavaClassGeneratorOptions& java_options,
+                     const Maybe<std::string> out_text_symbols_path = {}) {
+    if (!options_.generate_java_class_path && java_jar_writer_ == nullptr) {
+      return true;
     }
 
-    std::unique_ptr<std::ofstream> fout_text;
-    if (out_text_symbols_path) {
-      fout_text =
-          util::make_unique<std::ofstream>(out_text_symbols_path.value(), std::ofstream::binary);
-      if (!*fout_text) {
-        context_->GetDiagnostics()->Error(
-            DiagMessage() << "failed writing to '" << out_text_symbols_path.value()
-                          << "': " << android::base::SystemErrorCodeToString(errno));
+    // R.txt is written along with the first of R.java and the R classes.
+    std::ostringstream text_out;
+    std::ostream* out_text = out_text_symbols_path ? &text_out : nullptr;
+
+    JavaClassGenerator generator(context_, table, java_options);
+    if (options_.generate_java_class_path) {
+      // The R class does not depend on the package it is declared in, so it is generated once
+      // and written after the package declaration of each file. When the R classes are also
+      // compiled, the same class tree is used for both.
+      std::ostringstream body_out;
+      if (java_jar_writer_ != nullptr) {
+        if (!generator.GenerateClassBodyAndFiles(package_name_to_generate, &body_out,
+                                                 out_packages, java_jar_writer_.get(),
+                                                 out_text)) {
+          context_->GetDiagnostics()->Error(DiagMessage() << generator.getError());
+          return false;
+        }
+      } else if (!generator.GenerateClassBody(package_name_to_generate, &body_out, out_text)) {
+        context_->GetDiagnostics()->Error(DiagMessage() << generator.getError());
         return false;
       }
+      out_text = nullptr;
+
+      const std::string class_body = body_out.str();
+      for (const std::string& out_package : out_packages) {
+        Maybe<std::string> out_path = MakeJavaFilePath(out_package, "R.java");
+        if (!out_path) {
+          return false;
+        }
+
+        std::ostringstream fout;
+        ClassDefinition::WriteJavaFileHeader(out_package, &fout);
+        fout << class_body;
+        if (!WriteOutputFile(context_->GetDiagnostics(), out_path.value(), fout.str())) {
+          return false;
+        }
+      }
     }
 
-    JavaClassGenerator generator(context_, table, java_options);
-    if (!generator.Generate(package_name_to_generate, out_package, &fout, fout_text.get())) {
-      context_->GetDiagnostics()->Error(DiagMessage(out_path) << generator.getError());
-      return false;
+    if (java_jar_writer_ != nullptr && !options_.generate_java_class_path) {
+      if (!generator.GenerateClassFiles(package_name_to_generate, out_packages,
+                                        java_jar_writer_.get(), out_text)) {
+        context_->GetDiagnostics()->Error(DiagMessage(options_.generate_java_jar_path.value())
+                                          << generator.getError());
+        return false;
+      }
     }
 
-    if (!fout) {
-      context_->GetDiagnostics()->Error(DiagMessage()
-                                        << "failed writing to '" << out_path
-                                        << "': " << android::base::SystemErrorCodeToString(errno));
+    if (out_text_symbols_path) {
+      return WriteOutputFile(context_->GetDiagnostics(), out_text_symbols_path.value(),
+                             text_out.str());
     }
     return true;
   }
@@ -998,32 +1184,14 @@ class LinkCommand {
     const std::string package_utf8 =
         options_.custom_java_package.value_or_default(context_->GetCompilationPackage());
 
-    std::string out_path = options_.generate_java_class_path.value();
-    file::AppendPath(&out_path, file::PackageToPath(package_utf8));
-
-    if (!file::mkdirs(out_path)) {
-      context_->GetDiagnostics()->Error(DiagMessage() << "failed to create directory '" << out_path
-                                                      << "'");
+    Maybe<std::string> out_path = MakeJavaFilePath(package_utf8, "Manifest.java");
+    if (!out_path) {
       return false;
     }
 
-    file::AppendPath(&out_path, "Manifest.java");
-
-    std::ofstream fout(out_path, std::ofstream::binary);
-    if (!fout) {
-      context_->GetDiagnostics()->Error(DiagMessage()
-                                        << "failed writing to '" << out_path
-                                        << "': " << android::base::SystemErrorCodeToString(errno));
-      return false;
-    }
-
-    if (!ClassDefinition::WriteJavaFile(manifest_class.get(), package_utf8, true, &fout)) {
-      context_->GetDiagnostics()->Error(DiagMessage()
-                                        << "failed writing to '" << out_path
-                                        << "': " << android::base::SystemErrorCodeToString(errno));
-      return false;
-    }
-    return true;
+    std::ostringstream fout;
+    ClassDefinition::WriteJavaFile(manifest_class.get(), package_utf8, true, &fout);
+    return WriteOutputFile(context_->GetDiagnostics(), out_path.value(), fout.str());
   }
 
   bool WriteProguardFile(const Maybe<std::string>& out, const proguard::KeepSet& keep_set) {
@@ -1031,27 +1199,13 @@ class LinkCommand {
       return true;
     }
 
-    const std::string& out_path = out.value();
-    std::ofstream fout(out_path, std::ofstream::binary);
-    if (!fout) {
-      context_->GetDiagnostics()->Error(DiagMessage()
-                                        << "failed to open '" << out_path
-                                        << "': " << android::base::SystemErrorCodeToString(errno));
-      return false;
-    }
-
+    std::ostringstream fout;
     proguard::WriteKeepSet(&fout, keep_set);
-    if (!fout) {
-      context_->GetDiagnostics()->Error(DiagMessage()
-                                        << "failed writing to '" << out_path
-                                        << "': " << android::base::SystemErrorCodeToString(errno));
-      return false;
-    }
-    return true;
+    return WriteOutputFile(context_->GetDiagnostics(), out.value(), fout.str());
   }
 
-  std::unique_ptr<ResourceTable> LoadStaticLibrary(const std::string& input,
-                                                   std::string* out_error) {
+  std::unique_ptr<LazyPbTable> LoadStaticLibrary(const std::string& input,
+                                                 std::string* out_error) {
     std::unique_ptr<io::ZipFileCollection> collection =
         io::ZipFileCollection::Create(input, out_error);
     if (!collection) {
@@ -1060,15 +1214,60 @@ class LinkCommand {
     return LoadTablePbFromCollection(collection.get());
   }
 
-  std::unique_ptr<ResourceTable> LoadTablePbFromCollection(io::IFileCollection* collection) {
+  // Indexes the resources.arsc.flat of a static library. Types are decoded only as they are
+  // merged or looked up.
+  std::unique_ptr<LazyPbTable> LoadTablePbFromCollection(io::IFileCollection* collection) {
     io::IFile* file = collection->FindFile("resources.arsc.flat");
     if (!file) {
       return {};
     }
 
     std::unique_ptr<io::IData> data = file->OpenAsData();
-    return LoadTableFromPb(file->GetSource(), data->data(), data->size(),
-                           context_->GetDiagnostics());
+    if (!data) {
+      context_->GetDiagnostics()->Error(DiagMessage(file->GetSource()) << "failed to open file");
+      return {};
+    }
+    return LazyPbTable::Create(std::move(data), file->GetSource(), context_->GetDiagnostics());
+  }
+
+  // Merges the package `pkg` of a static library one type at a time, so that at most one decoded
+  // type of the library is held in memory.
+  bool MergeStaticLibraryPackage(const std::string& input, LazyPbTable* table,
+                                 const LazyPbTable::PackageIndex& pkg, bool override,
+                                 io::IFileCollection* collection) {
+    auto merge_table = [&](ResourceTable* type_table) -> bool {
+      if (options_.no_static_lib_packages) {
+        // Merge all resources as if they were in the compilation package. This is
+        // the old behavior of aapt.
+        if (&pkg == table->FindPackageById(kAppPackageId)) {
+          type_table->FindPackage(pkg.name)->name = "";
+        }
+        if (override) {
+          return table_merger_->MergeOverlay(Source(input), type_table, collection);
+        }
+        return table_merger_->Merge(Source(input), type_table, collection);
+      }
+
+      // This is the proper way to merge libraries, where the package name is
+      // preserved and resource names are mangled.
+      return table_merger_->MergeAndMangle(Source(input), pkg.name, type_table, collection);
+    };
+
+    if (pkg.types.empty()) {
+      ResourceTable empty_table;
+      empty_table.CreatePackage(pkg.name, pkg.id);
+      return merge_table(&empty_table);
+    }
+
+    bool error = false;
+    for (const LazyPbTable::TypeIndex& type : pkg.types) {
+      ResourceTable type_table;
+      if (!table->LoadType(pkg, type, &type_table)) {
+        return false;
+      }
+      error |= !merge_table(&type_table);
+    }
+    return !error;
   }
 
   bool MergeStaticLibrary(const std::string& input, bool override) {
@@ -1084,44 +1283,51 @@ class LinkCommand {
       return false;
     }
 
-    std::unique_ptr<ResourceTable> table = LoadTablePbFromCollection(collection.get());
+    std::unique_ptr<LazyPbTable> table = LoadTablePbFromCollection(collection.get());
     if (!table) {
       context_->GetDiagnostics()->Error(DiagMessage(input) << "invalid static library");
       return false;
     }
 
-    ResourceTablePackage* pkg = table->FindPackageById(kAppPackageId);
+    const LazyPbTable::PackageIndex* pkg = table->FindPackageById(kAppPackageId);
     if (!pkg) {
       context_->GetDiagnostics()->Error(DiagMessage(input) << "static library has no package");
       return false;
     }
 
-    bool result;
+    std::vector<const LazyPbTable::PackageIndex*> merge_pkgs;
     if (options_.no_static_lib_packages) {
-      // Merge all resources as if they were in the compilation package. This is
-      // the old behavior of aapt.
-
       // Add the package to the set of --extra-packages so we emit an R.java for
       // each library package.
       if (!pkg->name.empty()) {
         options_.extra_java_packages.insert(pkg->name);
       }
 
-      pkg->name = "";
-      if (override) {
-        result = table_merger_->MergeOverlay(Source(input), table.get(), collection.get());
-      } else {
-        result = table_merger_->Merge(Source(input), table.get(), collection.get());
+      // As with any other table, packages with no name or with the name of the
+      // compilation package are merged too.
+      for (const LazyPbTable::PackageIndex& other_pkg : table->packages()) {
+        if (&other_pkg == pkg || other_pkg.name.empty() ||
+            other_pkg.name == context_->GetCompilationPackage()) {
+          merge_pkgs.push_back(&other_pkg);
+        }
       }
-
     } else {
-      // This is the proper way to merge libraries, where the package name is
-      // preserved and resource names are mangled.
-      result =
-          table_merger_->MergeAndMangle(Source(input), pkg->name, table.get(), collection.get());
+      for (const LazyPbTable::PackageIndex& other_pkg : table->packages()) {
+        if (other_pkg.name != pkg->name) {
+          context_->GetDiagnostics()->Warn(DiagMessage(input) << "ignoring package "
+                                                              << other_pkg.name);
+          continue;
+        }
+        merge_pkgs.push_back(&other_pkg);
+      }
     }
 
-    if (!result) {
+    bool error = false;
+    for (const LazyPbTable::PackageIndex* merge_pkg : merge_pkgs) {
+      error |= !MergeStaticLibraryPackage(input, table.get(), *merge_pkg, override,
+                                          collection.get());
+    }
+    if (error) {
       return false;
     }
 
@@ -1379,12 +1585,13 @@ class LinkCommand {
 
   /**
    * Writes the AndroidManifest, ResourceTable, and all XML files referenced by
-   * the ResourceTable to the IArchiveWriter.
+   * the ResourceTable to the IArchiveWriter. All diagnostics and symbol lookups
+   * go through `context`, which may be a LinkWorkerContext.
    */
-  bool WriteApk(IArchiveWriter* writer, proguard::KeepSet* keep_set, xml::XmlResource* manifest,
-                ResourceTable* table) {
-    const bool keep_raw_values = context_->GetPackageType() == PackageType::kStaticLib;
-    bool result = FlattenXml(context_, manifest, "AndroidManifest.xml", keep_raw_values,
+  bool WriteApk(IAaptContext* context, IArchiveWriter* writer, proguard::KeepSet* keep_set,
+                xml::XmlResource* manifest, ResourceTable* table) {
+    const bool keep_raw_values = context->GetPackageType() == PackageType::kStaticLib;
+    bool result = FlattenXml(context, manifest, "AndroidManifest.xml", keep_raw_values,
                              true /*utf16*/, writer);
     if (!result) {
       return false;
@@ -1400,27 +1607,58 @@ class LinkCommand {
     file_flattener_options.no_xml_namespaces = options_.no_xml_namespaces;
     file_flattener_options.update_proguard_spec =
         static_cast<bool>(options_.generate_proguard_rules_path);
+    file_flattener_options.incremental_state = incremental_state_.get();
 
-    ResourceFileFlattener file_flattener(file_flattener_options, context_, keep_set);
+    ResourceFileFlattener file_flattener(file_flattener_options, context, keep_set);
 
     if (!file_flattener.Flatten(table, writer)) {
-      context_->GetDiagnostics()->Error(DiagMessage() << "failed linking file resources");
+      context->GetDiagnostics()->Error(DiagMessage() << "failed linking file resources");
       return false;
     }
 
-    if (context_->GetPackageType() == PackageType::kStaticLib) {
-      if (!FlattenTableToPb(table, writer)) {
+    if (context->GetPackageType() == PackageType::kStaticLib) {
+      if (!FlattenTableToPb(context, table, writer)) {
         return false;
       }
     } else {
-      if (!FlattenTable(table, writer)) {
-        context_->GetDiagnostics()->Error(DiagMessage() << "failed to write resources.arsc");
+      if (!FlattenTable(context, table, writer)) {
+        context->GetDiagnostics()->Error(DiagMessage() << "failed to write resources.arsc");
         return false;
       }
     }
     return true;
   }
 
+  // Generates the AndroidManifest.xml for a split and writes the split APK to `path`.
+  bool WriteSplitApk(IAaptContext* context, const AppInfo& app_info, const std::string& path,
+                     const SplitConstraints& constraints, ResourceTable* split_table,
+                     proguard::KeepSet* keep_set) {
+    if (context->IsVerbose()) {
+      context->GetDiagnostics()->Note(DiagMessage(path)
+                                      << "generating split with configurations '"
+                                      << util::Joiner(constraints.configs, ", ") << "'");
+    }
+
+    std::unique_ptr<IArchiveWriter> archive_writer =
+        MakeArchiveWriter(context->GetDiagnostics(), path);
+    if (!archive_writer) {
+      context->GetDiagnostics()->Error(DiagMessage() << "failed to create archive");
+      return false;
+    }
+
+    // Generate an AndroidManifest.xml for each split.
+    std::unique_ptr<xml::XmlResource> split_manifest = GenerateSplitManifest(app_info, constraints);
+
+    XmlReferenceLinker linker;
+    if (!linker.Consume(context, split_manifest.get())) {
+      context->GetDiagnostics()->Error(DiagMessage()
+                                       << "failed to create Split AndroidManifest.xml");
+      return false;
+    }
+
+    return WriteApk(context, archive_writer.get(), keep_set, split_manifest.get(), split_table);
+  }
+
   int Run(const std::vector<std::string>& input_files) {
     // Load the AndroidManifest.xml
     std::unique_ptr<xml::XmlResource> manifest_xml =
@@ -1505,29 +1743,46 @@ class LinkCommand {
       }
 
       // Assign IDs if we are building a regular app.
-      IdAssigner id_assigner(&options_.stable_id_map);
+      IdAssigner id_assigner(options_.stable_id_map.get());
       if (!id_assigner.Consume(context_, &final_table_)) {
         context_->GetDiagnostics()->Error(DiagMessage() << "failed assigning IDs");
         return 1;
       }
 
       // Now grab each ID and emit it as a file.
-      if (options_.resource_id_map_path) {
+      if (options_.resource_id_map_path || options_.binary_resource_id_map_path) {
+        // Keep the stable IDs of resources that are not in this table.
+        StableIdMap::NameIdMap id_map;
+        if (options_.stable_id_map) {
+          id_map.reserve(options_.stable_id_map->size());
+          options_.stable_id_map->ForEach([&](const ResourceNameRef& name, ResourceId id) {
+            id_map[name.ToResourceName()] = id;
+          });
+        }
+
         for (auto& package : final_table_.packages) {
           for (auto& type : package->types) {
             for (auto& entry : type->entries) {
               ResourceName name(package->name, type->type, entry->name);
               // The IDs are guaranteed to exist.
-              options_.stable_id_map[std::move(name)] =
+              id_map[std::move(name)] =
                   ResourceId(package->id.value(), type->id.value(), entry->id.value());
             }
           }
         }
 
-        if (!WriteStableIdMapToPath(context_->GetDiagnostics(), options_.stable_id_map,
+        if (options_.resource_id_map_path &&
+            !WriteStableIdMapToPath(context_->GetDiagnostics(), id_map,
                                     options_.resource_id_map_path.value())) {
           return 1;
         }
+
+        if (options_.binary_resource_id_map_path &&
+            !WriteOutputFile(context_->GetDiagnostics(),
+                             options_.binary_resource_id_map_path.value(),
+                             StableIdMap::SerializeBinary(id_map))) {
+          return 1;
+        }
       }
     } else {
       // Static libs are merged with other apps, and ID collisions are bad, so
@@ -1610,6 +1865,22 @@ class LinkCommand {
     proguard::KeepSet proguard_keep_set;
     proguard::KeepSet proguard_main_dex_keep_set;
 
+    if (options_.incremental_state_path) {
+      // Files linked with different settings can't be reused.
+      Digest options_digest;
+      options_digest.Update(static_cast<uint64_t>(context_->GetPackageType()))
+          .Update(context_->GetCompilationPackage())
+          .Update(context_->GetPackageId())
+          .Update(context_->GetMinSdkVersion())
+          .Update(options_.no_auto_version)
+          .Update(options_.no_version_vectors)
+          .Update(options_.no_version_transitions)
+          .Update(options_.no_xml_namespaces);
+      incremental_state_ = util::make_unique<IncrementalLinkState>();
+      incremental_state_->Load(options_.incremental_state_path.value(), options_digest.value(),
+                               context_->GetDiagnostics());
+    }
+
     if (context_->GetPackageType() == PackageType::kStaticLib) {
       if (options_.table_splitter_options.config_filter != nullptr ||
           !options_.table_splitter_options.preferred_densities.empty()) {
@@ -1628,46 +1899,39 @@ class LinkCommand {
       }
       table_splitter.SplitTable(&final_table_);
 
-      // Now we need to write out the Split APKs.
-      auto path_iter = options_.split_paths.begin();
-      auto split_constraints_iter = options_.split_constraints.begin();
-      for (std::unique_ptr<ResourceTable>& split_table : table_splitter.splits()) {
-        if (context_->IsVerbose()) {
-          context_->GetDiagnostics()->Note(DiagMessage(*path_iter)
-                                           << "generating split with configurations '"
-                                           << util::Joiner(split_constraints_iter->configs, ", ")
-                                           << "'");
-        }
-
-        std::unique_ptr<IArchiveWriter> archive_writer = MakeArchiveWriter(*path_iter);
-        if (!archive_writer) {
-          context_->GetDiagnostics()->Error(DiagMessage() << "failed to create archive");
-          return 1;
-        }
-
-        // Generate an AndroidManifest.xml for each split.
-        std::unique_ptr<xml::XmlResource> split_manifest =
-            GenerateSplitManifest(app_info, *split_constraints_iter);
-
-        XmlReferenceLinker linker;
-        if (!linker.Consume(context_, split_manifest.get())) {
-          context_->GetDiagnostics()->Error(DiagMessage()
-                                            << "failed to create Split AndroidManifest.xml");
-          return 1;
-        }
-
-        if (!WriteApk(archive_writer.get(), &proguard_keep_set, split_manifest.get(),
-                      split_table.get())) {
+      // Now we need to write out the Split APKs. Each split is written by a worker with its own
+      // context and keep set, and the results are combined in split order afterwards so that
+      // diagnostics and proguard rules don't depend on scheduling.
+      std::vector<std::unique_ptr<ResourceTable>>& splits = table_splitter.splits();
+      std::mutex symbol_lock;
+      std::vector<std::unique_ptr<LinkWorkerContext>> split_contexts;
+      for (size_t i = 0; i < splits.size(); i++) {
+        split_contexts.push_back(util::make_unique<LinkWorkerContext>(context_, &symbol_lock));
+      }
+      std::vector<proguard::KeepSet> split_keep_sets(splits.size());
+      std::unique_ptr<bool[]> split_results(new bool[splits.size()]());
+
+      // Like a serial loop, stop writing splits once one of them fails.
+      ThreadPool thread_pool;
+      thread_pool.ForEachUntilFailure(splits.size(), [&](size_t i) -> bool {
+        split_results[i] = WriteSplitApk(split_contexts[i].get(), app_info,
+                                         options_.split_paths[i], options_.split_constraints[i],
+                                         splits[i].get(), &split_keep_sets[i]);
+        return split_results[i];
+      });
+
+      for (size_t i = 0; i < splits.size(); i++) {
+        split_contexts[i]->GetDiagnostics()->ReplayTo(context_->GetDiagnostics());
+        if (!split_results[i]) {
           return 1;
         }
-
-        ++path_iter;
-        ++split_constraints_iter;
+        proguard_keep_set.Merge(split_keep_sets[i]);
       }
     }
 
     // Start writing the base APK.
-    std::unique_ptr<IArchiveWriter> archive_writer = MakeArchiveWriter(options_.output_path);
+    std::unique_ptr<IArchiveWriter> archive_writer =
+        MakeArchiveWriter(context_->GetDiagnostics(), options_.output_path);
     if (!archive_writer) {
       context_->GetDiagnostics()->Error(DiagMessage() << "failed to create archive");
       return 1;
@@ -1720,7 +1984,8 @@ class LinkCommand {
       return 1;
     }
 
-    if (!WriteApk(archive_writer.get(), &proguard_keep_set, manifest_xml.get(), &final_table_)) {
+    if (!WriteApk(context_, archive_writer.get(), &proguard_keep_set, manifest_xml.get(),
+                  &final_table_)) {
       return 1;
     }
 
@@ -1728,7 +1993,15 @@ class LinkCommand {
       return 1;
     }
 
-    if (options_.generate_java_class_path) {
+    if (options_.generate_java_jar_path) {
+      java_jar_writer_ = CreateZipFileArchiveWriter(context_->GetDiagnostics(),
+                                                    options_.generate_java_jar_path.value());
+      if (java_jar_writer_ == nullptr) {
+        return 1;
+      }
+    }
+
+    if (options_.generate_java_class_path || options_.generate_java_jar_path) {
       // The set of packages whose R class to call in the main classes
       // onResourcesLoaded callback.
       std::vector<std::string> packages_to_callback;
@@ -1763,19 +2036,24 @@ class LinkCommand {
         // private package.
         JavaClassGeneratorOptions options = template_options;
         options.types = JavaClassGeneratorOptions::SymbolTypes::kPublicPrivate;
-        if (!WriteJavaFile(&final_table_, actual_package, options_.private_symbols.value(),
+        if (!WriteJavaFile(&final_table_, actual_package, {options_.private_symbols.value()},
                            options)) {
           return 1;
         }
       }
 
-      // Generate all the symbols for all extra packages.
-      for (const std::string& extra_package : options_.extra_java_packages) {
-        packages_to_callback.push_back(extra_package);
+      // Generate all the symbols for all extra packages. Their R classes are identical, so the
+      // table is only walked once for all of them.
+      if (!options_.extra_java_packages.empty()) {
+        packages_to_callback.insert(packages_to_callback.end(),
+                                    options_.extra_java_packages.begin(),
+                                    options_.extra_java_packages.end());
 
         JavaClassGeneratorOptions options = template_options;
         options.types = JavaClassGeneratorOptions::SymbolTypes::kAll;
-        if (!WriteJavaFile(&final_table_, actual_package, extra_package, options)) {
+        const std::vector<std::string> extra_packages(options_.extra_java_packages.begin(),
+                                                       options_.extra_java_packages.end());
+        if (!WriteJavaFile(&final_table_, actual_package, extra_packages, options)) {
           return 1;
         }
       }
@@ -1793,10 +2071,13 @@ class LinkCommand {
             std::move(packages_to_callback);
       }
 
-      if (!WriteJavaFile(&final_table_, actual_package, output_package, options,
+      if (!WriteJavaFile(&final_table_, actual_package, {output_package.to_string()}, options,
                          options_.generate_text_symbols_path)) {
         return 1;
       }
+
+      // Finish the jar, so that its central directory is written.
+      java_jar_writer_.reset();
     }
 
     if (!WriteProguardFile(options_.generate_proguard_rules_path, proguard_keep_set)) {
@@ -1807,6 +2088,12 @@ class LinkCommand {
                            proguard_main_dex_keep_set)) {
       return 1;
     }
+
+    if (incremental_state_ != nullptr &&
+        !incremental_state_->Save(options_.incremental_state_path.value(),
+                                  context_->GetDiagnostics())) {
+      return 1;
+    }
     return 0;
   }
 
@@ -1824,12 +2111,18 @@ class LinkCommand {
   // collections.
   std::vector<std::unique_ptr<io::IFileCollection>> collections_;
 
-  // A vector of ResourceTables. This is here to retain ownership, so that the
+  // A vector of static library tables. This is here to retain ownership, so that the
   // SymbolTable can use these.
-  std::vector<std::unique_ptr<ResourceTable>> static_table_includes_;
+  std::vector<std::unique_ptr<LazyPbTable>> static_table_includes_;
 
   // The set of shared libraries being used, mapping their assigned package ID to package name.
   std::map<size_t, std::string> shared_libs_;
+
+  // The jar the compiled R classes are written to, if requested.
+  std::unique_ptr<IArchiveWriter> java_jar_writer_;
+
+  // The XML files reused from the previous link and saved for the next one, if requested.
+  std::unique_ptr<IncrementalLinkState> incremental_state_;
 };
 
 int Link(const std::vector<StringPiece>& args, IDiagnostics* diagnostics) {
@@ -1847,6 +2140,7 @@ int Link(const std::vector<StringPiece>& args, IDiagnostics* diagnostics) {
   bool shared_lib = false;
   bool static_lib = false;
   Maybe<std::string> stable_id_file_path;
+  Maybe<std::string> access_profile_path;
   std::vector<std::string> split_args;
   Flags flags =
       Flags()
@@ -1867,6 +2161,10 @@ int Link(const std::vector<StringPiece>& args, IDiagnostics* diagnostics) {
                         &package_id)
           .OptionalFlag("--java", "Directory in which to generate R.java.",
                         &options.generate_java_class_path)
+          .OptionalFlag("--java-jar",
+                        "Output jar of the compiled R classes, which can be used instead of\n"
+                        "compiling R.java. Not supported with --shared-lib.",
+                        &options.generate_java_jar_path)
           .OptionalFlag("--proguard", "Output file for generated Proguard rules.",
                         &options.generate_proguard_rules_path)
           .OptionalFlag("--proguard-main-dex",
@@ -1891,6 +2189,11 @@ int Link(const std::vector<StringPiece>& args, IDiagnostics* diagnostics) {
                           "Enables encoding sparse entries using a binary search tree.\n"
                           "This decreases APK size at the cost of resource retrieval performance.",
                           &options.table_flattener_options.use_sparse_entries)
+          .OptionalSwitch("--auto-sparse-encoding",
+                          "Encodes the entries of each type and configuration with whichever of\n"
+                          "the dense or sparse encodings is smaller. Sparse encoding is only used\n"
+                          "where the minSdk or the configuration's SDK version is O or higher.",
+                          &options.table_flattener_options.auto_sparse_entries)
           .OptionalSwitch("-x", "Legacy flag that specifies to use the package identifier 0x01.",
                           &legacy_x_flag)
           .OptionalSwitch("-z", "Require localization of strings marked 'suggested'.",
@@ -1933,12 +2236,28 @@ int Link(const std::vector<StringPiece>& args, IDiagnostics* diagnostics) {
                           "Generates R.java without the final modifier. This is implied when\n"
                           "--static-lib is specified.",
                           &options.generate_non_final_ids)
-          .OptionalFlag("--stable-ids", "File containing a list of name to ID mapping.",
+          .OptionalFlag("--stable-ids",
+                        "File containing a list of name to ID mapping, either as text or in\n"
+                        "the binary format written by --emit-binary-ids.",
                         &stable_id_file_path)
+          .OptionalFlag("--access-profile",
+                        "File listing the resources accessed during startup, one name or ID\n"
+                        "per line. Their values and strings are placed together in the\n"
+                        "resource table to reduce page faults when it is mapped.",
+                        &access_profile_path)
           .OptionalFlag("--emit-ids",
                         "Emit a file at the given path with a list of name to ID mappings,\n"
                         "suitable for use with --stable-ids.",
                         &options.resource_id_map_path)
+          .OptionalFlag("--emit-binary-ids",
+                        "Same as --emit-ids, but in a binary format that --stable-ids can\n"
+                        "search without parsing it first.",
+                        &options.binary_resource_id_map_path)
+          .OptionalFlag("--incremental-state",
+                        "File in which to keep the linked XML files between runs. XML files\n"
+                        "whose input and referenced resources are unchanged since the last\n"
+                        "link are reused instead of being linked again.",
+                        &options.incremental_state_path)
           .OptionalFlag("--private-symbols",
                         "Package name to use when generating R.java for private symbols.\n"
                         "If not specified, public and private symbols will use the application's\n"
@@ -2098,8 +2417,16 @@ int Link(const std::vector<StringPiece>& args, IDiagnostics* diagnostics) {
   }
 
   if (context.GetPackageType() != PackageType::kStaticLib && stable_id_file_path) {
-    if (!LoadStableIdMap(context.GetDiagnostics(), stable_id_file_path.value(),
-                         &options.stable_id_map)) {
+    options.stable_id_map = StableIdMap::Load(stable_id_file_path.value(),
+                                              context.GetDiagnostics());
+    if (!options.stable_id_map) {
+      return 1;
+    }
+  }
+
+  if (access_profile_path) {
+    if (!LoadResourceAccessProfile(context.GetDiagnostics(), access_profile_path.value(),
+                                   &options.table_flattener_options.access_profile)) {
       return 1;
     }
   }
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -33,10 +34,11 @@
 #include "flatten/XmlFlattener.h"
 #include "io/BigBufferInputStream.h"
 #include "io/Util.h"
-#include "optimize/ResourceDeduper.h"
-#include "optimize/VersionCollapser.h"
+#include "optimize/TableOptimizer.h"
+#include "process/WorkerContext.h"
 #include "split/TableSplitter.h"
 #include "util/Files.h"
+#include "util/ThreadPool.h"
 
 using ::aapt::configuration::Abi;
 using ::aapt::configuration::Artifact;
@@ -137,56 +139,41 @@ class OptimizeCommand {
       context_->GetDiagnostics()->Note(DiagMessage() << "Optimizing APK...");
     }
 
-    VersionCollapser collapser;
-    if (!collapser.Consume(context_, apk->GetResourceTable())) {
-      return 1;
-    }
-
-    ResourceDeduper deduper;
-    if (!deduper.Consume(context_, apk->GetResourceTable())) {
-      context_->GetDiagnostics()->Error(DiagMessage() << "failed deduping resources");
-      return 1;
-    }
-
     // Adjust the SplitConstraints so that their SDK version is stripped if it is less than or
     // equal to the minSdk.
     options_.split_constraints =
         AdjustSplitConstraintsForMinSdk(context_->GetMinSdkVersion(), options_.split_constraints);
 
-    // Stripping the APK using the TableSplitter. The resource table is modified in place in the
-    // LoadedApk.
     TableSplitter splitter(options_.split_constraints, options_.table_splitter_options);
     if (!splitter.VerifySplitConstraints(context_)) {
       return 1;
     }
-    splitter.SplitTable(apk->GetResourceTable());
-
-    auto path_iter = options_.split_paths.begin();
-    auto split_constraints_iter = options_.split_constraints.begin();
-    for (std::unique_ptr<ResourceTable>& split_table : splitter.splits()) {
-      if (context_->IsVerbose()) {
-        context_->GetDiagnostics()->Note(
-            DiagMessage(*path_iter) << "generating split with configurations '"
-                                    << util::Joiner(split_constraints_iter->configs, ", ") << "'");
-      }
 
-      // Generate an AndroidManifest.xml for each split.
-      std::unique_ptr<xml::XmlResource> split_manifest =
-          GenerateSplitManifest(options_.app_info, *split_constraints_iter);
-      std::unique_ptr<IArchiveWriter> split_writer =
-          CreateZipFileArchiveWriter(context_->GetDiagnostics(), *path_iter);
-      if (!split_writer) {
-        return 1;
-      }
+    // Collapse versions, dedupe and strip the APK using the TableSplitter, in a single pass over
+    // the entries. The resource table is modified in place in the LoadedApk.
+    TableOptimizerOptions optimizer_options;
+    optimizer_options.splitter = &splitter;
+    TableOptimizer optimizer(optimizer_options);
+    if (!optimizer.Consume(context_, apk->GetResourceTable())) {
+      context_->GetDiagnostics()->Error(DiagMessage() << "failed optimizing resources");
+      return 1;
+    }
 
-      if (!WriteSplitApk(split_table.get(), split_manifest.get(), split_writer.get())) {
-        return 1;
-      }
+    // Every output APK is written by its own task, with its own diagnostics. The tasks run
+    // concurrently and their diagnostics are replayed in the order the tasks were added.
+    std::vector<std::function<bool(IAaptContext*)>> tasks;
+    BigBuffer table_buffer(4096);
 
-      ++path_iter;
-      ++split_constraints_iter;
+    std::vector<std::unique_ptr<ResourceTable>>& splits = splitter.splits();
+    for (size_t i = 0; i < splits.size(); i++) {
+      ResourceTable* split_table = splits[i].get();
+      tasks.push_back([this, i, split_table](IAaptContext* context) {
+        return WriteSplitApk(context, options_.split_paths[i], options_.split_constraints[i],
+                             split_table);
+      });
     }
 
+    std::vector<std::unique_ptr<FilterChain>> filter_chains;
     if (options_.configuration && options_.output_dir) {
       PostProcessingConfiguration& config = options_.configuration.value();
 
@@ -202,8 +189,9 @@ class OptimizeCommand {
                 DiagMessage() << "could not find referenced ABI group '" << group << "'");
             return 1;
           }
-          FilterChain filters;
-          filters.AddFilter(AbiFilter::FromAbiList(abi_group->second));
+          filter_chains.push_back(util::make_unique<FilterChain>());
+          FilterChain* filters = filter_chains.back().get();
+          filters->AddFilter(AbiFilter::FromAbiList(abi_group->second));
 
           const std::string& path = apk->GetSource().path;
           const StringPiece ext = file::GetExtension(path);
@@ -216,39 +204,88 @@ class OptimizeCommand {
           std::string out = options_.output_dir.value();
           file::AppendPath(&out, file_name);
 
-          std::unique_ptr<IArchiveWriter> writer =
-              CreateZipFileArchiveWriter(context_->GetDiagnostics(), out);
-
-          if (!apk->WriteToArchive(context_, options_.table_flattener_options, &filters,
-                                   writer.get())) {
-            return 1;
-          }
+          tasks.push_back([this, &apk, &table_buffer, filters, out](IAaptContext* context) {
+            return WriteApk(context, apk.get(), table_buffer, filters, out);
+          });
         }
       }
     }
 
     if (options_.output_path) {
-      std::unique_ptr<IArchiveWriter> writer =
-          CreateZipFileArchiveWriter(context_->GetDiagnostics(), options_.output_path.value());
-      if (!apk->WriteToArchive(context_, options_.table_flattener_options, writer.get())) {
+      tasks.push_back([this, &apk, &table_buffer](IAaptContext* context) {
+        FilterChain empty;
+        return WriteApk(context, apk.get(), table_buffer, &empty, options_.output_path.value());
+      });
+    }
+
+    // Flattening modifies the resource table, so the stripped table is flattened once here and
+    // shared by every archive written from the APK.
+    if (tasks.size() > splits.size()) {
+      TableFlattener flattener(options_.table_flattener_options, &table_buffer);
+      if (!flattener.Consume(context_, apk->GetResourceTable())) {
         return 1;
       }
     }
 
+    std::vector<std::unique_ptr<WorkerContext>> task_contexts;
+    for (size_t i = 0; i < tasks.size(); i++) {
+      task_contexts.push_back(util::make_unique<WorkerContext>(context_));
+    }
+    std::unique_ptr<bool[]> results(new bool[tasks.size()]());
+
+    // Like a serial loop, stop writing artifacts once one of them fails.
+    ThreadPool thread_pool;
+    thread_pool.ForEachUntilFailure(tasks.size(), [&](size_t i) -> bool {
+      results[i] = tasks[i](task_contexts[i].get());
+      return results[i];
+    });
+
+    for (size_t i = 0; i < tasks.size(); i++) {
+      task_contexts[i]->GetDiagnostics()->ReplayTo(context_->GetDiagnostics());
+      if (!results[i]) {
+        return 1;
+      }
+    }
     return 0;
   }
 
  private:
-  bool WriteSplitApk(ResourceTable* table, xml::XmlResource* manifest, IArchiveWriter* writer) {
+  bool WriteApk(IAaptContext* context, LoadedApk* apk, const BigBuffer& table_buffer,
+                FilterChain* filters, const std::string& path) {
+    std::unique_ptr<IArchiveWriter> writer =
+        CreateZipFileArchiveWriter(context->GetDiagnostics(), path);
+    if (!writer) {
+      return false;
+    }
+    return apk->WriteToArchive(context, table_buffer, filters, writer.get());
+  }
+
+  bool WriteSplitApk(IAaptContext* context, const std::string& path,
+                     const SplitConstraints& constraints, ResourceTable* table) {
+    if (context->IsVerbose()) {
+      context->GetDiagnostics()->Note(DiagMessage(path)
+                                      << "generating split with configurations '"
+                                      << util::Joiner(constraints.configs, ", ") << "'");
+    }
+
+    // Generate an AndroidManifest.xml for each split.
+    std::unique_ptr<xml::XmlResource> manifest =
+        GenerateSplitManifest(options_.app_info, constraints);
+    std::unique_ptr<IArchiveWriter> writer =
+        CreateZipFileArchiveWriter(context->GetDiagnostics(), path);
+    if (!writer) {
+      return false;
+    }
+
     BigBuffer manifest_buffer(4096);
     XmlFlattener xml_flattener(&manifest_buffer, {});
-    if (!xml_flattener.Consume(context_, manifest)) {
+    if (!xml_flattener.Consume(context, manifest.get())) {
       return false;
     }
 
     io::BigBufferInputStream manifest_buffer_in(&manifest_buffer);
-    if (!io::CopyInputStreamToArchive(context_, &manifest_buffer_in, "AndroidManifest.xml",
-                                      ArchiveEntry::kCompress, writer)) {
+    if (!io::CopyInputStreamToArchive(context, &manifest_buffer_in, "AndroidManifest.xml",
+                                      ArchiveEntry::kCompress, writer.get())) {
       return false;
     }
 
@@ -267,9 +304,9 @@ class OptimizeCommand {
 
             if (file_ref->file == nullptr) {
               ResourceNameRef name(pkg->name, type->type, entry->name);
-              context_->GetDiagnostics()->Warn(DiagMessage(file_ref->GetSource())
-                                               << "file for resource " << name << " with config '"
-                                               << config_value->config << "' not found");
+              context->GetDiagnostics()->Warn(DiagMessage(file_ref->GetSource())
+                                              << "file for resource " << name << " with config '"
+                                              << config_value->config << "' not found");
               continue;
             }
 
@@ -282,8 +319,8 @@ class OptimizeCommand {
           FileReference* file_ref = entry.second;
           uint32_t compression_flags =
               file_ref->file->WasCompressed() ? ArchiveEntry::kCompress : 0u;
-          if (!io::CopyFileToArchive(context_, file_ref->file, *file_ref->path, compression_flags,
-                                     writer)) {
+          if (!io::CopyFileToArchive(context, file_ref->file, *file_ref->path, compression_flags,
+                                     writer.get())) {
             return false;
           }
         }
@@ -292,13 +329,13 @@ class OptimizeCommand {
 
     BigBuffer table_buffer(4096);
     TableFlattener table_flattener(options_.table_flattener_options, &table_buffer);
-    if (!table_flattener.Consume(context_, table)) {
+    if (!table_flattener.Consume(context, table)) {
       return false;
     }
 
     io::BigBufferInputStream table_buffer_in(&table_buffer);
-    if (!io::CopyInputStreamToArchive(context_, &table_buffer_in, "resources.arsc",
-                                      ArchiveEntry::kAlign, writer)) {
+    if (!io::CopyInputStreamToArchive(context, &table_buffer_in, "resources.arsc",
+                                      ArchiveEntry::kAlign, writer.get())) {
       return false;
     }
     return true;
@@ -348,6 +385,7 @@ int Optimize(const std::vector<StringPiece>& args) {
   OptimizeContext context;
   OptimizeOptions options;
   Maybe<std::string> config_path;
+  Maybe<std::string> access_profile_path;
   Maybe<std::string> target_densities;
   std::vector<std::string> configs;
   std::vector<std::string> split_args;
@@ -357,6 +395,11 @@ int Optimize(const std::vector<StringPiece>& args) {
           .OptionalFlag("-o", "Path to the output APK.", &options.output_path)
           .OptionalFlag("-d", "Path to the output directory (for splits).", &options.output_dir)
           .OptionalFlag("-x", "Path to XML configuration file.", &config_path)
+          .OptionalFlag("--access-profile",
+                        "File listing the resources accessed during startup, one name or ID\n"
+                        "per line. Their values and strings are placed together in the\n"
+                        "resource table to reduce page faults when it is mapped.",
+                        &access_profile_path)
           .OptionalFlag(
               "--target-densities",
               "Comma separated list of the screen densities that the APK will be optimized for.\n"
@@ -376,6 +419,11 @@ int Optimize(const std::vector<StringPiece>& args) {
                           "Enables encoding sparse entries using a binary search tree.\n"
                           "This decreases APK size at the cost of resource retrieval performance.",
                           &options.table_flattener_options.use_sparse_entries)
+          .OptionalSwitch("--auto-sparse-encoding",
+                          "Encodes the entries of each type and configuration with whichever of\n"
+                          "the dense or sparse encodings is smaller. Sparse encoding is only used\n"
+                          "where the minSdk or the configuration's SDK version is O or higher.",
+                          &options.table_flattener_options.auto_sparse_entries)
           .OptionalSwitch("-v", "Enables verbose logging", &verbose);
 
   if (!flags.Parse("aapt2 optimize", args, &std::cerr)) {
@@ -426,6 +474,13 @@ int Optimize(const std::vector<StringPiece>& args) {
     }
   }
 
+  if (access_profile_path) {
+    if (!LoadResourceAccessProfile(context.GetDiagnostics(), access_profile_path.value(),
+                                   &options.table_flattener_options.access_profile)) {
+      return 1;
+    }
+  }
+
   if (config_path) {
     if (!options.output_dir) {
       context.GetDiagnostics()->Error(
@@ -16,7 +16,10 @@
 
 #include "compile/IdAssigner.h"
 
-#include <map>
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
 
 #include "android-base/logging.h"
 
@@ -26,13 +29,87 @@
 
 namespace aapt {
 
+namespace {
+
+// A set of IDs stored as a bitmap that grows to fit the largest ID inserted.
+class IdBitSet {
+ public:
+  // Marks `id` as taken. Returns false if it already was.
+  bool Insert(size_t id) {
+    const size_t word = id / 64u;
+    if (word >= words_.size()) {
+      words_.resize(word + 1u, 0u);
+    }
+    const uint64_t bit = uint64_t(1u) << (id % 64u);
+    if (words_[word] & bit) {
+      return false;
+    }
+    words_[word] |= bit;
+    return true;
+  }
+
+  // Returns the smallest ID >= `start` that is not taken.
+  size_t NextFree(size_t start) const {
+    size_t word = start / 64u;
+    if (word >= words_.size()) {
+      return start;
+    }
+
+    uint64_t free_bits = ~words_[word] & (~uint64_t(0u) << (start % 64u));
+    while (free_bits == 0u) {
+      if (++word == words_.size()) {
+        return word * 64u;
+      }
+      free_bits = ~words_[word];
+    }
+    return word * 64u + __builtin_ctzll(free_bits);
+  }
+
+ private:
+  std::vector<uint64_t> words_;
+};
+
+// The resource IDs that are taken, with a bitmap of type IDs per package and a bitmap of entry
+// IDs per type.
+class ReservedIds {
+ public:
+  // Marks `id` as taken. Returns false if it already was.
+  bool Reserve(const ResourceId& id) {
+    PackageIds& package = packages_[id.package_id()];
+    package.type_ids.Insert(id.type_id());
+    return package.entry_ids[id.type_id()].Insert(id.entry_id());
+  }
+
+  // Returns the smallest type ID >= `start` that no reserved ID of the package uses.
+  size_t NextFreeTypeId(uint8_t package_id, size_t start) const {
+    const auto iter = packages_.find(package_id);
+    return iter != packages_.end() ? iter->second.type_ids.NextFree(start) : start;
+  }
+
+  // Returns the smallest entry ID >= `start` that no reserved ID of the type uses.
+  size_t NextFreeEntryId(uint8_t package_id, uint8_t type_id, size_t start) const {
+    const auto iter = packages_.find(package_id);
+    return iter != packages_.end() ? iter->second.entry_ids[type_id].NextFree(start) : start;
+  }
+
+ private:
+  struct PackageIds {
+    IdBitSet type_ids;
+    std::array<IdBitSet, 256u> entry_ids;
+  };
+
+  std::unordered_map<uint8_t, PackageIds> packages_;
+};
+
+}  // namespace
+
 /**
  * Assigns the intended ID to the ResourceTablePackage, ResourceTableType, and
  * ResourceEntry,
  * as long as there is no existing ID or the ID is the same.
  */
 static bool AssignId(IDiagnostics* diag, const ResourceId& id,
-                     const ResourceName& name, ResourceTablePackage* pkg,
+                     const ResourceNameRef& name, ResourceTablePackage* pkg,
                      ResourceTableType* type, ResourceEntry* entry) {
   if (pkg->id.value() == id.package_id()) {
     if (!type->id || type->id.value() == id.type_id()) {
@@ -52,23 +129,59 @@ static bool AssignId(IDiagnostics* diag, const ResourceId& id,
   return false;
 }
 
+// Returns the name of the first resource in the table with `id`, other than `skip`. Only used
+// to report collisions, so that names don't have to be kept for every reserved ID.
+static Maybe<ResourceName> FindNameInTable(ResourceTable* table, const ResourceId& id,
+                                           const ResourceEntry* skip) {
+  for (auto& package : table->packages) {
+    if (package->id.value() != id.package_id()) {
+      continue;
+    }
+
+    for (auto& type : package->types) {
+      if (!type->id || type->id.value() != id.type_id()) {
+        continue;
+      }
+
+      for (auto& entry : type->entries) {
+        if (entry.get() != skip && entry->id && entry->id.value() == id.entry_id()) {
+          return ResourceName(package->name, type->type, entry->name);
+        }
+      }
+    }
+  }
+  return {};
+}
+
+// Returns whether `name` is in the table with exactly the ID `id`.
+static bool HasId(ResourceTable* table, const ResourceNameRef& name, const ResourceId& id) {
+  Maybe<ResourceTable::SearchResult> result = table->FindResource(name);
+  if (!result) {
+    return false;
+  }
+
+  const ResourceTable::SearchResult& search_result = result.value();
+  return search_result.package->id && search_result.type->id && search_result.entry->id &&
+         ResourceId(search_result.package->id.value(), search_result.type->id.value(),
+                    search_result.entry->id.value()) == id;
+}
+
 bool IdAssigner::Consume(IAaptContext* context, ResourceTable* table) {
-  std::map<ResourceId, ResourceName> assigned_ids;
+  ReservedIds reserved_ids;
 
   for (auto& package : table->packages) {
     CHECK(bool(package->id)) << "packages must have manually assigned IDs";
 
     for (auto& type : package->types) {
       for (auto& entry : type->entries) {
-        const ResourceName name(package->name, type->type, entry->name);
+        const ResourceNameRef name(package->name, type->type, entry->name);
 
         if (assigned_id_map_) {
           // Assign the pre-assigned stable ID meant for this resource.
-          const auto iter = assigned_id_map_->find(name);
-          if (iter != assigned_id_map_->end()) {
-            const ResourceId assigned_id = iter->second;
+          const Maybe<ResourceId> assigned_id = assigned_id_map_->FindId(name);
+          if (assigned_id) {
             const bool result =
-                AssignId(context->GetDiagnostics(), assigned_id, name,
+                AssignId(context->GetDiagnostics(), assigned_id.value(), name,
                          package.get(), type.get(), entry.get());
             if (!result) {
               return false;
@@ -80,12 +193,12 @@ bool IdAssigner::Consume(IAaptContext* context, ResourceTable* table) {
           // If the ID is set for this resource, then reserve it.
           ResourceId resource_id(package->id.value(), type->id.value(),
                                  entry->id.value());
-          auto result = assigned_ids.insert({resource_id, name});
-          const ResourceName& existing_name = result.first->second;
-          if (!result.second) {
+          if (!reserved_ids.Reserve(resource_id)) {
+            const Maybe<ResourceName> existing_name =
+                FindNameInTable(table, resource_id, entry.get());
             context->GetDiagnostics()->Error(
-                DiagMessage() << "resource " << name << " has same ID "
-                              << resource_id << " as " << existing_name);
+                DiagMessage() << "resource " << name << " has same ID " << resource_id
+                              << " as " << existing_name.value());
             return false;
           }
         }
@@ -97,117 +210,73 @@ bool IdAssigner::Consume(IAaptContext* context, ResourceTable* table) {
     // Reserve all the IDs mentioned in the stable ID map. That way we won't
     // assign
     // IDs that were listed in the map if they don't exist in the table.
-    for (const auto& stable_id_entry : *assigned_id_map_) {
-      const ResourceName& pre_assigned_name = stable_id_entry.first;
-      const ResourceId& pre_assigned_id = stable_id_entry.second;
-      auto result = assigned_ids.insert({pre_assigned_id, pre_assigned_name});
-      const ResourceName& existing_name = result.first->second;
-      if (!result.second && existing_name != pre_assigned_name) {
-        context->GetDiagnostics()->Error(
-            DiagMessage() << "stable ID " << pre_assigned_id << " for resource "
-                          << pre_assigned_name
-                          << " is already taken by resource " << existing_name);
-        return false;
+    bool error = false;
+    assigned_id_map_->ForEach([&](const ResourceNameRef& pre_assigned_name,
+                                  ResourceId pre_assigned_id) {
+      if (error || reserved_ids.Reserve(pre_assigned_id)) {
+        return;
+      }
+
+      // The ID is taken, which is fine if it was taken by this resource.
+      if (HasId(table, pre_assigned_name, pre_assigned_id)) {
+        return;
+      }
+
+      // Otherwise it is either taken by a resource in the table, or by another stable ID.
+      Maybe<ResourceName> existing_name = FindNameInTable(table, pre_assigned_id, nullptr);
+      if (!existing_name) {
+        assigned_id_map_->ForEach([&](const ResourceNameRef& name, ResourceId id) {
+          if (!existing_name && id == pre_assigned_id && name != pre_assigned_name) {
+            existing_name = name.ToResourceName();
+          }
+        });
       }
+
+      context->GetDiagnostics()->Error(
+          DiagMessage() << "stable ID " << pre_assigned_id << " for resource "
+                        << pre_assigned_name << " is already taken by resource "
+                        << existing_name.value());
+      error = true;
+    });
+    if (error) {
+      return false;
     }
   }
 
   // Assign any resources without IDs the next available ID. Gaps will be filled
-  // if possible,
-  // unless those IDs have been reserved.
-
-  const auto assigned_ids_iter_end = assigned_ids.end();
+  // if possible, unless those IDs have been reserved. IDs handed out here are not reserved, but
+  // they are always above the ones handed out before them in the same package or type.
   for (auto& package : table->packages) {
     CHECK(bool(package->id)) << "packages must have manually assigned IDs";
 
-    // Build a half filled ResourceId object, which will be used to find the
-    // closest matching
-    // reserved ID in the assignedId map. From that point the next available
-    // type ID can be
-    // found.
-    ResourceId resource_id(package->id.value(), 0, 0);
-    uint8_t next_expected_type_id = 1;
-
-    // Find the closest matching ResourceId that is <= the one with only the
-    // package set.
-    auto next_type_iter = assigned_ids.lower_bound(resource_id);
+    const uint8_t package_id = package->id.value();
+    size_t next_type_id = 1u;
     for (auto& type : package->types) {
       if (!type->id) {
-        // We need to assign a type ID. Iterate over the reserved IDs until we
-        // find
-        // some type ID that is a distance of 2 greater than the last one we've
-        // seen.
-        // That means there is an available type ID between these reserved IDs.
-        while (next_type_iter != assigned_ids_iter_end) {
-          if (next_type_iter->first.package_id() != package->id.value()) {
-            break;
-          }
-
-          const uint8_t type_id = next_type_iter->first.type_id();
-          if (type_id > next_expected_type_id) {
-            // There is a gap in the type IDs, so use the missing one.
-            type->id = next_expected_type_id++;
-            break;
-          }
-
-          // Set our expectation to be the next type ID after the reserved one
-          // we
-          // just saw.
-          next_expected_type_id = type_id + 1;
-
-          // Move to the next reserved ID.
-          ++next_type_iter;
-        }
-
-        if (!type->id) {
-          // We must have hit the end of the reserved IDs and not found a gap.
-          // That means the next ID is available.
-          type->id = next_expected_type_id++;
+        const size_t type_id = reserved_ids.NextFreeTypeId(package_id, next_type_id);
+        if (type_id > 0xffu) {
+          context->GetDiagnostics()->Error(DiagMessage() << "no type ID left in package "
+                                                         << package->name << " for type "
+                                                         << type->type);
+          return false;
         }
+        type->id = static_cast<uint8_t>(type_id);
+        next_type_id = type_id + 1u;
       }
 
-      resource_id = ResourceId(package->id.value(), type->id.value(), 0);
-      uint16_t next_expected_entry_id = 0;
-
-      // Find the closest matching ResourceId that is <= the one with only the
-      // package
-      // and type set.
-      auto next_entry_iter = assigned_ids.lower_bound(resource_id);
+      const uint8_t type_id = type->id.value();
+      size_t next_entry_id = 0u;
       for (auto& entry : type->entries) {
         if (!entry->id) {
-          // We need to assign an entry ID. Iterate over the reserved IDs until
-          // we find
-          // some entry ID that is a distance of 2 greater than the last one
-          // we've seen.
-          // That means there is an available entry ID between these reserved
-          // IDs.
-          while (next_entry_iter != assigned_ids_iter_end) {
-            if (next_entry_iter->first.package_id() != package->id.value() ||
-                next_entry_iter->first.type_id() != type->id.value()) {
-              break;
-            }
-
-            const uint16_t entry_id = next_entry_iter->first.entry_id();
-            if (entry_id > next_expected_entry_id) {
-              // There is a gap in the entry IDs, so use the missing one.
-              entry->id = next_expected_entry_id++;
-              break;
-            }
-
-            // Set our expectation to be the next type ID after the reserved one
-            // we
-            // just saw.
-            next_expected_entry_id = entry_id + 1;
-
-            // Move to the next reserved entry ID.
-            ++next_entry_iter;
-          }
-
-          if (!entry->id) {
-            // We must have hit the end of the reserved IDs and not found a gap.
-            // That means the next ID is available.
-            entry->id = next_expected_entry_id++;
+          const size_t entry_id = reserved_ids.NextFreeEntryId(package_id, type_id, next_entry_id);
+          if (entry_id > 0xffffu) {
+            context->GetDiagnostics()->Error(
+                DiagMessage() << "no entry ID left for resource "
+                              << ResourceNameRef(package->name, type->type, entry->name));
+            return false;
           }
+          entry->id = static_cast<uint16_t>(entry_id);
+          next_entry_id = entry_id + 1u;
         }
       }
     }
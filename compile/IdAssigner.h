@@ -17,12 +17,15 @@
 #ifndef AAPT_COMPILE_IDASSIGNER_H
 #define AAPT_COMPILE_IDASSIGNER_H
 
+#include <memory>
 #include <unordered_map>
 
 #include "android-base/macros.h"
 
 #include "Resource.h"
+#include "compile/StableIdMap.h"
 #include "process/IResourceTableConsumer.h"
+#include "util/Util.h"
 
 namespace aapt {
 
@@ -32,12 +35,21 @@ class IdAssigner : public IResourceTableConsumer {
  public:
   IdAssigner() = default;
   explicit IdAssigner(const std::unordered_map<ResourceName, ResourceId>* map)
-      : assigned_id_map_(map) {}
+      : owned_id_map_(util::make_unique<StableIdMap>(*map)),
+        assigned_id_map_(owned_id_map_.get()) {
+  }
+
+  // Assigns the IDs in `map` to the resources it names. The map must outlive this IdAssigner.
+  explicit IdAssigner(const StableIdMap* map) : assigned_id_map_(map) {
+  }
 
   bool Consume(IAaptContext* context, ResourceTable* table) override;
 
  private:
-  const std::unordered_map<ResourceName, ResourceId>* assigned_id_map_ = nullptr;
+  DISALLOW_COPY_AND_ASSIGN(IdAssigner);
+
+  std::unique_ptr<StableIdMap> owned_id_map_;
+  const StableIdMap* assigned_id_map_ = nullptr;
 };
 
 }  // namespace aapt
@@ -16,12 +16,42 @@
 
 #include "compile/IdAssigner.h"
 
+#include "android-base/stringprintf.h"
+
 #include "test/Test.h"
 
+using ::android::base::StringPrintf;
+using ::testing::ElementsAre;
+
 namespace aapt {
 
 ::testing::AssertionResult VerifyIds(ResourceTable* table);
 
+// Records the messages of the errors logged to the context.
+class ErrorRecordingContext : public test::Context {
+ public:
+  IDiagnostics* GetDiagnostics() override {
+    return &diagnostics_;
+  }
+
+  const std::vector<std::string>& errors() const {
+    return diagnostics_.errors;
+  }
+
+ private:
+  struct ErrorRecorder : public IDiagnostics {
+    void Log(Level level, DiagMessageActual& actual_msg) override {
+      if (level == Level::Error) {
+        errors.push_back(actual_msg.message);
+      }
+    }
+
+    std::vector<std::string> errors;
+  };
+
+  ErrorRecorder diagnostics_;
+};
+
 TEST(IdAssignerTest, AssignIds) {
   std::unique_ptr<ResourceTable> table = test::ResourceTableBuilder()
                                              .AddSimple("android:attr/foo")
@@ -106,6 +136,80 @@ TEST(IdAssignerTest, FailWhenNonUniqueIdsAssigned) {
   ASSERT_FALSE(assigner.Consume(context.get(), table.get()));
 }
 
+TEST(IdAssignerTest, NameBothResourcesWithSameId) {
+  std::unique_ptr<ResourceTable> table =
+      test::ResourceTableBuilder()
+          .AddSimple("android:attr/foo", ResourceId(0x01040006))
+          .AddSimple("android:attr/bar", ResourceId(0x01040006))
+          .SetPackageId("android", 0x01)
+          .Build();
+
+  ErrorRecordingContext context;
+  IdAssigner assigner;
+  ASSERT_FALSE(assigner.Consume(&context, table.get()));
+  EXPECT_THAT(context.errors(),
+              ElementsAre("resource android:attr/foo has same ID 0x01040006 as android:attr/bar"));
+}
+
+TEST(IdAssignerTest, NameResourceHoldingStableId) {
+  std::unique_ptr<ResourceTable> table =
+      test::ResourceTableBuilder()
+          .AddSimple("android:attr/foo", ResourceId(0x01040006))
+          .AddSimple("android:attr/bar")
+          .SetPackageId("android", 0x01)
+          .Build();
+
+  std::unordered_map<ResourceName, ResourceId> id_map = {
+      {test::ParseNameOrDie("android:attr/baz"), ResourceId(0x01040006)}};
+  ErrorRecordingContext context;
+  IdAssigner assigner(&id_map);
+  ASSERT_FALSE(assigner.Consume(&context, table.get()));
+  EXPECT_THAT(context.errors(),
+              ElementsAre("stable ID 0x01040006 for resource android:attr/baz is already taken "
+                          "by resource android:attr/foo"));
+}
+
+TEST(IdAssignerTest, FailWhenNoTypeIdLeft) {
+  std::unique_ptr<ResourceTable> table = test::ResourceTableBuilder()
+                                             .AddSimple("android:string/foo")
+                                             .SetPackageId("android", 0x01)
+                                             .Build();
+
+  // Take every type ID with stable IDs of resources that are not in the table.
+  std::unordered_map<ResourceName, ResourceId> id_map;
+  for (uint32_t type_id = 1u; type_id <= 0xffu; type_id++) {
+    id_map[ResourceName("android", ResourceType::kId, StringPrintf("id%u", type_id))] =
+        ResourceId(0x01u, static_cast<uint8_t>(type_id), 0u);
+  }
+
+  ErrorRecordingContext context;
+  IdAssigner assigner(&id_map);
+  ASSERT_FALSE(assigner.Consume(&context, table.get()));
+  EXPECT_THAT(context.errors(),
+              ElementsAre("no type ID left in package android for type string"));
+}
+
+TEST(IdAssignerTest, FailWhenNoEntryIdLeft) {
+  std::unique_ptr<ResourceTable> table =
+      test::ResourceTableBuilder()
+          .AddSimple("android:string/bar", ResourceId(0x0102ffff))
+          .AddSimple("android:string/foo")
+          .SetPackageId("android", 0x01)
+          .Build();
+
+  // Take every other entry ID of the string type.
+  std::unordered_map<ResourceName, ResourceId> id_map;
+  for (uint32_t entry_id = 0u; entry_id < 0xffffu; entry_id++) {
+    id_map[ResourceName("android", ResourceType::kString, StringPrintf("s%u", entry_id))] =
+        ResourceId(0x01u, 0x02u, static_cast<uint16_t>(entry_id));
+  }
+
+  ErrorRecordingContext context;
+  IdAssigner assigner(&id_map);
+  ASSERT_FALSE(assigner.Consume(&context, table.get()));
+  EXPECT_THAT(context.errors(), ElementsAre("no entry ID left for resource android:string/foo"));
+}
+
 TEST(IdAssignerTest, AssignIdsWithIdMap) {
   std::unique_ptr<ResourceTable> table = test::ResourceTableBuilder()
                                              .AddSimple("android:attr/foo")
@@ -0,0 +1,337 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "compile/StableIdMap.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "ResourceUtils.h"
+#include "util/Files.h"
+#include "util/Util.h"
+
+using ::android::StringPiece;
+
+namespace aapt {
+
+namespace {
+
+constexpr char kBinaryMagic[8] = {'A', 'A', 'P', 'T', 'S', 'I', 'D', 'S'};
+constexpr uint32_t kBinaryVersion = 1u;
+
+struct BinaryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t entry_count;
+  uint32_t pool_size;
+};
+
+static_assert(sizeof(BinaryHeader) == 20u, "BinaryHeader must not be padded");
+
+// Orders names by package, type name and entry, as the binary format requires.
+int CompareNames(const StringPiece& lhs_package, const StringPiece& lhs_type,
+                 const StringPiece& lhs_entry, const StringPiece& rhs_package,
+                 const StringPiece& rhs_type, const StringPiece& rhs_entry) {
+  int cmp = lhs_package.compare(rhs_package);
+  if (cmp != 0) return cmp;
+  cmp = lhs_type.compare(rhs_type);
+  if (cmp != 0) return cmp;
+  return lhs_entry.compare(rhs_entry);
+}
+
+void AppendUint32(uint32_t value, std::string* out) {
+  const uint32_t device_value = util::HostToDevice32(value);
+  out->append(reinterpret_cast<const char*>(&device_value), sizeof(device_value));
+}
+
+}  // namespace
+
+struct StableIdMap::BinaryEntry {
+  uint32_t package;
+  uint32_t type;
+  uint32_t entry;
+  uint32_t id;
+};
+
+std::unique_ptr<StableIdMap> StableIdMap::Load(const std::string& path, IDiagnostics* diag) {
+  std::string error;
+  Maybe<android::FileMap> file_map = file::MmapPath(path, &error);
+  if (!file_map) {
+    diag->Error(DiagMessage(path) << "failed reading stable ID file: " << error);
+    return {};
+  }
+
+  const char* data = reinterpret_cast<const char*>(file_map.value().getDataPtr());
+  const size_t size = file_map.value().getDataLength();
+  if (size < sizeof(kBinaryMagic) || memcmp(data, kBinaryMagic, sizeof(kBinaryMagic)) != 0) {
+    return ParseText(StringPiece(data, size), path, diag);
+  }
+
+  std::unique_ptr<StableIdMap> id_map = util::make_unique<StableIdMap>();
+  if (!id_map->InitBinary(data, size, &error)) {
+    diag->Error(DiagMessage(path) << "invalid stable ID file: " << error);
+    return {};
+  }
+
+  // Moving the FileMap keeps the mapping, and with it the pointers into the data.
+  id_map->file_map_ = std::move(file_map);
+  return id_map;
+}
+
+std::unique_ptr<StableIdMap> StableIdMap::ParseText(const StringPiece& content,
+                                                    const std::string& path,
+                                                    IDiagnostics* diag) {
+  NameIdMap map;
+  size_t line_no = 0;
+  for (StringPiece line : util::Tokenize(content, '\n')) {
+    line_no++;
+    line = util::TrimWhitespace(line);
+    if (line.empty()) {
+      continue;
+    }
+
+    auto iter = std::find(line.begin(), line.end(), '=');
+    if (iter == line.end()) {
+      diag->Error(DiagMessage(Source(path, line_no)) << "missing '='");
+      return {};
+    }
+
+    ResourceNameRef name;
+    StringPiece res_name_str =
+        util::TrimWhitespace(line.substr(0, std::distance(line.begin(), iter)));
+    if (!ResourceUtils::ParseResourceName(res_name_str, &name)) {
+      diag->Error(DiagMessage(Source(path, line_no)) << "invalid resource name '" << res_name_str
+                                                     << "'");
+      return {};
+    }
+
+    const size_t res_id_start_idx = std::distance(line.begin(), iter) + 1;
+    const size_t res_id_str_len = line.size() - res_id_start_idx;
+    StringPiece res_id_str = util::TrimWhitespace(line.substr(res_id_start_idx, res_id_str_len));
+
+    Maybe<ResourceId> maybe_id = ResourceUtils::ParseResourceId(res_id_str);
+    if (!maybe_id) {
+      diag->Error(DiagMessage(Source(path, line_no)) << "invalid resource ID '" << res_id_str
+                                                     << "'");
+      return {};
+    }
+
+    map[name.ToResourceName()] = maybe_id.value();
+  }
+  return util::make_unique<StableIdMap>(std::move(map));
+}
+
+std::unique_ptr<StableIdMap> StableIdMap::CreateFromBinary(std::string data,
+                                                           std::string* out_error) {
+  std::unique_ptr<StableIdMap> id_map = util::make_unique<StableIdMap>();
+  id_map->binary_data_ = std::move(data);
+  if (!id_map->InitBinary(id_map->binary_data_.data(), id_map->binary_data_.size(), out_error)) {
+    return {};
+  }
+  return id_map;
+}
+
+bool StableIdMap::InitBinary(const void* data, size_t size, std::string* out_error) {
+  static_assert(sizeof(BinaryEntry) == 16u, "BinaryEntry must not be padded");
+
+  const char* bytes = reinterpret_cast<const char*>(data);
+  if (size < sizeof(BinaryHeader)) {
+    *out_error = "file is too small";
+    return false;
+  }
+
+  const BinaryHeader* header = reinterpret_cast<const BinaryHeader*>(bytes);
+  if (memcmp(header->magic, kBinaryMagic, sizeof(kBinaryMagic)) != 0) {
+    *out_error = "bad magic";
+    return false;
+  }
+
+  const uint32_t version = util::DeviceToHost32(header->version);
+  if (version != kBinaryVersion) {
+    *out_error = "unsupported version " + std::to_string(version);
+    return false;
+  }
+
+  const size_t entry_count = util::DeviceToHost32(header->entry_count);
+  const size_t pool_size = util::DeviceToHost32(header->pool_size);
+  const size_t remaining = size - sizeof(BinaryHeader);
+  if (entry_count > remaining / sizeof(BinaryEntry) ||
+      remaining - entry_count * sizeof(BinaryEntry) != pool_size) {
+    *out_error = "entries and string pool do not match the file size";
+    return false;
+  }
+
+  entries_ = reinterpret_cast<const BinaryEntry*>(bytes + sizeof(BinaryHeader));
+  entry_count_ = entry_count;
+  pool_ = bytes + sizeof(BinaryHeader) + entry_count * sizeof(BinaryEntry);
+  pool_size_ = pool_size;
+
+  // Check every string and the order of the entries once, so that lookups can trust them.
+  auto is_valid_string = [&](uint32_t device_offset) -> bool {
+    const size_t offset = util::DeviceToHost32(device_offset);
+    if (pool_size_ < sizeof(uint32_t) || offset > pool_size_ - sizeof(uint32_t)) {
+      return false;
+    }
+    uint32_t length;
+    memcpy(&length, pool_ + offset, sizeof(length));
+    return util::DeviceToHost32(length) <= pool_size_ - offset - sizeof(uint32_t);
+  };
+
+  for (size_t i = 0; i < entry_count_; i++) {
+    const BinaryEntry& entry = entries_[i];
+    if (!is_valid_string(entry.package) || !is_valid_string(entry.type) ||
+        !is_valid_string(entry.entry)) {
+      *out_error = "entry " + std::to_string(i) + " has a string outside of the pool";
+      return false;
+    }
+
+    if (ParseResourceType(GetPoolString(entry.type)) == nullptr) {
+      *out_error = "entry " + std::to_string(i) + " has an invalid resource type";
+      return false;
+    }
+
+    if (i > 0) {
+      const BinaryEntry& prev = entries_[i - 1];
+      if (CompareNames(GetPoolString(prev.package), GetPoolString(prev.type),
+                       GetPoolString(prev.entry), GetPoolString(entry.package),
+                       GetPoolString(entry.type), GetPoolString(entry.entry)) >= 0) {
+        *out_error = "entry " + std::to_string(i) + " is out of order";
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+StringPiece StableIdMap::GetPoolString(uint32_t device_offset) const {
+  const size_t offset = util::DeviceToHost32(device_offset);
+  uint32_t length;
+  memcpy(&length, pool_ + offset, sizeof(length));
+  return StringPiece(pool_ + offset + sizeof(length), util::DeviceToHost32(length));
+}
+
+Maybe<ResourceId> StableIdMap::FindId(const ResourceNameRef& name) const {
+  if (entries_ == nullptr) {
+    const auto iter = map_.find(name.ToResourceName());
+    if (iter == map_.end()) {
+      return {};
+    }
+    return iter->second;
+  }
+
+  const StringPiece type = ToString(name.type);
+  size_t low = 0u;
+  size_t high = entry_count_;
+  while (low < high) {
+    const size_t mid = low + (high - low) / 2u;
+    const BinaryEntry& entry = entries_[mid];
+    const int cmp = CompareNames(GetPoolString(entry.package), GetPoolString(entry.type),
+                                 GetPoolString(entry.entry), name.package, type, name.entry);
+    if (cmp == 0) {
+      return ResourceId(util::DeviceToHost32(entry.id));
+    } else if (cmp < 0) {
+      low = mid + 1u;
+    } else {
+      high = mid;
+    }
+  }
+  return {};
+}
+
+size_t StableIdMap::size() const {
+  return entries_ != nullptr ? entry_count_ : map_.size();
+}
+
+void StableIdMap::ForEach(
+    const std::function<void(const ResourceNameRef&, ResourceId)>& func) const {
+  if (entries_ == nullptr) {
+    for (const auto& entry : map_) {
+      func(entry.first, entry.second);
+    }
+    return;
+  }
+
+  for (size_t i = 0; i < entry_count_; i++) {
+    const BinaryEntry& entry = entries_[i];
+    const ResourceNameRef name(GetPoolString(entry.package),
+                               *ParseResourceType(GetPoolString(entry.type)),
+                               GetPoolString(entry.entry));
+    func(name, ResourceId(util::DeviceToHost32(entry.id)));
+  }
+}
+
+std::string StableIdMap::SerializeBinary(const NameIdMap& map) {
+  struct SortedEntry {
+    StringPiece package;
+    StringPiece type;
+    StringPiece entry;
+    ResourceId id;
+  };
+
+  std::vector<SortedEntry> sorted_entries;
+  sorted_entries.reserve(map.size());
+  for (const auto& entry : map) {
+    const ResourceName& name = entry.first;
+    sorted_entries.push_back(SortedEntry{name.package, ToString(name.type), name.entry,
+                                         entry.second});
+  }
+  std::sort(sorted_entries.begin(), sorted_entries.end(),
+            [](const SortedEntry& a, const SortedEntry& b) {
+              return CompareNames(a.package, a.type, a.entry, b.package, b.type, b.entry) < 0;
+            });
+
+  // Package and type names are shared by many entries, so each string is only stored once.
+  std::string pool;
+  std::unordered_map<StringPiece, uint32_t> pool_offsets;
+  auto add_to_pool = [&](const StringPiece& str) -> uint32_t {
+    auto result = pool_offsets.insert({str, static_cast<uint32_t>(pool.size())});
+    if (result.second) {
+      AppendUint32(static_cast<uint32_t>(str.size()), &pool);
+      pool.append(str.data(), str.size());
+    }
+    return result.first->second;
+  };
+
+  std::string entries;
+  entries.reserve(sorted_entries.size() * sizeof(BinaryEntry));
+  for (const SortedEntry& entry : sorted_entries) {
+    AppendUint32(add_to_pool(entry.package), &entries);
+    AppendUint32(add_to_pool(entry.type), &entries);
+    AppendUint32(add_to_pool(entry.entry), &entries);
+    AppendUint32(entry.id.id, &entries);
+  }
+
+  std::string out(kBinaryMagic, sizeof(kBinaryMagic));
+  AppendUint32(kBinaryVersion, &out);
+  AppendUint32(static_cast<uint32_t>(sorted_entries.size()), &out);
+  AppendUint32(static_cast<uint32_t>(pool.size()), &out);
+  out += entries;
+  out += pool;
+  return out;
+}
+
+void StableIdMap::WriteText(const NameIdMap& map, std::ostream* out) {
+  // Sort the entries, so that the same IDs always produce the same file.
+  std::vector<std::pair<ResourceName, ResourceId>> sorted_ids(map.begin(), map.end());
+  std::sort(sorted_ids.begin(), sorted_ids.end());
+
+  for (const auto& entry : sorted_ids) {
+    *out << entry.first << " = " << entry.second << "\n";
+  }
+}
+
+}  // namespace aapt
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AAPT_COMPILE_STABLEIDMAP_H
+#define AAPT_COMPILE_STABLEIDMAP_H
+
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+#include "android-base/macros.h"
+#include "androidfw/StringPiece.h"
+#include "utils/FileMap.h"
+
+#include "Diagnostics.h"
+#include "Resource.h"
+#include "util/Maybe.h"
+
+namespace aapt {
+
+// The IDs that resources must keep from one build to the next, as given to --stable-ids.
+//
+// The text format has one `package:type/entry = 0xPPTTEEEE` line per resource, and has to be
+// parsed into a hash map before it can be used. The binary format stores the entries sorted by
+// name, with their strings in a pool after them, so it can be mapped from disk and searched in
+// place without parsing or copying anything:
+//
+//   Header:  char magic[8] = "AAPTSIDS", uint32 version, uint32 entry_count, uint32 pool_size
+//   Entries: entry_count x {uint32 package, uint32 type, uint32 entry, uint32 id}, ordered by
+//            (package, type, entry) compared as bytes. Names are offsets into the pool.
+//   Pool:    pool_size bytes of strings, each a uint32 length followed by its characters.
+//
+// All integers are little-endian.
+class StableIdMap {
+ public:
+  using NameIdMap = std::unordered_map<ResourceName, ResourceId>;
+
+  // Creates an empty map.
+  StableIdMap() = default;
+
+  explicit StableIdMap(NameIdMap map) : map_(std::move(map)) {
+  }
+
+  // Loads a stable ID file in either format, telling them apart by the binary magic.
+  static std::unique_ptr<StableIdMap> Load(const std::string& path, IDiagnostics* diag);
+
+  // Parses the text format. Errors are reported against `path`.
+  static std::unique_ptr<StableIdMap> ParseText(const android::StringPiece& content,
+                                                const std::string& path, IDiagnostics* diag);
+
+  // Uses `data`, which must be in the binary format. Returns nullptr and sets `out_error` if it
+  // is malformed.
+  static std::unique_ptr<StableIdMap> CreateFromBinary(std::string data, std::string* out_error);
+
+  // Serializes `map` in the binary format.
+  static std::string SerializeBinary(const NameIdMap& map);
+
+  // Writes `map` in the text format, sorted by name.
+  static void WriteText(const NameIdMap& map, std::ostream* out);
+
+  Maybe<ResourceId> FindId(const ResourceNameRef& name) const;
+
+  size_t size() const;
+
+  // Calls `func` with every resource in the map.
+  void ForEach(const std::function<void(const ResourceNameRef&, ResourceId)>& func) const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(StableIdMap);
+
+  struct BinaryEntry;
+
+  // Validates the binary data in [data, data + size), which must outlive this map.
+  bool InitBinary(const void* data, size_t size, std::string* out_error);
+
+  android::StringPiece GetPoolString(uint32_t offset) const;
+
+  // Set when the map was loaded from the text format, or created from a NameIdMap.
+  NameIdMap map_;
+
+  // Set when the map was loaded from the binary format. The data is either mapped from disk or
+  // owned by binary_data_.
+  Maybe<android::FileMap> file_map_;
+  std::string binary_data_;
+  const BinaryEntry* entries_ = nullptr;
+  size_t entry_count_ = 0u;
+  const char* pool_ = nullptr;
+  size_t pool_size_ = 0u;
+};
+
+}  // namespace aapt
+
+#endif /* AAPT_COMPILE_STABLEIDMAP_H */
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "compile/StableIdMap.h"
+
+#include "compile/IdAssigner.h"
+#include "test/Test.h"
+
+namespace aapt {
+
+TEST(StableIdMapTest, ParseText) {
+  std::unique_ptr<IAaptContext> context = test::ContextBuilder().Build();
+  const std::string content =
+      "android:attr/foo = 0x01010000\n"
+      "\n"
+      "  com.app:string/bar = 0x7f020001  \n";
+  std::unique_ptr<StableIdMap> id_map =
+      StableIdMap::ParseText(content, "ids.txt", context->GetDiagnostics());
+  ASSERT_NE(nullptr, id_map);
+  EXPECT_EQ(2u, id_map->size());
+  EXPECT_EQ(make_value(ResourceId(0x01010000)),
+            id_map->FindId(test::ParseNameOrDie("android:attr/foo")));
+  EXPECT_EQ(make_value(ResourceId(0x7f020001)),
+            id_map->FindId(test::ParseNameOrDie("com.app:string/bar")));
+  EXPECT_FALSE(id_map->FindId(test::ParseNameOrDie("com.app:string/foo")));
+}
+
+TEST(StableIdMapTest, FailToParseTextWithoutId) {
+  std::unique_ptr<IAaptContext> context = test::ContextBuilder().Build();
+  EXPECT_EQ(nullptr,
+            StableIdMap::ParseText("android:attr/foo\n", "ids.txt", context->GetDiagnostics()));
+}
+
+TEST(StableIdMapTest, BinaryFormatRoundTrips) {
+  const StableIdMap::NameIdMap ids = {
+      {test::ParseNameOrDie("com.app:string/bar"), ResourceId(0x7f020001)},
+      {test::ParseNameOrDie("com.app:string/foo"), ResourceId(0x7f020000)},
+      {test::ParseNameOrDie("com.app:attr/foo"), ResourceId(0x7f010000)},
+      {test::ParseNameOrDie("android:attr/foo"), ResourceId(0x01010000)},
+  };
+
+  std::string error;
+  std::unique_ptr<StableIdMap> id_map =
+      StableIdMap::CreateFromBinary(StableIdMap::SerializeBinary(ids), &error);
+  ASSERT_NE(nullptr, id_map) << error;
+  EXPECT_EQ(ids.size(), id_map->size());
+
+  for (const auto& entry : ids) {
+    EXPECT_EQ(make_value(entry.second), id_map->FindId(entry.first)) << entry.first;
+  }
+  EXPECT_FALSE(id_map->FindId(test::ParseNameOrDie("com.app:string/baz")));
+  EXPECT_FALSE(id_map->FindId(test::ParseNameOrDie("android:string/foo")));
+
+  StableIdMap::NameIdMap visited;
+  id_map->ForEach([&](const ResourceNameRef& name, ResourceId id) {
+    visited[name.ToResourceName()] = id;
+  });
+  EXPECT_EQ(ids, visited);
+}
+
+TEST(StableIdMapTest, RejectMalformedBinary) {
+  const StableIdMap::NameIdMap ids = {
+      {test::ParseNameOrDie("com.app:string/foo"), ResourceId(0x7f020000)},
+  };
+  const std::string data = StableIdMap::SerializeBinary(ids);
+
+  std::string error;
+  EXPECT_EQ(nullptr, StableIdMap::CreateFromBinary(data.substr(0, data.size() - 1), &error));
+
+  std::string bad_offset = data;
+  bad_offset[20] = '\xff';
+  EXPECT_EQ(nullptr, StableIdMap::CreateFromBinary(bad_offset, &error));
+
+  std::string bad_version = data;
+  bad_version[8] = '\x02';
+  EXPECT_EQ(nullptr, StableIdMap::CreateFromBinary(bad_version, &error));
+}
+
+TEST(StableIdMapTest, AssignIdsFromBinaryMap) {
+  std::unique_ptr<ResourceTable> table = test::ResourceTableBuilder()
+                                             .AddSimple("android:attr/foo")
+                                             .AddSimple("android:attr/bar")
+                                             .SetPackageId("android", 0x01)
+                                             .Build();
+
+  std::string error;
+  std::unique_ptr<StableIdMap> id_map = StableIdMap::CreateFromBinary(
+      StableIdMap::SerializeBinary(
+          {{test::ParseNameOrDie("android:attr/foo"), ResourceId(0x01010002)},
+           {test::ParseNameOrDie("android:attr/baz"), ResourceId(0x01010000)}}),
+      &error);
+  ASSERT_NE(nullptr, id_map) << error;
+
+  std::unique_ptr<IAaptContext> context = test::ContextBuilder().Build();
+  IdAssigner assigner(id_map.get());
+  ASSERT_TRUE(assigner.Consume(context.get(), table.get()));
+
+  Maybe<ResourceTable::SearchResult> result =
+      table->FindResource(test::ParseNameOrDie("android:attr/foo"));
+  ASSERT_TRUE(result);
+  EXPECT_EQ(make_value<uint16_t>(0x0002), result.value().entry->id);
+
+  // The ID reserved for android:attr/baz must not be handed out.
+  result = table->FindResource(test::ParseNameOrDie("android:attr/bar"));
+  ASSERT_TRUE(result);
+  EXPECT_EQ(make_value<uint16_t>(0x0001), result.value().entry->id);
+}
+
+}  // namespace aapt
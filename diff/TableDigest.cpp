@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "diff/TableDigest.h"
+
+#include <algorithm>
+
+#include "ValueVisitor.h"
+#include "util/Digest.h"
+
+namespace aapt {
+
+namespace {
+
+// Feeds everything that Value::Equals() compares into a Digest. Each kind of value starts with
+// its own tag, so that different kinds of values with the same contents don't collide.
+class ValueDigester : public RawValueVisitor {
+ public:
+  using RawValueVisitor::Visit;
+
+  explicit ValueDigester(Digest* digest) : digest_(digest) {
+  }
+
+  void Visit(Reference* ref) override {
+    digest_->Update('R').Update(static_cast<uint64_t>(ref->reference_type))
+        .Update(ref->private_reference);
+    digest_->Update(bool(ref->id)).Update(ref->id ? ref->id.value().id : 0u);
+    digest_->Update(bool(ref->name));
+    if (ref->name) {
+      const ResourceName& name = ref->name.value();
+      digest_->Update(name.package).Update(static_cast<uint64_t>(name.type)).Update(name.entry);
+    }
+  }
+
+  void Visit(RawString* str) override {
+    digest_->Update('r').Update(*str->value);
+  }
+
+  void Visit(String* str) override {
+    digest_->Update('s').Update(*str->value);
+    VisitUntranslatableSections(str->untranslatable_sections);
+  }
+
+  void Visit(StyledString* str) override {
+    digest_->Update('S').Update(str->value->value);
+    digest_->Update(str->value->spans.size());
+    for (const StringPool::Span& span : str->value->spans) {
+      digest_->Update(*span.name).Update(span.first_char).Update(span.last_char);
+    }
+    VisitUntranslatableSections(str->untranslatable_sections);
+  }
+
+  void Visit(FileReference* file) override {
+    digest_->Update('f').Update(*file->path);
+  }
+
+  void Visit(Id* id) override {
+    digest_->Update('i');
+  }
+
+  void Visit(BinaryPrimitive* prim) override {
+    digest_->Update('b').Update(prim->value.dataType).Update(prim->value.data);
+  }
+
+  void Visit(Attribute* attr) override {
+    digest_->Update('A').Update(attr->type_mask).Update(static_cast<uint32_t>(attr->min_int))
+        .Update(static_cast<uint32_t>(attr->max_int));
+
+    // Attribute::Equals() doesn't depend on the order of the symbols.
+    std::vector<Attribute::Symbol*> symbols;
+    for (Attribute::Symbol& symbol : attr->symbols) {
+      symbols.push_back(&symbol);
+    }
+    std::sort(symbols.begin(), symbols.end(),
+              [](const Attribute::Symbol* a, const Attribute::Symbol* b) -> bool {
+                return a->symbol.name < b->symbol.name;
+              });
+
+    digest_->Update(symbols.size());
+    for (Attribute::Symbol* symbol : symbols) {
+      Visit(&symbol->symbol);
+      digest_->Update(symbol->value);
+    }
+  }
+
+  void Visit(Style* style) override {
+    digest_->Update('T').Update(bool(style->parent));
+    if (style->parent) {
+      Visit(&style->parent.value());
+    }
+
+    // Style::Equals() doesn't depend on the order of the entries.
+    std::vector<Style::Entry*> entries;
+    for (Style::Entry& entry : style->entries) {
+      entries.push_back(&entry);
+    }
+    std::sort(entries.begin(), entries.end(), [](const Style::Entry* a, const Style::Entry* b) {
+      return a->key.name < b->key.name;
+    });
+
+    digest_->Update(entries.size());
+    for (Style::Entry* entry : entries) {
+      Visit(&entry->key);
+      entry->value->Accept(this);
+    }
+  }
+
+  void Visit(Array* array) override {
+    digest_->Update('a').Update(array->elements.size());
+    for (std::unique_ptr<Item>& element : array->elements) {
+      element->Accept(this);
+    }
+  }
+
+  void Visit(Plural* plural) override {
+    digest_->Update('p');
+    for (std::unique_ptr<Item>& item : plural->values) {
+      digest_->Update(item != nullptr);
+      if (item != nullptr) {
+        item->Accept(this);
+      }
+    }
+  }
+
+  void Visit(Styleable* styleable) override {
+    digest_->Update('y').Update(styleable->entries.size());
+    for (Reference& ref : styleable->entries) {
+      Visit(&ref);
+    }
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ValueDigester);
+
+  void VisitUntranslatableSections(const std::vector<UntranslatableSection>& sections) {
+    digest_->Update(sections.size());
+    for (const UntranslatableSection& section : sections) {
+      digest_->Update(section.start).Update(section.end);
+    }
+  }
+
+  Digest* digest_;
+};
+
+// Adds the parts of a symbol that the diff compares. The public ID is only compared when the
+// symbol is public.
+template <typename Id>
+void DigestSymbol(const Symbol& symbol, const Maybe<Id>& id, Digest* digest) {
+  digest->Update(static_cast<uint64_t>(symbol.state));
+  if (symbol.state == SymbolState::kPublic) {
+    digest->Update(bool(id)).Update(id ? id.value() : 0u);
+  }
+}
+
+}  // namespace
+
+uint64_t DigestValue(Value* value) {
+  Digest digest;
+  ValueDigester digester(&digest);
+  value->Accept(&digester);
+  return digest.value();
+}
+
+uint64_t DigestEntry(ResourceEntry* entry) {
+  Digest digest;
+  digest.Update(entry->name);
+  DigestSymbol(entry->symbol_status, entry->id, &digest);
+
+  digest.Update(entry->values.size());
+  for (std::unique_ptr<ResourceConfigValue>& config_value : entry->values) {
+    const android::ResTable_config& config = config_value->config;
+    digest.Update(&config, sizeof(config)).Update(config_value->product);
+    digest.Update(DigestValue(config_value->value.get()));
+  }
+  return digest.value();
+}
+
+void TableDigests::Compute(const std::vector<ResourceTable*>& tables, ThreadPool* thread_pool) {
+  std::vector<ResourceTableType*> types;
+  for (ResourceTable* table : tables) {
+    for (auto& package : table->packages) {
+      for (auto& type : package->types) {
+        types.push_back(type.get());
+      }
+    }
+  }
+
+  // Each type is digested into its own slot, so the threads don't share anything.
+  std::vector<TypeDigest> type_digests(types.size());
+  thread_pool->ForEach(types.size(), [&](size_t i) {
+    ResourceTableType* type = types[i];
+    TypeDigest& type_digest = type_digests[i];
+
+    Digest digest;
+    digest.Update(static_cast<uint64_t>(type->type));
+    DigestSymbol(type->symbol_status, type->id, &digest);
+    digest.Update(type->entries.size());
+
+    type_digest.entry_digests.reserve(type->entries.size());
+    for (auto& entry : type->entries) {
+      const uint64_t entry_digest = DigestEntry(entry.get());
+      type_digest.entry_digests.push_back(entry_digest);
+      digest.Update(entry_digest);
+    }
+    type_digest.digest = digest.value();
+  });
+
+  for (size_t i = 0; i < types.size(); i++) {
+    types_[types[i]] = std::move(type_digests[i]);
+  }
+
+  for (ResourceTable* table : tables) {
+    for (auto& package : table->packages) {
+      Digest digest;
+      digest.Update(package->name).Update(bool(package->id));
+      digest.Update(package->id ? package->id.value() : 0u).Update(package->types.size());
+      for (auto& type : package->types) {
+        digest.Update(GetTypeDigest(type.get()));
+      }
+      packages_[package.get()] = digest.value();
+    }
+  }
+}
+
+uint64_t TableDigests::GetPackageDigest(const ResourceTablePackage* package) const {
+  return packages_.at(package);
+}
+
+uint64_t TableDigests::GetTypeDigest(const ResourceTableType* type) const {
+  return types_.at(type).digest;
+}
+
+uint64_t TableDigests::GetEntryDigest(const ResourceTableType* type, size_t index) const {
+  return types_.at(type).entry_digests[index];
+}
+
+}  // namespace aapt
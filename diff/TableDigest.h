@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AAPT_DIFF_TABLEDIGEST_H
+#define AAPT_DIFF_TABLEDIGEST_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "android-base/macros.h"
+
+#include "ResourceTable.h"
+#include "ResourceValues.h"
+#include "util/ThreadPool.h"
+
+namespace aapt {
+
+// Returns a digest of `value`. Values for which Value::Equals() is true have the same digest, so
+// two values with different digests are known to differ without comparing them.
+uint64_t DigestValue(Value* value);
+
+// Returns a digest of `entry`, covering its name, visibility, public ID and every config value.
+uint64_t DigestEntry(ResourceEntry* entry);
+
+// Digests of the types and packages of resource tables, built bottom-up from the digests of their
+// values. Two subtrees with the same digest have the same contents, so a comparison of two tables
+// only needs to look into the subtrees whose digests differ.
+class TableDigests {
+ public:
+  TableDigests() = default;
+
+  // Computes the digests of every package and type in `tables`. The types are digested on the
+  // threads of `thread_pool`.
+  void Compute(const std::vector<ResourceTable*>& tables, ThreadPool* thread_pool);
+
+  // Returns the digest of a package computed by Compute().
+  uint64_t GetPackageDigest(const ResourceTablePackage* package) const;
+
+  // Returns the digest of a type computed by Compute().
+  uint64_t GetTypeDigest(const ResourceTableType* type) const;
+
+  // Returns the digest of the entry at `index` in type->entries.
+  uint64_t GetEntryDigest(const ResourceTableType* type, size_t index) const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(TableDigests);
+
+  struct TypeDigest {
+    uint64_t digest = 0u;
+    std::vector<uint64_t> entry_digests;
+  };
+
+  std::unordered_map<const ResourceTablePackage*, uint64_t> packages_;
+  std::unordered_map<const ResourceTableType*, TypeDigest> types_;
+};
+
+}  // namespace aapt
+
+#endif /* AAPT_DIFF_TABLEDIGEST_H */
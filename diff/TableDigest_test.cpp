@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "diff/TableDigest.h"
+
+#include "ResourceUtils.h"
+#include "test/Test.h"
+
+namespace aapt {
+
+static std::unique_ptr<ResourceTable> BuildTable(const android::StringPiece& app_name) {
+  return test::ResourceTableBuilder()
+      .SetPackageId("com.app", 0x7f)
+      .AddString("com.app:string/app_name", ResourceId(0x7f020000), app_name)
+      .AddString("com.app:string/title", ResourceId(0x7f020001), "Title")
+      .AddReference("com.app:id/ref", ResourceId(0x7f010000), "com.app:string/title")
+      .AddValue("com.app:style/Theme", ResourceId(0x7f030000),
+                test::StyleBuilder()
+                    .AddItem("android:attr/foo", ResourceUtils::TryParseInt("1"))
+                    .AddItem("android:attr/bar", ResourceUtils::TryParseInt("2"))
+                    .Build())
+      .Build();
+}
+
+TEST(TableDigestTest, EqualValuesHaveEqualDigests) {
+  std::unique_ptr<Value> style_a = test::StyleBuilder()
+                                       .AddItem("android:attr/foo", ResourceUtils::TryParseInt("1"))
+                                       .AddItem("android:attr/bar", ResourceUtils::TryParseInt("2"))
+                                       .Build();
+  std::unique_ptr<Value> style_b = test::StyleBuilder()
+                                       .AddItem("android:attr/bar", ResourceUtils::TryParseInt("2"))
+                                       .AddItem("android:attr/foo", ResourceUtils::TryParseInt("1"))
+                                       .Build();
+  ASSERT_TRUE(style_a->Equals(style_b.get()));
+  EXPECT_EQ(DigestValue(style_a.get()), DigestValue(style_b.get()));
+
+  std::unique_ptr<Value> style_c = test::StyleBuilder()
+                                       .AddItem("android:attr/foo", ResourceUtils::TryParseInt("1"))
+                                       .AddItem("android:attr/bar", ResourceUtils::TryParseInt("3"))
+                                       .Build();
+  EXPECT_NE(DigestValue(style_a.get()), DigestValue(style_c.get()));
+
+  std::unique_ptr<Value> ref = test::BuildReference("android:attr/foo");
+  std::unique_ptr<Value> attr_ref = test::BuildReference("android:attr/foo");
+  static_cast<Reference*>(attr_ref.get())->reference_type = Reference::Type::kAttribute;
+  EXPECT_NE(DigestValue(ref.get()), DigestValue(attr_ref.get()));
+}
+
+TEST(TableDigestTest, OnlyChangedSubtreesHaveDifferentDigests) {
+  std::unique_ptr<ResourceTable> table_a = BuildTable("App");
+  std::unique_ptr<ResourceTable> table_b = BuildTable("App");
+  std::unique_ptr<ResourceTable> table_c = BuildTable("Renamed App");
+
+  ThreadPool thread_pool(2u);
+  TableDigests digests;
+  digests.Compute({table_a.get(), table_b.get(), table_c.get()}, &thread_pool);
+
+  ResourceTablePackage* pkg_a = table_a->FindPackage("com.app");
+  ResourceTablePackage* pkg_b = table_b->FindPackage("com.app");
+  ResourceTablePackage* pkg_c = table_c->FindPackage("com.app");
+  EXPECT_EQ(digests.GetPackageDigest(pkg_a), digests.GetPackageDigest(pkg_b));
+  EXPECT_NE(digests.GetPackageDigest(pkg_a), digests.GetPackageDigest(pkg_c));
+
+  EXPECT_EQ(digests.GetTypeDigest(pkg_a->FindType(ResourceType::kStyle)),
+            digests.GetTypeDigest(pkg_c->FindType(ResourceType::kStyle)));
+
+  ResourceTableType* strings_a = pkg_a->FindType(ResourceType::kString);
+  ResourceTableType* strings_c = pkg_c->FindType(ResourceType::kString);
+  EXPECT_NE(digests.GetTypeDigest(strings_a), digests.GetTypeDigest(strings_c));
+
+  // Entries are sorted by name: app_name, then title.
+  EXPECT_NE(digests.GetEntryDigest(strings_a, 0), digests.GetEntryDigest(strings_c, 0));
+  EXPECT_EQ(digests.GetEntryDigest(strings_a, 1), digests.GetEntryDigest(strings_c, 1));
+}
+
+}  // namespace aapt
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flatten/ResourceAccessProfile.h"
+
+#include "android-base/file.h"
+
+#include "ResourceUtils.h"
+#include "util/Util.h"
+
+using ::android::StringPiece;
+
+namespace aapt {
+
+bool ResourceAccessProfile::Parse(const StringPiece& content, const Source& source,
+                                  IDiagnostics* diag) {
+  size_t line_no = 0;
+  for (StringPiece line : util::Tokenize(content, '\n')) {
+    line_no++;
+    line = util::TrimWhitespace(line);
+    if (line.empty() || util::StartsWith(line, "#")) {
+      continue;
+    }
+
+    if (util::StartsWith(line, "0x")) {
+      Maybe<ResourceId> maybe_id = ResourceUtils::ParseResourceId(line);
+      if (!maybe_id) {
+        diag->Error(DiagMessage(source.WithLine(line_no)) << "invalid resource ID '" << line
+                                                          << "'");
+        return false;
+      }
+      ids_.insert(maybe_id.value());
+      continue;
+    }
+
+    ResourceNameRef name;
+    if (!ResourceUtils::ParseResourceName(line, &name)) {
+      diag->Error(DiagMessage(source.WithLine(line_no)) << "invalid resource name '" << line
+                                                        << "'");
+      return false;
+    }
+    names_.insert(name.ToResourceName());
+  }
+  return true;
+}
+
+bool ResourceAccessProfile::Contains(const ResourceNameRef& name,
+                                     const Maybe<ResourceId>& id) const {
+  if (id && ids_.find(id.value()) != ids_.end()) {
+    return true;
+  }
+
+  if (names_.empty()) {
+    return false;
+  }
+  return names_.find(name.ToResourceName()) != names_.end() ||
+         names_.find(ResourceName({}, name.type, name.entry)) != names_.end();
+}
+
+bool LoadResourceAccessProfile(IDiagnostics* diag, const std::string& path,
+                               ResourceAccessProfile* out_profile) {
+  std::string content;
+  if (!android::base::ReadFileToString(path, &content, true /*follow_symlinks*/)) {
+    diag->Error(DiagMessage(path) << "failed reading access profile");
+    return false;
+  }
+  return out_profile->Parse(content, Source(path), diag);
+}
+
+}  // namespace aapt
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AAPT_FLATTEN_RESOURCEACCESSPROFILE_H
+#define AAPT_FLATTEN_RESOURCEACCESSPROFILE_H
+
+#include <string>
+#include <unordered_set>
+
+#include "androidfw/StringPiece.h"
+
+#include "Diagnostics.h"
+#include "Resource.h"
+#include "Source.h"
+#include "util/Maybe.h"
+
+namespace aapt {
+
+// The set of resources an app accesses at a point of interest, such as during startup, as
+// collected from a trace. The TableFlattener lays out the data of these resources so that it
+// is read from as few pages as possible.
+class ResourceAccessProfile {
+ public:
+  // Parses a profile listing one resource per line, either by name ([package:]type/entry) or by
+  // ID (0xPPTTEEEE). Blank lines and lines starting with '#' are ignored.
+  bool Parse(const android::StringPiece& content, const Source& source, IDiagnostics* diag);
+
+  bool empty() const {
+    return names_.empty() && ids_.empty();
+  }
+
+  // Returns true if the resource is listed in the profile, either by its name or by its ID.
+  // Names listed without a package match the resource in any package.
+  bool Contains(const ResourceNameRef& name, const Maybe<ResourceId>& id) const;
+
+ private:
+  std::unordered_set<ResourceName> names_;
+  std::unordered_set<ResourceId> ids_;
+};
+
+// Reads and parses the profile at `path`.
+bool LoadResourceAccessProfile(IDiagnostics* diag, const std::string& path,
+                               ResourceAccessProfile* out_profile);
+
+}  // namespace aapt
+
+#endif /* AAPT_FLATTEN_RESOURCEACCESSPROFILE_H */
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flatten/ResourceAccessProfile.h"
+
+#include "test/Test.h"
+
+namespace aapt {
+
+TEST(ResourceAccessProfileTest, ParseNamesAndIds) {
+  std::unique_ptr<IAaptContext> context = test::ContextBuilder().Build();
+
+  ResourceAccessProfile profile;
+  ASSERT_TRUE(profile.Parse(R"(
+      # Startup trace.
+      com.app:string/app_name
+      layout/main
+
+      0x7f020003
+      )",
+                            Source("profile.txt"), context->GetDiagnostics()));
+  EXPECT_FALSE(profile.empty());
+
+  EXPECT_TRUE(profile.Contains(test::ParseNameOrDie("com.app:string/app_name"), {}));
+  EXPECT_FALSE(profile.Contains(test::ParseNameOrDie("com.lib:string/app_name"), {}));
+
+  EXPECT_TRUE(profile.Contains(test::ParseNameOrDie("com.app:layout/main"), {}));
+  EXPECT_TRUE(profile.Contains(test::ParseNameOrDie("com.lib:layout/main"), {}));
+
+  EXPECT_TRUE(profile.Contains(test::ParseNameOrDie("com.app:drawable/icon"),
+                               ResourceId(0x7f020003)));
+  EXPECT_FALSE(profile.Contains(test::ParseNameOrDie("com.app:drawable/icon"),
+                                ResourceId(0x7f020004)));
+}
+
+TEST(ResourceAccessProfileTest, FailToParseInvalidLines) {
+  std::unique_ptr<IAaptContext> context = test::ContextBuilder().Build();
+
+  ResourceAccessProfile profile;
+  EXPECT_FALSE(profile.Parse("notatype/foo", Source("profile.txt"), context->GetDiagnostics()));
+  EXPECT_FALSE(profile.Parse("0xnotanid", Source("profile.txt"), context->GetDiagnostics()));
+}
+
+}  // namespace aapt
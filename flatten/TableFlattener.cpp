@@ -17,6 +17,7 @@
 #include "flatten/TableFlattener.h"
 
 #include <algorithm>
+#include <memory>
 #include <numeric>
 #include <sstream>
 #include <type_traits>
@@ -24,6 +25,8 @@
 #include "android-base/logging.h"
 #include "android-base/macros.h"
 
+#include "ConfigInterner.h"
+#include "Diagnostics.h"
 #include "ResourceTable.h"
 #include "ResourceValues.h"
 #include "SdkConstants.h"
@@ -31,6 +34,7 @@
 #include "flatten/ChunkWriter.h"
 #include "flatten/ResourceTypeExtensions.h"
 #include "util/BigBuffer.h"
+#include "util/ThreadPool.h"
 
 using namespace android;
 
@@ -68,12 +72,58 @@ static bool cmp_style_entries(const Style::Entry& a, const Style::Entry& b) {
   return false;
 }
 
+// Counts of how the type chunks were encoded, used to report the savings of sparse encoding.
+struct SparseEncodingStats {
+  size_t type_chunks = 0u;
+  size_t sparse_type_chunks = 0u;
+  size_t saved_bytes = 0u;
+
+  void Merge(const SparseEncodingStats& other) {
+    type_chunks += other.type_chunks;
+    sparse_type_chunks += other.sparse_type_chunks;
+    saved_bytes += other.saved_bytes;
+  }
+};
+
 struct FlatEntry {
   ResourceEntry* entry;
   Value* value;
 
   // The entry string pool index to the entry's name.
   uint32_t entry_key;
+
+  // Whether the entry is listed in the access profile.
+  bool hot;
+};
+
+// Raises the priority of the strings referenced by a value, so that sorting the string pool
+// places them first.
+class HotStringVisitor : public ValueVisitor {
+ public:
+  using ValueVisitor::Visit;
+
+  explicit HotStringVisitor(StringPool* pool) : pool_(pool) {}
+
+  void Visit(RawString* value) override {
+    pool_->SetPriority(value->value, StringPool::Context::kHotPriority);
+  }
+
+  void Visit(String* value) override {
+    pool_->SetPriority(value->value, StringPool::Context::kHotPriority);
+  }
+
+  void Visit(StyledString* value) override {
+    pool_->SetPriority(value->value, StringPool::Context::kHotPriority);
+  }
+
+  void Visit(FileReference* value) override {
+    pool_->SetPriority(value->path, StringPool::Context::kHotPriority);
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(HotStringVisitor);
+
+  StringPool* pool_;
 };
 
 class MapFlattenVisitor : public RawValueVisitor {
@@ -218,12 +268,18 @@ class MapFlattenVisitor : public RawValueVisitor {
 class PackageFlattener {
  public:
   PackageFlattener(IAaptContext* context, ResourceTablePackage* package,
-                   const std::map<size_t, std::string>* shared_libs, bool use_sparse_entries)
+                   const std::map<size_t, std::string>* shared_libs,
+                   const TableFlattenerOptions& options, const ConfigOrder* config_order)
       : context_(context),
         diag_(context->GetDiagnostics()),
         package_(package),
         shared_libs_(shared_libs),
-        use_sparse_entries_(use_sparse_entries) {}
+        options_(options),
+        config_order_(config_order) {}
+
+  const SparseEncodingStats& sparse_encoding_stats() const {
+    return sparse_encoding_stats_;
+  }
 
   bool FlattenPackage(BigBuffer* buffer) {
     ChunkWriter pkg_writer(buffer);
@@ -246,7 +302,9 @@ class PackageFlattener {
     // Serialize the types. We do this now so that our type and key strings
     // are populated. We write those first.
     BigBuffer type_buffer(1024);
-    FlattenTypes(&type_buffer);
+    if (!FlattenTypes(&type_buffer)) {
+      return false;
+    }
 
     pkg_header->typeStrings = util::HostToDevice32(pkg_writer.size());
     StringPool::FlattenUtf16(pkg_writer.buffer(), type_pool_);
@@ -313,7 +371,7 @@ class PackageFlattener {
 
   bool FlattenConfig(const ResourceTableType* type, const ConfigDescription& config,
                      const size_t num_total_entries, std::vector<FlatEntry>* entries,
-                     BigBuffer* buffer) {
+                     IDiagnostics* diag, SparseEncodingStats* stats, BigBuffer* buffer) {
     CHECK(num_total_entries != 0);
     CHECK(num_total_entries <= std::numeric_limits<uint16_t>::max());
 
@@ -327,35 +385,50 @@ class PackageFlattener {
     std::vector<uint32_t> offsets;
     offsets.resize(num_total_entries, 0xffffffffu);
 
+    // Place the values of hot entries first, so that they share as few pages as possible. The
+    // offsets allow the values to be in any order.
+    std::stable_partition(entries->begin(), entries->end(),
+                          [](const FlatEntry& flat_entry) -> bool { return flat_entry.hot; });
+
     BigBuffer values_buffer(512);
     for (FlatEntry& flat_entry : *entries) {
       CHECK(static_cast<size_t>(flat_entry.entry->id.value()) < num_total_entries);
       offsets[flat_entry.entry->id.value()] = values_buffer.size();
       if (!FlattenValue(&flat_entry, &values_buffer)) {
-        diag_->Error(DiagMessage()
-                     << "failed to flatten resource '"
-                     << ResourceNameRef(package_->name, type->type, flat_entry.entry->name)
-                     << "' for configuration '" << config << "'");
+        diag->Error(DiagMessage()
+                    << "failed to flatten resource '"
+                    << ResourceNameRef(package_->name, type->type, flat_entry.entry->name)
+                    << "' for configuration '" << config << "'");
         return false;
       }
     }
 
-    bool sparse_encode = use_sparse_entries_;
-
     // Only sparse encode if the entries will be read on platforms O+.
-    sparse_encode =
-        sparse_encode && (context_->GetMinSdkVersion() >= SDK_O || config.sdkVersion >= SDK_O);
+    bool sparse_supported = context_->GetMinSdkVersion() >= SDK_O || config.sdkVersion >= SDK_O;
 
     // Only sparse encode if the offsets are representable in 2 bytes.
-    sparse_encode =
-        sparse_encode && (values_buffer.size() / 4u) <= std::numeric_limits<uint16_t>::max();
-
-    // Only sparse encode if the ratio of populated entries to total entries is below some
-    // threshold.
-    sparse_encode =
-        sparse_encode && ((100 * entries->size()) / num_total_entries) < kSparseEncodingThreshold;
+    sparse_supported =
+        sparse_supported && (values_buffer.size() / 4u) <= std::numeric_limits<uint16_t>::max();
+
+    const size_t dense_size = num_total_entries * sizeof(uint32_t);
+    const size_t sparse_size = entries->size() * sizeof(ResTable_sparseTypeEntry);
+
+    bool sparse_encode = false;
+    if (sparse_supported && options_.auto_sparse_entries) {
+      // Use whichever encoding of the offsets is smaller. Dense wins a tie, since its lookups
+      // are cheaper.
+      sparse_encode = sparse_size < dense_size;
+    } else if (sparse_supported && options_.use_sparse_entries) {
+      // Only sparse encode if the ratio of populated entries to total entries is below some
+      // threshold.
+      sparse_encode = ((100 * entries->size()) / num_total_entries) < kSparseEncodingThreshold;
+    }
 
+    stats->type_chunks++;
     if (sparse_encode) {
+      stats->sparse_type_chunks++;
+      stats->saved_bytes += dense_size - sparse_size;
+
       type_header->entryCount = util::HostToDevice32(entries->size());
       type_header->flags |= ResTable_type::FLAG_SPARSE;
       ResTable_sparseTypeEntry* indices =
@@ -460,11 +533,74 @@ class PackageFlattener {
     return true;
   }
 
+  // A type to flatten, with its entries sorted by ID, and the key string index of each entry and
+  // whether it is listed in the access profile.
+  struct TypeToFlatten {
+    ResourceTableType* type;
+    std::vector<ResourceEntry*> sorted_entries;
+    std::vector<uint32_t> entry_keys;
+    std::vector<bool> hot_entries;
+  };
+
+  bool FlattenType(TypeToFlatten* type_to_flatten, IDiagnostics* diag, SparseEncodingStats* stats,
+                   BigBuffer* buffer) {
+    ResourceTableType* type = type_to_flatten->type;
+    std::vector<ResourceEntry*>& sorted_entries = type_to_flatten->sorted_entries;
+    if (!FlattenTypeSpec(type, &sorted_entries, buffer)) {
+      return false;
+    }
+
+    // Since the entries are sorted by ID, the last ID will be the largest.
+    const size_t num_entries = sorted_entries.back()->id.value() + 1;
+
+    // The binary resource table lists resource entries for each
+    // configuration.
+    // We store them inverted, where a resource entry lists the values for
+    // each
+    // configuration available. Here we reverse this to match the binary
+    // table.
+    std::map<ConfigId, std::vector<FlatEntry>, ConfigIdLess> config_to_entry_list_map{
+        ConfigIdLess(config_order_)};
+    for (size_t i = 0; i < sorted_entries.size(); i++) {
+      ResourceEntry* entry = sorted_entries[i];
+
+      // Group values by configuration.
+      for (auto& config_value : entry->values) {
+        config_to_entry_list_map[config_value->config_id].push_back(
+            FlatEntry{entry, config_value->value.get(), type_to_flatten->entry_keys[i],
+                      type_to_flatten->hot_entries[i]});
+      }
+    }
+
+    // Flatten a configuration value. The configurations holding hot entries go first.
+    std::vector<std::pair<const ConfigDescription*, std::vector<FlatEntry>*>> configs;
+    for (auto& entry : config_to_entry_list_map) {
+      configs.push_back(
+          std::make_pair(&ConfigInterner::Get()->Lookup(entry.first), &entry.second));
+    }
+    auto is_hot = [](const FlatEntry& flat_entry) -> bool { return flat_entry.hot; };
+    std::stable_partition(
+        configs.begin(), configs.end(),
+        [&](const std::pair<const ConfigDescription*, std::vector<FlatEntry>*>& config) -> bool {
+          return std::any_of(config.second->begin(), config.second->end(), is_hot);
+        });
+
+    for (auto& config : configs) {
+      if (!FlattenConfig(type, *config.first, num_entries, config.second, diag, stats, buffer)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   bool FlattenTypes(BigBuffer* buffer) {
     // Sort the types by their IDs. They will be inserted into the StringPool in
     // this order.
     std::vector<ResourceTableType*> sorted_types = CollectAndSortTypes();
 
+    // Populate the type and key string pools up front, so that the types can then be flattened
+    // concurrently without touching either pool.
+    std::vector<TypeToFlatten> types_to_flatten;
     size_t expected_type_id = 1;
     for (ResourceTableType* type : sorted_types) {
       // If there is a gap in the type IDs, fill in the StringPool
@@ -483,40 +619,59 @@ class PackageFlattener {
         continue;
       }
 
-      if (!FlattenTypeSpec(type, &sorted_entries, buffer)) {
-        return false;
-      }
-
-      // Since the entries are sorted by ID, the last ID will be the largest.
-      const size_t num_entries = sorted_entries.back()->id.value() + 1;
-
-      // The binary resource table lists resource entries for each
-      // configuration.
-      // We store them inverted, where a resource entry lists the values for
-      // each
-      // configuration available. Here we reverse this to match the binary
-      // table.
-      std::map<ConfigDescription, std::vector<FlatEntry>> config_to_entry_list_map;
+      std::vector<uint32_t> entry_keys;
+      std::vector<bool> hot_entries;
+      entry_keys.reserve(sorted_entries.size());
+      hot_entries.reserve(sorted_entries.size());
       for (ResourceEntry* entry : sorted_entries) {
-        const uint32_t key_index = (uint32_t)key_pool_.MakeRef(entry->name).index();
-
-        // Group values by configuration.
-        for (auto& config_value : entry->values) {
-          config_to_entry_list_map[config_value->config].push_back(
-              FlatEntry{entry, config_value->value.get(), key_index});
-        }
+        entry_keys.push_back(static_cast<uint32_t>(key_pool_.MakeRef(entry->name).index()));
+        hot_entries.push_back(IsHot(type, entry));
       }
+      types_to_flatten.push_back(TypeToFlatten{type, std::move(sorted_entries),
+                                               std::move(entry_keys), std::move(hot_entries)});
+    }
 
-      // Flatten a configuration value.
-      for (auto& entry : config_to_entry_list_map) {
-        if (!FlattenConfig(type, entry.first, num_entries, &entry.second, buffer)) {
-          return false;
-        }
+    // Each type is flattened into its own buffer, and the buffers are then concatenated in
+    // type ID order.
+    const size_t type_count = types_to_flatten.size();
+    std::vector<BigBuffer> type_buffers;
+    type_buffers.reserve(type_count);
+    for (size_t i = 0; i < type_count; i++) {
+      type_buffers.emplace_back(1024);
+    }
+    std::vector<BufferedDiagnostics> type_diags(type_count);
+    std::vector<SparseEncodingStats> type_stats(type_count);
+    std::unique_ptr<bool[]> results(new bool[type_count]);
+
+    ThreadPool thread_pool(options_.max_threads);
+    thread_pool.ForEach(type_count, [&](size_t i) {
+      results[i] = FlattenType(&types_to_flatten[i], &type_diags[i], &type_stats[i],
+                               &type_buffers[i]);
+    });
+
+    for (size_t i = 0; i < type_count; i++) {
+      type_diags[i].ReplayTo(diag_);
+      if (!results[i]) {
+        return false;
       }
+      sparse_encoding_stats_.Merge(type_stats[i]);
+    }
+
+    for (BigBuffer& type_buffer : type_buffers) {
+      buffer->AppendBuffer(std::move(type_buffer));
     }
     return true;
   }
 
+  bool IsHot(const ResourceTableType* type, const ResourceEntry* entry) {
+    if (options_.access_profile.empty()) {
+      return false;
+    }
+    const ResourceId id(package_->id.value(), type->id.value(), entry->id.value());
+    return options_.access_profile.Contains(
+        ResourceNameRef(package_->name, type->type, entry->name), id);
+  }
+
   void FlattenLibrarySpec(BigBuffer* buffer) {
     ChunkWriter lib_writer(buffer);
     ResTable_lib_header* lib_header =
@@ -549,20 +704,51 @@ class PackageFlattener {
   IDiagnostics* diag_;
   ResourceTablePackage* package_;
   const std::map<size_t, std::string>* shared_libs_;
-  bool use_sparse_entries_;
+  const TableFlattenerOptions& options_;
+  const ConfigOrder* config_order_;
+  SparseEncodingStats sparse_encoding_stats_;
   StringPool type_pool_;
   StringPool key_pool_;
 };
 
 }  // namespace
 
+// Marks the strings of the resources in the access profile as hot.
+static void PromoteHotStrings(const ResourceAccessProfile& access_profile, ResourceTable* table) {
+  HotStringVisitor visitor(&table->string_pool);
+  for (auto& package : table->packages) {
+    for (auto& type : package->types) {
+      for (auto& entry : type->entries) {
+        Maybe<ResourceId> id;
+        if (package->id && type->id && entry->id) {
+          id = ResourceId(package->id.value(), type->id.value(), entry->id.value());
+        }
+
+        if (!access_profile.Contains(ResourceNameRef(package->name, type->type, entry->name),
+                                     id)) {
+          continue;
+        }
+
+        for (auto& config_value : entry->values) {
+          config_value->value->Accept(&visitor);
+        }
+      }
+    }
+  }
+}
+
 bool TableFlattener::Consume(IAaptContext* context, ResourceTable* table) {
+  if (!options_.access_profile.empty()) {
+    PromoteHotStrings(options_.access_profile, table);
+  }
+
   // We must do this before writing the resources, since the string pool IDs may change.
   table->string_pool.Prune();
-  table->string_pool.Sort([](const StringPool::Context& a, const StringPool::Context& b) -> int {
+  const ConfigOrder config_order;
+  table->string_pool.Sort([&](const StringPool::Context& a, const StringPool::Context& b) -> int {
     int diff = util::compare(a.priority, b.priority);
     if (diff == 0) {
-      diff = a.config.compare(b.config);
+      diff = config_order.Compare(a.config_id, b.config_id);
     }
     return diff;
   });
@@ -586,12 +772,22 @@ bool TableFlattener::Consume(IAaptContext* context, ResourceTable* table) {
   BigBuffer package_buffer(1024);
 
   // Flatten each package.
+  SparseEncodingStats sparse_encoding_stats;
   for (auto& package : table->packages) {
-    PackageFlattener flattener(context, package.get(), &table->included_packages_,
-                               options_.use_sparse_entries);
+    PackageFlattener flattener(context, package.get(), &table->included_packages_, options_,
+                               &config_order);
     if (!flattener.FlattenPackage(&package_buffer)) {
       return false;
     }
+    sparse_encoding_stats.Merge(flattener.sparse_encoding_stats());
+  }
+
+  if (context->IsVerbose() && (options_.use_sparse_entries || options_.auto_sparse_entries)) {
+    context->GetDiagnostics()->Note(DiagMessage()
+                                    << "sparse encoded " << sparse_encoding_stats.sparse_type_chunks
+                                    << " of " << sparse_encoding_stats.type_chunks
+                                    << " type chunks, saving " << sparse_encoding_stats.saved_bytes
+                                    << " bytes");
   }
 
   // Finally merge all the packages into the main buffer.
@@ -20,6 +20,7 @@
 #include "android-base/macros.h"
 
 #include "ResourceTable.h"
+#include "flatten/ResourceAccessProfile.h"
 #include "process/IResourceTableConsumer.h"
 #include "util/BigBuffer.h"
 
@@ -35,6 +36,20 @@ struct TableFlattenerOptions {
   // This is only available on platforms O+ and will only be respected when
   // minSdk is O+.
   bool use_sparse_entries = false;
+
+  // When true, each type chunk is encoded with whichever of the dense or sparse offset arrays is
+  // smaller, regardless of kSparseEncodingThreshold. Like use_sparse_entries, sparse encoding is
+  // only used where the chunk will be read on platforms O+.
+  bool auto_sparse_entries = false;
+
+  // The maximum number of threads used to flatten the types of a package. 0 uses the number of
+  // hardware threads.
+  size_t max_threads = 0u;
+
+  // The resources accessed during startup. Their strings are placed at the front of the value
+  // string pool, and their values are placed at the front of each type chunk, with the chunks
+  // that hold them ordered first within each type.
+  ResourceAccessProfile access_profile;
 };
 
 class TableFlattener : public IResourceTableConsumer {
@@ -26,6 +26,7 @@
 
 using namespace android;
 
+using ::testing::ElementsAre;
 using ::testing::IsNull;
 using ::testing::NotNull;
 
@@ -359,6 +360,118 @@ TEST_F(TableFlattenerTest, DoNotUseSparseEntryForDenseConfig) {
   EXPECT_EQ(no_sparse_contents.size(), sparse_contents.size());
 }
 
+TEST_F(TableFlattenerTest, AutoSparseEncodingUsesSparseEntryForDenseConfig) {
+  std::unique_ptr<IAaptContext> context = test::ContextBuilder()
+                                              .SetCompilationPackage("android")
+                                              .SetPackageId(0x01)
+                                              .SetMinSdkVersion(SDK_O)
+                                              .Build();
+
+  // Nine of every ten entries have an en-rGB value, which is too dense for the threshold used
+  // by use_sparse_entries.
+  const ConfigDescription sparse_config = test::ParseConfigOrDie("en-rGB");
+  test::ResourceTableBuilder builder;
+  builder.SetPackageId("android", 0x01);
+  for (int i = 0; i < 100; i++) {
+    const std::string name = base::StringPrintf("android:string/foo_%d", i);
+    const ResourceId resid(0x01, 0x02, static_cast<uint16_t>(i));
+    builder.AddValue(name, {}, resid,
+                     util::make_unique<BinaryPrimitive>(Res_value::TYPE_INT_DEC, i));
+    if (i % 10 != 9) {
+      builder.AddValue(name, sparse_config, resid,
+                       util::make_unique<BinaryPrimitive>(Res_value::TYPE_INT_DEC, i));
+    }
+  }
+  std::unique_ptr<ResourceTable> table_in = builder.Build();
+
+  TableFlattenerOptions threshold_options;
+  threshold_options.use_sparse_entries = true;
+
+  TableFlattenerOptions options;
+  options.auto_sparse_entries = true;
+
+  std::string no_sparse_contents;
+  ASSERT_TRUE(Flatten(context.get(), {}, table_in.get(), &no_sparse_contents));
+
+  std::string threshold_contents;
+  ASSERT_TRUE(Flatten(context.get(), threshold_options, table_in.get(), &threshold_contents));
+  EXPECT_EQ(no_sparse_contents, threshold_contents);
+
+  std::string sparse_contents;
+  ASSERT_TRUE(Flatten(context.get(), options, table_in.get(), &sparse_contents));
+
+  EXPECT_GT(no_sparse_contents.size(), sparse_contents.size());
+
+  ResourceTable sparse_table;
+  BinaryResourceParser parser(context.get(), &sparse_table, Source("test.arsc"),
+                              sparse_contents.data(), sparse_contents.size());
+  ASSERT_TRUE(parser.Parse());
+
+  auto value = test::GetValueForConfig<BinaryPrimitive>(&sparse_table, "android:string/foo_0",
+                                                        sparse_config);
+  ASSERT_THAT(value, NotNull());
+  EXPECT_EQ(0u, value->value.data);
+
+  EXPECT_THAT(test::GetValueForConfig<BinaryPrimitive>(&sparse_table, "android:string/foo_9",
+                                                       sparse_config),
+              IsNull());
+}
+
+TEST_F(TableFlattenerTest, AutoSparseEncodingRespectsMinSdk) {
+  std::unique_ptr<IAaptContext> context = test::ContextBuilder()
+                                              .SetCompilationPackage("android")
+                                              .SetPackageId(0x01)
+                                              .SetMinSdkVersion(SDK_LOLLIPOP)
+                                              .Build();
+
+  const ConfigDescription sparse_config = test::ParseConfigOrDie("en-rGB");
+  auto table_in = BuildTableWithSparseEntries(context.get(), sparse_config, 0.25f);
+
+  TableFlattenerOptions options;
+  options.auto_sparse_entries = true;
+
+  std::string no_sparse_contents;
+  ASSERT_TRUE(Flatten(context.get(), {}, table_in.get(), &no_sparse_contents));
+
+  std::string sparse_contents;
+  ASSERT_TRUE(Flatten(context.get(), options, table_in.get(), &sparse_contents));
+
+  EXPECT_EQ(no_sparse_contents, sparse_contents);
+}
+
+TEST_F(TableFlattenerTest, FlattenHotResourcesFirst) {
+  std::unique_ptr<ResourceTable> table =
+      test::ResourceTableBuilder()
+          .SetPackageId("com.app.test", 0x7f)
+          .AddString("com.app.test:string/a", ResourceId(0x7f020000), "aaa")
+          .AddString("com.app.test:string/b", ResourceId(0x7f020001), "bbb")
+          .AddString("com.app.test:string/c", ResourceId(0x7f020002), "ccc")
+          .AddString("com.app.test:string/c", ResourceId(0x7f020002),
+                     test::ParseConfigOrDie("fr"), "ccc fr")
+          .Build();
+
+  TableFlattenerOptions options;
+  ASSERT_TRUE(options.access_profile.Parse("string/c\n0x7f020001", Source("profile.txt"),
+                                           context_->GetDiagnostics()));
+
+  ResourceTable result;
+  ASSERT_TRUE(Flatten(context_.get(), options, table.get(), &result));
+
+  // The hot strings are sorted before the others.
+  EXPECT_EQ(0u, test::GetValue<String>(table.get(), "com.app.test:string/b")->value.index());
+  EXPECT_EQ(1u, test::GetValue<String>(table.get(), "com.app.test:string/c")->value.index());
+  EXPECT_EQ(3u, test::GetValue<String>(table.get(), "com.app.test:string/a")->value.index());
+
+  String* value = test::GetValue<String>(&result, "com.app.test:string/a");
+  ASSERT_THAT(value, NotNull());
+  EXPECT_EQ(std::string("aaa"), *value->value);
+
+  value = test::GetValueForConfig<String>(&result, "com.app.test:string/c",
+                                          test::ParseConfigOrDie("fr"));
+  ASSERT_THAT(value, NotNull());
+  EXPECT_EQ(std::string("ccc fr"), *value->value);
+}
+
 TEST_F(TableFlattenerTest, FlattenSharedLibrary) {
   std::unique_ptr<IAaptContext> context =
       test::ContextBuilder().SetCompilationPackage("lib").SetPackageId(0x00).Build();
@@ -467,4 +580,178 @@ TEST_F(TableFlattenerTest, LongSharedLibraryPackageNameIsIllegal) {
   ASSERT_FALSE(Flatten(context.get(), {}, table.get(), &result));
 }
 
+TEST_F(TableFlattenerTest, FlattenTypesConcurrently) {
+  test::ResourceTableBuilder builder;
+  builder.SetPackageId("com.app.test", 0x7f);
+  for (int i = 0; i < 50; i++) {
+    const std::string string_name = base::StringPrintf("com.app.test:string/string_%d", i);
+    builder.AddSimple(base::StringPrintf("com.app.test:id/id_%d", i), ResourceId(0x7f010000 | i))
+        .AddString(string_name, ResourceId(0x7f020000 | i), base::StringPrintf("default %d", i))
+        .AddString(string_name, ResourceId(0x7f020000 | i), test::ParseConfigOrDie("fr"),
+                   base::StringPrintf("french %d", i))
+        .AddSimple(base::StringPrintf("com.app.test:bool/bool_%d", i), ResourceId(0x7f040000 | i))
+        .AddSimple(base::StringPrintf("com.app.test:integer/integer_%d", i),
+                   ResourceId(0x7f050000 | i));
+  }
+  std::unique_ptr<ResourceTable> table = builder.Build();
+
+  TableFlattenerOptions serial_options;
+  serial_options.max_threads = 1u;
+  std::string serial_contents;
+  ASSERT_TRUE(Flatten(context_.get(), serial_options, table.get(), &serial_contents));
+
+  TableFlattenerOptions concurrent_options;
+  concurrent_options.max_threads = 4u;
+  std::string concurrent_contents;
+  ASSERT_TRUE(Flatten(context_.get(), concurrent_options, table.get(), &concurrent_contents));
+
+  // The types are concatenated in type ID order, whatever order they were flattened in.
+  EXPECT_EQ(serial_contents, concurrent_contents);
+
+  ResTable res_table;
+  ASSERT_TRUE(Flatten(context_.get(), concurrent_options, table.get(), &res_table));
+  EXPECT_TRUE(Exists(&res_table, "com.app.test:id/id_49", ResourceId(0x7f010031), {},
+                     Res_value::TYPE_INT_BOOLEAN, 0u, 0u));
+  EXPECT_TRUE(Exists(&res_table, "com.app.test:bool/bool_0", ResourceId(0x7f040000), {},
+                     Res_value::TYPE_INT_BOOLEAN, 0u, 0u));
+  EXPECT_TRUE(Exists(&res_table, "com.app.test:integer/integer_7", ResourceId(0x7f050007), {},
+                     Res_value::TYPE_INT_BOOLEAN, 0u, 0u));
+}
+
+TEST_F(TableFlattenerTest, ParseFilteredTypeChunksOneAtATime) {
+  std::unique_ptr<ResourceTable> table =
+      test::ResourceTableBuilder()
+          .SetPackageId("com.app.test", 0x7f)
+          .AddString("com.app.test:string/one", ResourceId(0x7f020000), "one")
+          .AddString("com.app.test:string/one", ResourceId(0x7f020000),
+                     test::ParseConfigOrDie("fr"), "un")
+          .AddString("com.app.test:string/two", ResourceId(0x7f020001),
+                     test::ParseConfigOrDie("fr"), "deux")
+          .AddSimple("com.app.test:integer/three", ResourceId(0x7f030000))
+          .AddSimple("com.app.test:integer/three", test::ParseConfigOrDie("fr"),
+                     ResourceId(0x7f030000))
+          .Build();
+
+  std::string contents;
+  ASSERT_TRUE(Flatten(context_.get(), {}, table.get(), &contents));
+
+  std::vector<std::string> chunks;
+  BinaryResourceParserOptions options;
+  options.type_filter = [](ResourceType type) -> bool { return type == ResourceType::kString; };
+  options.on_type_chunk = [&](const ResourceTablePackage& package, ResourceTableType* type,
+                              const ConfigDescription& config) -> bool {
+    for (const auto& entry : type->entries) {
+      for (const auto& value : entry->values) {
+        EXPECT_EQ(config, value->config);
+        String* str = ValueCast<String>(value->value.get());
+        chunks.push_back(config.toString().string() + ":" + entry->name + "=" +
+                         (str != nullptr ? *str->value : ""));
+      }
+    }
+    return true;
+  };
+
+  ResourceTable out_table;
+  BinaryResourceParser parser(context_.get(), &out_table, {}, contents.data(), contents.size(),
+                              nullptr, options);
+  ASSERT_TRUE(parser.Parse());
+
+  EXPECT_THAT(chunks, ElementsAre(":one=one", "fr:one=un", "fr:two=deux"));
+
+  // Nothing is kept once a type chunk has been handed out.
+  ResourceTablePackage* package = out_table.FindPackage("com.app.test");
+  ASSERT_THAT(package, NotNull());
+  EXPECT_TRUE(package->types.empty());
+
+  chunks.clear();
+  options.config_filter = [](const ConfigDescription& config) -> bool {
+    return config == ConfigDescription::DefaultConfig();
+  };
+  ResourceTable default_table;
+  BinaryResourceParser default_parser(context_.get(), &default_table, {}, contents.data(),
+                                      contents.size(), nullptr, options);
+  ASSERT_TRUE(default_parser.Parse());
+  EXPECT_THAT(chunks, ElementsAre(":one=one"));
+}
+
+TEST_F(TableFlattenerTest, ParsedValuesShareStrings) {
+  std::unique_ptr<ResourceTable> table =
+      test::ResourceTableBuilder()
+          .SetPackageId("com.app.test", 0x7f)
+          .AddString("com.app.test:string/one", ResourceId(0x7f020000), "shared")
+          .AddString("com.app.test:string/one", ResourceId(0x7f020000),
+                     test::ParseConfigOrDie("fr"), "shared")
+          .AddString("com.app.test:string/two", ResourceId(0x7f020001), "shared")
+          .AddFileReference("com.app.test:layout/main", ResourceId(0x7f030000),
+                            "res/layout/main.xml")
+          .Build();
+
+  ResourceTable out_table;
+  ASSERT_TRUE(Flatten(context_.get(), {}, table.get(), &out_table));
+
+  String* one = test::GetValue<String>(&out_table, "com.app.test:string/one");
+  String* one_fr =
+      test::GetValueForConfig<String>(&out_table, "com.app.test:string/one",
+                                      test::ParseConfigOrDie("fr"));
+  String* two = test::GetValue<String>(&out_table, "com.app.test:string/two");
+  ASSERT_THAT(one, NotNull());
+  ASSERT_THAT(one_fr, NotNull());
+  ASSERT_THAT(two, NotNull());
+  EXPECT_EQ("shared", *one->value);
+  EXPECT_EQ(&*one->value, &*one_fr->value);
+  EXPECT_EQ(&*one->value, &*two->value);
+
+  FileReference* main = test::GetValue<FileReference>(&out_table, "com.app.test:layout/main");
+  ASSERT_THAT(main, NotNull());
+  EXPECT_EQ("res/layout/main.xml", *main->path);
+  EXPECT_EQ(StringPool::Context::kHighPriority, main->path.GetContext().priority);
+}
+
+TEST_F(TableFlattenerTest, ParseTypeChunksConcurrently) {
+  test::ResourceTableBuilder builder;
+  builder.SetPackageId("com.app.test", 0x7f);
+  for (uint16_t i = 0; i < 20u; i++) {
+    const std::string name = "com.app.test:string/string_" + std::to_string(i);
+    builder.AddString(name, ResourceId(0x7f020000 | i), "value");
+    builder.AddString(name, ResourceId(0x7f020000 | i), test::ParseConfigOrDie("fr"),
+                      "valeur_" + std::to_string(i % 3));
+    builder.AddFileReference("com.app.test:layout/layout_" + std::to_string(i),
+                             ResourceId(0x7f030000 | i),
+                             "res/layout/layout_" + std::to_string(i) + ".xml");
+    builder.AddSimple("com.app.test:integer/integer_" + std::to_string(i),
+                      test::ParseConfigOrDie("land"), ResourceId(0x7f040000 | i));
+  }
+  std::unique_ptr<ResourceTable> table = builder.Build();
+
+  std::string contents;
+  ASSERT_TRUE(Flatten(context_.get(), {}, table.get(), &contents));
+
+  BinaryResourceParserOptions serial_options;
+  serial_options.max_threads = 1u;
+  ResourceTable serial_table;
+  BinaryResourceParser serial_parser(context_.get(), &serial_table, {}, contents.data(),
+                                     contents.size(), nullptr, serial_options);
+  ASSERT_TRUE(serial_parser.Parse());
+
+  BinaryResourceParserOptions concurrent_options;
+  concurrent_options.max_threads = 4u;
+  ResourceTable concurrent_table;
+  BinaryResourceParser concurrent_parser(context_.get(), &concurrent_table, {}, contents.data(),
+                                         contents.size(), nullptr, concurrent_options);
+  ASSERT_TRUE(concurrent_parser.Parse());
+
+  String* str = test::GetValueForConfig<String>(&concurrent_table, "com.app.test:string/string_7",
+                                                test::ParseConfigOrDie("fr"));
+  ASSERT_THAT(str, NotNull());
+  EXPECT_EQ("valeur_1", *str->value);
+
+  // The strings are interned in the same order as a serial parse, so both tables flatten to the
+  // same bytes.
+  std::string serial_contents;
+  ASSERT_TRUE(Flatten(context_.get(), {}, &serial_table, &serial_contents));
+  std::string concurrent_contents;
+  ASSERT_TRUE(Flatten(context_.get(), {}, &concurrent_table, &concurrent_contents));
+  EXPECT_EQ(serial_contents, concurrent_contents);
+}
+
 }  // namespace aapt
@@ -70,6 +70,13 @@ class AnnotationProcessor {
    */
   void WriteToStream(std::ostream* out, const android::StringPiece& prefix) const;
 
+  /**
+   * Returns true if the comments mark the member as @deprecated.
+   */
+  bool IsDeprecated() const {
+    return (annotation_bit_mask_ & kDeprecated) != 0;
+  }
+
  private:
   enum : uint32_t {
     kDeprecated = 0x01,
@@ -16,8 +16,13 @@
 
 #include "java/ClassDefinition.h"
 
+#include <algorithm>
+
 #include "androidfw/StringPiece.h"
 
+#include "flatten/Archive.h"
+#include "io/BigBufferInputStream.h"
+
 using android::StringPiece;
 
 namespace aapt {
@@ -39,6 +44,12 @@ void MethodDefinition::WriteToStream(const StringPiece& prefix, bool final,
   *out << prefix << "}";
 }
 
+bool MethodDefinition::WriteToClassFile(bool final, ClassFileBuilder* out, IArchiveWriter* writer,
+                                        std::string* out_error) const {
+  *out_error = "method '" + signature_ + "' can not be written to a class file";
+  return false;
+}
+
 ClassDefinition::Result ClassDefinition::AddMember(std::unique_ptr<ClassMember> member) {
   Result result = Result::kAdded;
   auto iter = indexed_members_.find(member->GetName());
@@ -68,13 +79,7 @@ void ClassDefinition::WriteToStream(const StringPiece& prefix, bool final,
     return;
   }
 
-  ClassMember::WriteToStream(prefix, final, out);
-
-  *out << prefix << "public ";
-  if (qualifier_ == ClassQualifier::kStatic) {
-    *out << "static ";
-  }
-  *out << "final class " << name_ << " {\n";
+  WriteOpeningToStream(prefix, out);
 
   std::string new_prefix = prefix.to_string();
   new_prefix.append(kIndent);
@@ -89,9 +94,63 @@ void ClassDefinition::WriteToStream(const StringPiece& prefix, bool final,
     }
   }
 
+  WriteClosingToStream(prefix, out);
+}
+
+void ClassDefinition::WriteOpeningToStream(const StringPiece& prefix, std::ostream* out) const {
+  ClassMember::WriteToStream(prefix, false, out);
+
+  *out << prefix << "public ";
+  if (qualifier_ == ClassQualifier::kStatic) {
+    *out << "static ";
+  }
+  *out << "final class " << name_ << " {\n";
+}
+
+void ClassDefinition::WriteClosingToStream(const StringPiece& prefix, std::ostream* out) const {
   *out << prefix << "}";
 }
 
+bool ClassDefinition::WriteToClassFile(bool final, ClassFileBuilder* out, IArchiveWriter* writer,
+                                       std::string* out_error) const {
+  if (empty() && !create_if_empty_) {
+    return true;
+  }
+
+  // Both the enclosing class and the nested class record the nesting.
+  const std::string class_name = out->name() + "$" + name_;
+  out->AddInnerClass(class_name, out->name(), name_);
+
+  ClassFileBuilder builder(class_name);
+  builder.AddInnerClass(class_name, out->name(), name_);
+  if (IsDeprecated()) {
+    builder.SetDeprecated();
+  }
+  return WriteMembersToClassFile(final, &builder, writer, out_error);
+}
+
+bool ClassDefinition::WriteMembersToClassFile(bool final, ClassFileBuilder* builder,
+                                              IArchiveWriter* writer,
+                                              std::string* out_error) const {
+  for (const std::unique_ptr<ClassMember>& member : ordered_members_) {
+    if (member != nullptr && !member->WriteToClassFile(final, builder, writer, out_error)) {
+      return false;
+    }
+  }
+
+  BigBuffer buffer(1024);
+  if (!builder->Build(&buffer, out_error)) {
+    return false;
+  }
+
+  io::BigBufferInputStream in(&buffer);
+  if (!writer->WriteFile(builder->name() + ".class", ArchiveEntry::kCompress, &in)) {
+    *out_error = writer->GetError();
+    return false;
+  }
+  return true;
+}
+
 constexpr static const char* sWarningHeader =
     "/* AUTO-GENERATED FILE. DO NOT MODIFY.\n"
     " *\n"
@@ -103,9 +162,30 @@ constexpr static const char* sWarningHeader =
 bool ClassDefinition::WriteJavaFile(const ClassDefinition* def,
                                     const StringPiece& package, bool final,
                                     std::ostream* out) {
-  *out << sWarningHeader << "package " << package << ";\n\n";
+  WriteJavaFileHeader(package, out);
   def->WriteToStream("", final, out);
   return bool(*out);
 }
 
+void ClassDefinition::WriteJavaFileHeader(const StringPiece& package, std::ostream* out) {
+  *out << sWarningHeader << "package " << package << ";\n\n";
+}
+
+bool ClassDefinition::WriteClassFiles(const ClassDefinition* def, const StringPiece& package,
+                                      bool final, IArchiveWriter* writer,
+                                      std::string* out_error) {
+  std::string class_name = package.to_string();
+  std::replace(class_name.begin(), class_name.end(), '.', '/');
+  if (!class_name.empty()) {
+    class_name += "/";
+  }
+  class_name += def->name_;
+
+  ClassFileBuilder builder(class_name);
+  if (def->IsDeprecated()) {
+    builder.SetDeprecated();
+  }
+  return def->WriteMembersToClassFile(final, &builder, writer, out_error);
+}
+
 }  // namespace aapt
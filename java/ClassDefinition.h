@@ -27,14 +27,26 @@
 
 #include "Resource.h"
 #include "java/AnnotationProcessor.h"
+#include "java/ClassFileBuilder.h"
 #include "util/Util.h"
 
 namespace aapt {
 
+class IArchiveWriter;
+
 // The number of attributes to emit per line in a Styleable array.
 constexpr static size_t kAttribsPerLine = 4;
 constexpr static const char* kIndent = "  ";
 
+// The value of an int field holding `value`.
+inline uint32_t ToJavaInt(uint32_t value) {
+  return value;
+}
+
+inline uint32_t ToJavaInt(const ResourceId& value) {
+  return value.id;
+}
+
 class ClassMember {
  public:
   virtual ~ClassMember() = default;
@@ -43,6 +55,10 @@ class ClassMember {
     return &processor_;
   }
 
+  bool IsDeprecated() const {
+    return processor_.IsDeprecated();
+  }
+
   virtual bool empty() const = 0;
 
   virtual const std::string& GetName() const = 0;
@@ -53,6 +69,12 @@ class ClassMember {
   virtual void WriteToStream(const android::StringPiece& prefix, bool final,
                              std::ostream* out) const;
 
+  // Adds the class member to `out`, the class file of the enclosing class. Nested classes are
+  // written to `writer` as class files of their own. Comments are not written. Returns false
+  // and sets `out_error` if the member can not be written.
+  virtual bool WriteToClassFile(bool final, ClassFileBuilder* out, IArchiveWriter* writer,
+                                std::string* out_error) const = 0;
+
  private:
   AnnotationProcessor processor_;
 };
@@ -78,6 +100,12 @@ class PrimitiveMember : public ClassMember {
          << ";";
   }
 
+  bool WriteToClassFile(bool final, ClassFileBuilder* out, IArchiveWriter* writer,
+                        std::string* out_error) const override {
+    out->AddIntField(name_, ToJavaInt(val_), final, IsDeprecated());
+    return true;
+  }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(PrimitiveMember);
 
@@ -108,6 +136,12 @@ class PrimitiveMember<std::string> : public ClassMember {
          << name_ << "=\"" << val_ << "\";";
   }
 
+  bool WriteToClassFile(bool final, ClassFileBuilder* out, IArchiveWriter* writer,
+                        std::string* out_error) const override {
+    out->AddStringField(name_, val_, final, IsDeprecated());
+    return true;
+  }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(PrimitiveMember);
 
@@ -157,6 +191,19 @@ class PrimitiveArrayMember : public ClassMember {
     *out << "\n" << prefix << kIndent << "};";
   }
 
+  bool WriteToClassFile(bool final, ClassFileBuilder* out, IArchiveWriter* writer,
+                        std::string* out_error) const override {
+    std::vector<uint32_t> values;
+    values.reserve(elements_.size());
+    for (const T& element : elements_) {
+      values.push_back(ToJavaInt(element));
+    }
+
+    // Arrays are always final, as in WriteToStream().
+    out->AddIntArrayField(name_, values, true, IsDeprecated());
+    return true;
+  }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(PrimitiveArrayMember);
 
@@ -190,6 +237,10 @@ class MethodDefinition : public ClassMember {
   void WriteToStream(const android::StringPiece& prefix, bool final,
                      std::ostream* out) const override;
 
+  // The statements of a method are Java source, so methods can not be written to class files.
+  bool WriteToClassFile(bool final, ClassFileBuilder* out, IArchiveWriter* writer,
+                        std::string* out_error) const override;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(MethodDefinition);
 
@@ -204,6 +255,14 @@ class ClassDefinition : public ClassMember {
   static bool WriteJavaFile(const ClassDefinition* def, const android::StringPiece& package,
                             bool final, std::ostream* out);
 
+  // Writes the header comment and package declaration of a Java file.
+  static void WriteJavaFileHeader(const android::StringPiece& package, std::ostream* out);
+
+  // Writes `def` and its nested classes to `writer` as compiled class files, under the
+  // directory of `package`. Returns false and sets `out_error` on failure.
+  static bool WriteClassFiles(const ClassDefinition* def, const android::StringPiece& package,
+                              bool final, IArchiveWriter* writer, std::string* out_error);
+
   ClassDefinition(const android::StringPiece& name, ClassQualifier qualifier, bool createIfEmpty)
       : name_(name.to_string()), qualifier_(qualifier), create_if_empty_(createIfEmpty) {}
 
@@ -223,9 +282,22 @@ class ClassDefinition : public ClassMember {
   void WriteToStream(const android::StringPiece& prefix, bool final,
                      std::ostream* out) const override;
 
+  // Writes the comments and declaration of the class, up to its opening brace. Together with
+  // WriteClosingToStream(), this lets members be written between the two one at a time, instead
+  // of being added to the class and held until it is complete.
+  void WriteOpeningToStream(const android::StringPiece& prefix, std::ostream* out) const;
+  void WriteClosingToStream(const android::StringPiece& prefix, std::ostream* out) const;
+
+  bool WriteToClassFile(bool final, ClassFileBuilder* out, IArchiveWriter* writer,
+                        std::string* out_error) const override;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(ClassDefinition);
 
+  // Adds the members of this class to `builder`, and writes the finished class file to `writer`.
+  bool WriteMembersToClassFile(bool final, ClassFileBuilder* builder, IArchiveWriter* writer,
+                               std::string* out_error) const;
+
   std::string name_;
   ClassQualifier qualifier_;
   bool create_if_empty_;
@@ -0,0 +1,440 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "java/ClassFileBuilder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "android-base/stringprintf.h"
+
+#include "util/Util.h"
+
+using ::android::StringPiece;
+using ::android::base::StringPrintf;
+
+namespace aapt {
+
+namespace {
+
+// Java 6 class files don't need StackMapTable attributes.
+constexpr uint16_t kMajorVersion = 50u;
+
+constexpr uint16_t kAccPublic = 0x0001u;
+constexpr uint16_t kAccStatic = 0x0008u;
+constexpr uint16_t kAccFinal = 0x0010u;
+constexpr uint16_t kAccSuper = 0x0020u;
+
+constexpr uint8_t kConstantUtf8 = 1u;
+constexpr uint8_t kConstantInteger = 3u;
+constexpr uint8_t kConstantClass = 7u;
+constexpr uint8_t kConstantString = 8u;
+constexpr uint8_t kConstantFieldRef = 9u;
+constexpr uint8_t kConstantMethodRef = 10u;
+constexpr uint8_t kConstantNameAndType = 12u;
+
+constexpr uint8_t kOpIconst0 = 0x03u;
+constexpr uint8_t kOpAload0 = 0x2au;
+constexpr uint8_t kOpBipush = 0x10u;
+constexpr uint8_t kOpSipush = 0x11u;
+constexpr uint8_t kOpLdc = 0x12u;
+constexpr uint8_t kOpLdcW = 0x13u;
+constexpr uint8_t kOpIastore = 0x4fu;
+constexpr uint8_t kOpDup = 0x59u;
+constexpr uint8_t kOpReturn = 0xb1u;
+constexpr uint8_t kOpPutstatic = 0xb3u;
+constexpr uint8_t kOpInvokespecial = 0xb7u;
+constexpr uint8_t kOpNewarray = 0xbcu;
+
+constexpr uint8_t kArrayTypeInt = 10u;
+
+constexpr size_t kMaxCodeSize = std::numeric_limits<uint16_t>::max();
+constexpr size_t kMaxConstantCount = std::numeric_limits<uint16_t>::max();
+constexpr size_t kMaxUtf8Size = std::numeric_limits<uint16_t>::max();
+
+// Class files are big endian.
+void WriteU1(uint8_t value, std::string* out) {
+  out->push_back(static_cast<char>(value));
+}
+
+void WriteU2(uint16_t value, std::string* out) {
+  WriteU1(static_cast<uint8_t>(value >> 8), out);
+  WriteU1(static_cast<uint8_t>(value), out);
+}
+
+void WriteU4(uint32_t value, std::string* out) {
+  WriteU2(static_cast<uint16_t>(value >> 16), out);
+  WriteU2(static_cast<uint16_t>(value), out);
+}
+
+// Class files encode strings in the modified UTF-8 of the JVM: NUL is encoded in two bytes, and
+// supplementary characters are encoded as surrogate pairs of three bytes each.
+std::string ToModifiedUtf8(const StringPiece& str) {
+  std::string result;
+  for (char16_t c : util::Utf8ToUtf16(str)) {
+    if (c != 0u && c < 0x80u) {
+      WriteU1(static_cast<uint8_t>(c), &result);
+    } else if (c < 0x800u) {
+      WriteU1(static_cast<uint8_t>(0xc0u | (c >> 6)), &result);
+      WriteU1(static_cast<uint8_t>(0x80u | (c & 0x3fu)), &result);
+    } else {
+      WriteU1(static_cast<uint8_t>(0xe0u | (c >> 12)), &result);
+      WriteU1(static_cast<uint8_t>(0x80u | ((c >> 6) & 0x3fu)), &result);
+      WriteU1(static_cast<uint8_t>(0x80u | (c & 0x3fu)), &result);
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+ClassFileBuilder::ClassFileBuilder(const StringPiece& name) : name_(name.to_string()) {
+  this_class_index_ = AddClass(name);
+  super_class_index_ = AddClass("java/lang/Object");
+}
+
+uint16_t ClassFileBuilder::AddConstant(const std::string& constant) {
+  auto iter = constant_indices_.find(constant);
+  if (iter != constant_indices_.end()) {
+    return iter->second;
+  }
+
+  // Indices past the limit are truncated here, and the class is rejected in Build().
+  const uint16_t index = static_cast<uint16_t>(constant_count_++);
+  constant_pool_ += constant;
+  constant_indices_.insert(std::make_pair(constant, index));
+  return index;
+}
+
+uint16_t ClassFileBuilder::AddUtf8(const StringPiece& str) {
+  std::string encoded = ToModifiedUtf8(str);
+  if (encoded.size() > kMaxUtf8Size) {
+    // The class is rejected in Build().
+    string_too_long_ = true;
+    encoded.resize(kMaxUtf8Size);
+  }
+
+  std::string constant;
+  WriteU1(kConstantUtf8, &constant);
+  WriteU2(static_cast<uint16_t>(encoded.size()), &constant);
+  constant += encoded;
+  return AddConstant(constant);
+}
+
+uint16_t ClassFileBuilder::AddInteger(uint32_t value) {
+  std::string constant;
+  WriteU1(kConstantInteger, &constant);
+  WriteU4(value, &constant);
+  return AddConstant(constant);
+}
+
+uint16_t ClassFileBuilder::AddClass(const StringPiece& name) {
+  std::string constant;
+  WriteU1(kConstantClass, &constant);
+  WriteU2(AddUtf8(name), &constant);
+  return AddConstant(constant);
+}
+
+uint16_t ClassFileBuilder::AddString(const StringPiece& str) {
+  std::string constant;
+  WriteU1(kConstantString, &constant);
+  WriteU2(AddUtf8(str), &constant);
+  return AddConstant(constant);
+}
+
+uint16_t ClassFileBuilder::AddNameAndType(const StringPiece& name, const StringPiece& descriptor) {
+  std::string constant;
+  WriteU1(kConstantNameAndType, &constant);
+  WriteU2(AddUtf8(name), &constant);
+  WriteU2(AddUtf8(descriptor), &constant);
+  return AddConstant(constant);
+}
+
+uint16_t ClassFileBuilder::AddFieldRef(const StringPiece& name, const StringPiece& descriptor) {
+  std::string constant;
+  WriteU1(kConstantFieldRef, &constant);
+  WriteU2(this_class_index_, &constant);
+  WriteU2(AddNameAndType(name, descriptor), &constant);
+  return AddConstant(constant);
+}
+
+uint16_t ClassFileBuilder::AddMethodRef(uint16_t class_index, const StringPiece& name,
+                                        const StringPiece& descriptor) {
+  std::string constant;
+  WriteU1(kConstantMethodRef, &constant);
+  WriteU2(class_index, &constant);
+  WriteU2(AddNameAndType(name, descriptor), &constant);
+  return AddConstant(constant);
+}
+
+// Only the fields set by the static initializer get a Fieldref constant, since the others are
+// never referenced from within the class. This keeps the constant pool as small as javac's.
+void ClassFileBuilder::AddField(const StringPiece& name, const StringPiece& descriptor,
+                                bool final, bool deprecated) {
+  Field field;
+  field.access_flags = kAccPublic | kAccStatic | (final ? kAccFinal : 0u);
+  field.name_index = AddUtf8(name);
+  field.descriptor_index = AddUtf8(descriptor);
+  field.constant_value_index = 0u;
+  field.deprecated = deprecated;
+  fields_.push_back(field);
+  has_deprecated_member_ |= deprecated;
+}
+
+void ClassFileBuilder::PushInt(uint32_t value) {
+  const int32_t signed_value = static_cast<int32_t>(value);
+  if (signed_value >= -1 && signed_value <= 5) {
+    WriteU1(static_cast<uint8_t>(kOpIconst0 + signed_value), &clinit_code_);
+  } else if (signed_value >= std::numeric_limits<int8_t>::min() &&
+             signed_value <= std::numeric_limits<int8_t>::max()) {
+    WriteU1(kOpBipush, &clinit_code_);
+    WriteU1(static_cast<uint8_t>(signed_value), &clinit_code_);
+  } else if (signed_value >= std::numeric_limits<int16_t>::min() &&
+             signed_value <= std::numeric_limits<int16_t>::max()) {
+    WriteU1(kOpSipush, &clinit_code_);
+    WriteU2(static_cast<uint16_t>(signed_value), &clinit_code_);
+  } else {
+    const uint16_t index = AddInteger(value);
+    if (index <= std::numeric_limits<uint8_t>::max()) {
+      WriteU1(kOpLdc, &clinit_code_);
+      WriteU1(static_cast<uint8_t>(index), &clinit_code_);
+    } else {
+      WriteU1(kOpLdcW, &clinit_code_);
+      WriteU2(index, &clinit_code_);
+    }
+  }
+}
+
+void ClassFileBuilder::PutStatic(uint16_t field_ref_index) {
+  WriteU1(kOpPutstatic, &clinit_code_);
+  WriteU2(field_ref_index, &clinit_code_);
+}
+
+void ClassFileBuilder::AddIntField(const StringPiece& name, uint32_t value, bool final,
+                                   bool deprecated) {
+  AddField(name, "I", final, deprecated);
+  if (final) {
+    fields_.back().constant_value_index = AddInteger(value);
+    return;
+  }
+
+  // javac only treats final fields as constants, so the other fields are set in <clinit>.
+  PushInt(value);
+  PutStatic(AddFieldRef(name, "I"));
+  clinit_max_stack_ = std::max<uint16_t>(clinit_max_stack_, 1u);
+}
+
+void ClassFileBuilder::AddStringField(const StringPiece& name, const StringPiece& value,
+                                      bool final, bool deprecated) {
+  AddField(name, "Ljava/lang/String;", final, deprecated);
+  const uint16_t string_index = AddString(value);
+  if (final) {
+    fields_.back().constant_value_index = string_index;
+    return;
+  }
+
+  if (string_index <= std::numeric_limits<uint8_t>::max()) {
+    WriteU1(kOpLdc, &clinit_code_);
+    WriteU1(static_cast<uint8_t>(string_index), &clinit_code_);
+  } else {
+    WriteU1(kOpLdcW, &clinit_code_);
+    WriteU2(string_index, &clinit_code_);
+  }
+  PutStatic(AddFieldRef(name, "Ljava/lang/String;"));
+  clinit_max_stack_ = std::max<uint16_t>(clinit_max_stack_, 1u);
+}
+
+void ClassFileBuilder::AddIntArrayField(const StringPiece& name,
+                                        const std::vector<uint32_t>& values, bool final,
+                                        bool deprecated) {
+  AddField(name, "[I", final, deprecated);
+
+  // new int[size], then for each element: dup, index, value, iastore.
+  PushInt(static_cast<uint32_t>(values.size()));
+  WriteU1(kOpNewarray, &clinit_code_);
+  WriteU1(kArrayTypeInt, &clinit_code_);
+  for (size_t i = 0; i < values.size(); i++) {
+    WriteU1(kOpDup, &clinit_code_);
+    PushInt(static_cast<uint32_t>(i));
+    PushInt(values[i]);
+    WriteU1(kOpIastore, &clinit_code_);
+  }
+  PutStatic(AddFieldRef(name, "[I"));
+  clinit_max_stack_ = std::max<uint16_t>(clinit_max_stack_, 4u);
+}
+
+void ClassFileBuilder::AddInnerClass(const StringPiece& inner_name, const StringPiece& outer_name,
+                                     const StringPiece& simple_name) {
+  inner_classes_.push_back(
+      InnerClass{AddClass(inner_name), AddClass(outer_name), AddUtf8(simple_name)});
+}
+
+void ClassFileBuilder::WriteDeprecatedAttributes(std::string* out) const {
+  WriteU2(deprecated_name_index_, out);
+  WriteU4(0u, out);
+
+  // One annotation without elements.
+  WriteU2(annotations_name_index_, out);
+  WriteU4(2u + 2u + 2u, out);
+  WriteU2(1u, out);
+  WriteU2(deprecated_type_index_, out);
+  WriteU2(0u, out);
+}
+
+bool ClassFileBuilder::Build(BigBuffer* out, std::string* out_error) {
+  // Add the names of the attributes and methods before the constant pool is written.
+  const uint16_t init_name_index = AddUtf8("<init>");
+  const uint16_t void_descriptor_index = AddUtf8("()V");
+  const uint16_t object_init_index = AddMethodRef(super_class_index_, "<init>", "()V");
+  const uint16_t code_name_index = AddUtf8("Code");
+
+  if (deprecated_ || has_deprecated_member_) {
+    deprecated_name_index_ = AddUtf8("Deprecated");
+    annotations_name_index_ = AddUtf8("RuntimeVisibleAnnotations");
+    deprecated_type_index_ = AddUtf8("Ljava/lang/Deprecated;");
+  }
+
+  uint16_t constant_value_name_index = 0u;
+  if (std::any_of(fields_.begin(), fields_.end(),
+                  [](const Field& field) { return field.constant_value_index != 0u; })) {
+    constant_value_name_index = AddUtf8("ConstantValue");
+  }
+
+  uint16_t clinit_name_index = 0u;
+  if (!clinit_code_.empty()) {
+    clinit_name_index = AddUtf8("<clinit>");
+  }
+
+  uint16_t inner_classes_name_index = 0u;
+  if (!inner_classes_.empty()) {
+    inner_classes_name_index = AddUtf8("InnerClasses");
+  }
+
+  if (string_too_long_) {
+    *out_error = StringPrintf("string constant in class %s is too long", name_.data());
+    return false;
+  }
+
+  if (constant_count_ > kMaxConstantCount) {
+    *out_error = StringPrintf("too many constants in class %s", name_.data());
+    return false;
+  }
+
+  // The code ends with a return instruction.
+  if (clinit_code_.size() + 1u > kMaxCodeSize) {
+    *out_error = StringPrintf("static initializer of class %s is too large", name_.data());
+    return false;
+  }
+
+  if (fields_.size() > std::numeric_limits<uint16_t>::max() ||
+      inner_classes_.size() > std::numeric_limits<uint16_t>::max()) {
+    *out_error = StringPrintf("too many members in class %s", name_.data());
+    return false;
+  }
+
+  std::string data;
+  WriteU4(0xcafebabeu, &data);
+  WriteU2(0u, &data);
+  WriteU2(kMajorVersion, &data);
+  WriteU2(static_cast<uint16_t>(constant_count_), &data);
+  data += constant_pool_;
+
+  WriteU2(kAccPublic | kAccFinal | kAccSuper, &data);
+  WriteU2(this_class_index_, &data);
+  WriteU2(super_class_index_, &data);
+
+  // Interfaces.
+  WriteU2(0u, &data);
+
+  WriteU2(static_cast<uint16_t>(fields_.size()), &data);
+  for (const Field& field : fields_) {
+    WriteU2(field.access_flags, &data);
+    WriteU2(field.name_index, &data);
+    WriteU2(field.descriptor_index, &data);
+    WriteU2(static_cast<uint16_t>((field.constant_value_index != 0u ? 1u : 0u) +
+                                  (field.deprecated ? 2u : 0u)),
+            &data);
+    if (field.constant_value_index != 0u) {
+      WriteU2(constant_value_name_index, &data);
+      WriteU4(2u, &data);
+      WriteU2(field.constant_value_index, &data);
+    }
+    if (field.deprecated) {
+      WriteDeprecatedAttributes(&data);
+    }
+  }
+
+  WriteU2(clinit_code_.empty() ? 1u : 2u, &data);
+
+  // public <init>() { super(); }
+  WriteU2(kAccPublic, &data);
+  WriteU2(init_name_index, &data);
+  WriteU2(void_descriptor_index, &data);
+  WriteU2(1u, &data);
+  WriteU2(code_name_index, &data);
+  WriteU4(2u + 2u + 4u + 5u + 2u + 2u, &data);
+  WriteU2(1u, &data);
+  WriteU2(1u, &data);
+  WriteU4(5u, &data);
+  WriteU1(kOpAload0, &data);
+  WriteU1(kOpInvokespecial, &data);
+  WriteU2(object_init_index, &data);
+  WriteU1(kOpReturn, &data);
+  WriteU2(0u, &data);
+  WriteU2(0u, &data);
+
+  if (!clinit_code_.empty()) {
+    WriteU2(kAccStatic, &data);
+    WriteU2(clinit_name_index, &data);
+    WriteU2(void_descriptor_index, &data);
+
+    // One Code attribute, without exception handlers or attributes of its own.
+    const uint32_t code_size = static_cast<uint32_t>(clinit_code_.size() + 1u);
+    WriteU2(1u, &data);
+    WriteU2(code_name_index, &data);
+    WriteU4(2u + 2u + 4u + code_size + 2u + 2u, &data);
+    WriteU2(clinit_max_stack_, &data);
+    WriteU2(0u, &data);
+    WriteU4(code_size, &data);
+    data += clinit_code_;
+    WriteU1(kOpReturn, &data);
+    WriteU2(0u, &data);
+    WriteU2(0u, &data);
+  }
+
+  WriteU2(static_cast<uint16_t>((inner_classes_.empty() ? 0u : 1u) + (deprecated_ ? 2u : 0u)),
+          &data);
+  if (!inner_classes_.empty()) {
+    WriteU2(inner_classes_name_index, &data);
+    WriteU4(static_cast<uint32_t>(2u + inner_classes_.size() * 8u), &data);
+    WriteU2(static_cast<uint16_t>(inner_classes_.size()), &data);
+    for (const InnerClass& inner_class : inner_classes_) {
+      WriteU2(inner_class.inner_class_index, &data);
+      WriteU2(inner_class.outer_class_index, &data);
+      WriteU2(inner_class.name_index, &data);
+      WriteU2(kAccPublic | kAccStatic | kAccFinal, &data);
+    }
+  }
+  if (deprecated_) {
+    WriteDeprecatedAttributes(&data);
+  }
+
+  memcpy(out->NextBlock<char>(data.size()), data.data(), data.size());
+  return true;
+}
+
+}  // namespace aapt
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AAPT_JAVA_CLASSFILEBUILDER_H
+#define AAPT_JAVA_CLASSFILEBUILDER_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "android-base/macros.h"
+#include "androidfw/StringPiece.h"
+
+#include "util/BigBuffer.h"
+
+namespace aapt {
+
+// Builds a compiled Java class file, so that R classes can be used without compiling R.java.
+// Only what R classes need is supported: public static int, String and int[] fields, and
+// public static final nested classes.
+//
+// Final int and String fields are initialized with a ConstantValue attribute, so that they are
+// inlined by javac like the fields of a compiled R.java. The other fields are initialized by a
+// static initializer. Like javac, the builder gives the class a public no-argument constructor,
+// and marks deprecated members with both the Deprecated attribute and the @Deprecated annotation.
+class ClassFileBuilder {
+ public:
+  // `name` is the binary name of the class in internal form, such as "com/example/R$string".
+  explicit ClassFileBuilder(const android::StringPiece& name);
+
+  const std::string& name() const {
+    return name_;
+  }
+
+  void AddIntField(const android::StringPiece& name, uint32_t value, bool final,
+                   bool deprecated = false);
+
+  void AddStringField(const android::StringPiece& name, const android::StringPiece& value,
+                      bool final, bool deprecated = false);
+
+  void AddIntArrayField(const android::StringPiece& name, const std::vector<uint32_t>& values,
+                        bool final, bool deprecated = false);
+
+  // Marks the class itself as deprecated.
+  void SetDeprecated() {
+    deprecated_ = true;
+  }
+
+  // Records that `inner_name` is a public static final class nested in `outer_name`, with the
+  // simple name `simple_name`. Both the outer class and the nested class must record this.
+  void AddInnerClass(const android::StringPiece& inner_name,
+                     const android::StringPiece& outer_name,
+                     const android::StringPiece& simple_name);
+
+  // Writes the class file to `out`. Returns false and sets `out_error` if the class exceeds one
+  // of the limits of the class file format, such as the 64KiB limit on the size of the static
+  // initializer.
+  bool Build(BigBuffer* out, std::string* out_error);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ClassFileBuilder);
+
+  struct Field {
+    uint16_t access_flags;
+    uint16_t name_index;
+    uint16_t descriptor_index;
+
+    // The index of the ConstantValue of the field, or 0 if it has none.
+    uint16_t constant_value_index;
+
+    bool deprecated;
+  };
+
+  struct InnerClass {
+    uint16_t inner_class_index;
+    uint16_t outer_class_index;
+    uint16_t name_index;
+  };
+
+  uint16_t AddConstant(const std::string& constant);
+  uint16_t AddUtf8(const android::StringPiece& str);
+  uint16_t AddInteger(uint32_t value);
+  uint16_t AddClass(const android::StringPiece& name);
+  uint16_t AddString(const android::StringPiece& str);
+  uint16_t AddNameAndType(const android::StringPiece& name,
+                          const android::StringPiece& descriptor);
+  uint16_t AddFieldRef(const android::StringPiece& name, const android::StringPiece& descriptor);
+  uint16_t AddMethodRef(uint16_t class_index, const android::StringPiece& name,
+                        const android::StringPiece& descriptor);
+
+  void AddField(const android::StringPiece& name, const android::StringPiece& descriptor,
+                bool final, bool deprecated);
+
+  // Writes the Deprecated attribute and the @Deprecated annotation, which follow the count of
+  // attributes of a class, field or method.
+  void WriteDeprecatedAttributes(std::string* out) const;
+
+  // Appends the instructions that push `value` onto the operand stack to the static initializer.
+  void PushInt(uint32_t value);
+  void PutStatic(uint16_t field_ref_index);
+
+  std::string name_;
+  uint16_t this_class_index_;
+  uint16_t super_class_index_;
+
+  // The constant pool entries, and the index of each entry keyed by its encoding.
+  std::string constant_pool_;
+  std::map<std::string, uint16_t> constant_indices_;
+  size_t constant_count_ = 1u;
+  bool string_too_long_ = false;
+
+  std::vector<Field> fields_;
+  std::vector<InnerClass> inner_classes_;
+  bool deprecated_ = false;
+  bool has_deprecated_member_ = false;
+
+  // Constant pool indices of the attribute names, added by Build().
+  uint16_t deprecated_name_index_ = 0u;
+  uint16_t annotations_name_index_ = 0u;
+  uint16_t deprecated_type_index_ = 0u;
+
+  // The code of the static initializer, without the final return instruction.
+  std::string clinit_code_;
+  uint16_t clinit_max_stack_ = 0u;
+};
+
+}  // namespace aapt
+
+#endif /* AAPT_JAVA_CLASSFILEBUILDER_H */
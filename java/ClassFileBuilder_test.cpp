@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "java/ClassFileBuilder.h"
+
+#include "test/Test.h"
+
+using ::testing::HasSubstr;
+using ::testing::Not;
+
+namespace aapt {
+
+static std::string Build(ClassFileBuilder* builder) {
+  BigBuffer buffer(1024);
+  std::string error;
+  CHECK(builder->Build(&buffer, &error)) << error;
+  return buffer.to_string();
+}
+
+TEST(ClassFileBuilderTest, WriteHeader) {
+  ClassFileBuilder builder("com/foo/R");
+  const std::string class_file = Build(&builder);
+
+  // Magic number, minor version 0 and major version 50.
+  EXPECT_EQ(std::string("\xca\xfe\xba\xbe\x00\x00\x00\x32", 8), class_file.substr(0, 8));
+  EXPECT_THAT(class_file, HasSubstr("com/foo/R"));
+  EXPECT_THAT(class_file, HasSubstr("java/lang/Object"));
+  EXPECT_THAT(class_file, HasSubstr("<init>"));
+  EXPECT_THAT(class_file, Not(HasSubstr("<clinit>")));
+}
+
+TEST(ClassFileBuilderTest, FinalFieldsAreConstants) {
+  ClassFileBuilder builder("com/foo/R$string");
+  builder.AddIntField("foo", 0x7f010000u, true);
+  builder.AddStringField("bar", "baz", true);
+  const std::string class_file = Build(&builder);
+
+  EXPECT_THAT(class_file, HasSubstr("ConstantValue"));
+  EXPECT_THAT(class_file, HasSubstr(std::string("\x03\x7f\x01\x00\x00", 5)));
+  EXPECT_THAT(class_file, Not(HasSubstr("<clinit>")));
+}
+
+TEST(ClassFileBuilderTest, NonFinalFieldsAreSetInStaticInitializer) {
+  ClassFileBuilder builder("com/foo/R$string");
+  builder.AddIntField("foo", 0x7f010000u, false);
+  const std::string class_file = Build(&builder);
+
+  EXPECT_THAT(class_file, Not(HasSubstr("ConstantValue")));
+  EXPECT_THAT(class_file, HasSubstr("<clinit>"));
+}
+
+TEST(ClassFileBuilderTest, ManyFinalFieldsFitInConstantPool) {
+  // Final fields need a name and a value constant each, but no Fieldref or NameAndType.
+  ClassFileBuilder builder("com/foo/R$id");
+  for (uint32_t i = 0; i < 30000u; i++) {
+    builder.AddIntField("id_" + std::to_string(i), 0x7f010000u + i, true);
+  }
+
+  BigBuffer buffer(1024);
+  std::string error;
+  EXPECT_TRUE(builder.Build(&buffer, &error)) << error;
+}
+
+TEST(ClassFileBuilderTest, WriteDeprecatedAttributes) {
+  ClassFileBuilder builder("com/foo/R$string");
+  builder.AddIntField("foo", 0x7f010000u, true);
+  const std::string plain_class_file = Build(&builder);
+  EXPECT_THAT(plain_class_file, Not(HasSubstr("Deprecated")));
+
+  ClassFileBuilder deprecated_builder("com/foo/R$string");
+  deprecated_builder.AddIntField("foo", 0x7f010000u, true, true /*deprecated*/);
+  const std::string class_file = Build(&deprecated_builder);
+  EXPECT_THAT(class_file, HasSubstr("RuntimeVisibleAnnotations"));
+  EXPECT_THAT(class_file, HasSubstr("Ljava/lang/Deprecated;"));
+}
+
+TEST(ClassFileBuilderTest, FailWhenStaticInitializerIsTooLarge) {
+  // Each element takes several bytes of code, so this exceeds the 64KiB limit.
+  std::vector<uint32_t> values(20000u, 0x7f010000u);
+
+  ClassFileBuilder builder("com/foo/R$styleable");
+  builder.AddIntArrayField("foo", values, true);
+
+  BigBuffer buffer(1024);
+  std::string error;
+  EXPECT_FALSE(builder.Build(&buffer, &error));
+  EXPECT_THAT(error, HasSubstr("too large"));
+}
+
+}  // namespace aapt
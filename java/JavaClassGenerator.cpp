@@ -17,6 +17,7 @@
 #include "java/JavaClassGenerator.h"
 
 #include <algorithm>
+#include <map>
 #include <ostream>
 #include <set>
 #include <sstream>
@@ -555,23 +556,26 @@ static void AppendJavaDocAnnotations(const std::vector<std::string>& annotations
   }
 }
 
-bool JavaClassGenerator::Generate(const StringPiece& package_name_to_generate,
-                                  const StringPiece& out_package_name, std::ostream* out,
-                                  std::ostream* out_r_txt) {
-  ClassDefinition r_class("R", ClassQualifier::kNone, true);
-  std::unique_ptr<MethodDefinition> rewrite_method;
+std::unique_ptr<MethodDefinition> JavaClassGenerator::MakeRewriteMethod() {
+  if (!options_.rewrite_callback_options) {
+    return {};
+  }
 
   // Generate an onResourcesLoaded() callback if requested.
-  if (options_.rewrite_callback_options) {
-    rewrite_method =
-        util::make_unique<MethodDefinition>("public static void onResourcesLoaded(int p)");
-    for (const std::string& package_to_callback :
-         options_.rewrite_callback_options.value().packages_to_callback) {
-      rewrite_method->AppendStatement(
-          StringPrintf("%s.R.onResourcesLoaded(p);", package_to_callback.data()));
-    }
-  }
+  std::unique_ptr<MethodDefinition> rewrite_method =
+      util::make_unique<MethodDefinition>("public static void onResourcesLoaded(int p)");
+  for (const std::string& package_to_callback :
+       options_.rewrite_callback_options.value().packages_to_callback) {
+    rewrite_method->AppendStatement(
+        StringPrintf("%s.R.onResourcesLoaded(p);", package_to_callback.data()));
+  }
+  return rewrite_method;
+}
 
+bool JavaClassGenerator::ProcessTypes(const StringPiece& package_name_to_generate,
+                                      MethodDefinition* out_rewrite_method,
+                                      std::ostream* out_r_txt,
+                                      const TypeClassCallback& on_type_class) {
   for (const auto& package : table_->packages) {
     for (const auto& type : package->types) {
       if (type->type == ResourceType::kAttrPrivate) {
@@ -587,7 +591,7 @@ bool JavaClassGenerator::Generate(const StringPiece& package_name_to_generate,
       std::unique_ptr<ClassDefinition> class_def = util::make_unique<ClassDefinition>(
           ToString(type->type), ClassQualifier::kStatic, force_creation_if_empty);
       if (!ProcessType(package_name_to_generate, *package, *type, class_def.get(),
-                       rewrite_method.get(), out_r_txt)) {
+                       out_rewrite_method, out_r_txt)) {
         return false;
       }
 
@@ -596,7 +600,7 @@ bool JavaClassGenerator::Generate(const StringPiece& package_name_to_generate,
         const ResourceTableType* priv_type = package->FindType(ResourceType::kAttrPrivate);
         if (priv_type) {
           if (!ProcessType(package_name_to_generate, *package, *priv_type, class_def.get(),
-                           rewrite_method.get(), out_r_txt)) {
+                           out_rewrite_method, out_r_txt)) {
             return false;
           }
         }
@@ -611,32 +615,162 @@ bool JavaClassGenerator::Generate(const StringPiece& package_name_to_generate,
 
       AppendJavaDocAnnotations(options_.javadoc_annotations, class_def->GetCommentBuilder());
 
-      r_class.AddMember(std::move(class_def));
+      on_type_class(std::move(class_def));
     }
   }
+  return true;
+}
+
+std::unique_ptr<ClassDefinition> JavaClassGenerator::GenerateClass(
+    const StringPiece& package_name_to_generate, std::ostream* out_r_txt) {
+  std::unique_ptr<ClassDefinition> r_class =
+      util::make_unique<ClassDefinition>("R", ClassQualifier::kNone, true);
+  std::unique_ptr<MethodDefinition> rewrite_method = MakeRewriteMethod();
+
+  if (!ProcessTypes(package_name_to_generate, rewrite_method.get(), out_r_txt,
+                    [&](std::unique_ptr<ClassDefinition> class_def) {
+                      r_class->AddMember(std::move(class_def));
+                    })) {
+    return {};
+  }
 
   if (rewrite_method != nullptr) {
-    r_class.AddMember(std::move(rewrite_method));
+    r_class->AddMember(std::move(rewrite_method));
+  }
+
+  AppendJavaDocAnnotations(options_.javadoc_annotations, r_class->GetCommentBuilder());
+  return r_class;
+}
+
+bool JavaClassGenerator::FinishRTxt(std::ostream* out_r_txt) {
+  if (out_r_txt != nullptr) {
+    out_r_txt->flush();
+
+    if (!*out_r_txt) {
+      error_ = android::base::SystemErrorCodeToString(errno);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool JavaClassGenerator::Generate(const StringPiece& package_name_to_generate,
+                                  const StringPiece& out_package_name, std::ostream* out,
+                                  std::ostream* out_r_txt) {
+  ClassDefinition::WriteJavaFileHeader(out_package_name, out);
+  return GenerateClassBody(package_name_to_generate, out, out_r_txt);
+}
+
+bool JavaClassGenerator::GenerateClassBody(const StringPiece& package_name_to_generate,
+                                           std::ostream* out, std::ostream* out_r_txt) {
+  // A type class replaces an earlier one of the same name when they are added to a
+  // ClassDefinition, which can only happen when the table has several packages. Since the type
+  // classes are written as soon as they are generated, find the ones that will be replaced
+  // up front and skip writing them.
+  std::vector<bool> replaced_type_classes;
+  std::map<StringPiece, size_t> last_type_class;
+  for (const auto& package : table_->packages) {
+    for (const auto& type : package->types) {
+      if (type->type != ResourceType::kAttrPrivate) {
+        auto result = last_type_class.insert({ToString(type->type), 0u});
+        if (!result.second) {
+          replaced_type_classes[result.first->second] = true;
+        }
+        result.first->second = replaced_type_classes.size();
+        replaced_type_classes.push_back(false);
+      }
+    }
   }
 
+  ClassDefinition r_class("R", ClassQualifier::kNone, true);
   AppendJavaDocAnnotations(options_.javadoc_annotations, r_class.GetCommentBuilder());
+  r_class.WriteOpeningToStream("", out);
+
+  // Each type class is written and freed before the next one is generated, so that only the
+  // fields of one type are held in memory at a time.
+  std::unique_ptr<MethodDefinition> rewrite_method = MakeRewriteMethod();
+  size_t type_class_index = 0u;
+  if (!ProcessTypes(package_name_to_generate, rewrite_method.get(), out_r_txt,
+                    [&](std::unique_ptr<ClassDefinition> class_def) {
+                      if (!replaced_type_classes[type_class_index++]) {
+                        class_def->WriteToStream(kIndent, options_.use_final, out);
+                        *out << "\n";
+                      }
+                    })) {
+    return false;
+  }
 
-  if (!ClassDefinition::WriteJavaFile(&r_class, out_package_name, options_.use_final, out)) {
+  if (rewrite_method != nullptr) {
+    rewrite_method->WriteToStream(kIndent, options_.use_final, out);
+    *out << "\n";
+  }
+
+  r_class.WriteClosingToStream("", out);
+  if (!*out) {
     return false;
   }
 
   out->flush();
+  return FinishRTxt(out_r_txt);
+}
 
-  if (out_r_txt != nullptr) {
-    out_r_txt->flush();
+bool JavaClassGenerator::GenerateClassFiles(const StringPiece& package_name_to_generate,
+                                            const StringPiece& out_package_name,
+                                            IArchiveWriter* writer, std::ostream* out_r_txt) {
+  const std::vector<std::string> out_package_names = {out_package_name.to_string()};
+  return GenerateClassFiles(package_name_to_generate, out_package_names, writer, out_r_txt);
+}
 
-    if (!*out_r_txt) {
-      error_ = android::base::SystemErrorCodeToString(errno);
+bool JavaClassGenerator::GenerateClassFiles(const StringPiece& package_name_to_generate,
+                                            const std::vector<std::string>& out_package_names,
+                                            IArchiveWriter* writer, std::ostream* out_r_txt) {
+  if (options_.rewrite_callback_options) {
+    error_ = "onResourcesLoaded() can not be generated as a class file";
+    return false;
+  }
+
+  // The classes of every output package are the same, so they are only generated once.
+  std::unique_ptr<ClassDefinition> r_class = GenerateClass(package_name_to_generate, out_r_txt);
+  if (r_class == nullptr) {
+    return false;
+  }
+
+  for (const std::string& out_package_name : out_package_names) {
+    if (!ClassDefinition::WriteClassFiles(r_class.get(), out_package_name, options_.use_final,
+                                          writer, &error_)) {
       return false;
     }
   }
+  return FinishRTxt(out_r_txt);
+}
 
-  return true;
+bool JavaClassGenerator::GenerateClassBodyAndFiles(
+    const StringPiece& package_name_to_generate, std::ostream* out,
+    const std::vector<std::string>& out_package_names, IArchiveWriter* writer,
+    std::ostream* out_r_txt) {
+  if (options_.rewrite_callback_options) {
+    error_ = "onResourcesLoaded() can not be generated as a class file";
+    return false;
+  }
+
+  std::unique_ptr<ClassDefinition> r_class = GenerateClass(package_name_to_generate, out_r_txt);
+  if (r_class == nullptr) {
+    return false;
+  }
+
+  r_class->WriteToStream("", options_.use_final, out);
+  if (!*out) {
+    return false;
+  }
+  out->flush();
+
+  for (const std::string& out_package_name : out_package_names) {
+    if (!ClassDefinition::WriteClassFiles(r_class.get(), out_package_name, options_.use_final,
+                                          writer, &error_)) {
+      return false;
+    }
+  }
+  return FinishRTxt(out_r_txt);
 }
 
 }  // namespace aapt
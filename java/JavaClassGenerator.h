@@ -17,13 +17,17 @@
 #ifndef AAPT_JAVA_CLASS_GENERATOR_H
 #define AAPT_JAVA_CLASS_GENERATOR_H
 
+#include <functional>
+#include <memory>
 #include <ostream>
 #include <string>
+#include <vector>
 
 #include "androidfw/StringPiece.h"
 
 #include "ResourceTable.h"
 #include "ResourceValues.h"
+#include "flatten/Archive.h"
 #include "process/IResourceTableConsumer.h"
 #include "process/SymbolTable.h"
 
@@ -76,9 +80,51 @@ class JavaClassGenerator {
                 const android::StringPiece& output_package_name, std::ostream* out,
                 std::ostream* out_r_txt = nullptr);
 
+  // Writes the R class to `out` without the file header and package declaration. The class does
+  // not depend on the package it is declared in, so it can be generated once and written after
+  // ClassDefinition::WriteJavaFileHeader() for each package that needs the same R class.
+  bool GenerateClassBody(const android::StringPiece& package_name_to_generate, std::ostream* out,
+                         std::ostream* out_r_txt = nullptr);
+
+  // Writes the R classes to `writer` as compiled class files, which can be used in place of
+  // compiling R.java. The rewrite callback of shared libraries is not supported.
+  bool GenerateClassFiles(const android::StringPiece& package_name_to_generate,
+                          const android::StringPiece& output_package_name, IArchiveWriter* writer,
+                          std::ostream* out_r_txt = nullptr);
+
+  // Writes the same R classes for each of `output_package_names`, generating them only once.
+  bool GenerateClassFiles(const android::StringPiece& package_name_to_generate,
+                          const std::vector<std::string>& output_package_names,
+                          IArchiveWriter* writer, std::ostream* out_r_txt = nullptr);
+
+  // Writes the R class to `out` like GenerateClassBody() and the R classes of each of
+  // `output_package_names` to `writer`, generating the classes only once for both.
+  bool GenerateClassBodyAndFiles(const android::StringPiece& package_name_to_generate,
+                                 std::ostream* out,
+                                 const std::vector<std::string>& output_package_names,
+                                 IArchiveWriter* writer, std::ostream* out_r_txt = nullptr);
+
   const std::string& getError() const;
 
  private:
+  // Builds the R class for the symbols belonging to `package_name_to_generate`. Returns nullptr
+  // and sets error_ on failure.
+  std::unique_ptr<ClassDefinition> GenerateClass(
+      const android::StringPiece& package_name_to_generate, std::ostream* out_r_txt);
+
+  using TypeClassCallback = std::function<void(std::unique_ptr<ClassDefinition>)>;
+
+  // Generates the class of each type in turn and hands it to `on_type_class`, which either adds
+  // it to an R class or writes it out directly. Returns false and sets error_ on failure.
+  bool ProcessTypes(const android::StringPiece& package_name_to_generate,
+                    MethodDefinition* out_rewrite_method, std::ostream* out_r_txt,
+                    const TypeClassCallback& on_type_class);
+
+  // Returns the onResourcesLoaded() method if the rewrite callback was requested.
+  std::unique_ptr<MethodDefinition> MakeRewriteMethod();
+
+  bool FinishRTxt(std::ostream* out_r_txt);
+
   bool SkipSymbol(SymbolState state);
   bool SkipSymbol(const Maybe<SymbolTable::Symbol>& symbol);
 
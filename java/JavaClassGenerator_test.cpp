@@ -16,9 +16,11 @@
 
 #include "java/JavaClassGenerator.h"
 
+#include <map>
 #include <sstream>
 #include <string>
 
+#include "java/ClassDefinition.h"
 #include "test/Test.h"
 #include "util/Util.h"
 
@@ -28,6 +30,42 @@ using ::testing::Ne;
 
 namespace aapt {
 
+// Collects the files written to it in memory.
+class InMemoryArchiveWriter : public IArchiveWriter {
+ public:
+  bool WriteFile(const StringPiece& path, uint32_t flags, io::InputStream* in) override {
+    std::string& content = files[path.to_string()];
+    const void* data;
+    size_t size;
+    while (in->Next(&data, &size)) {
+      content.append(static_cast<const char*>(data), size);
+    }
+    return true;
+  }
+
+  bool StartEntry(const StringPiece& path, uint32_t flags) override {
+    return false;
+  }
+
+  bool FinishEntry() override {
+    return false;
+  }
+
+  bool Write(const void* buffer, int size) override {
+    return false;
+  }
+
+  bool HadError() const override {
+    return false;
+  }
+
+  std::string GetError() const override {
+    return {};
+  }
+
+  std::map<std::string, std::string> files;
+};
+
 TEST(JavaClassGeneratorTest, FailWhenEntryIsJavaKeyword) {
   std::unique_ptr<ResourceTable> table =
       test::ResourceTableBuilder()
@@ -445,4 +483,122 @@ TEST(JavaClassGeneratorTest, GenerateOnResourcesLoadedCallbackForSharedLibrary)
   EXPECT_NE(std::string::npos, actual.find("com.boo.R.onResourcesLoaded"));
 }
 
+TEST(JavaClassGeneratorTest, GenerateClassFiles) {
+  std::unique_ptr<ResourceTable> table =
+      test::ResourceTableBuilder()
+          .SetPackageId("android", 0x01)
+          .AddSimple("android:id/one", ResourceId(0x01020000))
+          .AddValue("android:attr/bar", ResourceId(0x01010000),
+                    test::AttributeBuilder(false).Build())
+          .AddValue("android:styleable/foo", ResourceId(0x01030000),
+                    test::StyleableBuilder()
+                        .AddItem("android:attr/bar", ResourceId(0x01010000))
+                        .Build())
+          .Build();
+
+  std::unique_ptr<IAaptContext> context =
+      test::ContextBuilder()
+          .AddSymbolSource(util::make_unique<ResourceTableSymbolSource>(table.get()))
+          .SetNameManglerPolicy(NameManglerPolicy{"android"})
+          .Build();
+  JavaClassGenerator generator(context.get(), table.get(), {});
+
+  InMemoryArchiveWriter writer;
+  ASSERT_TRUE(generator.GenerateClassFiles("android", "com.foo", &writer));
+
+  ASSERT_EQ(4u, writer.files.size());
+  for (const auto& file : writer.files) {
+    // Every class file starts with the magic number.
+    EXPECT_EQ(std::string("\xca\xfe\xba\xbe"), file.second.substr(0, 4));
+  }
+
+  const std::string& id_class = writer.files["com/foo/R$id.class"];
+  EXPECT_NE(std::string::npos, id_class.find("com/foo/R$id"));
+  EXPECT_NE(std::string::npos, id_class.find("one"));
+  EXPECT_NE(std::string::npos, id_class.find("ConstantValue"));
+  EXPECT_NE(std::string::npos, id_class.find("InnerClasses"));
+
+  // The styleable array is initialized in the static initializer.
+  const std::string& styleable_class = writer.files["com/foo/R$styleable.class"];
+  EXPECT_NE(std::string::npos, styleable_class.find("<clinit>"));
+  EXPECT_NE(std::string::npos, styleable_class.find("foo_bar"));
+
+  EXPECT_NE(writer.files.end(), writer.files.find("com/foo/R.class"));
+  EXPECT_NE(writer.files.end(), writer.files.find("com/foo/R$attr.class"));
+}
+
+TEST(JavaClassGeneratorTest, FailToGenerateClassFilesWithRewriteCallback) {
+  std::unique_ptr<ResourceTable> table = test::ResourceTableBuilder()
+                                             .SetPackageId("foo", 0x00)
+                                             .AddSimple("foo:id/one", ResourceId(0x00020000))
+                                             .Build();
+
+  std::unique_ptr<IAaptContext> context =
+      test::ContextBuilder()
+          .AddSymbolSource(util::make_unique<ResourceTableSymbolSource>(table.get()))
+          .SetNameManglerPolicy(NameManglerPolicy{"foo"})
+          .Build();
+
+  JavaClassGeneratorOptions options;
+  options.use_final = false;
+  options.rewrite_callback_options = OnResourcesLoadedCallbackOptions{};
+  JavaClassGenerator generator(context.get(), table.get(), options);
+
+  InMemoryArchiveWriter writer;
+  EXPECT_FALSE(generator.GenerateClassFiles("foo", "foo", &writer));
+  EXPECT_TRUE(writer.files.empty());
+}
+
+TEST(JavaClassGeneratorTest, ClassBodyIsSharedByPackages) {
+  std::unique_ptr<ResourceTable> table =
+      test::ResourceTableBuilder()
+          .SetPackageId("android", 0x01)
+          .AddSimple("android:id/one", ResourceId(0x01020000))
+          .AddSimple("android:string/two", ResourceId(0x01030000))
+          .AddValue("android:attr/bar", ResourceId(0x01010000),
+                    test::AttributeBuilder(false).Build())
+          .AddValue("android:styleable/foo", ResourceId(0x01040000),
+                    test::StyleableBuilder()
+                        .AddItem("android:attr/bar", ResourceId(0x01010000))
+                        .Build())
+          .Build();
+
+  std::unique_ptr<IAaptContext> context =
+      test::ContextBuilder()
+          .AddSymbolSource(util::make_unique<ResourceTableSymbolSource>(table.get()))
+          .SetNameManglerPolicy(NameManglerPolicy{"android"})
+          .Build();
+  JavaClassGenerator generator(context.get(), table.get(), {});
+
+  std::stringstream expected;
+  std::stringstream expected_r_txt;
+  ASSERT_TRUE(generator.Generate("android", "com.foo", &expected, &expected_r_txt));
+
+  std::stringstream body;
+  std::stringstream r_txt;
+  ASSERT_TRUE(generator.GenerateClassBody("android", &body, &r_txt));
+  EXPECT_EQ(expected_r_txt.str(), r_txt.str());
+
+  std::stringstream actual;
+  ClassDefinition::WriteJavaFileHeader("com.foo", &actual);
+  actual << body.str();
+  EXPECT_EQ(expected.str(), actual.str());
+
+  InMemoryArchiveWriter writer;
+  ASSERT_TRUE(generator.GenerateClassFiles("android", {"com.foo", "com.bar"}, &writer));
+  EXPECT_EQ(10u, writer.files.size());
+  EXPECT_EQ(writer.files["com/foo/R$string.class"].size(),
+            writer.files["com/bar/R$string.class"].size());
+}
+
+  std::stringstream combined_body;
+  std::stringstream combined_r_txt;
+  InMemoryArchiveWriter combined_writer;
+  ASSERT_TRUE(generator.GenerateClassBodyAndFiles("android", &combined_body, {"com.foo", "com.bar"},
+                                                  &combined_writer, &combined_r_txt));
+  EXPECT_EQ(body.str(), combined_body.str());
+  EXPECT_EQ(expected_r_txt.str(), combined_r_txt.str());
+  EXPECT_EQ(writer.files, combined_writer.files);
+}
+
 }  // namespace aapt
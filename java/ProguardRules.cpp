@@ -16,14 +16,19 @@
 
 #include "java/ProguardRules.h"
 
+#include <algorithm>
 #include <memory>
+#include <numeric>
 #include <string>
+#include <tuple>
 
 #include "android-base/macros.h"
 
 #include "util/Util.h"
 #include "xml/XmlDom.h"
 
+using ::android::StringPiece;
+
 namespace aapt {
 namespace proguard {
 
@@ -56,11 +61,11 @@ class BaseVisitor : public xml::Visitor {
 
  protected:
   void AddClass(size_t line_number, const std::string& class_name) {
-    keep_set_->AddClass(Source(source_.path, line_number), class_name);
+    keep_set_->AddClass(source_.path, line_number, class_name);
   }
 
   void AddMethod(size_t line_number, const std::string& method_name) {
-    keep_set_->AddMethod(Source(source_.path, line_number), method_name);
+    keep_set_->AddMethod(source_.path, line_number, method_name);
   }
 
  private:
@@ -295,20 +300,90 @@ bool CollectProguardRules(const Source& source, xml::XmlResource* res, KeepSet*
   return true;
 }
 
-bool WriteKeepSet(std::ostream* out, const KeepSet& keep_set) {
-  for (const auto& entry : keep_set.keep_set_) {
-    for (const Source& source : entry.second) {
-      *out << "# Referenced at " << source << "\n";
-    }
-    *out << "-keep class " << entry.first << " { <init>(...); }\n" << std::endl;
+uint32_t KeepSet::Intern(const StringPiece& str) {
+  auto iter = string_ids_.find(str);
+  if (iter != string_ids_.end()) {
+    return iter->second;
+  }
+
+  const uint32_t id = static_cast<uint32_t>(strings_.size());
+  strings_.push_back(str.to_string());
+  string_ids_.emplace(strings_.back(), id);
+  return id;
+}
+
+void KeepSet::Merge(const KeepSet& other) {
+  // Intern each of the other set's strings once, rather than once per reference.
+  std::vector<uint32_t> ids;
+  ids.reserve(other.strings_.size());
+  for (const std::string& str : other.strings_) {
+    ids.push_back(Intern(str));
+  }
+
+  classes_.reserve(classes_.size() + other.classes_.size());
+  for (const Reference& ref : other.classes_) {
+    classes_.push_back(Reference{ids[ref.name], ids[ref.path], ref.line});
+  }
+
+  methods_.reserve(methods_.size() + other.methods_.size());
+  for (const Reference& ref : other.methods_) {
+    methods_.push_back(Reference{ids[ref.name], ids[ref.path], ref.line});
   }
+}
 
-  for (const auto& entry : keep_set.keep_method_set_) {
-    for (const Source& source : entry.second) {
-      *out << "# Referenced at " << source << "\n";
+void KeepSet::WriteReferences(std::ostream* out, const std::vector<Reference>& references,
+                              const std::vector<uint32_t>& string_ranks, const char* rule_prefix,
+                              const char* rule_suffix) const {
+  // Orders by name, then by source in the same way as operator<(Source, Source).
+  auto key = [&](const Reference& ref) {
+    return std::make_tuple(string_ranks[ref.name], string_ranks[ref.path], bool(ref.line),
+                           ref.line ? ref.line.value() : 0u);
+  };
+
+  std::vector<const Reference*> sorted;
+  sorted.reserve(references.size());
+  for (const Reference& ref : references) {
+    sorted.push_back(&ref);
+  }
+  std::sort(sorted.begin(), sorted.end(), [&](const Reference* a, const Reference* b) {
+    return key(*a) < key(*b);
+  });
+
+  for (auto iter = sorted.begin(); iter != sorted.end();) {
+    const uint32_t name = (*iter)->name;
+    const Reference* last = nullptr;
+    for (; iter != sorted.end() && (*iter)->name == name; ++iter) {
+      if (last != nullptr && key(*last) == key(**iter)) {
+        continue;
+      }
+      last = *iter;
+      *out << "# Referenced at " << strings_[last->path];
+      if (last->line) {
+        *out << ":" << last->line.value();
+      }
+      *out << "\n";
     }
-    *out << "-keepclassmembers class * { *** " << entry.first << "(...); }\n" << std::endl;
+    *out << rule_prefix << strings_[name] << rule_suffix << std::endl;
   }
+}
+
+bool WriteKeepSet(std::ostream* out, const KeepSet& keep_set) {
+  // Rank the interned strings once, so that sorting the references compares integers.
+  std::vector<uint32_t> sorted_ids(keep_set.strings_.size());
+  std::iota(sorted_ids.begin(), sorted_ids.end(), 0u);
+  std::sort(sorted_ids.begin(), sorted_ids.end(), [&](uint32_t a, uint32_t b) {
+    return keep_set.strings_[a] < keep_set.strings_[b];
+  });
+
+  std::vector<uint32_t> string_ranks(sorted_ids.size());
+  for (size_t i = 0; i < sorted_ids.size(); i++) {
+    string_ranks[sorted_ids[i]] = static_cast<uint32_t>(i);
+  }
+
+  keep_set.WriteReferences(out, keep_set.classes_, string_ranks, "-keep class ",
+                           " { <init>(...); }\n");
+  keep_set.WriteReferences(out, keep_set.methods_, string_ranks,
+                           "-keepclassmembers class * { *** ", "(...); }\n");
   return true;
 }
 
@@ -17,33 +17,82 @@
 #ifndef AAPT_PROGUARD_RULES_H
 #define AAPT_PROGUARD_RULES_H
 
-#include <map>
+#include <deque>
 #include <ostream>
-#include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "android-base/macros.h"
+#include "androidfw/StringPiece.h"
 
 #include "Resource.h"
 #include "Source.h"
+#include "util/Maybe.h"
 #include "xml/XmlDom.h"
 
 namespace aapt {
 namespace proguard {
 
+// The classes and methods referenced by XML files, along with where they were referenced.
+//
+// Class names and source paths are interned, since the same few names are referenced from
+// thousands of places. References are only sorted and de-duplicated when the set is written, so
+// adding one is cheap. A KeepSet is not thread-safe; collect into a set per thread and Merge()
+// them once all threads are done.
 class KeepSet {
  public:
-  inline void AddClass(const Source& source, const std::string& class_name) {
-    keep_set_[class_name].insert(source);
+  KeepSet() = default;
+  KeepSet(KeepSet&&) = default;
+  KeepSet& operator=(KeepSet&&) = default;
+
+  inline void AddClass(const Source& source, const android::StringPiece& class_name) {
+    AddClass(source.path, source.line, class_name);
+  }
+
+  inline void AddClass(const android::StringPiece& path, const Maybe<size_t>& line,
+                       const android::StringPiece& class_name) {
+    classes_.push_back(Reference{Intern(class_name), Intern(path), line});
+  }
+
+  inline void AddMethod(const Source& source, const android::StringPiece& method_name) {
+    AddMethod(source.path, source.line, method_name);
   }
 
-  inline void AddMethod(const Source& source, const std::string& method_name) {
-    keep_method_set_[method_name].insert(source);
+  inline void AddMethod(const android::StringPiece& path, const Maybe<size_t>& line,
+                        const android::StringPiece& method_name) {
+    methods_.push_back(Reference{Intern(method_name), Intern(path), line});
   }
 
+  // Adds every class and method kept by `other` to this set.
+  void Merge(const KeepSet& other);
+
  private:
+  DISALLOW_COPY_AND_ASSIGN(KeepSet);
+
   friend bool WriteKeepSet(std::ostream* out, const KeepSet& keep_set);
 
-  std::map<std::string, std::set<Source>> keep_set_;
-  std::map<std::string, std::set<Source>> keep_method_set_;
+  // A class or method name referenced at a source location. Both strings are indices into
+  // strings_.
+  struct Reference {
+    uint32_t name;
+    uint32_t path;
+    Maybe<size_t> line;
+  };
+
+  uint32_t Intern(const android::StringPiece& str);
+
+  // Writes `references` sorted by name and source, with one rule per distinct name.
+  void WriteReferences(std::ostream* out, const std::vector<Reference>& references,
+                       const std::vector<uint32_t>& string_ranks, const char* rule_prefix,
+                       const char* rule_suffix) const;
+
+  // A deque never moves its elements, so the StringPieces in string_ids_ stay valid.
+  std::deque<std::string> strings_;
+  std::unordered_map<android::StringPiece, uint32_t> string_ids_;
+
+  std::vector<Reference> classes_;
+  std::vector<Reference> methods_;
 };
 
 bool CollectProguardRulesForManifest(const Source& source,
@@ -116,4 +116,37 @@ TEST(ProguardRulesTest, MenuRulesAreEmitted) {
   EXPECT_THAT(actual, Not(HasSubstr("com.foo.Bat")));
 }
 
+TEST(ProguardRulesTest, MergedSetsAreWrittenSortedWithoutDuplicates) {
+  proguard::KeepSet set_a;
+  set_a.AddClass(Source("res/layout/b.xml", 3u), "com.foo.Bar");
+  set_a.AddClass(Source("res/layout/a.xml", 10u), "com.foo.Bar");
+  set_a.AddMethod(Source("res/layout/b.xml", 4u), "onClick");
+
+  proguard::KeepSet set_b;
+  set_b.AddClass(Source("res/layout/a.xml", 10u), "com.foo.Bar");
+  set_b.AddClass(Source("res/layout/a.xml", 2u), "com.foo.Bar");
+  set_b.AddClass(Source("res/layout/c.xml", 1u), "com.foo.Baz");
+  set_b.AddClass(Source("res/layout/c.xml", 1u), "android.widget.TextView");
+
+  proguard::KeepSet set;
+  set.Merge(set_b);
+  set.Merge(set_a);
+
+  std::stringstream out;
+  ASSERT_TRUE(proguard::WriteKeepSet(&out, set));
+
+  EXPECT_EQ(
+      "# Referenced at res/layout/c.xml:1\n"
+      "-keep class android.widget.TextView { <init>(...); }\n\n"
+      "# Referenced at res/layout/a.xml:2\n"
+      "# Referenced at res/layout/a.xml:10\n"
+      "# Referenced at res/layout/b.xml:3\n"
+      "-keep class com.foo.Bar { <init>(...); }\n\n"
+      "# Referenced at res/layout/c.xml:1\n"
+      "-keep class com.foo.Baz { <init>(...); }\n\n"
+      "# Referenced at res/layout/b.xml:4\n"
+      "-keepclassmembers class * { *** onClick(...); }\n\n",
+      out.str());
+}
+
 }  // namespace aapt
@@ -0,0 +1,375 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "link/IncrementalLinkState.h"
+
+#include <cstring>
+
+#include "android-base/file.h"
+#include "androidfw/ResourceTypes.h"
+#include "androidfw/StringPiece.h"
+
+#include "ResourceValues.h"
+#include "util/Digest.h"
+#include "util/Files.h"
+#include "util/Util.h"
+
+using ::android::StringPiece;
+
+namespace aapt {
+
+namespace {
+
+constexpr const char kMagic[] = "AAPTLNKS";
+constexpr uint32_t kFormatVersion = 1u;
+
+enum : uint8_t {
+  kLookupByName = 0u,
+  kLookupById = 1u,
+};
+
+// Appends little-endian integers and length-prefixed strings.
+class StateWriter {
+ public:
+  void WriteU8(uint8_t value) {
+    out_ += static_cast<char>(value);
+  }
+
+  void WriteU32(uint32_t value) {
+    for (size_t i = 0; i < sizeof(value); i++) {
+      WriteU8(static_cast<uint8_t>(value >> (i * 8)));
+    }
+  }
+
+  void WriteU64(uint64_t value) {
+    WriteU32(static_cast<uint32_t>(value));
+    WriteU32(static_cast<uint32_t>(value >> 32));
+  }
+
+  void WriteString(const StringPiece& str) {
+    WriteU32(static_cast<uint32_t>(str.size()));
+    out_.append(str.data(), str.size());
+  }
+
+  const std::string& str() const {
+    return out_;
+  }
+
+ private:
+  std::string out_;
+};
+
+// Reads what StateWriter writes. Once a read runs past the end of the data, every following read
+// fails too.
+class StateReader {
+ public:
+  explicit StateReader(const StringPiece& data) : data_(data) {
+  }
+
+  bool ReadU8(uint8_t* out) {
+    if (offset_ >= data_.size()) {
+      offset_ = data_.size() + 1;
+      return false;
+    }
+    *out = static_cast<uint8_t>(data_.data()[offset_++]);
+    return true;
+  }
+
+  bool ReadU32(uint32_t* out) {
+    *out = 0u;
+    for (size_t i = 0; i < sizeof(*out); i++) {
+      uint8_t byte;
+      if (!ReadU8(&byte)) {
+        return false;
+      }
+      *out |= static_cast<uint32_t>(byte) << (i * 8);
+    }
+    return true;
+  }
+
+  bool ReadU64(uint64_t* out) {
+    uint32_t low, high;
+    if (!ReadU32(&low) || !ReadU32(&high)) {
+      return false;
+    }
+    *out = (static_cast<uint64_t>(high) << 32) | low;
+    return true;
+  }
+
+  bool ReadString(std::string* out) {
+    uint32_t size;
+    if (!ReadU32(&size) || size > data_.size() - offset_) {
+      offset_ = data_.size() + 1;
+      return false;
+    }
+    out->assign(data_.data() + offset_, size);
+    offset_ += size;
+    return true;
+  }
+
+  bool AtEnd() const {
+    return offset_ == data_.size();
+  }
+
+ private:
+  StringPiece data_;
+  size_t offset_ = 0u;
+};
+
+void WriteDependency(const SymbolDependency& dependency, StateWriter* writer) {
+  if (dependency.name) {
+    const ResourceName& name = dependency.name.value();
+    writer->WriteU8(kLookupByName);
+    writer->WriteString(name.package);
+    writer->WriteString(ToString(name.type));
+    writer->WriteString(name.entry);
+  } else {
+    writer->WriteU8(kLookupById);
+    writer->WriteU32(dependency.id.value().id);
+  }
+  writer->WriteU64(dependency.digest);
+}
+
+bool ReadDependency(StateReader* reader, SymbolDependency* out_dependency) {
+  uint8_t kind;
+  if (!reader->ReadU8(&kind)) {
+    return false;
+  }
+
+  if (kind == kLookupByName) {
+    std::string package, type_str, entry;
+    if (!reader->ReadString(&package) || !reader->ReadString(&type_str) ||
+        !reader->ReadString(&entry)) {
+      return false;
+    }
+
+    const ResourceType* type = ParseResourceType(type_str);
+    if (type == nullptr) {
+      return false;
+    }
+    out_dependency->name = ResourceName(package, *type, entry);
+  } else if (kind == kLookupById) {
+    uint32_t id;
+    if (!reader->ReadU32(&id)) {
+      return false;
+    }
+    out_dependency->id = ResourceId(id);
+  } else {
+    return false;
+  }
+  return reader->ReadU64(&out_dependency->digest);
+}
+
+void WriteFile(const std::string& key, const CachedXmlFile& file, StateWriter* writer) {
+  writer->WriteString(key);
+  writer->WriteU64(file.input_digest);
+  writer->WriteU32(static_cast<uint32_t>(file.dependencies.size()));
+  for (const SymbolDependency& dependency : file.dependencies) {
+    WriteDependency(dependency, writer);
+  }
+
+  writer->WriteU32(static_cast<uint32_t>(file.outputs.size()));
+  for (const CachedXmlOutput& output : file.outputs) {
+    // The configuration is saved as the raw ResTable_config, which round-trips exactly.
+    writer->WriteString(StringPiece(reinterpret_cast<const char*>(&output.config),
+                                    sizeof(android::ResTable_config)));
+    writer->WriteString(output.path);
+    writer->WriteString(output.data);
+  }
+}
+
+bool ReadFile(StateReader* reader, std::string* out_key, CachedXmlFile* out_file) {
+  uint32_t dependency_count;
+  if (!reader->ReadString(out_key) || !reader->ReadU64(&out_file->input_digest) ||
+      !reader->ReadU32(&dependency_count)) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < dependency_count; i++) {
+    SymbolDependency dependency;
+    if (!ReadDependency(reader, &dependency)) {
+      return false;
+    }
+    out_file->dependencies.push_back(std::move(dependency));
+  }
+
+  uint32_t output_count;
+  if (!reader->ReadU32(&output_count)) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < output_count; i++) {
+    std::string config;
+    CachedXmlOutput output;
+    if (!reader->ReadString(&config) || config.size() != sizeof(android::ResTable_config) ||
+        !reader->ReadString(&output.path) || !reader->ReadString(&output.data)) {
+      return false;
+    }
+    memcpy(&output.config, config.data(), config.size());
+    out_file->outputs.push_back(std::move(output));
+  }
+  return true;
+}
+
+void DigestReference(const Reference& ref, Digest* digest) {
+  digest->Update(ref.name ? ref.name.value().ToString() : std::string());
+  digest->Update(ref.id ? ref.id.value().id : 0u);
+}
+
+}  // namespace
+
+uint64_t DigestSymbol(const SymbolTable::Symbol* symbol) {
+  Digest digest;
+  digest.Update(symbol != nullptr);
+  if (symbol == nullptr) {
+    return digest.value();
+  }
+
+  digest.Update(static_cast<bool>(symbol->id));
+  digest.Update(symbol->id ? symbol->id.value().id : 0u);
+  digest.Update(symbol->is_public);
+
+  // The attribute decides how the values assigned to it in XML are compiled.
+  const Attribute* attr = symbol->attribute.get();
+  digest.Update(attr != nullptr);
+  if (attr != nullptr) {
+    digest.Update(attr->type_mask);
+    digest.Update(static_cast<uint32_t>(attr->min_int));
+    digest.Update(static_cast<uint32_t>(attr->max_int));
+    digest.Update(attr->symbols.size());
+    for (const Attribute::Symbol& attr_symbol : attr->symbols) {
+      DigestReference(attr_symbol.symbol, &digest);
+      digest.Update(attr_symbol.value);
+    }
+  }
+  return digest.value();
+}
+
+std::unique_ptr<SymbolTable::Symbol> RecordingSymbolSource::FindByName(const ResourceName& name) {
+  const SymbolTable::Symbol* symbol = table_->FindByName(name);
+  SymbolDependency dependency;
+  dependency.name = name;
+  dependency.digest = DigestSymbol(symbol);
+  dependencies_.push_back(std::move(dependency));
+  return symbol != nullptr ? util::make_unique<SymbolTable::Symbol>(*symbol) : nullptr;
+}
+
+std::unique_ptr<SymbolTable::Symbol> RecordingSymbolSource::FindById(ResourceId id) {
+  const SymbolTable::Symbol* symbol = table_->FindById(id);
+  SymbolDependency dependency;
+  dependency.id = id;
+  dependency.digest = DigestSymbol(symbol);
+  dependencies_.push_back(std::move(dependency));
+  return symbol != nullptr ? util::make_unique<SymbolTable::Symbol>(*symbol) : nullptr;
+}
+
+void IncrementalLinkState::Load(const std::string& path, uint64_t options_digest,
+                                IDiagnostics* diag) {
+  options_digest_ = options_digest;
+  previous_files_.clear();
+
+  std::string data;
+  if (file::GetFileType(path) != file::FileType::kRegular ||
+      !android::base::ReadFileToString(path, &data)) {
+    return;
+  }
+
+  StateReader reader(data);
+  std::string magic;
+  uint32_t version;
+  uint64_t saved_options_digest;
+  uint32_t file_count;
+  if (!reader.ReadString(&magic) || magic != kMagic || !reader.ReadU32(&version) ||
+      version != kFormatVersion || !reader.ReadU64(&saved_options_digest) ||
+      !reader.ReadU32(&file_count)) {
+    diag->Warn(DiagMessage(path) << "ignoring incremental link state of an unknown format");
+    return;
+  }
+
+  if (saved_options_digest != options_digest) {
+    // The options changed, so none of the files can be reused.
+    return;
+  }
+
+  std::map<std::string, std::shared_ptr<const CachedXmlFile>> files;
+  for (uint32_t i = 0; i < file_count; i++) {
+    std::string key;
+    std::unique_ptr<CachedXmlFile> file = util::make_unique<CachedXmlFile>();
+    if (!ReadFile(&reader, &key, file.get())) {
+      diag->Warn(DiagMessage(path) << "ignoring corrupt incremental link state");
+      return;
+    }
+    files[key] = std::move(file);
+  }
+
+  if (!reader.AtEnd()) {
+    diag->Warn(DiagMessage(path) << "ignoring corrupt incremental link state");
+    return;
+  }
+  previous_files_ = std::move(files);
+}
+
+bool IncrementalLinkState::Save(const std::string& path, IDiagnostics* diag) {
+  std::lock_guard<std::mutex> guard(lock_);
+  StateWriter writer;
+  writer.WriteString(kMagic);
+  writer.WriteU32(kFormatVersion);
+  writer.WriteU64(options_digest_);
+  writer.WriteU32(static_cast<uint32_t>(files_.size()));
+  for (const auto& entry : files_) {
+    WriteFile(entry.first, *entry.second, &writer);
+  }
+
+  std::string error;
+  if (!file::WriteFileIfChanged(path, writer.str(), &error)) {
+    diag->Error(DiagMessage() << "failed writing to '" << path << "': " << error);
+    return false;
+  }
+  return true;
+}
+
+std::shared_ptr<const CachedXmlFile> IncrementalLinkState::FindUpToDate(
+    const std::string& key, uint64_t input_digest, SymbolTable* symbols) {
+  std::shared_ptr<const CachedXmlFile> file;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    auto iter = previous_files_.find(key);
+    if (iter == previous_files_.end() || iter->second->input_digest != input_digest) {
+      return {};
+    }
+    file = iter->second;
+  }
+
+  for (const SymbolDependency& dependency : file->dependencies) {
+    const SymbolTable::Symbol* symbol = dependency.name
+                                            ? symbols->FindByName(dependency.name.value())
+                                            : symbols->FindById(dependency.id.value());
+    if (DigestSymbol(symbol) != dependency.digest) {
+      return {};
+    }
+  }
+
+  std::lock_guard<std::mutex> guard(lock_);
+  files_[key] = file;
+  return file;
+}
+
+void IncrementalLinkState::Add(const std::string& key, std::unique_ptr<CachedXmlFile> file) {
+  std::lock_guard<std::mutex> guard(lock_);
+  files_[key] = std::move(file);
+}
+
+}  // namespace aapt
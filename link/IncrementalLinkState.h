@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AAPT_LINK_INCREMENTALLINKSTATE_H
+#define AAPT_LINK_INCREMENTALLINKSTATE_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "android-base/macros.h"
+
+#include "ConfigDescription.h"
+#include "Diagnostics.h"
+#include "Resource.h"
+#include "process/SymbolTable.h"
+#include "util/Maybe.h"
+
+namespace aapt {
+
+// A symbol looked up while linking an XML file, and a digest of what the lookup found.
+struct SymbolDependency {
+  // The lookup was either by name or by ID.
+  Maybe<ResourceName> name;
+  Maybe<ResourceId> id;
+  uint64_t digest = 0u;
+};
+
+// A binary XML file written for an XML resource: the resource itself, or one of the copies made
+// for newer API levels by auto-versioning.
+struct CachedXmlOutput {
+  ConfigDescription config;
+  std::string path;
+  std::string data;
+};
+
+// What a previous link produced for an XML resource, and what the result depended on.
+struct CachedXmlFile {
+  // The digest of the compiled file and of the settings it was linked with.
+  uint64_t input_digest = 0u;
+  std::vector<SymbolDependency> dependencies;
+  std::vector<CachedXmlOutput> outputs;
+};
+
+// Returns a digest of everything that linking an XML file reads from `symbol`, which may be
+// nullptr when the lookup found nothing.
+uint64_t DigestSymbol(const SymbolTable::Symbol* symbol);
+
+// Forwards lookups to a SymbolTable and records them as the dependencies of the file being linked.
+// Like SharedSymbolTableSource, it is meant to be wrapped by a SymbolTable of its own, so that
+// each symbol is only recorded once.
+class RecordingSymbolSource : public ISymbolSource {
+ public:
+  explicit RecordingSymbolSource(SymbolTable* table) : table_(table) {
+  }
+
+  std::unique_ptr<SymbolTable::Symbol> FindByName(const ResourceName& name) override;
+  std::unique_ptr<SymbolTable::Symbol> FindById(ResourceId id) override;
+
+  std::vector<SymbolDependency>* dependencies() {
+    return &dependencies_;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(RecordingSymbolSource);
+
+  SymbolTable* table_;
+  std::vector<SymbolDependency> dependencies_;
+};
+
+// The state that `aapt2 link --incremental-state` keeps between runs: the binary XML written for
+// each XML resource, keyed by the path of the resource in the APK. A file whose compiled input is
+// unchanged, and whose every symbol lookup gives the same result as before, does not need to be
+// linked and flattened again.
+//
+// Lookups and updates may come from several threads.
+class IncrementalLinkState {
+ public:
+  IncrementalLinkState() = default;
+
+  // Loads the state saved at `path`. A missing or unreadable file, or one saved by a link with
+  // a different `options_digest`, gives an empty state: it only costs a full link.
+  void Load(const std::string& path, uint64_t options_digest, IDiagnostics* diag);
+
+  // Saves the files added by this link. Files of the previous link that were not looked up
+  // again are dropped.
+  bool Save(const std::string& path, IDiagnostics* diag);
+
+  // Returns the file cached for `key` if it was produced from the same input, and if every
+  // symbol it depends on still resolves to the same thing in `symbols`. The file is kept for
+  // the next link.
+  std::shared_ptr<const CachedXmlFile> FindUpToDate(const std::string& key, uint64_t input_digest,
+                                                    SymbolTable* symbols);
+
+  // Records the file produced for `key` by this link.
+  void Add(const std::string& key, std::unique_ptr<CachedXmlFile> file);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(IncrementalLinkState);
+
+  uint64_t options_digest_ = 0u;
+
+  std::mutex lock_;
+  std::map<std::string, std::shared_ptr<const CachedXmlFile>> previous_files_;
+  std::map<std::string, std::shared_ptr<const CachedXmlFile>> files_;
+};
+
+}  // namespace aapt
+
+#endif  // AAPT_LINK_INCREMENTALLINKSTATE_H
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "link/IncrementalLinkState.h"
+
+#include "android-base/test_utils.h"
+
+#include "NameMangler.h"
+#include "test/Test.h"
+#include "util/Files.h"
+
+namespace aapt {
+
+class IncrementalLinkStateTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    context_ = test::ContextBuilder().Build();
+    path_ = dir_.path;
+    file::AppendPath(&path_, "link.state");
+  }
+
+ protected:
+  // Builds a symbol table in which android:id/foo has the given ID.
+  std::unique_ptr<SymbolTable> BuildSymbols(uint32_t foo_id) {
+    tables_.push_back(test::ResourceTableBuilder()
+                          .SetPackageId("android", 0x01)
+                          .AddSimple("android:id/foo", ResourceId(foo_id))
+                          .Build());
+    std::unique_ptr<SymbolTable> symbols = util::make_unique<SymbolTable>(&mangler_);
+    symbols->AppendSource(util::make_unique<ResourceTableSymbolSource>(tables_.back().get()));
+    return symbols;
+  }
+
+  // Saves a state with one file, which looked up android:id/foo in `symbols`.
+  void SaveState(SymbolTable* symbols) {
+    RecordingSymbolSource recorder(symbols);
+    ASSERT_NE(nullptr, recorder.FindByName(test::ParseNameOrDie("android:id/foo")));
+
+    std::unique_ptr<CachedXmlFile> file = util::make_unique<CachedXmlFile>();
+    file->input_digest = 42u;
+    file->dependencies = std::move(*recorder.dependencies());
+    file->outputs.push_back(
+        CachedXmlOutput{test::ParseConfigOrDie("v21"), "res/layout-v21/main.xml", "data"});
+
+    IncrementalLinkState state;
+    state.Load(path_, 1u, context_->GetDiagnostics());
+    state.Add("res/layout/main.xml", std::move(file));
+    ASSERT_TRUE(state.Save(path_, context_->GetDiagnostics()));
+  }
+
+  std::unique_ptr<IAaptContext> context_;
+  NameMangler mangler_{NameManglerPolicy{"android"}};
+  std::vector<std::unique_ptr<ResourceTable>> tables_;
+  TemporaryDir dir_;
+  std::string path_;
+};
+
+TEST_F(IncrementalLinkStateTest, ReuseFileWithSameInputAndSymbols) {
+  std::unique_ptr<SymbolTable> symbols = BuildSymbols(0x01020000);
+  SaveState(symbols.get());
+
+  IncrementalLinkState state;
+  state.Load(path_, 1u, context_->GetDiagnostics());
+  std::shared_ptr<const CachedXmlFile> file =
+      state.FindUpToDate("res/layout/main.xml", 42u, BuildSymbols(0x01020000).get());
+  ASSERT_NE(nullptr, file);
+  ASSERT_EQ(1u, file->outputs.size());
+  EXPECT_EQ(test::ParseConfigOrDie("v21"), file->outputs[0].config);
+  EXPECT_EQ(std::string("res/layout-v21/main.xml"), file->outputs[0].path);
+  EXPECT_EQ(std::string("data"), file->outputs[0].data);
+}
+
+TEST_F(IncrementalLinkStateTest, DontReuseFileWhenInputOrSymbolsChange) {
+  std::unique_ptr<SymbolTable> symbols = BuildSymbols(0x01020000);
+  SaveState(symbols.get());
+
+  IncrementalLinkState state;
+  state.Load(path_, 1u, context_->GetDiagnostics());
+  EXPECT_EQ(nullptr, state.FindUpToDate("res/layout/main.xml", 43u, symbols.get()));
+  EXPECT_EQ(nullptr,
+            state.FindUpToDate("res/layout/main.xml", 42u, BuildSymbols(0x01020001).get()));
+  EXPECT_EQ(nullptr, state.FindUpToDate("res/layout/other.xml", 42u, symbols.get()));
+
+  // A state saved with other options is discarded.
+  IncrementalLinkState other_state;
+  other_state.Load(path_, 2u, context_->GetDiagnostics());
+  EXPECT_EQ(nullptr, other_state.FindUpToDate("res/layout/main.xml", 42u, symbols.get()));
+}
+
+TEST_F(IncrementalLinkStateTest, OnlySaveFilesUsedByThisLink) {
+  std::unique_ptr<SymbolTable> symbols = BuildSymbols(0x01020000);
+  SaveState(symbols.get());
+
+  // Nothing is looked up, so nothing is kept.
+  IncrementalLinkState state;
+  state.Load(path_, 1u, context_->GetDiagnostics());
+  ASSERT_TRUE(state.Save(path_, context_->GetDiagnostics()));
+
+  IncrementalLinkState next_state;
+  next_state.Load(path_, 1u, context_->GetDiagnostics());
+  EXPECT_EQ(nullptr, next_state.FindUpToDate("res/layout/main.xml", 42u, symbols.get()));
+}
+
+TEST(DigestSymbolTest, DigestCoversIdVisibilityAndAttribute) {
+  SymbolTable::Symbol symbol(ResourceId(0x01010000));
+  const uint64_t digest = DigestSymbol(&symbol);
+  EXPECT_NE(DigestSymbol(nullptr), digest);
+
+  SymbolTable::Symbol public_symbol(ResourceId(0x01010000), {}, true /*pub*/);
+  EXPECT_NE(digest, DigestSymbol(&public_symbol));
+
+  SymbolTable::Symbol attr_symbol(ResourceId(0x01010000),
+                                  test::AttributeBuilder().SetTypeMask(0x01u).Build());
+  EXPECT_NE(digest, DigestSymbol(&attr_symbol));
+
+  SymbolTable::Symbol enum_symbol(ResourceId(0x01010000), test::AttributeBuilder()
+                                                              .SetTypeMask(0x01u)
+                                                              .AddItem("one", 1u)
+                                                              .Build());
+  EXPECT_NE(DigestSymbol(&attr_symbol), DigestSymbol(&enum_symbol));
+
+  SymbolTable::Symbol same_symbol(ResourceId(0x01010000));
+  EXPECT_EQ(digest, DigestSymbol(&same_symbol));
+}
+
+}  // namespace aapt
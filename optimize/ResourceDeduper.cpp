@@ -40,8 +40,13 @@ class DominatedKeyValueRemover : public DominatorTree::BottomUpVisitor {
  public:
   using Node = DominatorTree::Node;
 
-  explicit DominatedKeyValueRemover(IAaptContext* context, ResourceEntry* entry)
-      : context_(context), entry_(entry) {}
+  DominatedKeyValueRemover(IAaptContext* context, ResourceEntry* entry,
+                           ConfigRelations* relations,
+                           std::vector<std::unique_ptr<Value>>* out_removed_values)
+      : context_(context),
+        entry_(entry),
+        relations_(relations),
+        out_removed_values_(out_removed_values) {}
 
   void VisitConfig(Node* node) {
     Node* parent = node->parent();
@@ -59,13 +64,12 @@ class DominatedKeyValueRemover : public DominatorTree::BottomUpVisitor {
 
     // Compare compatible configs for this entry and ensure the values are
     // equivalent.
-    const ConfigDescription& node_configuration = node_value->config;
     for (const auto& sibling : entry_->values) {
       if (!sibling->value) {
         // Sibling was already removed.
         continue;
       }
-      if (node_configuration.IsCompatibleWith(sibling->config) &&
+      if (IsCompatibleWith(*node_value, *sibling) &&
           !node_value->value->Equals(sibling->value.get())) {
         // The configurations are compatible, but the value is
         // different, so we can't remove this value.
@@ -80,19 +84,35 @@ class DominatedKeyValueRemover : public DominatorTree::BottomUpVisitor {
       context_->GetDiagnostics()->Note(
           DiagMessage(parent_value->value->GetSource()) << "dominated here");
     }
+    if (out_removed_values_ != nullptr) {
+      out_removed_values_->push_back(std::move(node_value->value));
+    }
     node_value->value = {};
   }
 
  private:
   DISALLOW_COPY_AND_ASSIGN(DominatedKeyValueRemover);
 
+  bool IsCompatibleWith(const ResourceConfigValue& a, const ResourceConfigValue& b) {
+    if (relations_ != nullptr) {
+      return relations_->IsCompatibleWith(a.config_id, b.config_id);
+    }
+    return a.config.IsCompatibleWith(b.config);
+  }
+
   IAaptContext* context_;
   ResourceEntry* entry_;
+  ConfigRelations* relations_;
+  std::vector<std::unique_ptr<Value>>* out_removed_values_;
 };
 
-static void DedupeEntry(IAaptContext* context, ResourceEntry* entry) {
-  DominatorTree tree(entry->values);
-  DominatedKeyValueRemover remover(context, entry);
+}  // namespace
+
+void ResourceDeduper::DedupeEntry(IAaptContext* context, ResourceEntry* entry,
+                                  ConfigRelations* relations,
+                                  std::vector<std::unique_ptr<Value>>* out_removed_values) {
+  DominatorTree tree(entry->values, relations);
+  DominatedKeyValueRemover remover(context, entry, relations, out_removed_values);
   tree.Accept(&remover);
 
   // Erase the values that were removed.
@@ -105,13 +125,12 @@ static void DedupeEntry(IAaptContext* context, ResourceEntry* entry) {
       entry->values.end());
 }
 
-}  // namespace
-
 bool ResourceDeduper::Consume(IAaptContext* context, ResourceTable* table) {
+  ConfigRelations relations;
   for (auto& package : table->packages) {
     for (auto& type : package->types) {
       for (auto& entry : type->entries) {
-        DedupeEntry(context, entry.get());
+        DedupeEntry(context, entry.get(), &relations);
       }
     }
   }
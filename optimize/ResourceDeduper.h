@@ -17,13 +17,19 @@
 #ifndef AAPT_OPTIMIZE_RESOURCEDEDUPER_H
 #define AAPT_OPTIMIZE_RESOURCEDEDUPER_H
 
+#include <memory>
+#include <vector>
+
 #include "android-base/macros.h"
 
 #include "process/IResourceTableConsumer.h"
 
 namespace aapt {
 
+class ConfigRelations;
+class ResourceEntry;
 class ResourceTable;
+class Value;
 
 // Removes duplicated key-value entries from dominated resources.
 class ResourceDeduper : public IResourceTableConsumer {
@@ -32,6 +38,15 @@ class ResourceDeduper : public IResourceTableConsumer {
 
   bool Consume(IAaptContext* context, ResourceTable* table) override;
 
+  // Dedupes the values of a single entry. Only touches `entry`, so different entries can be
+  // deduped concurrently, as long as each thread has its own `context`. If set, `relations` is
+  // used to relate the configurations of the values, and may be shared by the threads. Destroying
+  // a value releases its string pool references, which is not thread-safe, so concurrent callers
+  // pass `out_removed_values` to receive the removed values and destroy them on a single thread.
+  static void DedupeEntry(IAaptContext* context, ResourceEntry* entry,
+                          ConfigRelations* relations = nullptr,
+                          std::vector<std::unique_ptr<Value>>* out_removed_values = nullptr);
+
  private:
   DISALLOW_COPY_AND_ASSIGN(ResourceDeduper);
 };
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "optimize/TableOptimizer.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "ConfigInterner.h"
+#include "ResourceTable.h"
+#include "optimize/ResourceDeduper.h"
+#include "optimize/VersionCollapser.h"
+#include "process/WorkerContext.h"
+#include "split/TableSplitter.h"
+#include "util/ThreadPool.h"
+
+namespace aapt {
+
+namespace {
+
+// Entries are handed to the worker threads in batches, so that the cost of scheduling a task
+// is small compared to the work done on its entries.
+constexpr size_t kEntriesPerTask = 256u;
+
+struct EntryWork {
+  ResourceTablePackage* package;
+  ResourceTableType* type;
+  ResourceEntry* entry;
+  TableSplitter::EntrySelection selection;
+};
+
+}  // namespace
+
+bool TableOptimizer::Consume(IAaptContext* context, ResourceTable* table) {
+  std::vector<EntryWork> work;
+  for (auto& package : table->packages) {
+    for (auto& type : package->types) {
+      for (auto& entry : type->entries) {
+        work.push_back(EntryWork{package.get(), type.get(), entry.get(), {}});
+      }
+    }
+  }
+
+  const int min_sdk = context->GetMinSdkVersion();
+  const size_t task_count = (work.size() + kEntriesPerTask - 1) / kEntriesPerTask;
+  std::vector<std::unique_ptr<WorkerContext>> task_contexts;
+  for (size_t i = 0; i < task_count; i++) {
+    task_contexts.push_back(util::make_unique<WorkerContext>(context));
+  }
+
+  // The configurations of the values are related over and over while deduping, so their relations
+  // are memoized once for all the threads.
+  std::unique_ptr<ConfigRelations> relations;
+  if (options_.dedupe) {
+    relations = util::make_unique<ConfigRelations>();
+  }
+
+  // Destroying a value releases its references into the table's StringPool, whose reference
+  // counts are not thread-safe. The workers only detach the values they remove, and the values are
+  // destroyed on this thread once the workers are done.
+  std::vector<std::vector<std::unique_ptr<Value>>> removed_values(task_count);
+
+  ThreadPool thread_pool(options_.max_threads);
+  thread_pool.ForEach(task_count, [&](size_t task) {
+    WorkerContext* task_context = task_contexts[task].get();
+    std::vector<std::unique_ptr<Value>>* task_removed_values = &removed_values[task];
+    const size_t end = std::min(work.size(), (task + 1) * kEntriesPerTask);
+    for (size_t i = task * kEntriesPerTask; i < end; i++) {
+      EntryWork& entry_work = work[i];
+      if (options_.collapse_versions) {
+        VersionCollapser::CollapseEntry(min_sdk, entry_work.entry, task_removed_values);
+      }
+
+      if (options_.dedupe) {
+        ResourceDeduper::DedupeEntry(task_context, entry_work.entry, relations.get(),
+                                     task_removed_values);
+      }
+
+      if (options_.splitter != nullptr) {
+        options_.splitter->SelectEntryValues(*entry_work.type, entry_work.entry,
+                                             &entry_work.selection);
+      }
+    }
+  });
+
+  removed_values.clear();
+  for (std::unique_ptr<WorkerContext>& task_context : task_contexts) {
+    task_context->GetDiagnostics()->ReplayTo(context->GetDiagnostics());
+  }
+
+  if (options_.splitter != nullptr) {
+    // The split tables are shared by all entries, so the selections are applied on this thread,
+    // in table order.
+    auto work_iter = work.begin();
+    for (auto& package : table->packages) {
+      options_.splitter->CreateSplitPackages(*package);
+      for (; work_iter != work.end() && work_iter->package == package.get(); ++work_iter) {
+        options_.splitter->ApplyEntrySelection(*package, *work_iter->type, work_iter->entry,
+                                               work_iter->selection);
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace aapt
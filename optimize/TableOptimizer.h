@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AAPT_OPTIMIZE_TABLEOPTIMIZER_H
+#define AAPT_OPTIMIZE_TABLEOPTIMIZER_H
+
+#include <cstddef>
+
+#include "android-base/macros.h"
+
+#include "process/IResourceTableConsumer.h"
+
+namespace aapt {
+
+class ResourceTable;
+class TableSplitter;
+
+struct TableOptimizerOptions {
+  // Collapses the versions of each entry, as VersionCollapser does.
+  bool collapse_versions = true;
+
+  // Removes dominated duplicate values, as ResourceDeduper does.
+  bool dedupe = true;
+
+  // When set, moves the values of each entry into the splits of this TableSplitter, as
+  // TableSplitter::SplitTable() does. The split constraints must already be verified.
+  TableSplitter* splitter = nullptr;
+
+  // The maximum number of threads to use. 0 uses the number of hardware threads.
+  size_t max_threads = 0u;
+};
+
+// Runs VersionCollapser, ResourceDeduper and TableSplitter in a single pass over the table.
+// Each entry is collapsed, deduped and has its split values selected in turn, with entries
+// processed in parallel. The result is the same as running the three one after another.
+class TableOptimizer : public IResourceTableConsumer {
+ public:
+  explicit TableOptimizer(const TableOptimizerOptions& options) : options_(options) {
+  }
+
+  bool Consume(IAaptContext* context, ResourceTable* table) override;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(TableOptimizer);
+
+  TableOptimizerOptions options_;
+};
+
+}  // namespace aapt
+
+#endif  // AAPT_OPTIMIZE_TABLEOPTIMIZER_H
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "optimize/TableOptimizer.h"
+
+#include "android-base/stringprintf.h"
+
+#include "filter/ConfigFilter.h"
+#include "optimize/ResourceDeduper.h"
+#include "optimize/VersionCollapser.h"
+#include "split/TableSplitter.h"
+#include "test/Test.h"
+
+using ::aapt::test::HasValue;
+using ::android::base::StringPrintf;
+using ::testing::Eq;
+using ::testing::Not;
+
+namespace aapt {
+
+// Enough entries to be spread over several worker tasks.
+constexpr size_t kEntryCount = 1000u;
+
+static std::unique_ptr<ResourceTable> BuildTable() {
+  test::ResourceTableBuilder builder;
+  for (size_t i = 0; i < kEntryCount; i++) {
+    const std::string name = StringPrintf("android:string/foo_%zu", i);
+    builder.AddString(name, {}, test::ParseConfigOrDie("v4"), "old")
+        .AddString(name, {}, test::ParseConfigOrDie("v14"), "value")
+        .AddString(name, {}, test::ParseConfigOrDie("land"), "value")
+        .AddString(name, {}, test::ParseConfigOrDie("fr"), "valeur")
+        .AddString(name, {}, test::ParseConfigOrDie("de-v21"), "Wert");
+  }
+  return builder.Build();
+}
+
+static std::vector<SplitConstraints> BuildSplitConstraints() {
+  std::vector<SplitConstraints> constraints;
+  constraints.push_back(SplitConstraints{{test::ParseConfigOrDie("fr")}});
+  constraints.push_back(SplitConstraints{{test::ParseConfigOrDie("de")}});
+  return constraints;
+}
+
+TEST(TableOptimizerTest, SameResultAsSeparatePasses) {
+  std::unique_ptr<IAaptContext> context = test::ContextBuilder().SetMinSdkVersion(21).Build();
+
+  std::unique_ptr<ResourceTable> expected_table = BuildTable();
+  ASSERT_TRUE(VersionCollapser().Consume(context.get(), expected_table.get()));
+  ASSERT_TRUE(ResourceDeduper().Consume(context.get(), expected_table.get()));
+  TableSplitter expected_splitter(BuildSplitConstraints(), TableSplitterOptions{});
+  expected_splitter.SplitTable(expected_table.get());
+
+  std::unique_ptr<ResourceTable> table = BuildTable();
+  TableSplitter splitter(BuildSplitConstraints(), TableSplitterOptions{});
+  TableOptimizerOptions options;
+  options.splitter = &splitter;
+  options.max_threads = 4u;
+  ASSERT_TRUE(TableOptimizer(options).Consume(context.get(), table.get()));
+
+  ResourceTable* split_fr = splitter.splits()[0].get();
+  ResourceTable* split_de = splitter.splits()[1].get();
+  for (size_t i = 0; i < kEntryCount; i++) {
+    const std::string name = StringPrintf("android:string/foo_%zu", i);
+
+    // v4 is collapsed away and v14 becomes the default.
+    EXPECT_THAT(table, HasValue(name, ConfigDescription::DefaultConfig()));
+    EXPECT_THAT(table, Not(HasValue(name, test::ParseConfigOrDie("v4"))));
+    EXPECT_THAT(table, Not(HasValue(name, test::ParseConfigOrDie("fr"))));
+    EXPECT_THAT(table, Not(HasValue(name, test::ParseConfigOrDie("de"))));
+
+    String* fr = test::GetValueForConfig<String>(split_fr, name, test::ParseConfigOrDie("fr"));
+    ASSERT_NE(nullptr, fr);
+    EXPECT_EQ(std::string("valeur"), *fr->value);
+
+    String* de = test::GetValueForConfig<String>(split_de, name, test::ParseConfigOrDie("de"));
+    ASSERT_NE(nullptr, de);
+    EXPECT_EQ(std::string("Wert"), *de->value);
+
+    Maybe<ResourceTable::SearchResult> expected =
+        expected_table->FindResource(test::ParseNameOrDie(name));
+    Maybe<ResourceTable::SearchResult> actual = table->FindResource(test::ParseNameOrDie(name));
+    ASSERT_TRUE(expected);
+    ASSERT_TRUE(actual);
+    ASSERT_EQ(expected.value().entry->values.size(), actual.value().entry->values.size());
+    for (size_t j = 0; j < actual.value().entry->values.size(); j++) {
+      EXPECT_EQ(expected.value().entry->values[j]->config,
+                actual.value().entry->values[j]->config);
+    }
+  }
+}
+
+TEST(TableOptimizerTest, ReleaseSharedStringReferencesExactlyOnce) {
+  std::unique_ptr<IAaptContext> context = test::ContextBuilder().SetMinSdkVersion(21).Build();
+
+  // Every value refers to the same pool string, so the workers that collapse, dedupe and filter
+  // values of different entries all release references to the same string.
+  test::ResourceTableBuilder builder;
+  for (size_t i = 0; i < kEntryCount; i++) {
+    const std::string name = StringPrintf("android:string/foo_%zu", i);
+    builder.AddString(name, {}, test::ParseConfigOrDie("v4"), "shared")
+        .AddString(name, {}, test::ParseConfigOrDie("v14"), "shared")
+        .AddString(name, {}, test::ParseConfigOrDie("land"), "shared")
+        .AddString(name, {}, test::ParseConfigOrDie("port"), "shared")
+        .AddString(name, {}, test::ParseConfigOrDie("fr"), "shared");
+  }
+  std::unique_ptr<ResourceTable> table = builder.Build();
+  ASSERT_THAT(table->string_pool.size(), Eq(1u));
+
+  AxisConfigFilter filter;
+  filter.AddConfig(test::ParseConfigOrDie("land"));
+  TableSplitterOptions splitter_options;
+  splitter_options.config_filter = &filter;
+  TableSplitter splitter(BuildSplitConstraints(), splitter_options);
+
+  TableOptimizerOptions options;
+  options.splitter = &splitter;
+  options.max_threads = 4u;
+  ASSERT_TRUE(TableOptimizer(options).Consume(context.get(), table.get()));
+
+  // The values left in the table still hold the string.
+  table->string_pool.Prune();
+  EXPECT_THAT(table->string_pool.size(), Eq(1u));
+
+  // Once they are gone, nothing does.
+  table->packages.clear();
+  table->string_pool.Prune();
+  EXPECT_THAT(table->string_pool.size(), Eq(0u));
+}
+
+}  // namespace aapt
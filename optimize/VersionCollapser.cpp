@@ -69,7 +69,8 @@ FilterIterator<Iterator, Pred> make_filter_iterator(Iterator begin,
  * next smallest
  * one will be kept.
  */
-static void CollapseVersions(int min_sdk, ResourceEntry* entry) {
+void VersionCollapser::CollapseEntry(int min_sdk, ResourceEntry* entry,
+                                     std::vector<std::unique_ptr<Value>>* out_removed_values) {
   // First look for all sdks less than minSdk.
   for (auto iter = entry->values.rbegin(); iter != entry->values.rend();
        ++iter) {
@@ -103,7 +104,11 @@ static void CollapseVersions(int min_sdk, ResourceEntry* entry) {
       auto filter_iter =
           make_filter_iterator(iter + 1, entry->values.rend(), pred);
       while (filter_iter.HasNext()) {
-        filter_iter.Next() = {};
+        std::unique_ptr<ResourceConfigValue>& removed = filter_iter.Next();
+        if (out_removed_values != nullptr) {
+          out_removed_values->push_back(std::move(removed->value));
+        }
+        removed = {};
       }
     }
   }
@@ -152,7 +157,7 @@ bool VersionCollapser::Consume(IAaptContext* context, ResourceTable* table) {
   for (auto& package : table->packages) {
     for (auto& type : package->types) {
       for (auto& entry : type->entries) {
-        CollapseVersions(min_sdk, entry.get());
+        CollapseEntry(min_sdk, entry.get());
       }
     }
   }
@@ -17,13 +17,18 @@
 #ifndef AAPT_OPTIMIZE_VERSIONCOLLAPSER_H
 #define AAPT_OPTIMIZE_VERSIONCOLLAPSER_H
 
+#include <memory>
+#include <vector>
+
 #include "android-base/macros.h"
 
 #include "process/IResourceTableConsumer.h"
 
 namespace aapt {
 
+class ResourceEntry;
 class ResourceTable;
+class Value;
 
 class VersionCollapser : public IResourceTableConsumer {
  public:
@@ -31,6 +36,13 @@ class VersionCollapser : public IResourceTableConsumer {
 
   bool Consume(IAaptContext* context, ResourceTable* table) override;
 
+  // Collapses the versions of a single entry. Only touches `entry`, so different entries can be
+  // collapsed concurrently. Destroying a value releases its string pool references, which is not
+  // thread-safe, so concurrent callers pass `out_removed_values` to receive the removed values
+  // and destroy them later on a single thread.
+  static void CollapseEntry(int min_sdk, ResourceEntry* entry,
+                            std::vector<std::unique_ptr<Value>>* out_removed_values = nullptr);
+
  private:
   DISALLOW_COPY_AND_ASSIGN(VersionCollapser);
 };
@@ -28,6 +28,7 @@
 #include "Resource.h"
 #include "ResourceUtils.h"
 #include "ValueVisitor.h"
+#include "proto/LazyPbTable.h"
 #include "util/Util.h"
 
 using android::StringPiece;
@@ -175,19 +176,8 @@ std::unique_ptr<SymbolTable::Symbol> DefaultSymbolTableDelegate::FindById(
   return {};
 }
 
-std::unique_ptr<SymbolTable::Symbol> ResourceTableSymbolSource::FindByName(
-    const ResourceName& name) {
-  Maybe<ResourceTable::SearchResult> result = table_->FindResource(name);
-  if (!result) {
-    if (name.type == ResourceType::kAttr) {
-      // Recurse and try looking up a private attribute.
-      return FindByName(ResourceName(name.package, ResourceType::kAttrPrivate, name.entry));
-    }
-    return {};
-  }
-
-  ResourceTable::SearchResult sr = result.value();
-
+static std::unique_ptr<SymbolTable::Symbol> SymbolFromSearchResult(
+    const ResourceName& name, const ResourceTable::SearchResult& sr) {
   std::unique_ptr<SymbolTable::Symbol> symbol = util::make_unique<SymbolTable::Symbol>();
   symbol->is_public = (sr.entry->symbol_status.state == SymbolState::kPublic);
 
@@ -210,6 +200,74 @@ std::unique_ptr<SymbolTable::Symbol> ResourceTableSymbolSource::FindByName(
   return symbol;
 }
 
+std::unique_ptr<SymbolTable::Symbol> ResourceTableSymbolSource::FindByName(
+    const ResourceName& name) {
+  Maybe<ResourceTable::SearchResult> result = table_->FindResource(name);
+  if (!result) {
+    if (name.type == ResourceType::kAttr) {
+      // Recurse and try looking up a private attribute.
+      return FindByName(ResourceName(name.package, ResourceType::kAttrPrivate, name.entry));
+    }
+    return {};
+  }
+  return SymbolFromSearchResult(name, result.value());
+}
+
+std::unique_ptr<SymbolTable::Symbol> LazyPbTableSymbolSource::FindByName(
+    const ResourceName& name) {
+  Maybe<LazyPbTable::IndexSearchResult> index_result = table_->FindEntry(name);
+  if (!index_result) {
+    if (name.type == ResourceType::kAttr) {
+      // Recurse and try looking up a private attribute.
+      return FindByName(ResourceName(name.package, ResourceType::kAttrPrivate, name.entry));
+    }
+    return {};
+  }
+
+  if (name.type == ResourceType::kAttr || name.type == ResourceType::kAttrPrivate) {
+    // The Attribute definition is needed, so decode the type.
+    Maybe<ResourceTable::SearchResult> result = table_->FindResource(name);
+    if (!result) {
+      return {};
+    }
+    return SymbolFromSearchResult(name, result.value());
+  }
+
+  const LazyPbTable::IndexSearchResult& sr = index_result.value();
+  std::unique_ptr<SymbolTable::Symbol> symbol = util::make_unique<SymbolTable::Symbol>();
+  symbol->is_public = (sr.entry->visibility == SymbolState::kPublic);
+
+  // IDs are only kept for public resources, as when the table is fully deserialized.
+  if (symbol->is_public && sr.package->id && sr.type->id && sr.entry->id) {
+    symbol->id = ResourceId(sr.package->id.value(), sr.type->id.value(), sr.entry->id.value());
+  }
+  return symbol;
+}
+
+static std::unique_ptr<SymbolTable::Symbol> CopySymbol(const SymbolTable::Symbol* symbol) {
+  if (symbol == nullptr) {
+    return {};
+  }
+  return util::make_unique<SymbolTable::Symbol>(*symbol);
+}
+
+std::unique_ptr<SymbolTable::Symbol> SharedSymbolTableSource::FindByName(
+    const ResourceName& name) {
+  std::lock_guard<std::mutex> guard(*lock_);
+  return CopySymbol(table_->FindByName(name));
+}
+
+std::unique_ptr<SymbolTable::Symbol> SharedSymbolTableSource::FindById(ResourceId id) {
+  std::lock_guard<std::mutex> guard(*lock_);
+  return CopySymbol(table_->FindById(id));
+}
+
+std::unique_ptr<SymbolTable::Symbol> SharedSymbolTableSource::FindByReference(
+    const Reference& ref) {
+  std::lock_guard<std::mutex> guard(*lock_);
+  return CopySymbol(table_->FindByReference(ref));
+}
+
 bool AssetManagerSymbolSource::AddAssetPath(const StringPiece& path) {
   int32_t cookie = 0;
   return assets_.addAssetPath(android::String8(path.data(), path.size()), &cookie);
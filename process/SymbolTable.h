@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include "android-base/macros.h"
@@ -48,6 +49,7 @@ inline android::hash_t hash_type(const ResourceId& id) {
 
 class ISymbolSource;
 class ISymbolTableDelegate;
+class LazyPbTable;
 class NameMangler;
 
 class SymbolTable {
@@ -186,6 +188,48 @@ class ResourceTableSymbolSource : public ISymbolSource {
   DISALLOW_COPY_AND_ASSIGN(ResourceTableSymbolSource);
 };
 
+// Exposes the resources in a static library's LazyPbTable as symbols for SymbolTable.
+// Only attribute lookups decode values; everything else is answered from the entry index.
+// Instances of this class must outlive the encompassed LazyPbTable.
+// Lookups by ID are ignored.
+class LazyPbTableSymbolSource : public ISymbolSource {
+ public:
+  explicit LazyPbTableSymbolSource(LazyPbTable* table) : table_(table) {}
+
+  std::unique_ptr<SymbolTable::Symbol> FindByName(
+      const ResourceName& name) override;
+
+  std::unique_ptr<SymbolTable::Symbol> FindById(ResourceId id) override {
+    return {};
+  }
+
+ private:
+  LazyPbTable* table_;
+
+  DISALLOW_COPY_AND_ASSIGN(LazyPbTableSymbolSource);
+};
+
+// Exposes a SymbolTable that is shared between threads as a symbol source. Every lookup on the
+// shared table happens while holding `lock`, and the result is copied out so that it stays valid
+// after the shared table's cache evicts it. Give each thread its own SymbolTable wrapping this
+// source so that the caches don't race.
+class SharedSymbolTableSource : public ISymbolSource {
+ public:
+  SharedSymbolTableSource(SymbolTable* table, std::mutex* lock) : table_(table), lock_(lock) {}
+
+  std::unique_ptr<SymbolTable::Symbol> FindByName(
+      const ResourceName& name) override;
+  std::unique_ptr<SymbolTable::Symbol> FindById(ResourceId id) override;
+  std::unique_ptr<SymbolTable::Symbol> FindByReference(
+      const Reference& ref) override;
+
+ private:
+  SymbolTable* table_;
+  std::mutex* lock_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedSymbolTableSource);
+};
+
 class AssetManagerSymbolSource : public ISymbolSource {
  public:
   AssetManagerSymbolSource() = default;
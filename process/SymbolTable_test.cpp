@@ -68,4 +68,27 @@ TEST(SymbolTableTest, FindByName) {
   EXPECT_NE(nullptr, symbol_table.FindByName(test::ParseNameOrDie("com.android.lib:id/foo")));
 }
 
+TEST(SharedSymbolTableSourceTest, ForwardsToSharedTableWithMangling) {
+  std::unique_ptr<ResourceTable> table =
+      test::ResourceTableBuilder()
+          .AddSimple("com.android.app:id/" + NameMangler::MangleEntry("com.android.lib", "foo"),
+                     ResourceId(0x7f020000))
+          .Build();
+
+  NameMangler mangler(NameManglerPolicy{"com.android.app", {"com.android.lib"}});
+  SymbolTable shared_table(&mangler);
+  shared_table.AppendSource(util::make_unique<ResourceTableSymbolSource>(table.get()));
+
+  std::mutex lock;
+  NameMangler worker_mangler(NameManglerPolicy{"com.android.app"});
+  SymbolTable worker_table(&worker_mangler);
+  worker_table.AppendSource(util::make_unique<SharedSymbolTableSource>(&shared_table, &lock));
+
+  const SymbolTable::Symbol* s =
+      worker_table.FindByName(test::ParseNameOrDie("com.android.lib:id/foo"));
+  ASSERT_NE(nullptr, s);
+  EXPECT_FALSE(s->is_public);
+  EXPECT_EQ(nullptr, worker_table.FindByName(test::ParseNameOrDie("com.android.lib:id/bar")));
+}
+
 }  // namespace aapt
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AAPT_PROCESS_WORKERCONTEXT_H
+#define AAPT_PROCESS_WORKERCONTEXT_H
+
+#include "android-base/macros.h"
+
+#include "Diagnostics.h"
+#include "process/IResourceTableConsumer.h"
+
+namespace aapt {
+
+// A context for work running on a worker thread. Everything is forwarded to the parent context,
+// except diagnostics, which are buffered so that the parent can replay them in a deterministic
+// order once the work is done.
+//
+// The parent's SymbolTable is not thread-safe. Work that looks up symbols must override
+// GetExternalSymbols().
+class WorkerContext : public IAaptContext {
+ public:
+  explicit WorkerContext(IAaptContext* parent) : parent_(parent) {
+  }
+
+  PackageType GetPackageType() override {
+    return parent_->GetPackageType();
+  }
+
+  BufferedDiagnostics* GetDiagnostics() override {
+    return &diagnostics_;
+  }
+
+  NameMangler* GetNameMangler() override {
+    return parent_->GetNameMangler();
+  }
+
+  const std::string& GetCompilationPackage() override {
+    return parent_->GetCompilationPackage();
+  }
+
+  uint8_t GetPackageId() override {
+    return parent_->GetPackageId();
+  }
+
+  SymbolTable* GetExternalSymbols() override {
+    return parent_->GetExternalSymbols();
+  }
+
+  bool IsVerbose() override {
+    return parent_->IsVerbose();
+  }
+
+  int GetMinSdkVersion() override {
+    return parent_->GetMinSdkVersion();
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(WorkerContext);
+
+  IAaptContext* parent_;
+  BufferedDiagnostics diagnostics_;
+};
+
+}  // namespace aapt
+
+#endif /* AAPT_PROCESS_WORKERCONTEXT_H */
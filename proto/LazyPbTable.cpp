@@ -0,0 +1,461 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "proto/LazyPbTable.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "android-base/logging.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/wire_format_lite.h"
+
+#include "proto/ProtoHelpers.h"
+#include "proto/ProtoSerialize.h"
+
+using ::android::StringPiece;
+using ::google::protobuf::io::CodedInputStream;
+using ::google::protobuf::internal::WireFormatLite;
+
+namespace aapt {
+
+namespace {
+
+// Reads the headers of a serialized pb::ResourceTable without materializing any messages.
+// Field numbers mirror the definitions in Resources.proto.
+class PbTableScanner {
+ public:
+  PbTableScanner(const uint8_t* data, size_t size) : data_(data), in_(data, size) {
+    in_.SetTotalBytesLimit(std::numeric_limits<int>::max(), -1);
+  }
+
+  bool ScanTable(StringPiece* out_source_pool, std::vector<LazyPbTable::PackageIndex>* out_pkgs) {
+    while (uint32_t tag = in_.ReadTag()) {
+      switch (Field(tag)) {
+        case pb::ResourceTable::kSourcePoolFieldNumber: {
+          CodedInputStream::Limit limit;
+          if (!PushMessage(tag, &limit)) {
+            return false;
+          }
+          bool result = ScanStringPool(out_source_pool);
+          in_.PopLimit(limit);
+          if (!result) {
+            return false;
+          }
+        } break;
+
+        case pb::ResourceTable::kPackageFieldNumber: {
+          CodedInputStream::Limit limit;
+          if (!PushMessage(tag, &limit)) {
+            return false;
+          }
+          out_pkgs->push_back({});
+          bool result = ScanPackage(&out_pkgs->back());
+          in_.PopLimit(limit);
+          if (!result) {
+            return false;
+          }
+        } break;
+
+        default:
+          if (!WireFormatLite::SkipField(&in_, tag)) {
+            return false;
+          }
+          break;
+      }
+    }
+    return in_.ConsumedEntireMessage();
+  }
+
+  // Describes why scanning failed, if the data was well formed but not a valid table.
+  const std::string& error() const {
+    return error_;
+  }
+
+ private:
+  static int Field(uint32_t tag) {
+    return WireFormatLite::GetTagFieldNumber(tag);
+  }
+
+  bool PushMessage(uint32_t tag, CodedInputStream::Limit* out_limit) {
+    if (WireFormatLite::GetTagWireType(tag) != WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+      return false;
+    }
+
+    uint32_t len = 0u;
+    if (!in_.ReadVarint32(&len)) {
+      return false;
+    }
+    *out_limit = in_.PushLimit(static_cast<int>(len));
+    return in_.BytesUntilLimit() == static_cast<int>(len);
+  }
+
+  bool ReadUint32(uint32_t tag, uint32_t* out_value) {
+    return WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_VARINT &&
+           in_.ReadVarint32(out_value);
+  }
+
+  bool ReadString(uint32_t tag, std::string* out_str) {
+    return WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_LENGTH_DELIMITED &&
+           WireFormatLite::ReadString(&in_, out_str);
+  }
+
+  bool ScanStringPool(StringPiece* out_data) {
+    while (uint32_t tag = in_.ReadTag()) {
+      if (Field(tag) == pb::StringPool::kDataFieldNumber) {
+        CodedInputStream::Limit limit;
+        if (!PushMessage(tag, &limit)) {
+          return false;
+        }
+
+        // Reference the bytes in place, the backing data outlives the pool.
+        const int len = in_.BytesUntilLimit();
+        *out_data = StringPiece(reinterpret_cast<const char*>(data_) + in_.CurrentPosition(),
+                                static_cast<size_t>(len));
+        in_.Skip(len);
+        in_.PopLimit(limit);
+      } else if (!WireFormatLite::SkipField(&in_, tag)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool ScanPackage(LazyPbTable::PackageIndex* out_pkg) {
+    while (uint32_t tag = in_.ReadTag()) {
+      switch (Field(tag)) {
+        case pb::Package::kPackageIdFieldNumber: {
+          uint32_t id = 0u;
+          if (!ReadUint32(tag, &id)) {
+            return false;
+          }
+          out_pkg->id = static_cast<uint8_t>(id);
+        } break;
+
+        case pb::Package::kPackageNameFieldNumber:
+          if (!ReadString(tag, &out_pkg->name)) {
+            return false;
+          }
+          break;
+
+        case pb::Package::kTypeFieldNumber: {
+          CodedInputStream::Limit limit;
+          if (!PushMessage(tag, &limit)) {
+            return false;
+          }
+          const int start = in_.CurrentPosition();
+          const int len = in_.BytesUntilLimit();
+          out_pkg->types.push_back({});
+          LazyPbTable::TypeIndex* type = &out_pkg->types.back();
+          type->data = data_ + start;
+          type->size = static_cast<size_t>(len);
+          bool result = ScanType(type);
+          in_.PopLimit(limit);
+          if (!result) {
+            return false;
+          }
+        } break;
+
+        default:
+          if (!WireFormatLite::SkipField(&in_, tag)) {
+            return false;
+          }
+          break;
+      }
+    }
+    return true;
+  }
+
+  bool ScanType(LazyPbTable::TypeIndex* out_type) {
+    std::string type_name;
+    while (uint32_t tag = in_.ReadTag()) {
+      switch (Field(tag)) {
+        case pb::Type::kIdFieldNumber: {
+          uint32_t id = 0u;
+          if (!ReadUint32(tag, &id)) {
+            return false;
+          }
+          out_type->id = static_cast<uint8_t>(id);
+        } break;
+
+        case pb::Type::kNameFieldNumber:
+          if (!ReadString(tag, &type_name)) {
+            return false;
+          }
+          break;
+
+        case pb::Type::kEntryFieldNumber: {
+          CodedInputStream::Limit limit;
+          if (!PushMessage(tag, &limit)) {
+            return false;
+          }
+          out_type->entries.push_back({});
+          bool result = ScanEntry(&out_type->entries.back());
+          in_.PopLimit(limit);
+          if (!result) {
+            return false;
+          }
+        } break;
+
+        default:
+          if (!WireFormatLite::SkipField(&in_, tag)) {
+            return false;
+          }
+          break;
+      }
+    }
+
+    const ResourceType* res_type = ParseResourceType(type_name);
+    if (res_type == nullptr) {
+      error_ = "unknown type '" + type_name + "'";
+      return false;
+    }
+    out_type->type = *res_type;
+
+    std::sort(out_type->entries.begin(), out_type->entries.end(),
+              [](const LazyPbTable::EntryIndex& a, const LazyPbTable::EntryIndex& b) -> bool {
+                return a.name < b.name;
+              });
+    return true;
+  }
+
+  bool ScanEntry(LazyPbTable::EntryIndex* out_entry) {
+    while (uint32_t tag = in_.ReadTag()) {
+      switch (Field(tag)) {
+        case pb::Entry::kIdFieldNumber: {
+          uint32_t id = 0u;
+          if (!ReadUint32(tag, &id)) {
+            return false;
+          }
+          out_entry->id = static_cast<uint16_t>(id);
+        } break;
+
+        case pb::Entry::kNameFieldNumber:
+          if (!ReadString(tag, &out_entry->name)) {
+            return false;
+          }
+          break;
+
+        case pb::Entry::kSymbolStatusFieldNumber: {
+          CodedInputStream::Limit limit;
+          if (!PushMessage(tag, &limit)) {
+            return false;
+          }
+          bool result = ScanSymbolStatus(out_entry);
+          in_.PopLimit(limit);
+          if (!result) {
+            return false;
+          }
+        } break;
+
+        default:
+          // The config values are left encoded.
+          if (!WireFormatLite::SkipField(&in_, tag)) {
+            return false;
+          }
+          break;
+      }
+    }
+    return true;
+  }
+
+  bool ScanSymbolStatus(LazyPbTable::EntryIndex* out_entry) {
+    while (uint32_t tag = in_.ReadTag()) {
+      if (Field(tag) == pb::SymbolStatus::kVisibilityFieldNumber) {
+        uint32_t visibility = 0u;
+        if (!ReadUint32(tag, &visibility)) {
+          return false;
+        }
+        out_entry->visibility =
+            DeserializeVisibilityFromPb(static_cast<pb::SymbolStatus_Visibility>(visibility));
+      } else if (!WireFormatLite::SkipField(&in_, tag)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  const uint8_t* data_;
+  CodedInputStream in_;
+  std::string error_;
+};
+
+}  // namespace
+
+std::unique_ptr<LazyPbTable> LazyPbTable::Create(std::unique_ptr<io::IData> data,
+                                                 const Source& source, IDiagnostics* diag) {
+  std::unique_ptr<LazyPbTable> table(new LazyPbTable(std::move(data), source, diag));
+  if (!table->Index()) {
+    return {};
+  }
+  return table;
+}
+
+LazyPbTable::LazyPbTable(std::unique_ptr<io::IData> data, const Source& source,
+                         IDiagnostics* diag)
+    : data_(std::move(data)), source_(source), diag_(diag) {
+}
+
+bool LazyPbTable::Index() {
+  // We import the android namespace because on Windows NO_ERROR is a macro, not an enum, which
+  // causes errors when qualifying it with android::
+  using namespace android;
+
+  StringPiece source_pool_data;
+  PbTableScanner scanner(static_cast<const uint8_t*>(data_->data()), data_->size());
+  if (!scanner.ScanTable(&source_pool_data, &packages_)) {
+    if (!scanner.error().empty()) {
+      diag_->Error(DiagMessage(source_) << scanner.error());
+    } else {
+      diag_->Error(DiagMessage(source_) << "invalid compiled table");
+    }
+    return false;
+  }
+
+  if (!source_pool_data.empty()) {
+    if (source_pool_.setTo(source_pool_data.data(), source_pool_data.size()) != NO_ERROR) {
+      diag_->Error(DiagMessage(source_) << "invalid source pool");
+      return false;
+    }
+  }
+  return true;
+}
+
+const LazyPbTable::PackageIndex* LazyPbTable::FindPackageById(uint8_t id) const {
+  for (const PackageIndex& package : packages_) {
+    if (package.id && package.id.value() == id) {
+      return &package;
+    }
+  }
+  return nullptr;
+}
+
+bool LazyPbTable::RenamePackage(uint8_t id, const StringPiece& name) {
+  for (PackageIndex& package : packages_) {
+    if (package.id && package.id.value() == id) {
+      CHECK(id_indices_.find(&package) == id_indices_.end()) << "package already loaded";
+      package.name = name.to_string();
+      return true;
+    }
+  }
+  return false;
+}
+
+Maybe<LazyPbTable::IndexSearchResult> LazyPbTable::FindEntry(const ResourceNameRef& name) const {
+  for (const PackageIndex& package : packages_) {
+    if (package.name != name.package) {
+      continue;
+    }
+
+    for (const TypeIndex& type : package.types) {
+      if (type.type != name.type) {
+        continue;
+      }
+
+      auto iter = std::lower_bound(type.entries.begin(), type.entries.end(), name.entry,
+                                   [](const EntryIndex& a, const StringPiece& b) -> bool {
+                                     return a.name < b;
+                                   });
+      if (iter != type.entries.end() && iter->name == name.entry) {
+        return IndexSearchResult{&package, &type, &*iter};
+      }
+    }
+  }
+  return {};
+}
+
+const std::map<ResourceId, ResourceNameRef>& LazyPbTable::GetIdIndex(
+    const PackageIndex& package) {
+  auto iter = id_indices_.find(&package);
+  if (iter != id_indices_.end()) {
+    return iter->second;
+  }
+
+  std::map<ResourceId, ResourceNameRef>& id_index = id_indices_[&package];
+  const uint8_t package_id = package.id.value_or_default(0u);
+  for (const TypeIndex& type : package.types) {
+    for (const EntryIndex& entry : type.entries) {
+      ResourceId resid(package_id, type.id.value_or_default(0u), entry.id.value_or_default(0u));
+      if (resid.is_valid()) {
+        id_index[resid] = ResourceNameRef(package.name, type.type, entry.name);
+      }
+    }
+  }
+  return id_index;
+}
+
+ResourceTableType* LazyPbTable::LoadType(const PackageIndex& package, const TypeIndex& type,
+                                         ResourceTable* out_table) {
+  ResourceTablePackage* pkg = out_table->CreatePackage(package.name, package.id);
+  if (pkg == nullptr) {
+    diag_->Error(DiagMessage(source_) << "conflicting ID for package '" << package.name << "'");
+    return {};
+  }
+
+  google::protobuf::Arena arena(MakeArenaOptions(type.size));
+  pb::Type* pb_type = google::protobuf::Arena::CreateMessage<pb::Type>(&arena);
+  if (!pb_type->ParseFromArray(type.data, static_cast<int>(type.size))) {
+    diag_->Error(DiagMessage(source_) << "invalid compiled table");
+    return {};
+  }
+
+  return DeserializeTypeFromPb(*pb_type, package.id.value_or_default(0u), source_pool_,
+                               GetIdIndex(package), pkg, &out_table->string_pool, source_, diag_);
+}
+
+Maybe<ResourceTable::SearchResult> LazyPbTable::FindResource(const ResourceNameRef& name) {
+  for (const PackageIndex& package : packages_) {
+    if (package.name != name.package) {
+      continue;
+    }
+
+    for (const TypeIndex& type : package.types) {
+      if (type.type != name.type) {
+        continue;
+      }
+
+      auto iter = loaded_types_.find(&type);
+      if (iter == loaded_types_.end()) {
+        ResourceTableType* loaded_type = LoadType(package, type, &table_);
+        if (loaded_type == nullptr) {
+          return {};
+        }
+        iter = loaded_types_.insert({&type, loaded_type}).first;
+      }
+
+      if (ResourceEntry* entry = iter->second->FindEntry(name.entry)) {
+        return ResourceTable::SearchResult{table_.FindPackage(package.name), iter->second, entry};
+      }
+    }
+  }
+  return {};
+}
+
+std::unique_ptr<ResourceTable> LazyPbTable::LoadAll() {
+  std::unique_ptr<ResourceTable> table = util::make_unique<ResourceTable>();
+  for (const PackageIndex& package : packages_) {
+    // Create the package even if it is empty, matching DeserializeTableFromPb().
+    table->CreatePackage(package.name, package.id);
+    for (const TypeIndex& type : package.types) {
+      if (!LoadType(package, type, table.get())) {
+        return {};
+      }
+    }
+  }
+  return table;
+}
+
+}  // namespace aapt
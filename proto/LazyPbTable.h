@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AAPT_PROTO_LAZYPBTABLE_H
+#define AAPT_PROTO_LAZYPBTABLE_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "android-base/macros.h"
+#include "androidfw/ResourceTypes.h"
+#include "androidfw/StringPiece.h"
+
+#include "Diagnostics.h"
+#include "Resource.h"
+#include "ResourceTable.h"
+#include "Source.h"
+#include "io/Data.h"
+#include "util/Maybe.h"
+
+namespace aapt {
+
+// A resource table backed by a serialized pb::ResourceTable (resources.arsc.flat), as found in
+// static libraries.
+//
+// Creating a LazyPbTable only scans the wire format for package, type and entry headers. The
+// values of a type are decoded the first time that type is loaded, so consumers that only need a
+// few resources, or that merge one type at a time, never hold the whole table in memory.
+class LazyPbTable {
+ public:
+  struct EntryIndex {
+    std::string name;
+    Maybe<uint16_t> id;
+    SymbolState visibility = SymbolState::kUndefined;
+  };
+
+  struct TypeIndex {
+    ResourceType type;
+    Maybe<uint8_t> id;
+
+    // Entries sorted by name.
+    std::vector<EntryIndex> entries;
+
+    // The serialized pb::Type, pointing into the backing data.
+    const uint8_t* data;
+    size_t size;
+  };
+
+  struct PackageIndex {
+    std::string name;
+    Maybe<uint8_t> id;
+    std::vector<TypeIndex> types;
+  };
+
+  // Indexes the serialized pb::ResourceTable held by `data`. Returns nullptr and logs to `diag`
+  // if the data is not a valid table.
+  static std::unique_ptr<LazyPbTable> Create(std::unique_ptr<io::IData> data, const Source& source,
+                                             IDiagnostics* diag);
+
+  const std::vector<PackageIndex>& packages() const {
+    return packages_;
+  }
+
+  struct IndexSearchResult {
+    const PackageIndex* package;
+    const TypeIndex* type;
+    const EntryIndex* entry;
+  };
+
+  const PackageIndex* FindPackageById(uint8_t id) const;
+
+  // Renames the package with ID `id`. Must be called before any type of the package is loaded.
+  bool RenamePackage(uint8_t id, const android::StringPiece& name);
+
+  // Looks up an entry in the index without decoding any values.
+  Maybe<IndexSearchResult> FindEntry(const ResourceNameRef& name) const;
+
+  // Decodes `type` of `package` into `out_table`, creating the package if necessary.
+  // Returns the decoded type, or nullptr if decoding failed.
+  ResourceTableType* LoadType(const PackageIndex& package, const TypeIndex& type,
+                              ResourceTable* out_table);
+
+  // Returns the resource named `name`, decoding its type into the table owned by this
+  // LazyPbTable if that has not happened yet.
+  Maybe<ResourceTable::SearchResult> FindResource(const ResourceNameRef& name);
+
+  // Decodes every type into a new ResourceTable.
+  std::unique_ptr<ResourceTable> LoadAll();
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(LazyPbTable);
+
+  LazyPbTable(std::unique_ptr<io::IData> data, const Source& source, IDiagnostics* diag);
+
+  bool Index();
+
+  const std::map<ResourceId, ResourceNameRef>& GetIdIndex(const PackageIndex& package);
+
+  std::unique_ptr<io::IData> data_;
+  Source source_;
+  IDiagnostics* diag_;
+
+  android::ResStringPool source_pool_;
+  std::vector<PackageIndex> packages_;
+
+  // Maps the resource IDs of a package's entries to their names, built on first use.
+  std::map<const PackageIndex*, std::map<ResourceId, ResourceNameRef>> id_indices_;
+
+  // Holds the types decoded by FindResource().
+  ResourceTable table_;
+  std::map<const TypeIndex*, ResourceTableType*> loaded_types_;
+};
+
+}  // namespace aapt
+
+#endif /* AAPT_PROTO_LAZYPBTABLE_H */
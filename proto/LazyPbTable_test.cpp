@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "proto/LazyPbTable.h"
+
+#include <cstring>
+
+#include "proto/ProtoSerialize.h"
+#include "test/Test.h"
+
+using ::testing::Eq;
+using ::testing::IsNull;
+using ::testing::NotNull;
+using ::testing::SizeIs;
+
+namespace aapt {
+
+static std::unique_ptr<LazyPbTable> SerializeToLazyTable(ResourceTable* table) {
+  std::string data;
+  CHECK(SerializeTableToPb(table)->SerializeToString(&data));
+
+  std::unique_ptr<uint8_t[]> buffer(new uint8_t[data.size()]);
+  memcpy(buffer.get(), data.data(), data.size());
+  return LazyPbTable::Create(util::make_unique<io::MallocData>(std::move(buffer), data.size()),
+                             Source("lib.apk"), test::GetDiagnostics());
+}
+
+TEST(LazyPbTableTest, IndexEntriesWithoutDecodingValues) {
+  std::unique_ptr<ResourceTable> table =
+      test::ResourceTableBuilder()
+          .SetPackageId("com.lib", 0x7f)
+          .AddString("com.lib:string/foo", ResourceId(0x7f020000), "foo")
+          .AddString("com.lib:string/bar", ResourceId(0x7f020001), "bar")
+          .AddSimple("com.lib:id/baz", ResourceId(0x7f030000))
+          .SetSymbolState("com.lib:string/foo", ResourceId(0x7f020000), SymbolState::kPublic)
+          .Build();
+
+  std::unique_ptr<LazyPbTable> lazy_table = SerializeToLazyTable(table.get());
+  ASSERT_THAT(lazy_table, NotNull());
+
+  const LazyPbTable::PackageIndex* pkg = lazy_table->FindPackageById(0x7f);
+  ASSERT_THAT(pkg, NotNull());
+  EXPECT_THAT(pkg->name, Eq("com.lib"));
+  EXPECT_THAT(pkg->types, SizeIs(2u));
+
+  Maybe<LazyPbTable::IndexSearchResult> result =
+      lazy_table->FindEntry(test::ParseNameOrDie("com.lib:string/foo"));
+  ASSERT_TRUE(result);
+  EXPECT_THAT(result.value().entry->visibility, Eq(SymbolState::kPublic));
+  ASSERT_TRUE(result.value().entry->id);
+  EXPECT_THAT(result.value().entry->id.value(), Eq(0x0000u));
+
+  EXPECT_TRUE(lazy_table->FindEntry(test::ParseNameOrDie("com.lib:id/baz")));
+  EXPECT_FALSE(lazy_table->FindEntry(test::ParseNameOrDie("com.lib:string/baz")));
+}
+
+TEST(LazyPbTableTest, LoadTypeOnDemand) {
+  std::unique_ptr<ResourceTable> table =
+      test::ResourceTableBuilder()
+          .SetPackageId("com.lib", 0x7f)
+          .AddString("com.lib:string/foo", ResourceId(0x7f020000), "foo")
+          .AddReference("com.lib:string/bar", ResourceId(0x7f020001), "com.lib:string/foo")
+          .SetSymbolState("com.lib:string/foo", ResourceId(0x7f020000), SymbolState::kPublic)
+          .Build();
+
+  std::unique_ptr<LazyPbTable> lazy_table = SerializeToLazyTable(table.get());
+  ASSERT_THAT(lazy_table, NotNull());
+
+  Maybe<ResourceTable::SearchResult> result =
+      lazy_table->FindResource(test::ParseNameOrDie("com.lib:string/foo"));
+  ASSERT_TRUE(result);
+  ASSERT_THAT(result.value().entry->values, SizeIs(1u));
+
+  String* str = ValueCast<String>(result.value().entry->values[0]->value.get());
+  ASSERT_THAT(str, NotNull());
+  EXPECT_THAT(*str->value, Eq("foo"));
+
+  std::unique_ptr<ResourceTable> loaded_table = lazy_table->LoadAll();
+  ASSERT_THAT(loaded_table, NotNull());
+
+  Reference* ref = test::GetValue<Reference>(loaded_table.get(), "com.lib:string/bar");
+  ASSERT_THAT(ref, NotNull());
+  ASSERT_TRUE(ref->name);
+  EXPECT_THAT(ref->name.value(), Eq(test::ParseNameOrDie("com.lib:string/foo")));
+}
+
+TEST(LazyPbTableTest, RejectInvalidData) {
+  const char kGarbage[] = "\xff\xff\xff\xff";
+  std::unique_ptr<uint8_t[]> buffer(new uint8_t[sizeof(kGarbage)]);
+  memcpy(buffer.get(), kGarbage, sizeof(kGarbage));
+  EXPECT_THAT(LazyPbTable::Create(util::make_unique<io::MallocData>(std::move(buffer),
+                                                                    sizeof(kGarbage)),
+                                  Source("lib.apk"), test::GetDiagnostics()),
+              IsNull());
+}
+
+TEST(LazyPbTableTest, RejectUnknownType) {
+  std::unique_ptr<ResourceTable> table =
+      test::ResourceTableBuilder()
+          .SetPackageId("com.lib", 0x7f)
+          .AddString("com.lib:string/foo", ResourceId(0x7f020000), "foo")
+          .Build();
+
+  std::unique_ptr<pb::ResourceTable> pb_table = SerializeTableToPb(table.get());
+  ASSERT_THAT(pb_table->package_size(), Eq(1));
+  ASSERT_THAT(pb_table->package(0).type_size(), Eq(1));
+  pb_table->mutable_package(0)->mutable_type(0)->set_name("bogus");
+
+  std::string data;
+  ASSERT_TRUE(pb_table->SerializeToString(&data));
+  std::unique_ptr<uint8_t[]> buffer(new uint8_t[data.size()]);
+  memcpy(buffer.get(), data.data(), data.size());
+  EXPECT_THAT(LazyPbTable::Create(util::make_unique<io::MallocData>(std::move(buffer), data.size()),
+                                  Source("lib.apk"), test::GetDiagnostics()),
+              IsNull());
+}
+
+}  // namespace aapt
@@ -16,8 +16,22 @@
 
 #include "proto/ProtoHelpers.h"
 
+#include <algorithm>
+
 namespace aapt {
 
+google::protobuf::ArenaOptions MakeArenaOptions(size_t size_hint) {
+  // Size the first block after the wire format. The in-memory form is larger, so subsequent
+  // blocks double in size up to kMaxBlockSize.
+  constexpr size_t kMinBlockSize = 64u * 1024u;
+  constexpr size_t kMaxBlockSize = 16u * 1024u * 1024u;
+
+  google::protobuf::ArenaOptions options;
+  options.start_block_size = std::min(std::max(size_hint, kMinBlockSize), kMaxBlockSize);
+  options.max_block_size = kMaxBlockSize;
+  return options;
+}
+
 void SerializeStringPoolToPb(const StringPool& pool, pb::StringPool* out_pb_pool) {
   BigBuffer buffer(1024);
   StringPool::FlattenUtf8(&buffer, pool);
@@ -18,6 +18,7 @@
 #define AAPT_PROTO_PROTOHELPERS_H
 
 #include "androidfw/ResourceTypes.h"
+#include "google/protobuf/arena.h"
 
 #include "ConfigDescription.h"
 #include "ResourceTable.h"
@@ -28,6 +29,10 @@
 
 namespace aapt {
 
+// Returns arena options suitable for holding a protobuf message that serializes to roughly
+// `size_hint` bytes. The arena grows in a few large blocks instead of many small ones.
+google::protobuf::ArenaOptions MakeArenaOptions(size_t size_hint);
+
 void SerializeStringPoolToPb(const StringPool& pool, pb::StringPool* out_pb_pool);
 
 void SerializeSourceToPb(const Source& source, StringPool* src_pool, pb::Source* out_pb_source);
@@ -18,6 +18,7 @@
 #define AAPT_FLATTEN_TABLEPROTOSERIALIZER_H
 
 #include "android-base/macros.h"
+#include "google/protobuf/arena.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 
@@ -63,9 +64,28 @@ class CompiledFileInputStream {
 };
 
 std::unique_ptr<pb::ResourceTable> SerializeTableToPb(ResourceTable* table);
+
+// Serializes the table into a pb::ResourceTable allocated on `arena`. The returned message and
+// all of its sub-messages are owned by the arena and are freed together when it is destroyed.
+pb::ResourceTable* SerializeTableToPb(ResourceTable* table, google::protobuf::Arena* arena);
+
 std::unique_ptr<ResourceTable> DeserializeTableFromPb(const pb::ResourceTable& pbTable,
                                                       const Source& source, IDiagnostics* diag);
 
+// Parses the serialized pb::ResourceTable in `data` on a temporary arena and converts it to a
+// ResourceTable. The arena, and every message parsed into it, is released before returning.
+std::unique_ptr<ResourceTable> DeserializeTableFromPb(const void* data, size_t len,
+                                                      const Source& source, IDiagnostics* diag);
+
+// Deserializes a single pb::Type of the package with ID `package_id` into `package`, creating
+// value strings in `value_pool`. References that only carry an ID are named using `id_index`,
+// which must cover every entry of the package. Returns the deserialized type, or nullptr on error.
+ResourceTableType* DeserializeTypeFromPb(const pb::Type& pb_type, uint32_t package_id,
+                                         const android::ResStringPool& source_pool,
+                                         const std::map<ResourceId, ResourceNameRef>& id_index,
+                                         ResourceTablePackage* package, StringPool* value_pool,
+                                         const Source& source, IDiagnostics* diag);
+
 std::unique_ptr<pb::internal::CompiledFile> SerializeCompiledFileToPb(const ResourceFile& file);
 std::unique_ptr<ResourceFile> DeserializeCompiledFileFromPb(
     const pb::internal::CompiledFile& pbFile, const Source& source, IDiagnostics* diag);
@@ -71,87 +71,98 @@ class PackagePbDeserializer {
 
     ResourceTablePackage* pkg = table->CreatePackage(pb_package.package_name(), id);
     for (const pb::Type& pb_type : pb_package.type()) {
-      const ResourceType* res_type = ParseResourceType(pb_type.name());
-      if (res_type == nullptr) {
-        diag_->Error(DiagMessage(source_) << "unknown type '" << pb_type.name() << "'");
-        return {};
+      if (!DeserializeTypeFromPb(pb_type, pb_package.package_id(), pkg, &table->string_pool,
+                                 &id_index)) {
+        return false;
       }
+    }
+
+    ReferenceIdToNameVisitor visitor(&id_index);
+    VisitAllValuesInPackage(pkg, &visitor);
+    return true;
+  }
 
-      ResourceTableType* type = pkg->FindOrCreateType(*res_type);
+  // Deserializes a single type into `pkg`, creating strings in `value_pool`. If `out_id_index` is
+  // not null, the IDs of the deserialized entries are recorded in it.
+  ResourceTableType* DeserializeTypeFromPb(const pb::Type& pb_type, uint32_t package_id,
+                                           ResourceTablePackage* pkg, StringPool* value_pool,
+                                           std::map<ResourceId, ResourceNameRef>* out_id_index) {
+    const ResourceType* res_type = ParseResourceType(pb_type.name());
+    if (res_type == nullptr) {
+      diag_->Error(DiagMessage(source_) << "unknown type '" << pb_type.name() << "'");
+      return {};
+    }
 
-      for (const pb::Entry& pb_entry : pb_type.entry()) {
-        ResourceEntry* entry = type->FindOrCreateEntry(pb_entry.name());
+    ResourceTableType* type = pkg->FindOrCreateType(*res_type);
 
-        // Deserialize the symbol status (public/private with source and comments).
-        if (pb_entry.has_symbol_status()) {
-          const pb::SymbolStatus& pb_status = pb_entry.symbol_status();
-          if (pb_status.has_source()) {
-            DeserializeSourceFromPb(pb_status.source(), *source_pool_,
-                                    &entry->symbol_status.source);
-          }
+    for (const pb::Entry& pb_entry : pb_type.entry()) {
+      ResourceEntry* entry = type->FindOrCreateEntry(pb_entry.name());
 
-          if (pb_status.has_comment()) {
-            entry->symbol_status.comment = pb_status.comment();
-          }
+      // Deserialize the symbol status (public/private with source and comments).
+      if (pb_entry.has_symbol_status()) {
+        const pb::SymbolStatus& pb_status = pb_entry.symbol_status();
+        if (pb_status.has_source()) {
+          DeserializeSourceFromPb(pb_status.source(), *source_pool_,
+                                  &entry->symbol_status.source);
+        }
 
-          entry->symbol_status.allow_new = pb_status.allow_new();
+        if (pb_status.has_comment()) {
+          entry->symbol_status.comment = pb_status.comment();
+        }
 
-          SymbolState visibility = DeserializeVisibilityFromPb(pb_status.visibility());
-          entry->symbol_status.state = visibility;
+        entry->symbol_status.allow_new = pb_status.allow_new();
 
-          if (visibility == SymbolState::kPublic) {
-            // This is a public symbol, we must encode the ID now if there is one.
-            if (pb_entry.has_id()) {
-              entry->id = static_cast<uint16_t>(pb_entry.id());
-            }
+        SymbolState visibility = DeserializeVisibilityFromPb(pb_status.visibility());
+        entry->symbol_status.state = visibility;
 
-            if (type->symbol_status.state != SymbolState::kPublic) {
-              // If the type has not been made public, do so now.
-              type->symbol_status.state = SymbolState::kPublic;
-              if (pb_type.has_id()) {
-                type->id = static_cast<uint8_t>(pb_type.id());
-              }
-            }
-          } else if (visibility == SymbolState::kPrivate) {
-            if (type->symbol_status.state == SymbolState::kUndefined) {
-              type->symbol_status.state = SymbolState::kPrivate;
+        if (visibility == SymbolState::kPublic) {
+          // This is a public symbol, we must encode the ID now if there is one.
+          if (pb_entry.has_id()) {
+            entry->id = static_cast<uint16_t>(pb_entry.id());
+          }
+
+          if (type->symbol_status.state != SymbolState::kPublic) {
+            // If the type has not been made public, do so now.
+            type->symbol_status.state = SymbolState::kPublic;
+            if (pb_type.has_id()) {
+              type->id = static_cast<uint8_t>(pb_type.id());
             }
           }
+        } else if (visibility == SymbolState::kPrivate) {
+          if (type->symbol_status.state == SymbolState::kUndefined) {
+            type->symbol_status.state = SymbolState::kPrivate;
+          }
         }
+      }
 
-        ResourceId resid(pb_package.package_id(), pb_type.id(), pb_entry.id());
-        if (resid.is_valid()) {
-          id_index[resid] = ResourceNameRef(pkg->name, type->type, entry->name);
-        }
+      ResourceId resid(package_id, pb_type.id(), pb_entry.id());
+      if (out_id_index != nullptr && resid.is_valid()) {
+        (*out_id_index)[resid] = ResourceNameRef(pkg->name, type->type, entry->name);
+      }
 
-        for (const pb::ConfigValue& pb_config_value : pb_entry.config_value()) {
-          const pb::ConfigDescription& pb_config = pb_config_value.config();
+      for (const pb::ConfigValue& pb_config_value : pb_entry.config_value()) {
+        const pb::ConfigDescription& pb_config = pb_config_value.config();
 
-          ConfigDescription config;
-          if (!DeserializeConfigDescriptionFromPb(pb_config, &config)) {
-            diag_->Error(DiagMessage(source_) << "invalid configuration");
-            return {};
-          }
+        ConfigDescription config;
+        if (!DeserializeConfigDescriptionFromPb(pb_config, &config)) {
+          diag_->Error(DiagMessage(source_) << "invalid configuration");
+          return {};
+        }
 
-          ResourceConfigValue* config_value = entry->FindOrCreateValue(config, pb_config.product());
-          if (config_value->value) {
-            // Duplicate config.
-            diag_->Error(DiagMessage(source_) << "duplicate configuration");
-            return {};
-          }
+        ResourceConfigValue* config_value = entry->FindOrCreateValue(config, pb_config.product());
+        if (config_value->value) {
+          // Duplicate config.
+          diag_->Error(DiagMessage(source_) << "duplicate configuration");
+          return {};
+        }
 
-          config_value->value =
-              DeserializeValueFromPb(pb_config_value.value(), config, &table->string_pool);
-          if (!config_value->value) {
-            return {};
-          }
+        config_value->value = DeserializeValueFromPb(pb_config_value.value(), config, value_pool);
+        if (!config_value->value) {
+          return {};
         }
       }
     }
-
-    ReferenceIdToNameVisitor visitor(&id_index);
-    VisitAllValuesInPackage(pkg, &visitor);
-    return true;
+    return type;
   }
 
  private:
@@ -385,6 +396,38 @@ std::unique_ptr<ResourceTable> DeserializeTableFromPb(const pb::ResourceTable& p
   return table;
 }
 
+ResourceTableType* DeserializeTypeFromPb(const pb::Type& pb_type, uint32_t package_id,
+                                         const android::ResStringPool& source_pool,
+                                         const std::map<ResourceId, ResourceNameRef>& id_index,
+                                         ResourceTablePackage* package, StringPool* value_pool,
+                                         const Source& source, IDiagnostics* diag) {
+  PackagePbDeserializer package_pb_deserializer(&source_pool, source, diag);
+  ResourceTableType* type = package_pb_deserializer.DeserializeTypeFromPb(
+      pb_type, package_id, package, value_pool, nullptr /*out_id_index*/);
+  if (!type) {
+    return {};
+  }
+
+  ReferenceIdToNameVisitor visitor(&id_index);
+  for (auto& entry : type->entries) {
+    for (auto& config_value : entry->values) {
+      config_value->value->Accept(&visitor);
+    }
+  }
+  return type;
+}
+
+std::unique_ptr<ResourceTable> DeserializeTableFromPb(const void* data, size_t len,
+                                                      const Source& source, IDiagnostics* diag) {
+  google::protobuf::Arena arena(MakeArenaOptions(len));
+  pb::ResourceTable* pb_table = google::protobuf::Arena::CreateMessage<pb::ResourceTable>(&arena);
+  if (!pb_table->ParseFromArray(data, static_cast<int>(len))) {
+    diag->Error(DiagMessage(source) << "invalid compiled table");
+    return {};
+  }
+  return DeserializeTableFromPb(*pb_table, source, diag);
+}
+
 std::unique_ptr<ResourceFile> DeserializeCompiledFileFromPb(
     const pb::internal::CompiledFile& pb_file, const Source& source, IDiagnostics* diag) {
   std::unique_ptr<ResourceFile> file = util::make_unique<ResourceFile>();
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include "ConfigInterner.h"
 #include "Resource.h"
 #include "ResourceTable.h"
 #include "StringPool.h"
@@ -204,18 +205,18 @@ class PbSerializerVisitor : public RawValueVisitor {
 
 }  // namespace
 
-std::unique_ptr<pb::ResourceTable> SerializeTableToPb(ResourceTable* table) {
+static void SerializeTableToPbImpl(ResourceTable* table, pb::ResourceTable* pb_table) {
   // We must do this before writing the resources, since the string pool IDs may change.
   table->string_pool.Prune();
-  table->string_pool.Sort([](const StringPool::Context& a, const StringPool::Context& b) -> int {
+  const ConfigOrder config_order;
+  table->string_pool.Sort([&](const StringPool::Context& a, const StringPool::Context& b) -> int {
     int diff = util::compare(a.priority, b.priority);
     if (diff == 0) {
-      diff = a.config.compare(b.config);
+      diff = config_order.Compare(a.config_id, b.config_id);
     }
     return diff;
   });
 
-  auto pb_table = util::make_unique<pb::ResourceTable>();
   StringPool source_pool;
 
   for (auto& package : table->packages) {
@@ -272,6 +273,17 @@ std::unique_ptr<pb::ResourceTable> SerializeTableToPb(ResourceTable* table) {
   }
 
   SerializeStringPoolToPb(source_pool, pb_table->mutable_source_pool());
+}
+
+std::unique_ptr<pb::ResourceTable> SerializeTableToPb(ResourceTable* table) {
+  auto pb_table = util::make_unique<pb::ResourceTable>();
+  SerializeTableToPbImpl(table, pb_table.get());
+  return pb_table;
+}
+
+pb::ResourceTable* SerializeTableToPb(ResourceTable* table, google::protobuf::Arena* arena) {
+  pb::ResourceTable* pb_table = google::protobuf::Arena::CreateMessage<pb::ResourceTable>(arena);
+  SerializeTableToPbImpl(table, pb_table);
   return pb_table;
 }
 
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "proto/ProtoSerialize.h"
+
+#include "android-base/stringprintf.h"
+#include "benchmark/benchmark.h"
+
+#include "ResourceTable.h"
+#include "test/Test.h"
+
+using ::android::base::StringPrintf;
+
+namespace aapt {
+
+// Builds a table shaped like a large static library: many strings, each localized into a handful
+// of languages, plus styles that carry several items.
+static std::unique_ptr<ResourceTable> BuildLargeStaticLibTable(size_t entry_count) {
+  static const char* kLocales[] = {"", "de", "fr", "ja", "zh-rCN"};
+
+  test::ResourceTableBuilder builder;
+  builder.SetPackageId("com.lib", 0x7f);
+  for (size_t i = 0; i < entry_count; i++) {
+    const std::string string_name = StringPrintf("com.lib:string/string_%zu", i);
+    for (const char* locale : kLocales) {
+      builder.AddString(string_name, {}, test::ParseConfigOrDie(locale),
+                        StringPrintf("value %zu (%s)", i, locale));
+    }
+
+    builder.AddValue(StringPrintf("com.lib:style/Style_%zu", i),
+                     test::StyleBuilder()
+                         .SetParent("com.lib:style/Base")
+                         .AddItem("com.lib:attr/foo", test::BuildReference(string_name))
+                         .AddItem("com.lib:attr/bar", test::BuildReference(string_name))
+                         .Build());
+  }
+  return builder.Build();
+}
+
+static std::string SerializeToString(ResourceTable* table) {
+  std::string out;
+  SerializeTableToPb(table)->SerializeToString(&out);
+  return out;
+}
+
+static void BM_TableProtoRoundTripHeap(benchmark::State& state) {
+  std::unique_ptr<ResourceTable> table = BuildLargeStaticLibTable(state.range(0));
+  while (state.KeepRunning()) {
+    std::string data = SerializeToString(table.get());
+
+    pb::ResourceTable pb_table;
+    CHECK(pb_table.ParseFromString(data));
+    std::unique_ptr<ResourceTable> result =
+        DeserializeTableFromPb(pb_table, Source("lib.apk"), test::GetDiagnostics());
+    CHECK(result != nullptr);
+  }
+}
+BENCHMARK(BM_TableProtoRoundTripHeap)->Arg(1000)->Arg(10000)->Arg(50000);
+
+static void BM_TableProtoRoundTripArena(benchmark::State& state) {
+  std::unique_ptr<ResourceTable> table = BuildLargeStaticLibTable(state.range(0));
+  while (state.KeepRunning()) {
+    std::string data;
+    {
+      google::protobuf::Arena arena(MakeArenaOptions(0u));
+      SerializeTableToPb(table.get(), &arena)->SerializeToString(&data);
+    }
+
+    std::unique_ptr<ResourceTable> result = DeserializeTableFromPb(
+        data.data(), data.size(), Source("lib.apk"), test::GetDiagnostics());
+    CHECK(result != nullptr);
+  }
+}
+BENCHMARK(BM_TableProtoRoundTripArena)->Arg(1000)->Arg(10000)->Arg(50000);
+
+}  // namespace aapt
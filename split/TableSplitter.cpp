@@ -20,20 +20,19 @@
 #include <map>
 #include <set>
 #include <unordered_set>
-#include <unordered_map>
 #include <vector>
 
 #include "android-base/logging.h"
 
 #include "ConfigDescription.h"
+#include "ConfigInterner.h"
 #include "ResourceTable.h"
 #include "util/Util.h"
 
 namespace aapt {
 
-using ConfigClaimedMap = std::unordered_map<ResourceConfigValue*, bool>;
-using ConfigDensityGroups =
-    std::map<ConfigDescription, std::vector<ResourceConfigValue*>>;
+// Density-dependent values, grouped by the ID of their config stripped of its density.
+using ConfigDensityGroups = std::map<ConfigId, std::vector<ResourceConfigValue*>, ConfigIdLess>;
 
 static ConfigDescription CopyWithoutDensity(const ConfigDescription& config) {
   ConfigDescription without_density = config;
@@ -41,84 +40,6 @@ static ConfigDescription CopyWithoutDensity(const ConfigDescription& config) {
   return without_density;
 }
 
-/**
- * Selects values that match exactly the constraints given.
- */
-class SplitValueSelector {
- public:
-  explicit SplitValueSelector(const SplitConstraints& constraints) {
-    for (const ConfigDescription& config : constraints.configs) {
-      if (config.density == 0) {
-        density_independent_configs_.insert(config);
-      } else {
-        density_dependent_config_to_density_map_[CopyWithoutDensity(config)] =
-            config.density;
-      }
-    }
-  }
-
-  std::vector<ResourceConfigValue*> SelectValues(
-      const ConfigDensityGroups& density_groups,
-      ConfigClaimedMap* claimed_values) {
-    std::vector<ResourceConfigValue*> selected;
-
-    // Select the regular values.
-    for (auto& entry : *claimed_values) {
-      // Check if the entry has a density.
-      ResourceConfigValue* config_value = entry.first;
-      if (config_value->config.density == 0 && !entry.second) {
-        // This is still available.
-        if (density_independent_configs_.find(config_value->config) !=
-            density_independent_configs_.end()) {
-          selected.push_back(config_value);
-
-          // Mark the entry as taken.
-          entry.second = true;
-        }
-      }
-    }
-
-    // Now examine the densities
-    for (auto& entry : density_groups) {
-      // We do not care if the value is claimed, since density values can be
-      // in multiple splits.
-      const ConfigDescription& config = entry.first;
-      const std::vector<ResourceConfigValue*>& related_values = entry.second;
-      auto density_value_iter =
-          density_dependent_config_to_density_map_.find(config);
-      if (density_value_iter !=
-          density_dependent_config_to_density_map_.end()) {
-        // Select the best one!
-        ConfigDescription target_density = config;
-        target_density.density = density_value_iter->second;
-
-        ResourceConfigValue* best_value = nullptr;
-        for (ResourceConfigValue* this_value : related_values) {
-          if (!best_value ||
-              this_value->config.isBetterThan(best_value->config,
-                                              &target_density)) {
-            best_value = this_value;
-          }
-        }
-        CHECK(best_value != nullptr);
-
-        // When we select one of these, they are all claimed such that the base
-        // doesn't include any anymore.
-        (*claimed_values)[best_value] = true;
-        selected.push_back(best_value);
-      }
-    }
-    return selected;
-  }
-
- private:
-  DISALLOW_COPY_AND_ASSIGN(SplitValueSelector);
-
-  std::set<ConfigDescription> density_independent_configs_;
-  std::map<ConfigDescription, uint16_t>
-      density_dependent_config_to_density_map_;
-};
-
 /**
  * Marking non-preferred densities as claimed will make sure the base doesn't
  * include them,
@@ -126,9 +47,9 @@ class SplitValueSelector {
  */
 static void MarkNonPreferredDensitiesAsClaimed(
     const std::vector<uint16_t>& preferred_densities, const ConfigDensityGroups& density_groups,
-    ConfigClaimedMap* config_claimed_map) {
+    std::unordered_set<ResourceConfigValue*>* claimed_values) {
   for (auto& entry : density_groups) {
-    const ConfigDescription& config = entry.first;
+    const ConfigDescription& config = ConfigInterner::Get()->Lookup(entry.first);
     const std::vector<ResourceConfigValue*>& related_values = entry.second;
 
     // There can be multiple best values if there are multiple preferred densities.
@@ -151,11 +72,56 @@ static void MarkNonPreferredDensitiesAsClaimed(
     // Claim all the values that aren't the best so that they will be removed from the base.
     for (ResourceConfigValue* this_value : related_values) {
       if (best_values.find(this_value) == best_values.end()) {
-        (*config_claimed_map)[this_value] = true;
+        claimed_values->insert(this_value);
       }
     }
   }
 }
+
+TableSplitter::TableSplitter(const std::vector<SplitConstraints>& splits,
+                             const TableSplitterOptions& options)
+    : split_constraints_(splits), options_(options) {
+  ConfigInterner* interner = ConfigInterner::Get();
+  for (size_t idx = 0; idx < split_constraints_.size(); idx++) {
+    splits_.push_back(util::make_unique<ResourceTable>());
+
+    std::map<ConfigDescription, uint16_t> density_dependent_config_to_density_map;
+    for (const ConfigDescription& config : split_constraints_[idx].configs) {
+      if (config.density == 0) {
+        // If a config appears in more than one split, the first split claims the values.
+        split_by_config_.insert(std::make_pair(interner->Intern(config), idx));
+      } else {
+        density_dependent_config_to_density_map[CopyWithoutDensity(config)] = config.density;
+      }
+    }
+
+    for (const auto& entry : density_dependent_config_to_density_map) {
+      density_selectors_[interner->Intern(entry.first)].push_back(
+          DensitySelector{idx, entry.second});
+    }
+  }
+
+  // The values of the table to split are created before the splitter, so their configs are
+  // already interned.
+  const size_t config_count = interner->size();
+  without_density_ids_.reserve(config_count);
+  for (ConfigId id = 0u; id < config_count; id++) {
+    const ConfigDescription& config = interner->Lookup(id);
+    without_density_ids_.push_back(config.density == 0
+                                       ? id
+                                       : interner->Intern(CopyWithoutDensity(config)));
+  }
+  config_order_ = util::make_unique<ConfigOrder>();
+}
+
+ConfigId TableSplitter::WithoutDensity(ConfigId id) const {
+  if (id < without_density_ids_.size()) {
+    return without_density_ids_[id];
+  }
+  ConfigInterner* interner = ConfigInterner::Get();
+  return interner->Intern(CopyWithoutDensity(interner->Lookup(id)));
+}
+
 bool TableSplitter::VerifySplitConstraints(IAaptContext* context) {
   bool error = false;
   for (size_t i = 0; i < split_constraints_.size(); i++) {
@@ -175,122 +141,156 @@ bool TableSplitter::VerifySplitConstraints(IAaptContext* context) {
   return !error;
 }
 
-void TableSplitter::SplitTable(ResourceTable* original_table) {
-  const size_t split_count = split_constraints_.size();
-  for (auto& pkg : original_table->packages) {
-    // Initialize all packages for splits.
-    for (size_t idx = 0; idx < split_count; idx++) {
-      ResourceTable* split_table = splits_[idx].get();
-      split_table->CreatePackage(pkg->name, pkg->id);
+void TableSplitter::CreateSplitPackages(const ResourceTablePackage& package) {
+  for (std::unique_ptr<ResourceTable>& split_table : splits_) {
+    split_table->CreatePackage(package.name, package.id);
+  }
+}
+
+void TableSplitter::SelectEntryValues(const ResourceTableType& type, ResourceEntry* entry,
+                                      EntrySelection* out_selection) const {
+  out_selection->split_values.clear();
+  out_selection->claimed_values.clear();
+  out_selection->removed_values.clear();
+
+  if (type.type == ResourceType::kMipmap) {
+    // Always keep mipmaps.
+    return;
+  }
+
+  if (options_.config_filter) {
+    // First eliminate any resource that we definitely don't want.
+    for (std::unique_ptr<ResourceConfigValue>& config_value : entry->values) {
+      if (!options_.config_filter->Match(config_value->config)) {
+        // null out the entry. We will clean up and remove nulls at the
+        // end for performance reasons.
+        out_selection->removed_values.push_back(std::move(config_value->value));
+        config_value.reset();
+      }
     }
+  }
 
-    for (auto& type : pkg->types) {
-      if (type->type == ResourceType::kMipmap) {
-        // Always keep mipmaps.
-        continue;
+  // Organize the values into two separate buckets. Those that are density-dependent
+  // and those that are density-independent.
+  // One density technically matches all density, it's just that some densities
+  // match better. So we need to be aware of the full set of densities to make this
+  // decision.
+  ConfigDensityGroups density_groups{ConfigIdLess(config_order_.get())};
+  for (const std::unique_ptr<ResourceConfigValue>& config_value : entry->values) {
+    if (config_value && config_value->config.density != 0) {
+      // Create a bucket for this density-dependent config.
+      density_groups[WithoutDensity(config_value->config_id)].push_back(config_value.get());
+    }
+  }
+
+  // Select the values that go into the splits. A density-independent value
+  // goes to the split that claims its config, if any. Anything that doesn't
+  // match one of the splits stays in the base.
+  for (const std::unique_ptr<ResourceConfigValue>& config_value : entry->values) {
+    if (config_value && config_value->config.density == 0) {
+      auto split_iter = split_by_config_.find(config_value->config_id);
+      if (split_iter != split_by_config_.end()) {
+        out_selection->split_values.push_back(
+            std::make_pair(split_iter->second, config_value.get()));
+        out_selection->claimed_values.insert(config_value.get());
       }
+    }
+  }
 
-      for (auto& entry : type->entries) {
-        if (options_.config_filter) {
-          // First eliminate any resource that we definitely don't want.
-          for (std::unique_ptr<ResourceConfigValue>& config_value :
-               entry->values) {
-            if (!options_.config_filter->Match(config_value->config)) {
-              // null out the entry. We will clean up and remove nulls at the
-              // end for performance reasons.
-              config_value.reset();
-            }
-          }
-        }
+  // Density-dependent values can be selected by multiple splits. Each split
+  // picks the value that best matches its density, and every selected value
+  // is claimed so that the base doesn't include it anymore.
+  for (const auto& density_group : density_groups) {
+    auto selectors_iter = density_selectors_.find(density_group.first);
+    if (selectors_iter == density_selectors_.end()) {
+      continue;
+    }
 
-        // Organize the values into two separate buckets. Those that are
-        // density-dependent
-        // and those that are density-independent.
-        // One density technically matches all density, it's just that some
-        // densities
-        // match better. So we need to be aware of the full set of densities to
-        // make this
-        // decision.
-        ConfigDensityGroups density_groups;
-        ConfigClaimedMap config_claimed_map;
-        for (const std::unique_ptr<ResourceConfigValue>& config_value :
-             entry->values) {
-          if (config_value) {
-            config_claimed_map[config_value.get()] = false;
-
-            if (config_value->config.density != 0) {
-              // Create a bucket for this density-dependent config.
-              density_groups[CopyWithoutDensity(config_value->config)]
-                  .push_back(config_value.get());
-            }
-          }
-        }
+    for (const DensitySelector& selector : selectors_iter->second) {
+      ConfigDescription target_density = ConfigInterner::Get()->Lookup(density_group.first);
+      target_density.density = selector.density;
 
-        // First we check all the splits. If it doesn't match one of the splits,
-        // we
-        // leave it in the base.
-        for (size_t idx = 0; idx < split_count; idx++) {
-          const SplitConstraints& split_constraint = split_constraints_[idx];
-          ResourceTable* split_table = splits_[idx].get();
-
-          // Select the values we want from this entry for this split.
-          SplitValueSelector selector(split_constraint);
-          std::vector<ResourceConfigValue*> selected_values =
-              selector.SelectValues(density_groups, &config_claimed_map);
-
-          // No need to do any work if we selected nothing.
-          if (!selected_values.empty()) {
-            // Create the same resource structure in the split. We do this
-            // lazily because we might not have actual values for each
-            // type/entry.
-            ResourceTablePackage* split_pkg =
-                split_table->FindPackage(pkg->name);
-            ResourceTableType* split_type =
-                split_pkg->FindOrCreateType(type->type);
-            if (!split_type->id) {
-              split_type->id = type->id;
-              split_type->symbol_status = type->symbol_status;
-            }
-
-            ResourceEntry* split_entry =
-                split_type->FindOrCreateEntry(entry->name);
-            if (!split_entry->id) {
-              split_entry->id = entry->id;
-              split_entry->symbol_status = entry->symbol_status;
-            }
-
-            // Copy the selected values into the new Split Entry.
-            for (ResourceConfigValue* config_value : selected_values) {
-              ResourceConfigValue* new_config_value =
-                  split_entry->FindOrCreateValue(config_value->config,
-                                                 config_value->product);
-              new_config_value->value = std::unique_ptr<Value>(
-                  config_value->value->Clone(&split_table->string_pool));
-            }
-          }
+      ResourceConfigValue* best_value = nullptr;
+      for (ResourceConfigValue* this_value : density_group.second) {
+        if (!best_value || this_value->config.isBetterThan(best_value->config, &target_density)) {
+          best_value = this_value;
         }
+      }
+      CHECK(best_value != nullptr);
 
-        if (!options_.preferred_densities.empty()) {
-          MarkNonPreferredDensitiesAsClaimed(options_.preferred_densities,
-                                             density_groups,
-                                             &config_claimed_map);
-        }
+      out_selection->claimed_values.insert(best_value);
+      out_selection->split_values.push_back(std::make_pair(selector.split_index, best_value));
+    }
+  }
 
-        // All splits are handled, now check to see what wasn't claimed and
-        // remove
-        // whatever exists in other splits.
-        for (std::unique_ptr<ResourceConfigValue>& config_value :
-             entry->values) {
-          if (config_value && config_claimed_map[config_value.get()]) {
-            // Claimed, remove from base.
-            config_value.reset();
-          }
-        }
+  if (!options_.preferred_densities.empty()) {
+    MarkNonPreferredDensitiesAsClaimed(options_.preferred_densities, density_groups,
+                                       &out_selection->claimed_values);
+  }
+
+  std::stable_sort(out_selection->split_values.begin(), out_selection->split_values.end(),
+                   [](const std::pair<size_t, ResourceConfigValue*>& a,
+                      const std::pair<size_t, ResourceConfigValue*>& b) -> bool {
+                     return a.first < b.first;
+                   });
+}
 
-        // Now erase all nullptrs.
-        entry->values.erase(
-            std::remove(entry->values.begin(), entry->values.end(), nullptr),
-            entry->values.end());
+void TableSplitter::ApplyEntrySelection(const ResourceTablePackage& package,
+                                        const ResourceTableType& type, ResourceEntry* entry,
+                                        const EntrySelection& selection) {
+  // Copy the selected values into the splits, creating the same resource
+  // structure in each split lazily, since most splits only have values
+  // for a few types/entries.
+  ResourceTable* split_table = nullptr;
+  ResourceEntry* split_entry = nullptr;
+  for (const auto& split_value : selection.split_values) {
+    if (split_table != splits_[split_value.first].get()) {
+      split_table = splits_[split_value.first].get();
+
+      ResourceTablePackage* split_pkg = split_table->FindPackage(package.name);
+      ResourceTableType* split_type = split_pkg->FindOrCreateType(type.type);
+      if (!split_type->id) {
+        split_type->id = type.id;
+        split_type->symbol_status = type.symbol_status;
+      }
+
+      split_entry = split_type->FindOrCreateEntry(entry->name);
+      if (!split_entry->id) {
+        split_entry->id = entry->id;
+        split_entry->symbol_status = entry->symbol_status;
+      }
+    }
+
+    ResourceConfigValue* config_value = split_value.second;
+    ResourceConfigValue* new_config_value =
+        split_entry->FindOrCreateValue(config_value->config, config_value->product);
+    new_config_value->value =
+        std::unique_ptr<Value>(config_value->value->Clone(&split_table->string_pool));
+  }
+
+  // All splits are handled, now remove whatever was claimed from the base.
+  if (!selection.claimed_values.empty()) {
+    for (std::unique_ptr<ResourceConfigValue>& config_value : entry->values) {
+      if (config_value && selection.claimed_values.count(config_value.get()) != 0) {
+        config_value.reset();
+      }
+    }
+  }
+
+  // Now erase all nullptrs, including the values removed by the config filter.
+  entry->values.erase(std::remove(entry->values.begin(), entry->values.end(), nullptr),
+                      entry->values.end());
+}
+
+void TableSplitter::SplitTable(ResourceTable* original_table) {
+  EntrySelection selection;
+  for (auto& pkg : original_table->packages) {
+    CreateSplitPackages(*pkg);
+
+    for (auto& type : pkg->types) {
+      for (auto& entry : type->entries) {
+        SelectEntryValues(*type, entry.get(), &selection);
+        ApplyEntrySelection(*pkg, *type, entry.get(), selection);
       }
     }
   }
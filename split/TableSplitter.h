@@ -17,11 +17,18 @@
 #ifndef AAPT_SPLIT_TABLESPLITTER_H
 #define AAPT_SPLIT_TABLESPLITTER_H
 
+#include <map>
+#include <memory>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
+
 #include "android-base/macros.h"
 
 #include "ConfigDescription.h"
+#include "ConfigInterner.h"
 #include "ResourceTable.h"
 #include "filter/ConfigFilter.h"
 #include "process/IResourceTableConsumer.h"
@@ -49,24 +56,98 @@ struct TableSplitterOptions {
 class TableSplitter {
  public:
   TableSplitter(const std::vector<SplitConstraints>& splits,
-                const TableSplitterOptions& options)
-      : split_constraints_(splits), options_(options) {
-    for (size_t i = 0; i < split_constraints_.size(); i++) {
-      splits_.push_back(util::make_unique<ResourceTable>());
-    }
-  }
+                const TableSplitterOptions& options);
 
   bool VerifySplitConstraints(IAaptContext* context);
 
+  /**
+   * Moves the values matching each split's constraints out of `original_table`
+   * and into the split tables. The constraints are indexed up front, so the
+   * cost of splitting is proportional to the number of values in the table
+   * and the number of values selected, not to the number of splits.
+   */
   void SplitTable(ResourceTable* original_table);
 
+  /**
+   * The values of an entry that were selected by SelectEntryValues().
+   */
+  struct EntrySelection {
+    /**
+     * The values to copy into the splits, with the index of the split each one
+     * goes into, ordered by split.
+     */
+    std::vector<std::pair<size_t, ResourceConfigValue*>> split_values;
+
+    /**
+     * The values to remove from the base.
+     */
+    std::unordered_set<ResourceConfigValue*> claimed_values;
+
+    /**
+     * The values dropped by the config filter. Destroying a value releases
+     * its string pool references, which is not thread-safe, so they are kept
+     * here and destroyed along with the selection.
+     */
+    std::vector<std::unique_ptr<Value>> removed_values;
+  };
+
+  /**
+   * The per-entry steps of SplitTable(), for callers that visit the table
+   * themselves. CreateSplitPackages() must be called for a package before
+   * applying the selections of its entries.
+   *
+   * SelectEntryValues() only modifies `entry`, so it can run on different
+   * entries concurrently. ApplyEntrySelection() writes into the split tables
+   * and must not.
+   */
+  void CreateSplitPackages(const ResourceTablePackage& package);
+  void SelectEntryValues(const ResourceTableType& type, ResourceEntry* entry,
+                         EntrySelection* out_selection) const;
+  void ApplyEntrySelection(const ResourceTablePackage& package,
+                           const ResourceTableType& type, ResourceEntry* entry,
+                           const EntrySelection& selection);
+
   std::vector<std::unique_ptr<ResourceTable>>& splits() { return splits_; }
 
  private:
+  struct DensitySelector {
+    size_t split_index;
+    uint16_t density;
+  };
+
+  /**
+   * Returns the ID of the configuration `id` stripped of its density.
+   */
+  ConfigId WithoutDensity(ConfigId id) const;
+
   std::vector<SplitConstraints> split_constraints_;
   std::vector<std::unique_ptr<ResourceTable>> splits_;
   TableSplitterOptions options_;
 
+  /**
+   * Maps each density-independent config to the first split that claims it.
+   */
+  std::unordered_map<ConfigId, size_t> split_by_config_;
+
+  /**
+   * Maps each config, stripped of its density, to the splits that select the
+   * best matching density for it, in split order.
+   */
+  std::unordered_map<ConfigId, std::vector<DensitySelector>> density_selectors_;
+
+  /**
+   * The ID of each config interned before the splitter was created, stripped
+   * of its density, by ID. Stripping creates new configs, which are interned
+   * here once instead of for every value.
+   */
+  std::vector<ConfigId> without_density_ids_;
+
+  /**
+   * Orders the density groups of an entry. Taken after the stripped configs
+   * were interned.
+   */
+  std::unique_ptr<ConfigOrder> config_order_;
+
   DISALLOW_COPY_AND_ASSIGN(TableSplitter);
 };
 }
@@ -248,4 +248,45 @@ TEST(TableSplitterTest, SplitTableByConfigAndDensity) {
                                         test::ParseConfigOrDie("land-xxhdpi")));
 }
 
+TEST(TableSplitterTest, SplitOnlyCreatesStructureForSelectedValues) {
+  std::unique_ptr<ResourceTable> table =
+      test::ResourceTableBuilder()
+          .AddString("android:string/foo", {}, test::ParseConfigOrDie("fr"), "foo fr")
+          .AddString("android:string/foo", {}, test::ParseConfigOrDie("de"), "foo de")
+          .AddString("android:string/bar", {}, test::ParseConfigOrDie("de"), "bar de")
+          .AddSimple("android:id/baz")
+          .Build();
+
+  std::vector<SplitConstraints> constraints;
+  constraints.push_back(SplitConstraints{{test::ParseConfigOrDie("fr")}});
+  constraints.push_back(SplitConstraints{{test::ParseConfigOrDie("de")}});
+  constraints.push_back(SplitConstraints{{test::ParseConfigOrDie("ja")}});
+
+  TableSplitter splitter(constraints, TableSplitterOptions{});
+  splitter.SplitTable(table.get());
+
+  ResourceTable* split_fr = splitter.splits()[0].get();
+  ResourceTable* split_de = splitter.splits()[1].get();
+  ResourceTable* split_ja = splitter.splits()[2].get();
+
+  String* str = test::GetValueForConfig<String>(split_fr, "android:string/foo",
+                                                test::ParseConfigOrDie("fr"));
+  ASSERT_NE(nullptr, str);
+  EXPECT_EQ(std::string("foo fr"), *str->value);
+  EXPECT_FALSE(split_fr->FindResource(test::ParseNameOrDie("android:string/bar")));
+
+  EXPECT_NE(nullptr, test::GetValueForConfig<String>(split_de, "android:string/foo",
+                                                     test::ParseConfigOrDie("de")));
+  EXPECT_NE(nullptr, test::GetValueForConfig<String>(split_de, "android:string/bar",
+                                                     test::ParseConfigOrDie("de")));
+
+  // Every split has the package, but only splits with values have types.
+  ASSERT_NE(nullptr, split_ja->FindPackage("android"));
+  EXPECT_TRUE(split_ja->FindPackage("android")->types.empty());
+
+  EXPECT_EQ(nullptr, test::GetValueForConfig<String>(table.get(), "android:string/foo",
+                                                     test::ParseConfigOrDie("fr")));
+  EXPECT_NE(nullptr, test::GetValue<Id>(table.get(), "android:id/baz"));
+}
+
 }  // namespace aapt
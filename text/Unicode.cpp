@@ -16,8 +16,8 @@
 
 #include "text/Unicode.h"
 
-#include <algorithm>
 #include <array>
+#include <cstdint>
 
 #include "text/Utf8Iterator.h"
 
@@ -28,42 +28,74 @@ namespace text {
 
 namespace {
 
-struct CharacterProperties {
-  enum : uint32_t {
-    kXidStart = 1 << 0,
-    kXidContinue = 1 << 1,
-  };
-
-  char32_t first_char;
-  char32_t last_char;
-  uint32_t properties;
+// The properties of a block of 256 code points, with one bit per code point.
+struct PropertyBlock {
+  std::array<uint32_t, 8> xid_start;
+  std::array<uint32_t, 8> xid_continue;
 };
 
-// Incude the generated data table.
+// Incude the generated data tables.
 #include "text/Unicode_data.cpp"
 
-bool CompareCharacterProperties(const CharacterProperties& a, char32_t codepoint) {
-  return a.last_char < codepoint;
+const PropertyBlock& FindPropertyBlock(char32_t codepoint) {
+  return sPropertyBlocks[sPropertyBlockIndex[codepoint >> 8]];
+}
+
+bool TestBit(const std::array<uint32_t, 8>& bitmap, char32_t codepoint) {
+  const uint32_t offset = codepoint & 0xffu;
+  return (bitmap[offset >> 5] >> (offset & 0x1fu)) & 1u;
 }
 
-uint32_t FindCharacterProperties(char32_t codepoint) {
-  const auto iter_end = sCharacterProperties.end();
-  const auto iter = std::lower_bound(sCharacterProperties.begin(), iter_end, codepoint,
-                                     CompareCharacterProperties);
-  if (iter != iter_end && codepoint >= iter->first_char) {
-    return iter->properties;
+// Returns true if `str` is not empty, its first character is accepted by `is_first` and every other
+// character is accepted by `is_next`. Names are mostly ASCII, so ASCII characters are checked as
+// they are, and only the rest of the string from the first non-ASCII character is decoded.
+template <typename FirstPredicate, typename NextPredicate>
+bool AllCharactersMatch(const StringPiece& str, const FirstPredicate& is_first,
+                        const NextPredicate& is_next) {
+  if (str.empty()) {
+    return false;
+  }
+
+  const size_t len = str.size();
+  size_t i = 0;
+  for (; i < len; i++) {
+    const unsigned char c = static_cast<unsigned char>(str.data()[i]);
+    if (c >= 0x80u || c == 0u) {
+      // Let the iterator decide where the string ends.
+      break;
+    }
+
+    if (!(i == 0 ? is_first(c) : is_next(c))) {
+      return false;
+    }
+  }
+
+  Utf8Iterator iter(str.substr(i));
+  bool first = i == 0;
+  while (iter.HasNext()) {
+    const char32_t codepoint = iter.Next();
+    if (!(first ? is_first(codepoint) : is_next(codepoint))) {
+      return false;
+    }
+    first = false;
   }
-  return 0u;
+  return !first;
 }
 
 }  // namespace
 
 bool IsXidStart(char32_t codepoint) {
-  return FindCharacterProperties(codepoint) & CharacterProperties::kXidStart;
+  if (codepoint >= sPropertyBlockIndex.size() << 8) {
+    return false;
+  }
+  return TestBit(FindPropertyBlock(codepoint).xid_start, codepoint);
 }
 
 bool IsXidContinue(char32_t codepoint) {
-  return FindCharacterProperties(codepoint) & CharacterProperties::kXidContinue;
+  if (codepoint >= sPropertyBlockIndex.size() << 8) {
+    return false;
+  }
+  return TestBit(FindPropertyBlock(codepoint).xid_continue, codepoint);
 }
 
 // Hardcode the White_Space characters since they are few and the external/icu project doesn't
@@ -78,47 +110,21 @@ bool IsWhitespace(char32_t codepoint) {
 }
 
 bool IsJavaIdentifier(const StringPiece& str) {
-  Utf8Iterator iter(str);
-
-  // Check the first character.
-  if (!iter.HasNext()) {
-    return false;
-  }
-
-  if (!IsXidStart(iter.Next())) {
-    return false;
-  }
-
-  while (iter.HasNext()) {
-    const char32_t codepoint = iter.Next();
-    if (!IsXidContinue(codepoint) && codepoint != U'$') {
-      return false;
-    }
-  }
-  return true;
+  return AllCharactersMatch(
+      str, [](char32_t codepoint) -> bool { return IsXidStart(codepoint); },
+      [](char32_t codepoint) -> bool {
+        return IsXidContinue(codepoint) || codepoint == U'$';
+      });
 }
 
 bool IsValidResourceEntryName(const StringPiece& str) {
-  Utf8Iterator iter(str);
-
-  // Check the first character.
-  if (!iter.HasNext()) {
-    return false;
-  }
-
   // Resources are allowed to start with '_'
-  const char32_t first_codepoint = iter.Next();
-  if (!IsXidStart(first_codepoint) && first_codepoint != U'_') {
-    return false;
-  }
-
-  while (iter.HasNext()) {
-    const char32_t codepoint = iter.Next();
-    if (!IsXidContinue(codepoint) && codepoint != U'.' && codepoint != U'-') {
-      return false;
-    }
-  }
-  return true;
+  return AllCharactersMatch(
+      str,
+      [](char32_t codepoint) -> bool { return IsXidStart(codepoint) || codepoint == U'_'; },
+      [](char32_t codepoint) -> bool {
+        return IsXidContinue(codepoint) || codepoint == U'.' || codepoint == U'-';
+      });
 }
 
 }  // namespace text
@@ -41,6 +41,13 @@ TEST(UnicodeTest, IsXidContinue) {
   EXPECT_THAT(invalid_input, Each(ResultOf(IsXidContinue, Eq(false))));
 }
 
+TEST(UnicodeTest, IsXidOutsideOfUnicode) {
+  EXPECT_FALSE(IsXidStart(0x110000));
+  EXPECT_FALSE(IsXidContinue(0x110000));
+  EXPECT_FALSE(IsXidStart(0xffffffff));
+  EXPECT_FALSE(IsXidContinue(0xffffffff));
+}
+
 TEST(UnicodeTest, IsJavaIdentifier) {
   EXPECT_TRUE(IsJavaIdentifier("FøøBar_12"));
   EXPECT_TRUE(IsJavaIdentifier("Føø$Bar"));
@@ -48,6 +55,12 @@ TEST(UnicodeTest, IsJavaIdentifier) {
   EXPECT_FALSE(IsJavaIdentifier("12FøøBar"));
   EXPECT_FALSE(IsJavaIdentifier("_FøøBar"));
   EXPECT_FALSE(IsJavaIdentifier("$Føø$Bar"));
+  EXPECT_FALSE(IsJavaIdentifier(""));
+  EXPECT_FALSE(IsJavaIdentifier("Foo;Bar"));
+
+  // An invalid UTF-8 sequence ends the name.
+  EXPECT_TRUE(IsJavaIdentifier("Foo\xff" "Bar"));
+  EXPECT_FALSE(IsJavaIdentifier("\xff" "FooBar"));
 }
 
 TEST(UnicodeTest, IsValidResourceEntryName) {
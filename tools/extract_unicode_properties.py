@@ -1,42 +1,31 @@
 #!/bin/env python3
 
 """Extracts the XID_Start and XID_Continue Derived core properties from the ICU data files
-and emits a std::array<> for binary searching.
+and emits two-level lookup tables for them.
+
+Unicode is split into blocks of 256 code points. The first level maps each block to the index of
+its bitmaps in the second level, and blocks with the same bitmaps share them, so the tables stay
+small while a lookup is two array accesses.
 """
 
 import re
 import sys
 
-CharacterPropertyEnumMap = {
-        1: "CharacterProperties::kXidStart",
-        2: "CharacterProperties::kXidContinue"
+# The properties, by the bit they are given when extracted and the name of their bitmap.
+CharacterPropertyBitmaps = {
+        1: "xid_start",
+        2: "xid_continue"
 }
 
-class CharacterProperty:
-    def __init__(self, first_char, last_char, prop_type):
-        self.first_char = first_char
-        self.last_char = last_char
-        self.prop_type = prop_type
-
-    def key(self):
-        return self.first_char
+# One past the last Unicode code point.
+kMaxCodePoint = 0x110000
 
-    def merge(self, other):
-        if self.last_char + 1 == other.first_char and self.prop_type == other.prop_type:
-            self.last_char = other.last_char
-        else:
-            raise KeyError()
-
-    def __repr__(self):
-        types = []
-        for enum_int, enum_str in CharacterPropertyEnumMap.items():
-            if enum_int & self.prop_type:
-                types.append(enum_str)
-        return "{}0x{:04x}, 0x{:04x}, {}{}".format(
-                "{", self.first_char, self.last_char, ' | '.join(types), "}")
+kBlockSize = 256
+kBitsPerWord = 32
 
 def extract_unicode_properties(f, props, chars_out):
-    prog = re.compile(r"^(?P<first>\w{4})(..(?P<last>\w{4}))?\W+;\W+(?P<prop>\w+)")
+    prog = re.compile(
+            r"^(?P<first>[0-9A-Fa-f]{4,6})(\.\.(?P<last>[0-9A-Fa-f]{4,6}))?\s+;\s+(?P<prop>\w+)")
     for line in f:
         result = prog.match(line)
         if result:
@@ -48,22 +37,38 @@ def extract_unicode_properties(f, props, chars_out):
                 last_char = (int(last_char_str, 16) if last_char_str else start_char) + 1
                 prop_type = props[prop_type_str]
                 for char in range(start_char, last_char):
-                    if char not in chars_out:
-                        chars_out[char] = CharacterProperty(char, char, 0)
-                    chars_out[char].prop_type |= prop_type
+                    chars_out[char] = chars_out.get(char, 0) | prop_type
     return chars_out
 
-def flatten_unicode_properties(chars):
-    result = []
-    for char_prop in sorted(chars.values(), key=CharacterProperty.key):
-        if len(result) == 0:
-            result.append(char_prop)
-        else:
-            try:
-                result[len(result) - 1].merge(char_prop)
-            except KeyError:
-                result.append(char_prop)
-    return result
+def make_block(chars, block_start):
+    """Returns the bitmaps of each property for the block starting at `block_start`."""
+    bitmaps = []
+    for prop_type in sorted(CharacterPropertyBitmaps.keys()):
+        words = [0] * (kBlockSize // kBitsPerWord)
+        for offset in range(kBlockSize):
+            if chars.get(block_start + offset, 0) & prop_type:
+                words[offset // kBitsPerWord] |= 1 << (offset % kBitsPerWord)
+        bitmaps.append(tuple(words))
+    return tuple(bitmaps)
+
+def build_tables(chars):
+    """Returns the block index of each block of code points, and the distinct blocks."""
+    empty_block = make_block({}, 0)
+    blocks = [empty_block]
+    block_ids = {empty_block: 0}
+    index = []
+    for block_start in range(0, kMaxCodePoint, kBlockSize):
+        block = make_block(chars, block_start)
+        if block not in block_ids:
+            block_ids[block] = len(blocks)
+            blocks.append(block)
+        index.append(block_ids[block])
+    if len(blocks) > 256:
+        raise ValueError("too many distinct blocks for an 8-bit index: {}".format(len(blocks)))
+    return index, blocks
+
+def format_words(words):
+    return ", ".join("0x{:08x}".format(word) for word in words)
 
 license = """/*
  * Copyright (C) 2017 The Android Open Source Project
@@ -93,10 +98,22 @@ if __name__ == "__main__":
     for file_path in sys.argv[1:]:
         with open(file_path) as f:
             extract_unicode_properties(f, props, char_props)
-    result = flatten_unicode_properties(char_props)
-    print("{}\nconst static std::array<CharacterProperties, {}> sCharacterProperties = {}"
-            .format(license, len(result), "{{"))
-    for prop in result:
-        print("    {},".format(prop))
-    print("}};")
+    index, blocks = build_tables(char_props)
 
+    print(license)
+    print("// Generated by tools/extract_unicode_properties.py. Do not edit.\n")
+    print("const static std::array<uint8_t, {}> sPropertyBlockIndex = {}".format(
+            len(index), "{{"))
+    for i in range(0, len(index), 16):
+        print("    {},".format(", ".join(str(block) for block in index[i:i + 16])))
+    print("}};\n")
+
+    print("const static std::array<PropertyBlock, {}> sPropertyBlocks = {}".format(
+            len(blocks), "{{"))
+    for block in blocks:
+        bitmaps = []
+        for words in block:
+            bitmaps.append("{{{{{},\n       {}}}}}".format(
+                    format_words(words[:4]), format_words(words[4:])))
+        print("    {{{}}},".format(",\n     ".join(bitmaps)))
+    print("}};")
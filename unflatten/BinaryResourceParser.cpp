@@ -31,7 +31,9 @@
 #include "ResourceValues.h"
 #include "Source.h"
 #include "ValueVisitor.h"
+#include "process/WorkerContext.h"
 #include "unflatten/ResChunkPullParser.h"
+#include "util/ThreadPool.h"
 #include "util/Util.h"
 
 namespace aapt {
@@ -71,17 +73,61 @@ class ReferenceIdToNameVisitor : public ValueVisitor {
   const std::map<ResourceId, ResourceName>* mapping_;
 };
 
+// Moves the strings of values decoded on a worker thread into the table's string pool.
+class StringPoolMover : public ValueVisitor {
+ public:
+  using ValueVisitor::Visit;
+
+  explicit StringPoolMover(StringPool* pool) : pool_(pool) {
+  }
+
+  void Visit(RawString* str) override {
+    str->value = pool_->MakeRef(str->value);
+  }
+
+  void Visit(String* str) override {
+    str->value = pool_->MakeRef(str->value);
+  }
+
+  void Visit(StyledString* str) override {
+    str->value = pool_->MakeRef(str->value);
+  }
+
+  void Visit(FileReference* file) override {
+    file->path = pool_->MakeRef(file->path);
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(StringPoolMover);
+
+  StringPool* pool_;
+};
+
+// Returns the string at `idx` of `pool`. UTF-8 strings are returned in place, without copying
+// them out of the pool. UTF-16 strings are converted into `scratch`.
+StringPiece GetStringPiece(const ResStringPool& pool, size_t idx, std::string* scratch) {
+  size_t len;
+  const char* str = pool.string8At(idx, &len);
+  if (str != nullptr) {
+    return StringPiece(str, len);
+  }
+  *scratch = util::GetString(pool, idx);
+  return *scratch;
+}
+
 }  // namespace
 
 BinaryResourceParser::BinaryResourceParser(IAaptContext* context, ResourceTable* table,
                                            const Source& source, const void* data, size_t len,
-                                           io::IFileCollection* files)
+                                           io::IFileCollection* files,
+                                           const BinaryResourceParserOptions& options)
     : context_(context),
       table_(table),
       source_(source),
       data_(data),
       data_len_(len),
-      files_(files) {
+      files_(files),
+      options_(options) {
 }
 
 bool BinaryResourceParser::Parse() {
@@ -118,6 +164,44 @@ bool BinaryResourceParser::Parse() {
   return true;
 }
 
+bool BinaryResourceParser::ParseValuePool() {
+  ResChunkPullParser parser(data_, data_len_);
+  if (!ResChunkPullParser::IsGoodEvent(parser.Next()) ||
+      util::DeviceToHost16(parser.chunk()->type) != android::RES_TABLE_TYPE) {
+    context_->GetDiagnostics()->Error(DiagMessage(source_) << "corrupt resources.arsc");
+    return false;
+  }
+
+  const ResTable_header* table_header = ConvertTo<ResTable_header>(parser.chunk());
+  if (!table_header) {
+    context_->GetDiagnostics()->Error(DiagMessage(source_) << "corrupt ResTable_header chunk");
+    return false;
+  }
+
+  // The value string pool precedes the packages.
+  ResChunkPullParser table_parser(GetChunkData(&table_header->header),
+                                  GetChunkDataLen(&table_header->header));
+  while (ResChunkPullParser::IsGoodEvent(table_parser.Next())) {
+    if (util::DeviceToHost16(table_parser.chunk()->type) != android::RES_STRING_POOL_TYPE) {
+      continue;
+    }
+
+    value_pool_chunk_ = table_parser.chunk();
+    status_t err = value_pool_.setTo(table_parser.chunk(),
+                                     util::DeviceToHost32(table_parser.chunk()->size));
+    if (err != NO_ERROR) {
+      context_->GetDiagnostics()->Error(DiagMessage(source_)
+                                        << "corrupt string pool in ResTable: "
+                                        << value_pool_.getError());
+      return false;
+    }
+    return true;
+  }
+
+  context_->GetDiagnostics()->Error(DiagMessage(source_) << "missing string pool in ResTable");
+  return false;
+}
+
 /**
  * Parses the resource table, which contains all the packages, types, and
  * entries.
@@ -136,6 +220,7 @@ bool BinaryResourceParser::ParseTable(const ResChunk_header* chunk) {
     switch (util::DeviceToHost16(parser.chunk()->type)) {
       case android::RES_STRING_POOL_TYPE:
         if (value_pool_.getError() == NO_INIT) {
+          value_pool_chunk_ = parser.chunk();
           status_t err = value_pool_.setTo(
               parser.chunk(), util::DeviceToHost32(parser.chunk()->size));
           if (err != NO_ERROR) {
@@ -145,9 +230,11 @@ bool BinaryResourceParser::ParseTable(const ResChunk_header* chunk) {
             return false;
           }
 
-          // Reserve some space for the strings we are going to add.
-          table_->string_pool.HintWillAdd(value_pool_.size(),
-                                          value_pool_.styleCount());
+          // Reserve some space for the strings we are going to add, unless they are only held
+          // one type chunk at a time.
+          if (!options_.on_type_chunk) {
+            table_->string_pool.HintWillAdd(value_pool_.size(), value_pool_.styleCount());
+          }
         } else {
           context_->GetDiagnostics()->Warn(
               DiagMessage(source_) << "unexpected string pool in ResTable");
@@ -201,8 +288,13 @@ bool BinaryResourceParser::ParsePackage(const ResChunk_header* chunk) {
     package_name[i] = util::DeviceToHost16(package_header->name[i]);
   }
 
-  ResourceTablePackage* package = table_->CreatePackage(
-      util::Utf16ToUtf8(package_name), static_cast<uint8_t>(package_id));
+  const std::string package_name_utf8 = util::Utf16ToUtf8(package_name);
+  if (options_.package_filter && !options_.package_filter(package_name_utf8)) {
+    return true;
+  }
+
+  ResourceTablePackage* package =
+      table_->CreatePackage(package_name_utf8, static_cast<uint8_t>(package_id));
   if (!package) {
     context_->GetDiagnostics()->Error(
         DiagMessage(source_) << "incompatible package '" << package_name
@@ -214,6 +306,14 @@ bool BinaryResourceParser::ParsePackage(const ResChunk_header* chunk) {
   // clear the type and key pool in case they were set from a previous package.
   type_pool_.uninit();
   key_pool_.uninit();
+  type_pool_chunk_ = nullptr;
+  key_pool_chunk_ = nullptr;
+  key_names_.clear();
+
+  // Type chunks only depend on the string pools, so unless the table is streamed they are
+  // collected and decoded concurrently once the package has been scanned.
+  const bool concurrent = options_.max_threads != 1u && !options_.on_type_chunk;
+  std::vector<const ResChunk_header*> type_chunks;
 
   ResChunkPullParser parser(GetChunkData(&package_header->header),
                             GetChunkDataLen(&package_header->header));
@@ -221,6 +321,7 @@ bool BinaryResourceParser::ParsePackage(const ResChunk_header* chunk) {
     switch (util::DeviceToHost16(parser.chunk()->type)) {
       case android::RES_STRING_POOL_TYPE:
         if (type_pool_.getError() == NO_INIT) {
+          type_pool_chunk_ = parser.chunk();
           status_t err = type_pool_.setTo(
               parser.chunk(), util::DeviceToHost32(parser.chunk()->size));
           if (err != NO_ERROR) {
@@ -231,6 +332,7 @@ bool BinaryResourceParser::ParsePackage(const ResChunk_header* chunk) {
             return false;
           }
         } else if (key_pool_.getError() == NO_INIT) {
+          key_pool_chunk_ = parser.chunk();
           status_t err = key_pool_.setTo(
               parser.chunk(), util::DeviceToHost32(parser.chunk()->size));
           if (err != NO_ERROR) {
@@ -252,7 +354,9 @@ bool BinaryResourceParser::ParsePackage(const ResChunk_header* chunk) {
         break;
 
       case android::RES_TABLE_TYPE_TYPE:
-        if (!ParseType(package, parser.chunk())) {
+        if (concurrent) {
+          type_chunks.push_back(parser.chunk());
+        } else if (!ParseType(package, parser.chunk())) {
           return false;
         }
         break;
@@ -277,6 +381,15 @@ bool BinaryResourceParser::ParsePackage(const ResChunk_header* chunk) {
     return false;
   }
 
+  if (!type_chunks.empty() && !ParseTypesConcurrently(package, type_chunks)) {
+    return false;
+  }
+
+  if (options_.on_type_chunk) {
+    // Nothing was kept in the table.
+    return true;
+  }
+
   // Now go through the table and change local resource ID references to
   // symbolic references.
   ReferenceIdToNameVisitor visitor(&id_index_);
@@ -307,8 +420,14 @@ bool BinaryResourceParser::ParseTypeSpec(const ResChunk_header* chunk) {
   return true;
 }
 
-bool BinaryResourceParser::ParseType(const ResourceTablePackage* package,
-                                     const ResChunk_header* chunk) {
+bool BinaryResourceParser::ParseType(ResourceTablePackage* package, const ResChunk_header* chunk) {
+  TypeChunkEntries entries;
+  return DecodeType(*package, chunk, &entries) && AddEntries(package, &entries);
+}
+
+bool BinaryResourceParser::DecodeType(const ResourceTablePackage& package,
+                                      const ResChunk_header* chunk,
+                                      TypeChunkEntries* out_entries) {
   if (type_pool_.getError() != NO_ERROR) {
     context_->GetDiagnostics()->Error(DiagMessage(source_)
                                       << "missing type string pool");
@@ -350,6 +469,14 @@ bool BinaryResourceParser::ParseType(const ResourceTablePackage* package,
     return false;
   }
 
+  out_entries->type = *parsed_type;
+  out_entries->config = config;
+  if ((options_.type_filter && !options_.type_filter(*parsed_type)) ||
+      (options_.config_filter && !options_.config_filter(config))) {
+    out_entries->skipped = true;
+    return true;
+  }
+
   TypeVariant tv(type);
   for (auto it = tv.beginEntries(); it != tv.endEntries(); ++it) {
     const ResTable_entry* entry = *it;
@@ -357,25 +484,13 @@ bool BinaryResourceParser::ParseType(const ResourceTablePackage* package,
       continue;
     }
 
-    const ResourceName name(
-        package->name, *parsed_type,
-        util::GetString(key_pool_, util::DeviceToHost32(entry->key.index)));
+    const ResourceNameRef name(package.name, *parsed_type,
+                               GetKeyName(util::DeviceToHost32(entry->key.index)));
 
-    const ResourceId res_id(package->id.value(), type->id,
+    const ResourceId res_id(package.id.value(), type->id,
                             static_cast<uint16_t>(it.index()));
 
-    std::unique_ptr<Value> resource_value;
-    if (entry->flags & ResTable_entry::FLAG_COMPLEX) {
-      const ResTable_map_entry* mapEntry = static_cast<const ResTable_map_entry*>(entry);
-
-      // TODO(adamlesinski): Check that the entry count is valid.
-      resource_value = ParseMapEntry(name, config, mapEntry);
-    } else {
-      const Res_value* value =
-          (const Res_value*)((const uint8_t*)entry + util::DeviceToHost32(entry->size));
-      resource_value = ParseValue(name, config, *value);
-    }
-
+    std::unique_ptr<Value> resource_value = ParseEntry(name, config, entry);
     if (!resource_value) {
       context_->GetDiagnostics()->Error(
           DiagMessage(source_) << "failed to parse value for resource " << name
@@ -384,30 +499,144 @@ bool BinaryResourceParser::ParseType(const ResourceTablePackage* package,
       return false;
     }
 
-    if (!table_->AddResourceAllowMangled(name, res_id, config, {}, std::move(resource_value),
-                                         context_->GetDiagnostics())) {
+    out_entries->entries.push_back(
+        TypeChunkEntries::Entry{name, res_id, std::move(resource_value),
+                                (entry->flags & ResTable_entry::FLAG_PUBLIC) != 0});
+  }
+  return true;
+}
+
+bool BinaryResourceParser::AddEntries(ResourceTablePackage* package, TypeChunkEntries* entries) {
+  if (entries->skipped) {
+    return true;
+  }
+
+  for (TypeChunkEntries::Entry& entry : entries->entries) {
+    if (!table_->AddResourceAllowMangled(entry.name, entry.id, entries->config, {},
+                                         std::move(entry.value), context_->GetDiagnostics())) {
       return false;
     }
 
-    if ((entry->flags & ResTable_entry::FLAG_PUBLIC) != 0) {
+    if (entry.is_public) {
       Symbol symbol;
       symbol.state = SymbolState::kPublic;
       symbol.source = source_.WithLine(0);
-      if (!table_->SetSymbolStateAllowMangled(name, res_id, symbol, context_->GetDiagnostics())) {
+      if (!table_->SetSymbolStateAllowMangled(entry.name, entry.id, symbol,
+                                              context_->GetDiagnostics())) {
         return false;
       }
     }
 
+    if (options_.on_type_chunk) {
+      continue;
+    }
+
     // Add this resource name->id mapping to the index so
     // that we can resolve all ID references to name references.
-    auto cache_iter = id_index_.find(res_id);
+    auto cache_iter = id_index_.find(entry.id);
     if (cache_iter == id_index_.end()) {
-      id_index_.insert({res_id, name});
+      id_index_.insert({entry.id, entry.name.ToResourceName()});
+    }
+  }
+
+  if (options_.on_type_chunk) {
+    return StreamTypeChunk(package, entries->type, entries->config);
+  }
+  return true;
+}
+
+bool BinaryResourceParser::InitPoolsFrom(const BinaryResourceParser& parser) {
+  const std::pair<ResStringPool*, const ResChunk_header*> pools[] = {
+      {&value_pool_, parser.value_pool_chunk_},
+      {&type_pool_, parser.type_pool_chunk_},
+      {&key_pool_, parser.key_pool_chunk_},
+  };
+  for (const auto& pool : pools) {
+    if (pool.second != nullptr &&
+        pool.first->setTo(pool.second, util::DeviceToHost32(pool.second->size)) != NO_ERROR) {
+      return false;
     }
   }
   return true;
 }
 
+bool BinaryResourceParser::ParseTypesConcurrently(
+    ResourceTablePackage* package, const std::vector<const ResChunk_header*>& chunks) {
+  // Each worker decodes with a parser of its own, so that the lazily decoded key names and the
+  // interned strings are not shared between threads. The workers read the same string pools
+  // and intern into string pools of their own.
+  struct Worker {
+    explicit Worker(IAaptContext* parent) : context(parent) {
+    }
+
+    WorkerContext context;
+    ResourceTable table;
+    std::unique_ptr<BinaryResourceParser> parser;
+  };
+
+  ThreadPool thread_pool(options_.max_threads);
+  const size_t worker_count = std::min(chunks.size(), thread_pool.max_threads());
+  std::vector<std::unique_ptr<Worker>> workers;
+  for (size_t i = 0; i < worker_count; i++) {
+    std::unique_ptr<Worker> worker = util::make_unique<Worker>(context_);
+    worker->parser = util::make_unique<BinaryResourceParser>(
+        &worker->context, &worker->table, source_, data_, data_len_, files_, options_);
+    if (!worker->parser->InitPoolsFrom(*this)) {
+      return false;
+    }
+    workers.push_back(std::move(worker));
+  }
+
+  std::vector<TypeChunkEntries> chunk_entries(chunks.size());
+  std::vector<BufferedDiagnostics> chunk_diags(chunks.size());
+  std::unique_ptr<bool[]> results(new bool[chunks.size()]);
+  thread_pool.ForEach(worker_count, [&](size_t i) {
+    Worker* worker = workers[i].get();
+    for (size_t j = i; j < chunks.size(); j += worker_count) {
+      results[j] = worker->parser->DecodeType(*package, chunks[j], &chunk_entries[j]);
+      worker->context.GetDiagnostics()->ReplayTo(&chunk_diags[j]);
+    }
+  });
+
+  // Adding the entries in chunk order interns their strings in the table's string pool in the
+  // same order, and with the same contexts, as a serial parse.
+  StringPoolMover mover(&table_->string_pool);
+  for (size_t i = 0; i < chunks.size(); i++) {
+    chunk_diags[i].ReplayTo(context_->GetDiagnostics());
+    if (!results[i]) {
+      return false;
+    }
+
+    for (TypeChunkEntries::Entry& entry : chunk_entries[i].entries) {
+      entry.value->Accept(&mover);
+    }
+    if (!AddEntries(package, &chunk_entries[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool BinaryResourceParser::StreamTypeChunk(ResourceTablePackage* package, ResourceType type,
+                                           const ConfigDescription& config) {
+  auto iter = std::find_if(package->types.begin(), package->types.end(),
+                           [&](const std::unique_ptr<ResourceTableType>& t) -> bool {
+                             return t->type == type;
+                           });
+  if (iter == package->types.end()) {
+    // The chunk had no entries.
+    return true;
+  }
+
+  const bool result = options_.on_type_chunk(*package, iter->get(), config);
+  package->types.erase(iter);
+
+  // Let go of the interned strings too, so that they can be pruned.
+  value_refs_.clear();
+  table_->string_pool.Prune();
+  return result;
+}
+
 bool BinaryResourceParser::ParseLibrary(const ResChunk_header* chunk) {
   DynamicRefTable dynamic_ref_table;
   if (dynamic_ref_table.load(reinterpret_cast<const ResTable_lib_header*>(chunk)) != NO_ERROR) {
@@ -423,11 +652,82 @@ bool BinaryResourceParser::ParseLibrary(const ResChunk_header* chunk) {
   return true;
 }
 
+std::unique_ptr<Value> BinaryResourceParser::ParseEntry(const ResourceNameRef& name,
+                                                        const ConfigDescription& config,
+                                                        const ResTable_entry* entry) {
+  if (entry->flags & ResTable_entry::FLAG_COMPLEX) {
+    const ResTable_map_entry* mapEntry = static_cast<const ResTable_map_entry*>(entry);
+
+    // TODO(adamlesinski): Check that the entry count is valid.
+    return ParseMapEntry(name, config, mapEntry);
+  }
+
+  const Res_value* value =
+      (const Res_value*)((const uint8_t*)entry + util::DeviceToHost32(entry->size));
+  return ParseValue(name, config, *value);
+}
+
+void BinaryResourceParser::ClearDecodedStrings() {
+  key_names_.clear();
+  value_refs_.clear();
+}
+
+const std::string& BinaryResourceParser::GetKeyName(uint32_t index) {
+  if (key_names_.empty()) {
+    key_names_.resize(key_pool_.size());
+  }
+
+  if (index >= key_names_.size()) {
+    // An index out of range decodes to an empty name, as with util::GetString().
+    static const std::string empty;
+    return empty;
+  }
+
+  std::string& key_name = key_names_[index];
+  if (key_name.empty()) {
+    key_name = util::GetString(key_pool_, index);
+  }
+  return key_name;
+}
+
+std::unique_ptr<Item> BinaryResourceParser::ParseUnstyledString(ResourceType type,
+                                                                const ConfigDescription& config,
+                                                                uint32_t index) {
+  auto iter = value_refs_.find(index);
+  if (iter == value_refs_.end()) {
+    // Intern the string with the context ResourceUtils::ParseBinaryResValue() would give it.
+    std::string scratch;
+    const StringPiece str = GetStringPiece(value_pool_, index, &scratch);
+    const bool is_file = type != ResourceType::kString && util::StartsWith(str, "res/");
+    const StringPool::Context context =
+        is_file ? StringPool::Context(StringPool::Context::kHighPriority, config)
+                : StringPool::Context(config);
+    iter = value_refs_.insert({index, table_->string_pool.MakeRef(str, context)}).first;
+  }
+
+  const StringPool::Ref& ref = iter->second;
+  if (type != ResourceType::kString && util::StartsWith(*ref, "res/")) {
+    // This must be a FileReference.
+    return util::make_unique<FileReference>(ref);
+  }
+  return util::make_unique<String>(ref);
+}
+
 std::unique_ptr<Item> BinaryResourceParser::ParseValue(const ResourceNameRef& name,
                                                        const ConfigDescription& config,
                                                        const android::Res_value& value) {
-  std::unique_ptr<Item> item = ResourceUtils::ParseBinaryResValue(name.type, config, value_pool_,
-                                                                  value, &table_->string_pool);
+  std::unique_ptr<Item> item;
+  const uint32_t data = util::DeviceToHost32(value.data);
+  const ResStringPool_span* spans = value.dataType == Res_value::TYPE_STRING
+                                        ? value_pool_.styleAt(data)
+                                        : nullptr;
+  if (value.dataType == Res_value::TYPE_STRING && name.type != ResourceType::kId &&
+      (spans == nullptr || spans->name.index == ResStringPool_span::END)) {
+    item = ParseUnstyledString(name.type, config, data);
+  } else {
+    item = ResourceUtils::ParseBinaryResValue(name.type, config, value_pool_, value,
+                                              &table_->string_pool);
+  }
   if (files_ != nullptr && item != nullptr) {
     FileReference* file_ref = ValueCast<FileReference>(item.get());
     if (file_ref != nullptr) {
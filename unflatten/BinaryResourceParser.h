@@ -17,7 +17,10 @@
 #ifndef AAPT_BINARY_RESOURCE_PARSER_H
 #define AAPT_BINARY_RESOURCE_PARSER_H
 
+#include <functional>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "android-base/macros.h"
 #include "androidfw/ResourceTypes.h"
@@ -32,6 +35,28 @@ namespace aapt {
 
 struct SymbolTable_entry;
 
+struct BinaryResourceParserOptions {
+  // The maximum number of threads decoding the type chunks of a package. A value of 0 uses the
+  // number of hardware threads available. Streaming with on_type_chunk is always serial.
+  size_t max_threads = 0u;
+
+  // Chunks of packages, types and configurations rejected by these filters are skipped without
+  // decoding their entries. An unset filter accepts everything. The filters may be called from
+  // worker threads.
+  std::function<bool(const std::string& package_name)> package_filter;
+  std::function<bool(ResourceType type)> type_filter;
+  std::function<bool(const ConfigDescription& config)> config_filter;
+
+  // If set, the table is streamed instead of accumulated: this is called once the entries of
+  // each ResTable_type chunk have been added to the table, and the type is removed from the
+  // table again when it returns. Memory use is then bounded by the largest type chunk instead of
+  // the whole table. References are left as resource IDs, since resolving them to names requires
+  // an index of the whole table. Returning false stops parsing.
+  std::function<bool(const ResourceTablePackage& package, ResourceTableType* type,
+                     const ConfigDescription& config)>
+      on_type_chunk;
+};
+
 /*
  * Parses a binary resource table (resources.arsc) and adds the entries
  * to a ResourceTable. This is different than the libandroidfw ResTable
@@ -46,26 +71,89 @@ class BinaryResourceParser {
    * add any resources parsed to `table`. `source` is for logging purposes.
    */
   BinaryResourceParser(IAaptContext* context, ResourceTable* table, const Source& source,
-                       const void* data, size_t data_len, io::IFileCollection* files = nullptr);
+                       const void* data, size_t data_len, io::IFileCollection* files = nullptr,
+                       const BinaryResourceParserOptions& options = {});
 
   /*
    * Parses the binary resource table and returns true if successful.
    */
   bool Parse();
 
+  /*
+   * Reads only the value string pool of the table, so that single entries can be
+   * decoded with ParseEntry() without parsing the rest of the table.
+   */
+  bool ParseValuePool();
+
+  /*
+   * Decodes a single entry of a ResTable_type chunk of this table. Resource references
+   * are left as resource IDs. Returns nullptr if the entry could not be decoded.
+   */
+  std::unique_ptr<Value> ParseEntry(const ResourceNameRef& name, const ConfigDescription& config,
+                                    const android::ResTable_entry* entry);
+
+  /*
+   * Forgets the strings decoded by previous calls to ParseEntry(), so that the strings of the
+   * table's string pool that no value uses anymore can be pruned.
+   */
+  void ClearDecodedStrings();
+
  private:
   DISALLOW_COPY_AND_ASSIGN(BinaryResourceParser);
 
   bool ParseTable(const android::ResChunk_header* chunk);
   bool ParsePackage(const android::ResChunk_header* chunk);
   bool ParseTypeSpec(const android::ResChunk_header* chunk);
-  bool ParseType(const ResourceTablePackage* package,
-                 const android::ResChunk_header* chunk);
+  bool ParseType(ResourceTablePackage* package, const android::ResChunk_header* chunk);
+
+  // The entries decoded from a ResTable_type chunk, before they are added to the table.
+  struct TypeChunkEntries {
+    struct Entry {
+      ResourceNameRef name;
+      ResourceId id;
+      std::unique_ptr<Value> value;
+      bool is_public;
+    };
+
+    // Set if the chunk was rejected by the filters in the options.
+    bool skipped = false;
+
+    ResourceType type;
+    ConfigDescription config;
+    std::vector<Entry> entries;
+  };
+
+  // Decodes a ResTable_type chunk of `package` without modifying the table, apart from
+  // interning strings in its string pool.
+  bool DecodeType(const ResourceTablePackage& package, const android::ResChunk_header* chunk,
+                  TypeChunkEntries* out_entries);
+
+  bool AddEntries(ResourceTablePackage* package, TypeChunkEntries* entries);
+
+  // Points the string pools of this parser at the pools `parser` has read, for decoding type
+  // chunks on a worker thread.
+  bool InitPoolsFrom(const BinaryResourceParser& parser);
+
+  // Decodes the type chunks of `package` on worker threads, and then adds their entries in
+  // chunk order.
+  bool ParseTypesConcurrently(ResourceTablePackage* package,
+                              const std::vector<const android::ResChunk_header*>& chunks);
+
+  // Hands the entries just parsed from a type chunk to options_.on_type_chunk and removes them.
+  bool StreamTypeChunk(ResourceTablePackage* package, ResourceType type,
+                       const ConfigDescription& config);
   bool ParseLibrary(const android::ResChunk_header* chunk);
 
   std::unique_ptr<Item> ParseValue(const ResourceNameRef& name, const ConfigDescription& config,
                                    const android::Res_value& value);
 
+  // Parses an unstyled string of the value pool, interning it only the first time it is used.
+  std::unique_ptr<Item> ParseUnstyledString(ResourceType type, const ConfigDescription& config,
+                                            uint32_t index);
+
+  // Returns the name at `index` of the key pool, decoding it only the first time it is used.
+  const std::string& GetKeyName(uint32_t index);
+
   std::unique_ptr<Value> ParseMapEntry(const ResourceNameRef& name,
                                        const ConfigDescription& config,
                                        const android::ResTable_map_entry* map);
@@ -105,16 +193,30 @@ class BinaryResourceParser {
   // Optional file collection from which to create io::IFile objects.
   io::IFileCollection* files_;
 
+  BinaryResourceParserOptions options_;
+
   // The standard value string pool for resource values.
   android::ResStringPool value_pool_;
+  const android::ResChunk_header* value_pool_chunk_ = nullptr;
 
   // The string pool that holds the names of the types defined
   // in this table.
   android::ResStringPool type_pool_;
+  const android::ResChunk_header* type_pool_chunk_ = nullptr;
 
   // The string pool that holds the names of the entries defined
   // in this table.
   android::ResStringPool key_pool_;
+  const android::ResChunk_header* key_pool_chunk_ = nullptr;
+
+  // The entry names decoded from key_pool_, by index. Entry names are never empty, so an empty
+  // string is a name that has not been decoded yet. Entries of a type in different
+  // configurations share their names, which are decoded once instead of once per entry.
+  std::vector<std::string> key_names_;
+
+  // The strings of value_pool_ that have been interned in the table's string pool, by index.
+  // Values that share a string decode and look it up once instead of once per value.
+  std::unordered_map<uint32_t, StringPool::Ref> value_refs_;
 
   // A mapping of resource ID to resource name. When we finish parsing
   // we use this to convert all resource IDs to symbolic references.
@@ -0,0 +1,420 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "unflatten/BinaryTableIndex.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "unflatten/ResChunkPullParser.h"
+#include "util/Util.h"
+
+namespace aapt {
+
+using namespace android;
+
+std::unique_ptr<BinaryTableIndex> BinaryTableIndex::Create(IAaptContext* context,
+                                                           const Source& source, const void* data,
+                                                           size_t len) {
+  std::unique_ptr<BinaryTableIndex> index(new BinaryTableIndex(context, source, data, len));
+  if (!index->Index()) {
+    return {};
+  }
+  return index;
+}
+
+BinaryTableIndex::BinaryTableIndex(IAaptContext* context, const Source& source, const void* data,
+                                   size_t len)
+    : context_(context),
+      source_(source),
+      data_(data),
+      len_(len),
+      parser_(context, &table_, source, data, len) {
+}
+
+bool BinaryTableIndex::Index() {
+  if (!parser_.ParseValuePool()) {
+    return false;
+  }
+
+  // ParseValuePool() has checked the table header.
+  ResChunkPullParser parser(data_, len_);
+  parser.Next();
+  const ResTable_header* table_header = ConvertTo<ResTable_header>(parser.chunk());
+
+  ResChunkPullParser table_parser(GetChunkData(&table_header->header),
+                                  GetChunkDataLen(&table_header->header));
+  while (ResChunkPullParser::IsGoodEvent(table_parser.Next())) {
+    if (util::DeviceToHost16(table_parser.chunk()->type) == RES_TABLE_PACKAGE_TYPE) {
+      if (!IndexPackage(table_parser.chunk())) {
+        return false;
+      }
+    }
+  }
+
+  if (table_parser.event() == ResChunkPullParser::Event::kBadDocument) {
+    context_->GetDiagnostics()->Error(DiagMessage(source_) << "corrupt resource table: "
+                                                           << table_parser.error());
+    return false;
+  }
+  return true;
+}
+
+bool BinaryTableIndex::IndexPackage(const ResChunk_header* chunk) {
+  constexpr size_t kMinPackageSize =
+      sizeof(ResTable_package) - sizeof(ResTable_package::typeIdOffset);
+  const ResTable_package* package_header = ConvertTo<ResTable_package, kMinPackageSize>(chunk);
+  if (!package_header) {
+    context_->GetDiagnostics()->Error(DiagMessage(source_) << "corrupt ResTable_package chunk");
+    return false;
+  }
+
+  const uint32_t package_id = util::DeviceToHost32(package_header->id);
+  if (package_id > std::numeric_limits<uint8_t>::max()) {
+    context_->GetDiagnostics()->Error(DiagMessage(source_) << "package ID is too big ("
+                                                           << package_id << ")");
+    return false;
+  }
+
+  size_t len = strnlen16((const char16_t*)package_header->name, arraysize(package_header->name));
+  std::u16string package_name;
+  package_name.resize(len);
+  for (size_t i = 0; i < len; i++) {
+    package_name[i] = util::DeviceToHost16(package_header->name[i]);
+  }
+
+  std::unique_ptr<PackageChunks> package = util::make_unique<PackageChunks>();
+  package->name = util::Utf16ToUtf8(package_name);
+  package->id = static_cast<uint8_t>(package_id);
+
+  ResStringPool type_pool;
+  ResChunkPullParser parser(GetChunkData(&package_header->header),
+                            GetChunkDataLen(&package_header->header));
+  while (ResChunkPullParser::IsGoodEvent(parser.Next())) {
+    switch (util::DeviceToHost16(parser.chunk()->type)) {
+      case RES_STRING_POOL_TYPE: {
+        ResStringPool* pool = nullptr;
+        if (type_pool.getError() == NO_INIT) {
+          pool = &type_pool;
+        } else if (package->key_pool.getError() == NO_INIT) {
+          pool = &package->key_pool;
+        } else {
+          break;
+        }
+
+        if (pool->setTo(parser.chunk(), util::DeviceToHost32(parser.chunk()->size)) !=
+            NO_ERROR) {
+          context_->GetDiagnostics()->Error(DiagMessage(source_)
+                                            << "corrupt string pool in ResTable_package: "
+                                            << pool->getError());
+          return false;
+        }
+        break;
+      }
+
+      case RES_TABLE_TYPE_SPEC_TYPE: {
+        const ResTable_typeSpec* spec = ConvertTo<ResTable_typeSpec>(parser.chunk());
+        if (!spec ||
+            util::DeviceToHost16(spec->header.headerSize) +
+                    static_cast<uint64_t>(util::DeviceToHost32(spec->entryCount)) *
+                        sizeof(uint32_t) >
+                util::DeviceToHost32(spec->header.size)) {
+          context_->GetDiagnostics()->Error(DiagMessage(source_)
+                                            << "corrupt ResTable_typeSpec chunk");
+          return false;
+        }
+
+        TypeChunks* type = GetOrCreateType(package.get(), spec->id, type_pool);
+        if (!type) {
+          return false;
+        }
+        type->spec = spec;
+        break;
+      }
+
+      case RES_TABLE_TYPE_TYPE: {
+        const ResTable_type* type_chunk =
+            ConvertTo<ResTable_type, kResTableTypeMinSize>(parser.chunk());
+        if (!type_chunk) {
+          context_->GetDiagnostics()->Error(DiagMessage(source_)
+                                            << "corrupt ResTable_type chunk");
+          return false;
+        }
+
+        // Check the bounds of the offsets once here, so that lookups only need to check the
+        // bounds of the entry they read.
+        const size_t offset_size = (type_chunk->flags & ResTable_type::FLAG_SPARSE) != 0
+                                       ? sizeof(ResTable_sparseTypeEntry)
+                                       : sizeof(uint32_t);
+        const uint64_t offsets_end =
+            util::DeviceToHost16(type_chunk->header.headerSize) +
+            static_cast<uint64_t>(util::DeviceToHost32(type_chunk->entryCount)) * offset_size;
+        const uint32_t chunk_size = util::DeviceToHost32(type_chunk->header.size);
+        if (offsets_end > chunk_size ||
+            util::DeviceToHost32(type_chunk->entriesStart) > chunk_size) {
+          context_->GetDiagnostics()->Error(DiagMessage(source_)
+                                            << "corrupt ResTable_type chunk");
+          return false;
+        }
+
+        TypeChunks* type = GetOrCreateType(package.get(), type_chunk->id, type_pool);
+        if (!type) {
+          return false;
+        }
+        type->configs.push_back(type_chunk);
+        break;
+      }
+
+      default:
+        break;
+    }
+  }
+
+  if (parser.event() == ResChunkPullParser::Event::kBadDocument) {
+    context_->GetDiagnostics()->Error(DiagMessage(source_) << "corrupt ResTable_package: "
+                                                           << parser.error());
+    return false;
+  }
+
+  if (package->key_pool.getError() != NO_ERROR) {
+    context_->GetDiagnostics()->Error(DiagMessage(source_) << "missing key string pool");
+    return false;
+  }
+
+  packages_.push_back(std::move(package));
+  return true;
+}
+
+BinaryTableIndex::TypeChunks* BinaryTableIndex::GetOrCreateType(PackageChunks* package,
+                                                                uint8_t type_id,
+                                                                const ResStringPool& type_pool) {
+  if (type_id == 0) {
+    context_->GetDiagnostics()->Error(DiagMessage(source_) << "type chunk has invalid id 0");
+    return nullptr;
+  }
+
+  if (package->types.size() < type_id) {
+    package->types.resize(type_id);
+  }
+
+  std::unique_ptr<TypeChunks>& type = package->types[type_id - 1];
+  if (!type) {
+    if (type_pool.getError() != NO_ERROR) {
+      context_->GetDiagnostics()->Error(DiagMessage(source_) << "missing type string pool");
+      return nullptr;
+    }
+
+    const std::string type_str = util::GetString(type_pool, type_id - 1);
+    const ResourceType* parsed_type = ParseResourceType(type_str);
+    if (!parsed_type) {
+      context_->GetDiagnostics()->Error(DiagMessage(source_)
+                                        << "invalid type name '" << type_str
+                                        << "' for type with ID " << (int)type_id);
+      return nullptr;
+    }
+
+    type = util::make_unique<TypeChunks>();
+    type->type = *parsed_type;
+    type->id = type_id;
+  }
+  return type.get();
+}
+
+const ResTable_entry* BinaryTableIndex::FindEntry(const ResTable_type* type, uint16_t entry_id) {
+  const uint8_t* base = reinterpret_cast<const uint8_t*>(type);
+  const uint8_t* offsets = base + util::DeviceToHost16(type->header.headerSize);
+  const uint32_t entry_count = util::DeviceToHost32(type->entryCount);
+
+  uint32_t offset;
+  if ((type->flags & ResTable_type::FLAG_SPARSE) != 0) {
+    // The sparse entries are sorted by entry ID.
+    const ResTable_sparseTypeEntry* begin =
+        reinterpret_cast<const ResTable_sparseTypeEntry*>(offsets);
+    const ResTable_sparseTypeEntry* end = begin + entry_count;
+    const ResTable_sparseTypeEntry* iter = std::lower_bound(
+        begin, end, entry_id, [](const ResTable_sparseTypeEntry& e, uint16_t id) -> bool {
+          return util::DeviceToHost16(e.idx) < id;
+        });
+    if (iter == end || util::DeviceToHost16(iter->idx) != entry_id) {
+      return nullptr;
+    }
+    offset = static_cast<uint32_t>(util::DeviceToHost16(iter->offset)) * 4u;
+  } else {
+    if (entry_id >= entry_count) {
+      return nullptr;
+    }
+    offset = util::DeviceToHost32(reinterpret_cast<const uint32_t*>(offsets)[entry_id]);
+    if (offset == ResTable_type::NO_ENTRY) {
+      return nullptr;
+    }
+  }
+
+  // Make sure the entry and its value lie within the chunk.
+  const uint64_t chunk_size = util::DeviceToHost32(type->header.size);
+  const uint64_t entry_start = static_cast<uint64_t>(util::DeviceToHost32(type->entriesStart)) +
+                               offset;
+  if (entry_start + sizeof(ResTable_entry) > chunk_size) {
+    return nullptr;
+  }
+
+  const ResTable_entry* entry = reinterpret_cast<const ResTable_entry*>(base + entry_start);
+  uint64_t entry_end = entry_start + util::DeviceToHost16(entry->size);
+  if ((util::DeviceToHost16(entry->flags) & ResTable_entry::FLAG_COMPLEX) != 0) {
+    if (util::DeviceToHost16(entry->size) < sizeof(ResTable_map_entry)) {
+      return nullptr;
+    }
+    const ResTable_map_entry* map = static_cast<const ResTable_map_entry*>(entry);
+    entry_end += static_cast<uint64_t>(util::DeviceToHost32(map->count)) * sizeof(ResTable_map);
+  } else {
+    entry_end += sizeof(Res_value);
+  }
+  return entry_end <= chunk_size ? entry : nullptr;
+}
+
+Maybe<uint16_t> BinaryTableIndex::FindEntryId(const PackageChunks& package, TypeChunks* type,
+                                              const std::string& name) {
+  if (!type->entry_ids) {
+    type->entry_ids = util::make_unique<std::unordered_map<std::string, uint16_t>>();
+
+    uint32_t entry_count = 0;
+    for (const ResTable_type* type_chunk : type->configs) {
+      entry_count = std::max(entry_count, util::DeviceToHost32(type_chunk->entryCount));
+    }
+    if (type->spec) {
+      entry_count = std::max(entry_count, util::DeviceToHost32(type->spec->entryCount));
+    }
+    entry_count = std::min<uint32_t>(entry_count, std::numeric_limits<uint16_t>::max() + 1u);
+
+    // Not every configuration defines every entry, so look for each name until it is found.
+    std::vector<bool> found(entry_count);
+    for (const ResTable_type* type_chunk : type->configs) {
+      for (uint32_t i = 0; i < entry_count; i++) {
+        if (found[i]) {
+          continue;
+        }
+
+        const ResTable_entry* entry = FindEntry(type_chunk, static_cast<uint16_t>(i));
+        if (entry) {
+          found[i] = true;
+          type->entry_ids->insert(
+              {util::GetString(package.key_pool, util::DeviceToHost32(entry->key.index)),
+               static_cast<uint16_t>(i)});
+        }
+      }
+    }
+  }
+
+  auto iter = type->entry_ids->find(name);
+  if (iter == type->entry_ids->end()) {
+    return {};
+  }
+  return iter->second;
+}
+
+Maybe<BinaryTableIndex::Result> BinaryTableIndex::Lookup(const PackageChunks& package,
+                                                         const TypeChunks& type,
+                                                         uint16_t entry_id,
+                                                         const ConfigFilter& config_filter) {
+  // Drop the strings of the values returned by previous lookups that are gone. The parser
+  // reuses the strings it interned only within a lookup, so that it does not keep them alive.
+  parser_.ClearDecodedStrings();
+  table_.string_pool.Prune();
+
+  Result result;
+  result.id = ResourceId(package.id, type.id, entry_id);
+  if (type.spec && entry_id < util::DeviceToHost32(type.spec->entryCount)) {
+    const uint32_t* spec_flags = reinterpret_cast<const uint32_t*>(
+        reinterpret_cast<const uint8_t*>(type.spec) +
+        util::DeviceToHost16(type.spec->header.headerSize));
+    result.spec_flags = util::DeviceToHost32(spec_flags[entry_id]);
+  }
+
+  bool found = false;
+  for (const ResTable_type* type_chunk : type.configs) {
+    const ResTable_entry* entry = FindEntry(type_chunk, entry_id);
+    if (!entry) {
+      continue;
+    }
+
+    if (!found) {
+      found = true;
+      result.name = ResourceName(
+          package.name, type.type,
+          util::GetString(package.key_pool, util::DeviceToHost32(entry->key.index)));
+    }
+
+    ConfigDescription config;
+    config.copyFromDtoH(type_chunk->config);
+    if (config_filter && !config_filter(config)) {
+      continue;
+    }
+
+    std::unique_ptr<Value> value = parser_.ParseEntry(result.name, config, entry);
+    if (!value) {
+      context_->GetDiagnostics()->Error(DiagMessage(source_)
+                                        << "failed to parse value for resource " << result.name
+                                        << " (" << result.id << ") with configuration '"
+                                        << config << "'");
+      return {};
+    }
+    result.values.push_back(ConfigValue{config, std::move(value)});
+  }
+
+  if (!found) {
+    return {};
+  }
+  return std::move(result);
+}
+
+Maybe<BinaryTableIndex::Result> BinaryTableIndex::FindResource(ResourceId id,
+                                                               const ConfigFilter& config_filter) {
+  for (const std::unique_ptr<PackageChunks>& package : packages_) {
+    if (package->id != id.package_id() || id.type_id() == 0 ||
+        id.type_id() > package->types.size()) {
+      continue;
+    }
+
+    const TypeChunks* type = package->types[id.type_id() - 1].get();
+    if (type) {
+      return Lookup(*package, *type, id.entry_id(), config_filter);
+    }
+  }
+  return {};
+}
+
+Maybe<BinaryTableIndex::Result> BinaryTableIndex::FindResource(const ResourceNameRef& name,
+                                                               const ConfigFilter& config_filter) {
+  const std::string entry_name = name.entry.to_string();
+  for (const std::unique_ptr<PackageChunks>& package : packages_) {
+    if (!name.package.empty() && package->name != name.package) {
+      continue;
+    }
+
+    for (const std::unique_ptr<TypeChunks>& type : package->types) {
+      if (!type || type->type != name.type) {
+        continue;
+      }
+
+      Maybe<uint16_t> entry_id = FindEntryId(*package, type.get(), entry_name);
+      if (entry_id) {
+        return Lookup(*package, *type, entry_id.value(), config_filter);
+      }
+    }
+  }
+  return {};
+}
+
+}  // namespace aapt
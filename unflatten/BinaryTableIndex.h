@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AAPT_UNFLATTEN_BINARYTABLEINDEX_H
+#define AAPT_UNFLATTEN_BINARYTABLEINDEX_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "android-base/macros.h"
+#include "androidfw/ResourceTypes.h"
+
+#include "ConfigDescription.h"
+#include "Resource.h"
+#include "ResourceTable.h"
+#include "ResourceValues.h"
+#include "Source.h"
+#include "process/IResourceTableConsumer.h"
+#include "unflatten/BinaryResourceParser.h"
+#include "util/Maybe.h"
+
+namespace aapt {
+
+// Answers point queries against a binary resource table (resources.arsc) without parsing it.
+//
+// Creating the index only walks the chunk headers of the table, recording where the
+// ResTable_typeSpec and ResTable_type chunks of each type are. A lookup by ID then goes straight
+// to the entry through the offset array of each ResTable_type chunk, and only decodes the values
+// it returns. A lookup by name first maps the names of the type's entries to their IDs, once per
+// type.
+class BinaryTableIndex {
+ public:
+  using ConfigFilter = std::function<bool(const ConfigDescription& config)>;
+
+  struct ConfigValue {
+    ConfigDescription config;
+    std::unique_ptr<Value> value;
+  };
+
+  struct Result {
+    ResourceName name;
+    ResourceId id;
+
+    // The ResTable_typeSpec flags of the resource, such as SPEC_PUBLIC.
+    uint32_t spec_flags = 0;
+
+    // The values of the resource, in the order of the type chunks that define them. References
+    // are left as resource IDs.
+    std::vector<ConfigValue> values;
+  };
+
+  // Indexes the table held by `data`, which must outlive the index. Returns nullptr and logs to
+  // the context's diagnostics if the table is corrupt.
+  static std::unique_ptr<BinaryTableIndex> Create(IAaptContext* context, const Source& source,
+                                                  const void* data, size_t len);
+
+  // Looks up the resource with ID `id`, decoding only the values whose configuration passes
+  // `config_filter`, if set. Returns nothing if there is no such resource.
+  Maybe<Result> FindResource(ResourceId id, const ConfigFilter& config_filter = {});
+
+  // Looks up the resource named `name`. An empty package matches any package.
+  Maybe<Result> FindResource(const ResourceNameRef& name, const ConfigFilter& config_filter = {});
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(BinaryTableIndex);
+
+  struct TypeChunks {
+    ResourceType type;
+    uint8_t id = 0;
+    const android::ResTable_typeSpec* spec = nullptr;
+    std::vector<const android::ResTable_type*> configs;
+
+    // Maps the names of the entries to their IDs, built by the first lookup by name.
+    std::unique_ptr<std::unordered_map<std::string, uint16_t>> entry_ids;
+  };
+
+  struct PackageChunks {
+    std::string name;
+    uint8_t id = 0;
+    android::ResStringPool key_pool;
+
+    // Indexed by type ID - 1. Types that the table does not define are nullptr.
+    std::vector<std::unique_ptr<TypeChunks>> types;
+  };
+
+  BinaryTableIndex(IAaptContext* context, const Source& source, const void* data, size_t len);
+
+  bool Index();
+  bool IndexPackage(const android::ResChunk_header* chunk);
+  TypeChunks* GetOrCreateType(PackageChunks* package, uint8_t type_id,
+                              const android::ResStringPool& type_pool);
+
+  // Returns the entry `entry_id` of a ResTable_type chunk, or nullptr if the chunk does not
+  // define it.
+  const android::ResTable_entry* FindEntry(const android::ResTable_type* type,
+                                           uint16_t entry_id);
+
+  Maybe<uint16_t> FindEntryId(const PackageChunks& package, TypeChunks* type,
+                              const std::string& name);
+
+  Maybe<Result> Lookup(const PackageChunks& package, const TypeChunks& type, uint16_t entry_id,
+                       const ConfigFilter& config_filter);
+
+  IAaptContext* context_;
+  Source source_;
+  const void* data_;
+  size_t len_;
+
+  // Holds the strings of the decoded values.
+  ResourceTable table_;
+  BinaryResourceParser parser_;
+
+  std::vector<std::unique_ptr<PackageChunks>> packages_;
+};
+
+}  // namespace aapt
+
+#endif  // AAPT_UNFLATTEN_BINARYTABLEINDEX_H
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "unflatten/BinaryTableIndex.h"
+
+#include "SdkConstants.h"
+#include "flatten/TableFlattener.h"
+#include "test/Test.h"
+
+using ::testing::Eq;
+using ::testing::IsNull;
+using ::testing::NotNull;
+
+namespace aapt {
+
+class BinaryTableIndexTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    context_ = test::ContextBuilder()
+                   .SetCompilationPackage("com.app.test")
+                   .SetPackageId(0x7f)
+                   .SetMinSdkVersion(SDK_O)
+                   .Build();
+  }
+
+  std::unique_ptr<BinaryTableIndex> Index(ResourceTable* table,
+                                          const TableFlattenerOptions& options = {}) {
+    BigBuffer buffer(1024);
+    TableFlattener flattener(options, &buffer);
+    if (!flattener.Consume(context_.get(), table)) {
+      return {};
+    }
+    contents_ = buffer.to_string();
+    return BinaryTableIndex::Create(context_.get(), Source("test.arsc"), contents_.data(),
+                                    contents_.size());
+  }
+
+ protected:
+  std::unique_ptr<IAaptContext> context_;
+  std::string contents_;
+};
+
+static std::unique_ptr<ResourceTable> BuildTable() {
+  return test::ResourceTableBuilder()
+      .SetPackageId("com.app.test", 0x7f)
+      .AddString("com.app.test:string/app_name", ResourceId(0x7f020000), "App")
+      .AddString("com.app.test:string/app_name", ResourceId(0x7f020000),
+                 test::ParseConfigOrDie("fr"), "Appli")
+      .AddString("com.app.test:string/only_fr", ResourceId(0x7f020002),
+                 test::ParseConfigOrDie("fr"), "Seulement")
+      .AddValue("com.app.test:id/ref", ResourceId(0x7f010000),
+                test::BuildReference("com.app.test:string/app_name", ResourceId(0x7f020000)))
+      .SetSymbolState("com.app.test:string/app_name", ResourceId(0x7f020000),
+                      SymbolState::kPublic)
+      .Build();
+}
+
+TEST_F(BinaryTableIndexTest, FindResourceById) {
+  std::unique_ptr<ResourceTable> table = BuildTable();
+  std::unique_ptr<BinaryTableIndex> index = Index(table.get());
+  ASSERT_THAT(index, NotNull());
+
+  Maybe<BinaryTableIndex::Result> result = index->FindResource(ResourceId(0x7f020000));
+  ASSERT_TRUE(result);
+  EXPECT_THAT(result.value().name, Eq(test::ParseNameOrDie("com.app.test:string/app_name")));
+  EXPECT_NE(0u, result.value().spec_flags & android::ResTable_typeSpec::SPEC_PUBLIC);
+  ASSERT_EQ(2u, result.value().values.size());
+
+  EXPECT_EQ(ConfigDescription::DefaultConfig(), result.value().values[0].config);
+  String* str = ValueCast<String>(result.value().values[0].value.get());
+  ASSERT_THAT(str, NotNull());
+  EXPECT_EQ("App", *str->value);
+
+  EXPECT_EQ(test::ParseConfigOrDie("fr"), result.value().values[1].config);
+  str = ValueCast<String>(result.value().values[1].value.get());
+  ASSERT_THAT(str, NotNull());
+  EXPECT_EQ("Appli", *str->value);
+
+  // References are left as IDs.
+  result = index->FindResource(ResourceId(0x7f010000));
+  ASSERT_TRUE(result);
+  ASSERT_EQ(1u, result.value().values.size());
+  Reference* ref = ValueCast<Reference>(result.value().values[0].value.get());
+  ASSERT_THAT(ref, NotNull());
+  EXPECT_EQ(ResourceId(0x7f020000), ref->id.value_or_default({}));
+
+  EXPECT_FALSE(index->FindResource(ResourceId(0x7f020001)));
+  EXPECT_FALSE(index->FindResource(ResourceId(0x7f020003)));
+  EXPECT_FALSE(index->FindResource(ResourceId(0x7f090000)));
+  EXPECT_FALSE(index->FindResource(ResourceId(0x01020000)));
+}
+
+TEST_F(BinaryTableIndexTest, FindResourceByNameAndConfig) {
+  std::unique_ptr<ResourceTable> table = BuildTable();
+  std::unique_ptr<BinaryTableIndex> index = Index(table.get());
+  ASSERT_THAT(index, NotNull());
+
+  const ConfigDescription fr_config = test::ParseConfigOrDie("fr");
+  auto fr_only = [&](const ConfigDescription& config) -> bool { return config == fr_config; };
+
+  Maybe<BinaryTableIndex::Result> result =
+      index->FindResource(ResourceNameRef({}, ResourceType::kString, "app_name"), fr_only);
+  ASSERT_TRUE(result);
+  EXPECT_EQ(ResourceId(0x7f020000), result.value().id);
+  ASSERT_EQ(1u, result.value().values.size());
+  EXPECT_EQ(fr_config, result.value().values[0].config);
+
+  // An entry that only exists in a configuration other than the default one.
+  result = index->FindResource(test::ParseNameOrDie("com.app.test:string/only_fr"));
+  ASSERT_TRUE(result);
+  EXPECT_EQ(ResourceId(0x7f020002), result.value().id);
+  EXPECT_EQ(1u, result.value().values.size());
+
+  EXPECT_FALSE(index->FindResource(test::ParseNameOrDie("com.app.test:string/missing")));
+  EXPECT_FALSE(index->FindResource(test::ParseNameOrDie("com.other:string/app_name")));
+}
+
+TEST_F(BinaryTableIndexTest, FindResourceInSparseType) {
+  std::unique_ptr<ResourceTable> table = BuildTable();
+  TableFlattenerOptions options;
+  options.use_sparse_entries = true;
+  std::unique_ptr<BinaryTableIndex> index = Index(table.get(), options);
+  ASSERT_THAT(index, NotNull());
+
+  Maybe<BinaryTableIndex::Result> result = index->FindResource(ResourceId(0x7f020002));
+  ASSERT_TRUE(result);
+  EXPECT_THAT(result.value().name, Eq(test::ParseNameOrDie("com.app.test:string/only_fr")));
+  EXPECT_FALSE(index->FindResource(ResourceId(0x7f020001)));
+}
+
+TEST_F(BinaryTableIndexTest, ValuesOutliveLaterLookups) {
+  std::unique_ptr<ResourceTable> table = BuildTable();
+  std::unique_ptr<BinaryTableIndex> index = Index(table.get());
+  ASSERT_THAT(index, NotNull());
+
+  Maybe<BinaryTableIndex::Result> first = index->FindResource(ResourceId(0x7f020000));
+  ASSERT_TRUE(first);
+
+  // The strings of the values of the first lookup are only held by those values, which keep them
+  // from being pruned by the next lookups.
+  for (int i = 0; i < 2; i++) {
+    Maybe<BinaryTableIndex::Result> result = index->FindResource(ResourceId(0x7f020002));
+    ASSERT_TRUE(result);
+    ASSERT_EQ(1u, result.value().values.size());
+    String* str = ValueCast<String>(result.value().values[0].value.get());
+    ASSERT_THAT(str, NotNull());
+    EXPECT_EQ("Seulement", *str->value);
+  }
+
+  ASSERT_EQ(2u, first.value().values.size());
+  String* str = ValueCast<String>(first.value().values[1].value.get());
+  ASSERT_THAT(str, NotNull());
+  EXPECT_EQ("Appli", *str->value);
+
+  // Strings that were pruned are decoded again.
+  first = Maybe<BinaryTableIndex::Result>();
+  Maybe<BinaryTableIndex::Result> again = index->FindResource(ResourceId(0x7f020000));
+  ASSERT_TRUE(again);
+  ASSERT_EQ(2u, again.value().values.size());
+  str = ValueCast<String>(again.value().values[0].value.get());
+  ASSERT_THAT(str, NotNull());
+  EXPECT_EQ("App", *str->value);
+}
+
+TEST_F(BinaryTableIndexTest, RejectCorruptTable) {
+  std::unique_ptr<ResourceTable> table = BuildTable();
+  ASSERT_THAT(Index(table.get()), NotNull());
+
+  std::string truncated = contents_.substr(0, contents_.size() / 2);
+  EXPECT_THAT(BinaryTableIndex::Create(context_.get(), Source("test.arsc"), truncated.data(),
+                                       truncated.size()),
+              IsNull());
+}
+
+}  // namespace aapt
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AAPT_UTIL_DIGEST_H
+#define AAPT_UTIL_DIGEST_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "androidfw/StringPiece.h"
+
+namespace aapt {
+
+// Computes a 64-bit FNV-1a digest of the data fed to it. It is not cryptographically strong, but
+// it is fast and gives the same result on every run and platform, which is what is needed to tell
+// whether the inputs of a build step have changed.
+class Digest {
+ public:
+  Digest& Update(const void* data, size_t len) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; i++) {
+      value_ = (value_ ^ bytes[i]) * kPrime;
+    }
+    return *this;
+  }
+
+  Digest& Update(uint64_t value) {
+    for (size_t i = 0; i < sizeof(value); i++) {
+      value_ = (value_ ^ static_cast<uint8_t>(value >> (i * 8))) * kPrime;
+    }
+    return *this;
+  }
+
+  // The length is included, so that consecutive strings can't run into each other.
+  Digest& Update(const android::StringPiece& str) {
+    Update(static_cast<uint64_t>(str.size()));
+    return Update(str.data(), str.size());
+  }
+
+  uint64_t value() const {
+    return value_;
+  }
+
+ private:
+  static constexpr uint64_t kOffsetBasis = 0xcbf29ce484222325ull;
+  static constexpr uint64_t kPrime = 0x100000001b3ull;
+
+  uint64_t value_ = kOffsetBasis;
+};
+
+}  // namespace aapt
+
+#endif  // AAPT_UTIL_DIGEST_H
@@ -18,8 +18,10 @@
 
 #include <dirent.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <cstdio>
 #include <string>
@@ -27,6 +29,7 @@
 #include "android-base/errors.h"
 #include "android-base/file.h"
 #include "android-base/logging.h"
+#include "android-base/stringprintf.h"
 #include "android-base/unique_fd.h"
 #include "android-base/utf8.h"
 
@@ -40,7 +43,9 @@
 using ::android::FileMap;
 using ::android::StringPiece;
 using ::android::base::ReadFileToString;
+using ::android::base::StringPrintf;
 using ::android::base::SystemErrorCodeToString;
+using ::android::base::WriteStringToFd;
 using ::android::base::unique_fd;
 
 namespace aapt {
@@ -214,6 +219,72 @@ bool AppendArgsFromFile(const StringPiece& path, std::vector<std::string>* out_a
   return true;
 }
 
+// Creates a file next to `path` that no other process or thread writes to, like mkstemp(), which
+// is not available on Windows. Stale files left behind by an earlier process are skipped.
+static unique_fd CreateTemporaryFile(const std::string& path, std::string* out_tmp_path) {
+  static std::atomic<uint32_t> sTemporaryFileCount{0u};
+  const int flags = O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC | O_BINARY;
+  for (int attempt = 0; attempt < 100; attempt++) {
+    *out_tmp_path =
+        StringPrintf("%s.%d.%u.tmp", path.c_str(), static_cast<int>(getpid()),
+                     static_cast<unsigned int>(sTemporaryFileCount.fetch_add(1u)));
+    unique_fd fd(TEMP_FAILURE_RETRY(::android::base::utf8::open(out_tmp_path->c_str(), flags,
+                                                                0666)));
+    if (fd != -1 || errno != EEXIST) {
+      return fd;
+    }
+  }
+  return {};
+}
+
+bool WriteFileIfChanged(const std::string& path, const std::string& contents,
+                        std::string* out_error) {
+  std::string existing_contents;
+  if (GetFileType(path) == FileType::kRegular &&
+      ReadFileToString(path, &existing_contents, true /*follow_symlinks*/) &&
+      existing_contents == contents) {
+    return true;
+  }
+
+  // Concurrent writers of the same path each need their own temporary file.
+  std::string tmp_path;
+  unique_fd fd = CreateTemporaryFile(path, &tmp_path);
+  if (fd == -1) {
+    if (out_error) {
+      *out_error = SystemErrorCodeToString(errno);
+    }
+    return false;
+  }
+
+  int error = 0;
+  if (!WriteStringToFd(contents, fd)) {
+    error = errno;
+  }
+  if (close(fd.release()) != 0 && error == 0) {
+    error = errno;
+  }
+
+  if (error == 0) {
+#ifdef _WIN32
+    // rename() does not replace an existing file on Windows.
+    unlink(path.c_str());
+#endif
+    if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+      error = errno;
+    }
+  }
+
+  if (error != 0) {
+    // Cleaning up may change errno, so the error is saved first.
+    unlink(tmp_path.c_str());
+    if (out_error) {
+      *out_error = SystemErrorCodeToString(error);
+    }
+    return false;
+  }
+  return true;
+}
+
 bool FileFilter::SetPattern(const StringPiece& pattern) {
   pattern_tokens_ = util::SplitAndLowercase(pattern, ':');
   return true;
@@ -80,6 +80,14 @@ Maybe<android::FileMap> MmapPath(const std::string& path, std::string* out_error
 bool AppendArgsFromFile(const android::StringPiece& path, std::vector<std::string>* out_arglist,
                         std::string* out_error);
 
+// Writes `contents` to the file at `path`, unless the file already holds exactly these contents.
+// An unchanged file is left alone and keeps its modification time, so that build steps depending
+// on it are not rerun. Otherwise the contents are written to a unique temporary file in the same
+// directory which is renamed over `path`, so that readers never see a partially written file.
+// On Windows the existing file is deleted before the rename, so `path` briefly does not exist.
+bool WriteFileIfChanged(const std::string& path, const std::string& contents,
+                        std::string* out_error);
+
 // Filter that determines which resource files/directories are
 // processed by AAPT. Takes a pattern string supplied by the user.
 // Pattern format is specified in the FileFilter::SetPattern() method.
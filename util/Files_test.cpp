@@ -16,7 +16,13 @@
 
 #include "util/Files.h"
 
+#include <sys/stat.h>
+
 #include <sstream>
+#include <thread>
+
+#include "android-base/file.h"
+#include "android-base/test_utils.h"
 
 #include "test/Test.h"
 
@@ -55,5 +61,64 @@ TEST_F(FilesTest, AppendPathWithLeadingOrTrailingSeparators) {
   EXPECT_EQ(expected_path_, base);
 }
 
+static ino_t GetInode(const std::string& path) {
+  struct stat sb;
+  EXPECT_EQ(0, stat(path.c_str(), &sb));
+  return sb.st_ino;
+}
+
+TEST_F(FilesTest, WriteFileIfChanged) {
+  TemporaryDir dir;
+  std::string path = dir.path;
+  AppendPath(&path, "R.java");
+
+  std::string error;
+  ASSERT_TRUE(WriteFileIfChanged(path, "hello", &error)) << error;
+  std::string contents;
+  ASSERT_TRUE(::android::base::ReadFileToString(path, &contents));
+  EXPECT_EQ("hello", contents);
+
+  // The same contents leave the file in place.
+  const ino_t inode = GetInode(path);
+  ASSERT_TRUE(WriteFileIfChanged(path, "hello", &error)) << error;
+  EXPECT_EQ(inode, GetInode(path));
+
+  // New contents replace the file, leaving no temporary file behind.
+  ASSERT_TRUE(WriteFileIfChanged(path, "hello there", &error)) << error;
+  ASSERT_TRUE(::android::base::ReadFileToString(path, &contents));
+  EXPECT_EQ("hello there", contents);
+  Maybe<std::vector<std::string>> files = FindFiles(dir.path, test::GetDiagnostics());
+  ASSERT_TRUE(files);
+  EXPECT_THAT(files.value(), ::testing::ElementsAre("R.java"));
+}
+
+TEST_F(FilesTest, ConcurrentWriteFileIfChangedLeavesOneFile) {
+  TemporaryDir dir;
+  std::string path = dir.path;
+  AppendPath(&path, "R.java");
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([&path, i]() {
+      std::string error;
+      for (int j = 0; j < 20; j++) {
+        EXPECT_TRUE(WriteFileIfChanged(path, "contents " + std::to_string(i), &error)) << error;
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  std::string contents;
+  ASSERT_TRUE(::android::base::ReadFileToString(path, &contents));
+  EXPECT_THAT(contents, ::testing::StartsWith("contents "));
+
+  // Every temporary file was renamed over the output.
+  Maybe<std::vector<std::string>> files = FindFiles(dir.path, test::GetDiagnostics());
+  ASSERT_TRUE(files);
+  EXPECT_THAT(files.value(), ::testing::ElementsAre("R.java"));
+}
+
 }  // namespace files
 }  // namespace aapt
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aapt {
+
+namespace {
+
+// A batch of tasks shared between the thread that called ForEach() and its helpers.
+struct Batch {
+  Batch(size_t count, const std::function<bool(size_t)>& task, size_t max_helpers)
+      : count(count), task(task), max_helpers(max_helpers) {
+  }
+
+  // Runs tasks until there are none left to hand out.
+  void Run() {
+    size_t i;
+    while (!failed.load(std::memory_order_relaxed) && (i = next_index.fetch_add(1u)) < count) {
+      if (!task(i)) {
+        failed = true;
+      }
+    }
+  }
+
+  bool HasWork() const {
+    return !failed.load(std::memory_order_relaxed) &&
+           next_index.load(std::memory_order_relaxed) < count;
+  }
+
+  const size_t count;
+  const std::function<bool(size_t)>& task;
+  std::atomic<size_t> next_index{0u};
+  std::atomic<bool> failed{false};
+
+  // Guarded by Workers::lock_.
+  const size_t max_helpers;
+  size_t helpers = 0u;
+  size_t active_helpers = 0u;
+};
+
+// The threads shared by every ThreadPool. They are started on demand and live for the rest of
+// the process.
+class Workers {
+ public:
+  static Workers* Get() {
+    // Leaked on purpose, so that no thread is joined while static destructors run.
+    static Workers* workers = new Workers();
+    return workers;
+  }
+
+  // Runs `batch` on the calling thread and up to `batch->max_helpers` shared threads, and
+  // returns once every task that was handed out has returned.
+  void Run(Batch* batch) {
+    if (batch->max_helpers > 0u) {
+      std::lock_guard<std::mutex> guard(lock_);
+      EnsureThreads(batch->max_helpers);
+      batches_.push_back(batch);
+      work_available_.notify_all();
+    }
+
+    batch->Run();
+
+    if (batch->max_helpers > 0u) {
+      std::unique_lock<std::mutex> guard(lock_);
+      batches_.erase(std::find(batches_.begin(), batches_.end(), batch));
+      batch_done_.wait(guard, [&]() { return batch->active_helpers == 0u; });
+    }
+  }
+
+ private:
+  Workers() = default;
+
+  void EnsureThreads(size_t count) {
+    while (threads_started_ < count) {
+      std::thread(&Workers::Loop, this).detach();
+      threads_started_++;
+    }
+  }
+
+  // Returns the most recently started batch that wants help. Nested batches are started last,
+  // and finishing them first unblocks the tasks that are waiting on them.
+  Batch* FindBatch() const {
+    for (auto iter = batches_.rbegin(); iter != batches_.rend(); ++iter) {
+      if ((*iter)->helpers < (*iter)->max_helpers && (*iter)->HasWork()) {
+        return *iter;
+      }
+    }
+    return nullptr;
+  }
+
+  void Loop() {
+    std::unique_lock<std::mutex> guard(lock_);
+    while (true) {
+      Batch* batch = nullptr;
+      work_available_.wait(guard, [&]() { return (batch = FindBatch()) != nullptr; });
+      batch->helpers++;
+      batch->active_helpers++;
+
+      guard.unlock();
+      batch->Run();
+      guard.lock();
+
+      batch->active_helpers--;
+      if (batch->active_helpers == 0u) {
+        batch_done_.notify_all();
+      }
+    }
+  }
+
+  std::mutex lock_;
+  std::condition_variable work_available_;
+  std::condition_variable batch_done_;
+  std::vector<Batch*> batches_;
+  size_t threads_started_ = 0u;
+};
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t max_threads) : max_threads_(max_threads) {
+  if (max_threads_ == 0u) {
+    // hardware_concurrency() may return 0 if the value is not computable.
+    max_threads_ = std::max(1u, std::thread::hardware_concurrency());
+  }
+}
+
+void ThreadPool::ForEach(size_t count, const std::function<void(size_t)>& task) {
+  ForEachUntilFailure(count, [&](size_t i) -> bool {
+    task(i);
+    return true;
+  });
+}
+
+bool ThreadPool::ForEachUntilFailure(size_t count, const std::function<bool(size_t)>& task) {
+  // The calling thread is one of the workers.
+  const size_t max_helpers = std::min(count, max_threads_) - (count > 0u ? 1u : 0u);
+  Batch batch(count, task, max_helpers);
+  Workers::Get()->Run(&batch);
+  return !batch.failed;
+}
+
+}  // namespace aapt
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AAPT_UTIL_THREADPOOL_H
+#define AAPT_UTIL_THREADPOOL_H
+
+#include <cstddef>
+#include <functional>
+
+#include "android-base/macros.h"
+
+namespace aapt {
+
+// Runs batches of independent tasks on a bounded number of threads.
+//
+// Tasks are handed out in index order, but may complete in any order. Callers that need
+// deterministic output should have each task write into its own slot and combine the results
+// once ForEach() returns.
+//
+// Every ThreadPool draws its helpers from one set of threads shared by the whole process, which
+// are started once and kept for later batches. A task may itself use a ThreadPool: the nested
+// batch runs on the task's thread and whichever shared threads are idle, so nesting never
+// creates more threads.
+class ThreadPool {
+ public:
+  // Creates a pool that runs at most `max_threads` tasks at the same time. A value of 0 uses the
+  // number of hardware threads available.
+  explicit ThreadPool(size_t max_threads = 0u);
+
+  size_t max_threads() const {
+    return max_threads_;
+  }
+
+  // Invokes `task(i)` for every i in [0, count) and blocks until all of them have returned.
+  // The calling thread runs tasks as well, so a pool of one thread runs everything serially.
+  void ForEach(size_t count, const std::function<void(size_t)>& task);
+
+  // Like ForEach(), but stops handing out tasks once one of them returns false. Tasks already
+  // running are allowed to finish. Since tasks are handed out in index order, every task before
+  // the first failing one has run. Returns false if any task failed.
+  bool ForEachUntilFailure(size_t count, const std::function<bool(size_t)>& task);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+
+  size_t max_threads_;
+};
+
+}  // namespace aapt
+
+#endif /* AAPT_UTIL_THREADPOOL_H */
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/ThreadPool.h"
+
+#include <atomic>
+#include <vector>
+
+#include "test/Test.h"
+
+using ::testing::Each;
+using ::testing::Eq;
+
+namespace aapt {
+
+TEST(ThreadPoolTest, RunsEveryTaskOnce) {
+  ThreadPool pool(4u);
+  std::vector<int> runs(100u, 0);
+  pool.ForEach(runs.size(), [&](size_t i) { runs[i]++; });
+  EXPECT_THAT(runs, Each(Eq(1)));
+}
+
+TEST(ThreadPoolTest, SingleThreadRunsTasksInOrder) {
+  ThreadPool pool(1u);
+  std::vector<size_t> order;
+  pool.ForEach(5u, [&](size_t i) { order.push_back(i); });
+  EXPECT_THAT(order, Eq(std::vector<size_t>{0u, 1u, 2u, 3u, 4u}));
+}
+
+TEST(ThreadPoolTest, NoTasks) {
+  ThreadPool pool;
+  EXPECT_GE(pool.max_threads(), 1u);
+  pool.ForEach(0u, [](size_t) { FAIL(); });
+}
+
+TEST(ThreadPoolTest, NestedPoolsRunEveryTaskOnce) {
+  ThreadPool outer(4u);
+  std::vector<std::vector<int>> runs(8u, std::vector<int>(50u, 0));
+  outer.ForEach(runs.size(), [&](size_t i) {
+    ThreadPool inner(4u);
+    inner.ForEach(runs[i].size(), [&](size_t j) { runs[i][j]++; });
+  });
+
+  for (const std::vector<int>& inner_runs : runs) {
+    EXPECT_THAT(inner_runs, Each(Eq(1)));
+  }
+}
+
+TEST(ThreadPoolTest, StopAfterFailure) {
+  ThreadPool pool(1u);
+  std::vector<size_t> order;
+  EXPECT_FALSE(pool.ForEachUntilFailure(5u, [&](size_t i) -> bool {
+    order.push_back(i);
+    return i != 2u;
+  }));
+  EXPECT_THAT(order, Eq(std::vector<size_t>{0u, 1u, 2u}));
+}
+
+TEST(ThreadPoolTest, TasksBeforeFailureRun) {
+  ThreadPool pool(4u);
+  std::vector<std::atomic<bool>> ran(200u);
+  for (std::atomic<bool>& r : ran) {
+    r = false;
+  }
+
+  EXPECT_FALSE(pool.ForEachUntilFailure(ran.size(), [&](size_t i) -> bool {
+    ran[i] = true;
+    return i != 100u;
+  }));
+  for (size_t i = 0; i <= 100u; i++) {
+    EXPECT_TRUE(ran[i]);
+  }
+  EXPECT_TRUE(pool.ForEachUntilFailure(10u, [](size_t) -> bool { return true; }));
+}
+
+}  // namespace aapt
@@ -17,6 +17,7 @@
 #include "util/Util.h"
 
 #include <algorithm>
+#include <cstring>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -431,8 +432,8 @@ StringBuilder& StringBuilder::Append(const StringPiece& str) {
   }
 
   // Accumulate the added string's UTF-16 length.
-  ssize_t len = utf8_to_utf16_length(reinterpret_cast<const uint8_t*>(str_.data()) + new_data_index,
-                                     str_.size() - new_data_index);
+  ssize_t len = Utf8ToUtf16Length(
+      StringPiece(str_.data() + new_data_index, str_.size() - new_data_index));
   if (len < 0) {
     error_ = "invalid unicode code point";
     return *this;
@@ -441,29 +442,201 @@ StringBuilder& StringBuilder::Append(const StringPiece& str) {
   return *this;
 }
 
+// Returns the number of ASCII characters `data` starts with. Eight bytes are checked at a time,
+// since most strings in resource tables are ASCII.
+static size_t AsciiPrefixLength(const char* data, size_t len) {
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data + i, sizeof(word));
+    if ((word & UINT64_C(0x8080808080808080)) != 0) {
+      break;
+    }
+  }
+
+  while (i < len && (static_cast<uint8_t>(data[i]) & 0x80u) == 0) {
+    i++;
+  }
+  return i;
+}
+
+// Same as AsciiPrefixLength(), for UTF-16. Four code units are checked at a time.
+static size_t AsciiPrefixLength(const char16_t* data, size_t len) {
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) / sizeof(char16_t) <= len; i += sizeof(uint64_t) / sizeof(char16_t)) {
+    uint64_t word;
+    memcpy(&word, data + i, sizeof(word));
+    if ((word & UINT64_C(0xff80ff80ff80ff80)) != 0) {
+      break;
+    }
+  }
+
+  while (i < len && data[i] < 0x80u) {
+    i++;
+  }
+  return i;
+}
+
+// The transcoders below handle malformed input the same way as the ones in libutils, so that the
+// strings written to and read from binary string pools do not change.
+
+// Returns the number of bytes of the UTF-8 sequence starting with `lead`. Continuation bytes count
+// as sequences of one byte.
+static size_t Utf8SequenceLength(uint8_t lead) {
+  return ((0xe5000000u >> ((lead >> 3) & 0x1eu)) & 3u) + 1u;
+}
+
+static char32_t DecodeUtf8Sequence(const uint8_t* data, size_t len) {
+  static const uint8_t kLeadMasks[] = {0x00, 0xff, 0x1f, 0x0f, 0x07};
+  char32_t codepoint = data[0] & kLeadMasks[len];
+  for (size_t i = 1; i < len; i++) {
+    codepoint = (codepoint << 6) | (data[i] & 0x3fu);
+  }
+  return codepoint;
+}
+
+// Returns the number of bytes `codepoint` takes in UTF-8. Unpaired surrogates and values beyond
+// the last code point take none, and are dropped.
+static size_t Utf8EncodedLength(char32_t codepoint) {
+  if (codepoint < 0x80u) {
+    return 1u;
+  } else if (codepoint < 0x800u) {
+    return 2u;
+  } else if (codepoint < 0x10000u) {
+    return (codepoint < 0xd800u || codepoint > 0xdfffu) ? 3u : 0u;
+  } else if (codepoint <= 0x10ffffu) {
+    return 4u;
+  }
+  return 0u;
+}
+
+static char* EncodeUtf8(char32_t codepoint, size_t len, char* out) {
+  static const uint8_t kLeadMarks[] = {0x00, 0x00, 0xc0, 0xe0, 0xf0};
+  for (size_t i = len; i > 1; i--) {
+    out[i - 1] = static_cast<char>((codepoint & 0x3fu) | 0x80u);
+    codepoint >>= 6;
+  }
+  if (len != 0) {
+    out[0] = static_cast<char>(codepoint | kLeadMarks[len]);
+  }
+  return out + len;
+}
+
+// Reads the code point at `*i` of a UTF-16 string, combining surrogate pairs.
+static char32_t DecodeUtf16(const char16_t* data, size_t len, size_t* i) {
+  const char16_t unit = data[(*i)++];
+  if ((unit & 0xfc00u) == 0xd800u && *i < len && (data[*i] & 0xfc00u) == 0xdc00u) {
+    const char16_t trail = data[(*i)++];
+    return (static_cast<char32_t>(unit - 0xd800u) << 10 | (trail - 0xdc00u)) + 0x10000u;
+  }
+  return unit;
+}
+
+ssize_t Utf8ToUtf16Length(const StringPiece& utf8) {
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(utf8.data());
+  const size_t len = utf8.size();
+  size_t utf16_len = 0;
+  size_t i = 0;
+  while (i < len) {
+    if (data[i] < 0x80u) {
+      const size_t ascii_len = AsciiPrefixLength(utf8.data() + i, len - i);
+      utf16_len += ascii_len;
+      i += ascii_len;
+      continue;
+    }
+
+    const size_t sequence_len = Utf8SequenceLength(data[i]);
+    if (sequence_len > len - i) {
+      return -1;
+    }
+    utf16_len += DecodeUtf8Sequence(data + i, sequence_len) > 0xffffu ? 2u : 1u;
+    i += sequence_len;
+  }
+  return utf16_len;
+}
+
 std::u16string Utf8ToUtf16(const StringPiece& utf8) {
-  ssize_t utf16_length = utf8_to_utf16_length(
-      reinterpret_cast<const uint8_t*>(utf8.data()), utf8.length());
+  const ssize_t utf16_length = Utf8ToUtf16Length(utf8);
   if (utf16_length <= 0) {
     return {};
   }
 
   std::u16string utf16;
   utf16.resize(utf16_length);
-  utf8_to_utf16(reinterpret_cast<const uint8_t*>(utf8.data()), utf8.length(),
-                &*utf16.begin(), utf16_length + 1);
+  char16_t* out = &*utf16.begin();
+
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(utf8.data());
+  const size_t len = utf8.size();
+  size_t i = 0;
+  while (i < len) {
+    if (data[i] < 0x80u) {
+      const size_t ascii_len = AsciiPrefixLength(utf8.data() + i, len - i);
+      out = std::copy(data + i, data + i + ascii_len, out);
+      i += ascii_len;
+      continue;
+    }
+
+    // The length was checked above, so every sequence is complete.
+    const size_t sequence_len = Utf8SequenceLength(data[i]);
+    char32_t codepoint = DecodeUtf8Sequence(data + i, sequence_len);
+    if (codepoint <= 0xffffu) {
+      *out++ = static_cast<char16_t>(codepoint);
+    } else {
+      codepoint -= 0x10000u;
+      *out++ = static_cast<char16_t>((codepoint >> 10) + 0xd800u);
+      *out++ = static_cast<char16_t>((codepoint & 0x3ffu) + 0xdc00u);
+    }
+    i += sequence_len;
+  }
   return utf16;
 }
 
+ssize_t Utf16ToUtf8Length(const StringPiece16& utf16) {
+  const char16_t* data = utf16.data();
+  const size_t len = utf16.size();
+  if (len == 0) {
+    return -1;
+  }
+
+  size_t utf8_len = 0;
+  size_t i = 0;
+  while (i < len) {
+    if (data[i] < 0x80u) {
+      const size_t ascii_len = AsciiPrefixLength(data + i, len - i);
+      utf8_len += ascii_len;
+      i += ascii_len;
+      continue;
+    }
+    utf8_len += Utf8EncodedLength(DecodeUtf16(data, len, &i));
+  }
+  return utf8_len;
+}
+
 std::string Utf16ToUtf8(const StringPiece16& utf16) {
-  ssize_t utf8_length = utf16_to_utf8_length(utf16.data(), utf16.length());
+  const ssize_t utf8_length = Utf16ToUtf8Length(utf16);
   if (utf8_length <= 0) {
     return {};
   }
 
   std::string utf8;
   utf8.resize(utf8_length);
-  utf16_to_utf8(utf16.data(), utf16.length(), &*utf8.begin(), utf8_length + 1);
+  char* out = &*utf8.begin();
+
+  const char16_t* data = utf16.data();
+  const size_t len = utf16.size();
+  size_t i = 0;
+  while (i < len) {
+    if (data[i] < 0x80u) {
+      const size_t ascii_len = AsciiPrefixLength(data + i, len - i);
+      out = std::transform(data + i, data + i + ascii_len, out,
+                           [](char16_t c) -> char { return static_cast<char>(c); });
+      i += ascii_len;
+      continue;
+    }
+
+    const char32_t codepoint = DecodeUtf16(data, len, &i);
+    out = EncodeUtf8(codepoint, Utf8EncodedLength(codepoint), out);
+  }
   return utf8;
 }
 
@@ -210,6 +210,18 @@ inline StringBuilder::operator bool() const { return error_.empty(); }
 std::u16string Utf8ToUtf16(const android::StringPiece& utf8);
 std::string Utf16ToUtf8(const android::StringPiece16& utf16);
 
+/**
+ * Returns the length of `utf8` in UTF16 code units, or -1 if it ends in
+ * the middle of a character.
+ */
+ssize_t Utf8ToUtf16Length(const android::StringPiece& utf8);
+
+/**
+ * Returns the length of `utf16` in UTF8 bytes, or -1 if it is empty.
+ * Unpaired surrogates are dropped.
+ */
+ssize_t Utf16ToUtf8Length(const android::StringPiece16& utf16);
+
 /**
  * Writes the entire BigBuffer to the output stream.
  */
@@ -174,4 +174,49 @@ TEST(UtilTest, VerifyJavaStringFormat) {
   ASSERT_FALSE(util::VerifyJavaStringFormat("%09f %08s"));
 }
 
+TEST(UtilTest, Utf8ToUtf16) {
+  EXPECT_THAT(util::Utf8ToUtf16(""), Eq(u""));
+  EXPECT_THAT(util::Utf8ToUtf16("hello, world and everyone in it"),
+              Eq(u"hello, world and everyone in it"));
+  EXPECT_THAT(util::Utf8ToUtf16("caf\xc3\xa9 au lait"), Eq(u"caf\u00e9 au lait"));
+  EXPECT_THAT(util::Utf8ToUtf16("\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e"), Eq(u"\u65e5\u672c\u8a9e"));
+  EXPECT_THAT(util::Utf8ToUtf16("\xd9\x85\xd8\xb1\xd8\xad\xd8\xa8\xd8\xa7"),
+              Eq(u"\u0645\u0631\u062d\u0628\u0627"));
+  EXPECT_THAT(util::Utf8ToUtf16("hi \xf0\x9f\x98\x80!"), Eq(u"hi \U0001f600!"));
+
+  // A character cut off at the end of the string makes the whole string invalid.
+  EXPECT_THAT(util::Utf8ToUtf16("truncated \xe6\x97"), Eq(u""));
+}
+
+TEST(UtilTest, Utf8ToUtf16Length) {
+  EXPECT_THAT(util::Utf8ToUtf16Length(""), Eq(0));
+  EXPECT_THAT(util::Utf8ToUtf16Length("0123456789abcdefghij"), Eq(20));
+  EXPECT_THAT(util::Utf8ToUtf16Length("\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e"), Eq(3));
+  EXPECT_THAT(util::Utf8ToUtf16Length("\xf0\x9f\x98\x80"), Eq(2));
+  EXPECT_THAT(util::Utf8ToUtf16Length("abcdefgh\xf0\x9f\x98"), Eq(-1));
+}
+
+TEST(UtilTest, Utf16ToUtf8) {
+  EXPECT_THAT(util::Utf16ToUtf8(u""), Eq(""));
+  EXPECT_THAT(util::Utf16ToUtf8(u"hello, world and everyone in it"),
+              Eq("hello, world and everyone in it"));
+  EXPECT_THAT(util::Utf16ToUtf8(u"\u65e5\u672c\u8a9e and \u0645\u0631\u062d\u0628\u0627"),
+              Eq("\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e and "
+                 "\xd9\x85\xd8\xb1\xd8\xad\xd8\xa8\xd8\xa7"));
+  EXPECT_THAT(util::Utf16ToUtf8(u"hi \U0001f600!"), Eq("hi \xf0\x9f\x98\x80!"));
+
+  // Unpaired surrogates are dropped.
+  const char16_t lone_surrogates[] = {u'a', 0xd83d, u'b', 0xde00, 0};
+  EXPECT_THAT(util::Utf16ToUtf8(lone_surrogates), Eq("ab"));
+}
+
+TEST(UtilTest, Utf8Utf16RoundTrip) {
+  const std::string str =
+      "Mixed ASCII text, \xe4\xb8\xad\xe6\x96\x87, \xd8\xb9\xd8\xb1\xd8\xa8\xd9\x8a "
+      "and \xf0\x9f\x8e\x89\xf0\x9f\x91\x8d across word boundaries";
+  const std::u16string str16 = util::Utf8ToUtf16(str);
+  EXPECT_THAT(static_cast<ssize_t>(str16.size()), Eq(util::Utf8ToUtf16Length(str)));
+  EXPECT_THAT(util::Utf16ToUtf8(str16), Eq(str));
+}
+
 }  // namespace aapt